@@ -0,0 +1,72 @@
+#include "cten.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Parameter updates per second of one fused Adam (or AdamW) step over a flat model (100M parameters by default,
+// split into equal tensors), for 1, 2, 4, ... worker threads. Needs about 2 GB at the default size.
+
+enum MemoryPoolIds {
+    PoolId_Model = 1,
+    PoolId_Optimizer = 2,
+};
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double bench(optim_adam* optimizer, int n_iters) {
+    optim_adam_step(optimizer);  // warm-up, touches every page
+    double start = now_seconds();
+    for(int it = 0; it < n_iters; it++) {
+        optim_adam_step(optimizer);
+    }
+    return (now_seconds() - start) / n_iters;
+}
+
+int main(int argc, char** argv) {
+    long long n_total = argc > 1 ? atoll(argv[1]) : 100000000LL;
+    int n_tensors = argc > 2 ? atoi(argv[2]) : 100;
+    int n_iters = argc > 3 ? atoi(argv[3]) : 10;
+    int max_threads = argc > 4 ? atoi(argv[4]) : 8;
+    bool decoupled = argc > 5 && strcmp(argv[5], "adamw") == 0;
+    int numel = (int)(n_total / n_tensors);
+
+    cten_initilize();
+
+    cten_begin_malloc(PoolId_Model);
+    Tensor* params = malloc(sizeof(Tensor) * n_tensors);
+    for(int i = 0; i < n_tensors; i++) {
+        params[i] = Tensor_zeros((TensorShape){numel}, true);
+    }
+    cten_end_malloc();
+
+    cten_begin_malloc(PoolId_Optimizer);
+    optim_adam* optimizer = decoupled ? optim_adamw_new(n_tensors, params, 1e-3f, 0.9f, 0.999f, 1e-8f, 0.01f)
+                                      : optim_adam_new(n_tensors, params, 1e-3f, 0.9f, 0.999f, 1e-8f, 0.01f);
+    cten_end_malloc();
+    // some non-zero gradient so the loop does real work
+    for(int i = 0; i < n_tensors; i++) {
+        for(int j = 0; j < numel; j++) params[i].node->grad.data->flex[j] = (float)(j % 7) * 0.01f - 0.03f;
+    }
+
+    double n = (double)numel * n_tensors;
+    printf("%s: %d tensors x %d = %.1fM parameters, %d steps\n", decoupled ? "adamw" : "adam", n_tensors, numel,
+           n / 1e6, n_iters);
+    printf("%8s %12s %14s\n", "threads", "step ms", "updates/s");
+    for(int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+        cten_set_num_threads(n_threads);
+        double t = bench(optimizer, n_iters);
+        printf("%8d %12.2f %14.3e\n", n_threads, t * 1e3, n / t);
+    }
+    cten_set_num_threads(1);
+
+    cten_free(PoolId_Optimizer);
+    cten_free(PoolId_Model);
+    free(params);
+    cten_finalize();
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "cten.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// CSV parsing throughput in MB/s: the streaming cten_csv reader vs. fgets + strtod per field, on a
+// synthetic file of n_features float columns and an integer label (default 64 MB, 32 features).
+
+#define BENCH_FILE "bench_csv.tmp.csv"
+
+enum MemoryPoolIds {
+    PoolId_Default = 0,
+};
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long write_dataset(long target_bytes, int n_features) {
+    FILE* fp = fopen(BENCH_FILE, "wb");
+    if(fp == NULL) return -1;
+    unsigned state = 12345;
+    for(long row = 0; ftell(fp) < target_bytes; row++) {
+        for(int c = 0; c < n_features; c++) {
+            state = state * 1664525u + 1013904223u;
+            fprintf(fp, "%.6g,", (float)(state >> 8) / (1 << 24) * 20.0f - 10.0f);
+        }
+        fprintf(fp, "%ld\n", row % 10);
+    }
+    long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+static double run_cten(int n_features, long* n_rows) {
+    cten_begin_malloc(PoolId_Default);
+    double start = now_seconds();
+    cten_csv* csv = cten_csv_open(BENCH_FILE, ',', false, -1);
+    Tensor X = Tensor_new((TensorShape){4096, n_features}, false);
+    int* y = malloc(sizeof(int) * 4096);
+    long total = 0;
+    int n;
+    while((n = cten_csv_read(csv, X, y)) > 0) total += n;
+    cten_csv_close(csv);
+    double elapsed = now_seconds() - start;
+    free(y);
+    cten_end_malloc();
+    cten_free(PoolId_Default);
+    *n_rows = total;
+    return elapsed;
+}
+
+static double run_strtod(int n_features, long* n_rows) {
+    double start = now_seconds();
+    FILE* fp = fopen(BENCH_FILE, "rb");
+    float* x = malloc(sizeof(float) * n_features);
+    char line[1 << 14];
+    long total = 0;
+    volatile float sink = 0.0f;
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        char* p = line;
+        for(int c = 0; c < n_features; c++) {
+            x[c] = (float)strtod(p, &p);
+            p++;  // the delimiter
+        }
+        sink += x[0] + (float)strtol(p, NULL, 10);
+        total++;
+    }
+    fclose(fp);
+    free(x);
+    *n_rows = total;
+    return now_seconds() - start;
+}
+
+int main(int argc, char** argv) {
+    long megabytes = argc > 1 ? atol(argv[1]) : 64;
+    int n_features = argc > 2 ? atoi(argv[2]) : 32;
+    cten_initilize();
+
+    long size = write_dataset(megabytes << 20, n_features);
+    if(size < 0) {
+        fprintf(stderr, "cannot write %s\n", BENCH_FILE);
+        return 1;
+    }
+    printf("file: %.1f MB, %d features\n", size / 1048576.0, n_features);
+
+    // warm the page cache so both readers see the same storage
+    long rows;
+    run_strtod(n_features, &rows);
+    for(int k = 0; k < 2; k++) {
+        long cten_rows, strtod_rows;
+        double t_cten = run_cten(n_features, &cten_rows);
+        double t_strtod = run_strtod(n_features, &strtod_rows);
+        printf("cten_csv      %8ld rows  %7.3f s  %7.1f MB/s\n", cten_rows, t_cten, size / 1048576.0 / t_cten);
+        printf("fgets+strtod  %8ld rows  %7.3f s  %7.1f MB/s\n", strtod_rows, t_strtod, size / 1048576.0 / t_strtod);
+    }
+
+    remove(BENCH_FILE);
+    cten_finalize();
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "cten.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// One epoch of batches from a memory-mapped dataset (default 256 MB, 64 features, batch 256) read in order,
+// fully shuffled and block-shuffled: the gather cost of each order, in MB/s of feature rows delivered.
+
+#define BENCH_FILE "bench_dataloader.tmp.ctds"
+
+enum MemoryPoolIds {
+    PoolId_Default = 0,
+    PoolId_Data = 1,
+};
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void run(cten_dataset* ds, const char* name, bool shuffle, int block_rows, int batch_size) {
+    cten_begin_malloc(PoolId_Default);
+    cten_dataloader* loader = cten_dataloader_new(ds, 0, cten_dataset_num_samples(ds), batch_size, 3, shuffle);
+    cten_dataloader_config(loader, 42, block_rows);
+    cten_end_malloc();
+    double start = now_seconds();
+    Tensor x, y;
+    volatile float sink = 0.0f;
+    while(cten_dataloader_next(loader, &x, &y)) sink += x.data->flex[0];
+    double elapsed = now_seconds() - start;
+    cten_dataloader_free(loader);
+    cten_free(PoolId_Default);
+    double megabytes = (double)cten_dataset_num_samples(ds) * cten_dataset_num_features(ds) * sizeof(float) / 1048576.0;
+    printf("%-22s %7.3f s  %8.1f MB/s\n", name, elapsed, megabytes / elapsed);
+}
+
+int main(int argc, char** argv) {
+    long megabytes = argc > 1 ? atol(argv[1]) : 256;
+    int n_features = argc > 2 ? atoi(argv[2]) : 64;
+    int batch_size = 256;
+    cten_initilize();
+
+    int n_samples = (int)((megabytes << 20) / (sizeof(float) * n_features));
+    float* X = malloc(sizeof(float) * n_samples * n_features);
+    int* y = malloc(sizeof(int) * n_samples);
+    for(long i = 0; i < (long)n_samples * n_features; i++) X[i] = (float)(i % 1000) * 0.001f;
+    for(int i = 0; i < n_samples; i++) y[i] = i % 10;
+    bool saved = cten_dataset_save(BENCH_FILE, X, y, n_samples, n_features, false);
+    free(X);
+    free(y);
+    if(!saved) {
+        fprintf(stderr, "cannot write %s\n", BENCH_FILE);
+        return 1;
+    }
+
+    cten_begin_malloc(PoolId_Data);
+    cten_dataset* ds = cten_dataset_open(BENCH_FILE);
+    cten_end_malloc();
+    printf("dataset: %d samples x %d features, batch %d\n", n_samples, n_features, batch_size);
+    run(ds, "sequential", false, 0, batch_size);
+    for(int k = 0; k < 2; k++) {
+        run(ds, "shuffled", true, 0, batch_size);
+        run(ds, "block-shuffled (1024)", true, 1024, batch_size);
+    }
+
+    cten_dataset_close(ds);
+    cten_free(PoolId_Data);
+    remove(BENCH_FILE);
+    cten_finalize();
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "cten.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Memory of one captured training step (forward + backward + SGD) of a two-layer MLP: the naive sum of
+// every buffer the step allocates vs. the slab the planner packs them into, plus eager vs. replay step time.
+
+enum MemoryPoolIds {
+    PoolId_Default = 0,
+    PoolId_Model = 1,
+    PoolId_Optimizer = 2,
+    PoolId_Step = 3,
+};
+
+typedef struct Model {
+    Tensor weight_1, weight_2;
+    Tensor bias_1, bias_2;
+} Model;
+
+static Tensor Model_loss(Model* model, Tensor x, Tensor y) {
+    Tensor h = nn_relu(nn_linear(x, model->weight_1, model->bias_1));
+    return nn_softmax_crossentropy(y, nn_linear(h, model->weight_2, model->bias_2));
+}
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv) {
+    int batch = argc > 1 ? atoi(argv[1]) : 64;
+    int hidden = argc > 2 ? atoi(argv[2]) : 256;
+    int n_iters = argc > 3 ? atoi(argv[3]) : 50;
+    int n_features = 784;
+    int n_classes = 10;
+
+    cten_initilize();
+
+    Model model;
+    cten_begin_malloc(PoolId_Model);
+    model.weight_1 = Glorot_init((TensorShape){n_features, hidden}, true);
+    model.bias_1 = Tensor_zeros((TensorShape){1, hidden}, true);
+    model.weight_2 = Glorot_init((TensorShape){hidden, n_classes}, true);
+    model.bias_2 = Tensor_zeros((TensorShape){1, n_classes}, true);
+    Tensor x = Tensor_new((TensorShape){batch, n_features}, false);
+    Tensor y = Tensor_zeros((TensorShape){batch, n_classes}, false);
+    for(int i = 0; i < batch; i++) y.data->flex[i * n_classes + i % n_classes] = 1.0f;
+    cten_end_malloc();
+
+    Tensor params[] = {model.weight_1, model.bias_1, model.weight_2, model.bias_2};
+    cten_begin_malloc(PoolId_Optimizer);
+    optim_sgd* optimizer = optim_sgd_new(4, params, 0.0f);
+    optim_sgd_config(optimizer, 0.01f, 0.9f);
+    cten_end_malloc();
+
+    double start = now_seconds();
+    for(int it = 0; it < n_iters; it++) {
+        cten_begin_malloc(PoolId_Default);
+        optim_sgd_zerograd(optimizer);
+        Tensor_backward(Model_loss(&model, x, y), (Tensor){0});
+        optim_sgd_step(optimizer);
+        cten_end_malloc();
+        cten_free(PoolId_Default);
+    }
+    double eager = (now_seconds() - start) / n_iters;
+
+    cten_graph_capture_begin(PoolId_Step);
+    optim_sgd_zerograd(optimizer);
+    Tensor loss = Model_loss(&model, x, y);
+    Tensor_backward(loss, (Tensor){0});
+    optim_sgd_step(optimizer);
+    cten_graph* step = cten_graph_capture_end(loss);
+
+    start = now_seconds();
+    for(int it = 0; it < n_iters; it++) {
+        cten_graph_replay(step);
+    }
+    double replay = (now_seconds() - start) / n_iters;
+
+    size_t naive = cten_graph_naive_bytes(step);
+    size_t planned = cten_graph_planned_bytes(step);
+    printf("batch %d, hidden %d, %d captured steps\n", batch, hidden, cten_graph_num_steps(step));
+    printf("naive:   %8.2f MB\n", naive / 1048576.0);
+    printf("planned: %8.2f MB (%.1f%% of naive)\n", planned / 1048576.0, 100.0 * planned / naive);
+    printf("eager step:  %8.3f ms\n", eager * 1e3);
+    printf("replay step: %8.3f ms\n", replay * 1e3);
+
+    cten_free(PoolId_Step);
+    cten_free(PoolId_Optimizer);
+    cten_free(PoolId_Model);
+    cten_finalize();
+    return 0;
+}
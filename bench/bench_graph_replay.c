@@ -0,0 +1,92 @@
+#include "cten.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Batch-1 latency of the src2/main.c MLP: eager forward vs. replay of a captured graph.
+
+enum MemoryPoolIds {
+    PoolId_Default = 0,
+    PoolId_Model = 1,
+    PoolId_Graph = 3,
+};
+
+typedef struct Model {
+    Tensor weight_1, weight_2;
+    Tensor bias_1, bias_2;
+} Model;
+
+Tensor Model_forward(Model* model, Tensor x) {
+    x = nn_linear(x, model->weight_1, model->bias_1);
+    x = nn_relu(x);
+    x = nn_linear(x, model->weight_2, model->bias_2);
+    return x;
+}
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char* name, double* samples, int n) {
+    qsort(samples, n, sizeof(double), compare_doubles);
+    printf("%-8s p50: %8.2f us   p99: %8.2f us\n", name, samples[n / 2] * 1e6, samples[n * 99 / 100] * 1e6);
+}
+
+int main(int argc, char** argv) {
+    int hidden = argc > 1 ? atoi(argv[1]) : 32;
+    int n_iters = argc > 2 ? atoi(argv[2]) : 20000;
+    int n_features = 4;
+    int n_classes = 3;
+
+    cten_initilize();
+
+    Model model;
+    cten_begin_malloc(PoolId_Model);
+    model.weight_1 = Glorot_init((TensorShape){n_features, hidden}, true);
+    model.bias_1 = Tensor_zeros((TensorShape){1, hidden}, true);
+    model.weight_2 = Glorot_init((TensorShape){hidden, n_classes}, true);
+    model.bias_2 = Tensor_zeros((TensorShape){1, n_classes}, true);
+    Tensor input = Tensor_zeros((TensorShape){1, n_features}, false);
+    cten_end_malloc();
+
+    double* samples = malloc(sizeof(double) * n_iters);
+    cten_begin_eval();
+
+    for(int it = 0; it < n_iters; it++) {
+        input.data->flex[it % n_features] = (float)(it % 7) / 7.0f;
+        double start = now_seconds();
+        cten_begin_malloc(PoolId_Default);
+        Tensor y_pred = nn_softmax(Model_forward(&model, input), 1);
+        cten_end_malloc();
+        cten_free(PoolId_Default);
+        samples[it] = now_seconds() - start;
+        (void)y_pred;
+    }
+    report("eager", samples, n_iters);
+
+    cten_graph_capture_begin(PoolId_Graph);
+    Tensor y_pred = nn_softmax(Model_forward(&model, input), 1);
+    cten_graph* graph = cten_graph_capture_end(y_pred);
+    for(int it = 0; it < n_iters; it++) {
+        input.data->flex[it % n_features] = (float)(it % 7) / 7.0f;
+        double start = now_seconds();
+        cten_graph_replay(graph);
+        samples[it] = now_seconds() - start;
+    }
+    report("replay", samples, n_iters);
+    printf("captured steps: %d\n", cten_graph_num_steps(graph));
+
+    cten_end_eval();
+    free(samples);
+    cten_free(PoolId_Graph);
+    cten_free(PoolId_Model);
+    cten_finalize();
+    return 0;
+}
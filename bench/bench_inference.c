@@ -0,0 +1,118 @@
+#include "cten.h"
+#include "common/threads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Throughput of concurrent read-only inference: the MLP from src2/main.c is loaded once into
+// PoolId_Model and every worker thread runs Model_forward with its own context and scratch pool.
+
+enum MemoryPoolIds {
+    PoolId_Default = 0,
+    PoolId_Model = 1,
+};
+
+typedef struct Model {
+    Tensor weight_1, weight_2;
+    Tensor bias_1, bias_2;
+} Model;
+
+Tensor Model_forward(Model* model, Tensor x) {
+    x = nn_linear(x, model->weight_1, model->bias_1);
+    x = nn_relu(x);
+    x = nn_linear(x, model->weight_2, model->bias_2);
+    return x;
+}
+
+typedef struct Worker {
+    Model* model;
+    int n_requests;
+    int n_features;
+    int n_classes;
+    long checksum;
+} Worker;
+
+static void Worker_main(void* arg) {
+    Worker* self = arg;
+    // each thread owns its context: allocator stack, eval mode and RNG are never shared
+    cten_initilize();
+    cten_begin_eval();
+    // stands in for the request buffer a server receives; the input tensor views it without a copy
+    float* request = malloc(sizeof(float) * self->n_features);
+    Tensor input = Tensor_from_buffer((TensorShape){1, self->n_features}, request, NULL);
+    for(int r = 0; r < self->n_requests; r++) {
+        for(int k = 0; k < self->n_features; k++) {
+            request[k] = (float)((r + k) % 7) / 7.0f;
+        }
+        cten_begin_malloc(PoolId_Default);
+        Tensor logit = Model_forward(self->model, input);
+        Tensor y_pred = nn_softmax(logit, 1);
+        int pred_classes[1];
+        Tensor_argmax(y_pred, pred_classes);
+        self->checksum += pred_classes[0];
+        cten_end_malloc();
+        cten_free(PoolId_Default);
+    }
+    Tensor_release(input);
+    free(request);
+    cten_end_eval();
+    cten_finalize();
+}
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 1, 2, 4, ... and finally `max_threads` itself when it is not a power of two
+static int next_thread_count(int n, int max_threads) {
+    if(n < max_threads && n * 2 > max_threads) return max_threads;
+    return n * 2;
+}
+
+int main(int argc, char** argv) {
+    int hidden = argc > 1 ? atoi(argv[1]) : 256;
+    int n_requests = argc > 2 ? atoi(argv[2]) : 20000;
+    int max_threads = argc > 3 ? atoi(argv[3]) : c11_thrd__hardware_concurrency();
+    int n_features = 4;
+    int n_classes = 3;
+
+    cten_initilize();
+
+    Model model;
+    cten_begin_malloc(PoolId_Model);
+    model.weight_1 = Glorot_init((TensorShape){n_features, hidden}, true);
+    model.bias_1 = Tensor_zeros((TensorShape){1, hidden}, true);
+    model.weight_2 = Glorot_init((TensorShape){hidden, n_classes}, true);
+    model.bias_2 = Tensor_zeros((TensorShape){1, n_classes}, true);
+    cten_end_malloc();
+
+    printf("hidden: %d, requests per thread: %d\n", hidden, n_requests);
+    printf("%8s %14s %10s\n", "threads", "requests/s", "speedup");
+
+    double base_rps = 0.0;
+    Worker* workers = malloc(sizeof(Worker) * max_threads);
+    c11_thrd_t* threads = malloc(sizeof(c11_thrd_t) * max_threads);
+    for(int n_threads = 1; n_threads <= max_threads; n_threads = next_thread_count(n_threads, max_threads)) {
+        double start = now_seconds();
+        for(int t = 0; t < n_threads; t++) {
+            workers[t] = (Worker){&model, n_requests, n_features, n_classes, 0};
+            bool ok = c11_thrd__create(&threads[t], Worker_main, &workers[t]);
+            cten_assert(ok, "failed to start worker thread %d", t);
+        }
+        for(int t = 0; t < n_threads; t++) {
+            c11_thrd__join(threads[t]);
+        }
+        double elapsed = now_seconds() - start;
+        double rps = (double)n_requests * n_threads / elapsed;
+        if(n_threads == 1) base_rps = rps;
+        printf("%8d %14.0f %9.2fx\n", n_threads, rps, rps / base_rps);
+    }
+    free(threads);
+    free(workers);
+
+    cten_free(PoolId_Model);
+    cten_finalize();
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "cten.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Full-batch training of the iris 4-32-3 MLP to a target loss: forward/backward evaluations and wall time
+// for SGD with momentum (one evaluation per epoch) vs. L-BFGS (closure evaluations including line search).
+
+enum MemoryPoolIds {
+    PoolId_Default = 0,
+    PoolId_Model = 1,
+    PoolId_Optimizer = 2,
+    PoolId_Data = 3,
+};
+
+typedef struct Model {
+    Tensor weight_1, bias_1, weight_2, bias_2;
+} Model;
+
+typedef struct Problem {
+    Model model;
+    Tensor x, y;
+} Problem;
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Tensor Problem_loss(void* ctx) {
+    Problem* self = ctx;
+    Model* m = &self->model;
+    Tensor h = nn_relu(nn_linear(self->x, m->weight_1, m->bias_1));
+    return nn_softmax_crossentropy(self->y, nn_linear(h, m->weight_2, m->bias_2));
+}
+
+static void Model_init(Model* model) {
+    cten_manual_seed(42);
+    cten_begin_malloc(PoolId_Model);
+    model->weight_1 = Glorot_init((TensorShape){4, 32}, true);
+    model->bias_1 = Tensor_zeros((TensorShape){1, 32}, true);
+    model->weight_2 = Glorot_init((TensorShape){32, 3}, true);
+    model->bias_2 = Tensor_zeros((TensorShape){1, 3}, true);
+    cten_end_malloc();
+}
+
+static void run_sgd(Problem* p, float target, int max_epochs) {
+    Model_init(&p->model);
+    cten_begin_malloc(PoolId_Optimizer);
+    optim_sgd* opt = optim_sgd_new(4, (Tensor*)&p->model, 0.0f);
+    optim_sgd_config(opt, 0.01f, 0.0f);
+    cten_end_malloc();
+
+    double start = now_seconds();
+    float loss = 0.0f;
+    int epoch = 0;
+    while(epoch < max_epochs) {
+        epoch++;
+        cten_begin_malloc(PoolId_Default);
+        optim_sgd_zerograd(opt);
+        Tensor l = Problem_loss(p);
+        loss = l.data->flex[0];
+        Tensor_backward(l, (Tensor){0});
+        optim_sgd_step(opt);
+        cten_end_malloc();
+        cten_free(PoolId_Default);
+        if(loss < target) break;
+    }
+    printf("%-8s %8d evaluations %10.2f ms  loss %.5f\n", "sgd", epoch, (now_seconds() - start) * 1e3, loss);
+    cten_free(PoolId_Optimizer);
+    cten_free(PoolId_Model);
+}
+
+static void run_lbfgs(Problem* p, float target, int max_steps) {
+    Model_init(&p->model);
+    cten_begin_malloc(PoolId_Optimizer);
+    optim_lbfgs* opt = optim_lbfgs_new(4, (Tensor*)&p->model, 1.0f, 20, 10);
+    cten_end_malloc();
+
+    double start = now_seconds();
+    float loss = 0.0f;
+    for(int step = 0; step < max_steps && !(loss < target && step > 0); step++) {
+        loss = optim_lbfgs_step(opt, Problem_loss, p, PoolId_Default);
+    }
+    printf("%-8s %8d evaluations %10.2f ms  loss %.5f\n", "lbfgs", optim_lbfgs_func_evals(opt),
+           (now_seconds() - start) * 1e3, loss);
+    cten_free(PoolId_Optimizer);
+    cten_free(PoolId_Model);
+}
+
+int main(int argc, char** argv) {
+    float target = argc > 1 ? (float)atof(argv[1]) : 0.03f;
+    cten_initilize();
+
+    const float(*X)[4];
+    const int* y;
+    int n_samples = load_iris_dataset(&X, &y);
+    float(*X_norm)[4] = malloc(n_samples * sizeof(*X_norm));
+    Tensor_normalize_dataset((const float*)X, (float*)X_norm, n_samples, n_samples, 4);
+
+    Problem p;
+    cten_begin_malloc(PoolId_Data);
+    p.x = Tensor_zeros((TensorShape){n_samples, 4}, false);
+    p.y = Tensor_zeros((TensorShape){n_samples, 3}, false);
+    cten_end_malloc();
+    memcpy(p.x.data->flex, X_norm, sizeof(float) * 4 * n_samples);
+    for(int i = 0; i < n_samples; i++) p.y.data->flex[i * 3 + y[i]] = 1.0f;
+
+    printf("iris, full batch of %d, target loss %g\n", n_samples, target);
+    run_sgd(&p, target, 5000);
+    run_lbfgs(&p, target, 50);
+
+    free(X_norm);
+    cten_free(PoolId_Data);
+    cten_finalize();
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "cten.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Convergence and state memory of Adam and RMSProp with fp32, factored and 8-bit state, on iris (4-32-3
+// MLP, every fifth sample held out) and on a synthetic teacher-student regression with a wide hidden layer.
+
+enum MemoryPoolIds {
+    PoolId_Default = 0,
+    PoolId_Model = 1,
+    PoolId_Optimizer = 2,
+    PoolId_Data = 3,
+};
+
+static const char* state_names[] = {"fp32", "factored", "8bit"};
+
+typedef struct Model {
+    Tensor weight_1, bias_1, weight_2, bias_2;
+} Model;
+
+static Tensor Model_forward(Model* model, Tensor x) {
+    x = nn_relu(nn_linear(x, model->weight_1, model->bias_1));
+    return nn_linear(x, model->weight_2, model->bias_2);
+}
+
+static void Model_init(Model* model, int n_in, int hidden, int n_out) {
+    cten_manual_seed(42);
+    model->weight_1 = Glorot_init((TensorShape){n_in, hidden}, true);
+    model->bias_1 = Tensor_zeros((TensorShape){1, hidden}, true);
+    model->weight_2 = Glorot_init((TensorShape){hidden, n_out}, true);
+    model->bias_2 = Tensor_zeros((TensorShape){1, n_out}, true);
+}
+
+typedef struct Task {
+    const char* name;
+    Tensor x_train, y_train, x_test;
+    const int* test_labels;  // NULL for regression
+    int n_test;
+    int n_in, hidden, n_out;
+    int n_epochs;
+} Task;
+
+typedef struct Optimizer {
+    optim_adam* adam;
+    optim_rmsprop* rmsprop;
+} Optimizer;
+
+static void run(const Task* task, bool use_adam, OptimState state) {
+    Model model;
+    cten_begin_malloc(PoolId_Model);
+    Model_init(&model, task->n_in, task->hidden, task->n_out);
+    cten_end_malloc();
+
+    Optimizer opt = {0};
+    cten_begin_malloc(PoolId_Optimizer);
+    if(use_adam) {
+        opt.adam = optim_adam_new_with_state(4, (Tensor*)&model, 0.01f, 0.9f, 0.999f, 1e-8f, 0.0f, state);
+    } else {
+        opt.rmsprop = optim_rmsprop_new_with_state(4, (Tensor*)&model, 0.002f, 0.99f, 1e-8f, 0.0f, state);
+    }
+    cten_end_malloc();
+
+    float loss = 0.0f;
+    for(int epoch = 0; epoch < task->n_epochs; epoch++) {
+        cten_begin_malloc(PoolId_Default);
+        Tensor out = Model_forward(&model, task->x_train);
+        Tensor l = task->test_labels ? nn_softmax_crossentropy(task->y_train, out) : nn_mse_loss(task->y_train, out);
+        loss = l.data->flex[0];
+        if(use_adam) {
+            optim_adam_zerograd(opt.adam);
+            Tensor_backward(l, (Tensor){0});
+            optim_adam_step(opt.adam);
+        } else {
+            optim_rmsprop_zerograd(opt.rmsprop);
+            Tensor_backward(l, (Tensor){0});
+            optim_rmsprop_step(opt.rmsprop);
+        }
+        cten_end_malloc();
+        cten_free(PoolId_Default);
+    }
+
+    char metric[32] = "";
+    if(task->test_labels != NULL) {
+        cten_begin_malloc(PoolId_Default);
+        cten_begin_eval();
+        Tensor out = Model_forward(&model, task->x_test);
+        cten_end_eval();
+        int correct = 0;
+        for(int i = 0; i < task->n_test; i++) {
+            int best = 0;
+            for(int c = 1; c < task->n_out; c++) {
+                if(out.data->flex[i * task->n_out + c] > out.data->flex[i * task->n_out + best]) best = c;
+            }
+            correct += best == task->test_labels[i];
+        }
+        cten_end_malloc();
+        cten_free(PoolId_Default);
+        snprintf(metric, sizeof(metric), "test acc %.3f", (float)correct / task->n_test);
+    }
+
+    size_t bytes = use_adam ? optim_adam_state_bytes(opt.adam) : optim_rmsprop_state_bytes(opt.rmsprop);
+    printf("%-10s %-8s %-9s final loss %10.6f  state %9.1f KB  %s\n", task->name, use_adam ? "adam" : "rmsprop",
+           state_names[state], loss, bytes / 1024.0, metric);
+
+    cten_free(PoolId_Optimizer);
+    cten_free(PoolId_Model);
+}
+
+static void run_all(const Task* task) {
+    for(int use_adam = 1; use_adam >= 0; use_adam--) {
+        for(int state = OptimState_fp32; state <= OptimState_8bit; state++) {
+            run(task, use_adam, (OptimState)state);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    int hidden = argc > 1 ? atoi(argv[1]) : 256;
+    cten_initilize();
+    cten_begin_malloc(PoolId_Data);
+
+    // iris
+    const float(*X)[4];
+    const int* y;
+    int n_samples = load_iris_dataset(&X, &y);
+    float(*X_norm)[4] = malloc(n_samples * sizeof(*X_norm));
+    Tensor_normalize_dataset((const float*)X, (float*)X_norm, n_samples, n_samples, 4);
+    int n_test = n_samples / 5, n_train = n_samples - n_test;
+    Task iris = {"iris", Tensor_zeros((TensorShape){n_train, 4}, false), Tensor_zeros((TensorShape){n_train, 3}, false),
+                 Tensor_zeros((TensorShape){n_test, 4}, false), NULL, n_test, 4, 32, 3, 300};
+    int* test_labels = malloc(sizeof(int) * n_test);
+    for(int i = 0, tr = 0, te = 0; i < n_samples; i++) {
+        if(i % 5 == 4) {
+            memcpy(iris.x_test.data->flex + te * 4, X_norm[i], sizeof(float) * 4);
+            test_labels[te++] = y[i];
+        } else {
+            memcpy(iris.x_train.data->flex + tr * 4, X_norm[i], sizeof(float) * 4);
+            iris.y_train.data->flex[tr++ * 3 + y[i]] = 1.0f;
+        }
+    }
+    iris.test_labels = test_labels;
+
+    // synthetic: a fixed random teacher MLP generates the targets
+    int n_in = 64, n_out = 16, n_syn = 256;
+    Task synthetic = {
+        .name = "synthetic",
+        .x_train = Tensor_new((TensorShape){n_syn, n_in}, false),
+        .n_in = n_in,
+        .hidden = hidden,
+        .n_out = n_out,
+        .n_epochs = 200,
+    };
+    Model teacher;
+    Model_init(&teacher, n_in, 32, n_out);
+    cten_begin_eval();
+    synthetic.y_train = Model_forward(&teacher, synthetic.x_train);
+    cten_end_eval();
+    cten_end_malloc();
+
+    run_all(&iris);
+    run_all(&synthetic);
+
+    free(test_labels);
+    free(X_norm);
+    cten_free(PoolId_Data);
+    cten_finalize();
+    return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+// a whole file mapped read-only into memory
+typedef struct c11_mmap {
+    const void* data;
+    size_t size;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} c11_mmap;
+
+bool c11_mmap__open(c11_mmap* self, const char* path);  // false if the file cannot be opened or is empty
+void c11_mmap__close(c11_mmap* self);
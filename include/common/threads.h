@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+
+typedef HANDLE c11_thrd_t;
+typedef CRITICAL_SECTION c11_mtx_t;
+typedef CONDITION_VARIABLE c11_cnd_t;
+#else
+#include <pthread.h>
+
+typedef pthread_t c11_thrd_t;
+typedef pthread_mutex_t c11_mtx_t;
+typedef pthread_cond_t c11_cnd_t;
+#endif
+
+typedef void (*c11_thrd_fn)(void* arg);
+
+bool c11_thrd__create(c11_thrd_t* self, c11_thrd_fn fn, void* arg);
+void c11_thrd__join(c11_thrd_t self);
+int c11_thrd__hardware_concurrency();
+
+void c11_mtx__ctor(c11_mtx_t* self);
+void c11_mtx__dtor(c11_mtx_t* self);
+void c11_mtx__lock(c11_mtx_t* self);
+void c11_mtx__unlock(c11_mtx_t* self);
+
+void c11_cnd__ctor(c11_cnd_t* self);
+void c11_cnd__dtor(c11_cnd_t* self);
+void c11_cnd__wait(c11_cnd_t* self, c11_mtx_t* mtx);
+void c11_cnd__signal(c11_cnd_t* self);
+void c11_cnd__broadcast(c11_cnd_t* self);
@@ -80,4 +80,4 @@ void c11_vector__swap(c11_vector* self, c11_vector* other);
 
 // NOTE: here we do an extra NULL check for it to avoid UB
 #define c11__foreach(T, self, it)                                                                  \
-    for(T* it = (self)->data; it && it != (T*)(self)->data + (self)->length; it++)
\ No newline at end of file
+    for(T* it = (self)->data; it && it != (T*)(self)->data + (self)->length; it++)
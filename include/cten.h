@@ -17,10 +17,16 @@
 
 typedef int TensorShape[4];
 typedef struct GradNode GradNode;
+typedef struct cten_context cten_context;
+
+typedef union OpParam {
+    int i;
+    float f;
+} OpParam;
 
 typedef struct FloatBuffer {
     int numel;
-    float flex[];
+    float* flex;  // usually right after the header; a captured graph points it into its slab
 } FloatBuffer;
 
 typedef struct Tensor {
@@ -35,7 +41,8 @@ typedef struct GradNode {
     struct Tensor inputs[4];
     int n_inputs;
     const char* name;
-    int params[4];
+    OpParam params[4];
+    int n_pending;  // consumers that have not propagated into this node yet, only non-zero during Tensor_backward
 } GradNode;
 
 typedef struct {
@@ -46,6 +53,15 @@ typedef struct {
 void cten_initilize();
 void cten_finalize();
 
+/* Context */
+cten_context* cten_context_new();
+void cten_context_delete(cten_context* ctx);
+cten_context* cten_context_current();
+cten_context* cten_context_bind(cten_context* ctx);
+void cten_manual_seed(uint64_t seed);
+uint64_t cten_get_rng_state();
+void cten_set_rng_state(uint64_t state);
+
 /* TensorShape */
 int TensorShape_numel(TensorShape shape);
 int TensorShape_dim(TensorShape shape);
@@ -58,6 +74,16 @@ Tensor Tensor_zeros(TensorShape shape, bool requires_grad);
 Tensor Tensor_ones(TensorShape shape, bool requires_grad);
 Tensor Tensor_transpose(Tensor self);
 
+// a tensor viewing caller-owned memory of TensorShape_numel(shape) floats, without a copy and without pool
+// memory. The view has no gradient and works as an input to every operator; operators never write to it.
+// release (may be NULL) is called on the buffer when the view lets go of it.
+typedef void (*cten_release_fn)(float* data);
+Tensor Tensor_from_buffer(TensorShape shape, float* data, cten_release_fn release);
+// points the view at another buffer of the same size and releases the previous one; a captured graph that
+// reads the view reads the new buffer on its next replay
+void Tensor_rebind(Tensor self, float* data);
+void Tensor_release(Tensor self);  // releases the buffer and frees the view; only for Tensor_from_buffer
+
 float Tensor_get(Tensor self, int i, int j, int k, int l);
 void Tensor_set(Tensor self, int i, int j, int k, int l, float value);
 void Tensor_backward(Tensor self, Tensor grad);
@@ -127,7 +153,42 @@ void cten_begin_malloc(PoolId id);
 void cten_end_malloc();
 void cten_free(PoolId id);
 
+/* Gradient Accumulation */
+// builds the mean loss of samples [begin, end); everything it allocates is freed before the next micro-batch
+typedef Tensor (*cten_loss_fn)(void* ctx, int begin, int end);
+
+// runs forward and backward on micro-batches of n_samples, accumulating into the parameters' gradients
+// as if one batch of n_samples had been used; returns the mean loss over all samples
+float cten_accumulate_grad(Tensor* params, int n_params, PoolId scratch, int n_samples, int micro_batch_size,
+                           cten_loss_fn loss_fn, void* ctx);
+
+/* Graph Capture */
+typedef struct cten_graph cten_graph;
+
+void cten_graph_capture_begin(PoolId id);
+cten_graph* cten_graph_capture_end(Tensor output);
+void cten_graph_replay(const cten_graph* self);
+int cten_graph_num_steps(const cten_graph* self);
+void cten_graph_capture_keep(Tensor t);
+size_t cten_graph_planned_bytes(const cten_graph* self);
+size_t cten_graph_naive_bytes(const cten_graph* self);
+
+typedef struct cten_writer cten_writer;
+typedef struct cten_file cten_file;
+typedef struct cten_checkpoint cten_checkpoint;
+typedef struct cten_csv cten_csv;
+typedef struct cten_dataset cten_dataset;
+typedef struct cten_dataloader cten_dataloader;
+typedef struct cten_feature_stats cten_feature_stats;
+
 /* Optimizer */
+// how Adam and RMSProp store their moment estimates
+typedef enum OptimState {
+    OptimState_fp32 = 0,      // full fp32 tensors
+    OptimState_factored = 1,  // second moments of matrices as row and column averages (Adafactor)
+    OptimState_8bit = 2,      // block-wise 8-bit codes with one fp32 scale per block
+} OptimState;
+
 typedef struct optim_sgd optim_sgd;
 typedef struct optim_adagrad optim_adagrad;
 typedef struct optim_rmsprop optim_rmsprop;
@@ -138,21 +199,61 @@ optim_sgd* optim_sgd_new(int n_params, Tensor* params, float weight_decay);
 void optim_sgd_zerograd(optim_sgd* self);
 void optim_sgd_step(optim_sgd* self);
 void optim_sgd_config(optim_sgd* self, float lr, float momentum);
+//LARS - SGD with a per-tensor trust ratio; configure lr and momentum with optim_sgd_config
+optim_sgd* optim_lars_new(int n_params, Tensor* params, float weight_decay, float trust_coefficient);
+void optim_sgd_clip_grad_norm(optim_sgd* self, float max_norm);
+void optim_sgd_clip_grad_value_range(optim_sgd* self, float min_value, float max_value);
+void optim_sgd_step_in_backward(optim_sgd* self, bool enable);  // update each parameter once its gradient is final
+void optim_sgd_save_state(const optim_sgd* self, cten_writer* writer, const char* prefix);
+bool optim_sgd_load_state(optim_sgd* self, const cten_file* file, const char* prefix);
 
 //AdaGrad - Updated with weight decay
 optim_adagrad* optim_adagrad_new(int n_params, Tensor* params, float lr, float ε,float weight_decay);
 void optim_adagrad_zerograd(optim_adagrad* self);
 void optim_adagrad_step(optim_adagrad* self);
+void optim_adagrad_clip_grad_norm(optim_adagrad* self, float max_norm);
+void optim_adagrad_clip_grad_value_range(optim_adagrad* self, float min_value, float max_value);
+void optim_adagrad_step_in_backward(optim_adagrad* self, bool enable);  // update each parameter once its gradient is final
+void optim_adagrad_save_state(const optim_adagrad* self, cten_writer* writer, const char* prefix);
+bool optim_adagrad_load_state(optim_adagrad* self, const cten_file* file, const char* prefix);
 
 //RMSProp - Updated with weight decay
 optim_rmsprop* optim_rmsprop_new(int n_params, Tensor* params, float lr, float β, float ε, float weight_decay);
+optim_rmsprop* optim_rmsprop_new_with_state(int n_params, Tensor* params, float lr, float β, float ε, float weight_decay, OptimState state);
+size_t optim_rmsprop_state_bytes(const optim_rmsprop* self);
 void optim_rmsprop_zerograd(optim_rmsprop* self);
 void optim_rmsprop_step(optim_rmsprop* self);
+void optim_rmsprop_clip_grad_norm(optim_rmsprop* self, float max_norm);
+void optim_rmsprop_clip_grad_value_range(optim_rmsprop* self, float min_value, float max_value);
+void optim_rmsprop_step_in_backward(optim_rmsprop* self, bool enable);  // update each parameter once its gradient is final
+void optim_rmsprop_save_state(const optim_rmsprop* self, cten_writer* writer, const char* prefix);
+bool optim_rmsprop_load_state(optim_rmsprop* self, const cten_file* file, const char* prefix);
 
 //Adam - Updated with weight decay
 optim_adam* optim_adam_new(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay);
+optim_adam* optim_adam_new_with_state(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay, OptimState state);
+size_t optim_adam_state_bytes(const optim_adam* self);
 void optim_adam_zerograd(optim_adam* self);
 void optim_adam_step(optim_adam* self);
+void optim_adam_clip_grad_norm(optim_adam* self, float max_norm);
+void optim_adam_clip_grad_value_range(optim_adam* self, float min_value, float max_value);
+void optim_adam_step_in_backward(optim_adam* self, bool enable);  // update each parameter once its gradient is final
+void optim_adam_save_state(const optim_adam* self, cten_writer* writer, const char* prefix);
+bool optim_adam_load_state(optim_adam* self, const cten_file* file, const char* prefix);
+//AdamW - weight decay applied to the parameters instead of the gradient
+optim_adam* optim_adamw_new(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay);
+optim_adam* optim_adamw_new_with_state(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay, OptimState state);
+//LAMB - Adam with a per-tensor trust ratio
+optim_adam* optim_lamb_new(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay);
+
+//L-BFGS - full-batch quasi-Newton with a strong-Wolfe line search
+typedef struct optim_lbfgs optim_lbfgs;
+// returns the loss at the current parameters; the optimizer zeroes the gradients and runs backward itself
+typedef Tensor (*cten_closure)(void* ctx);
+optim_lbfgs* optim_lbfgs_new(int n_params, Tensor* params, float lr, int max_iter, int history_size);
+// up to max_iter iterations, each closure call inside the scratch pool; returns the final loss
+float optim_lbfgs_step(optim_lbfgs* self, cten_closure closure, void* ctx, PoolId scratch);
+int optim_lbfgs_func_evals(const optim_lbfgs* self);
 
 /* Gradient Clipping */
 void cten_clip_grad_norm(Tensor* params, int n_params, float max_norm);
@@ -161,6 +262,113 @@ void cten_clip_grad_value_range(Tensor* params, int n_params, float min_value, f
 void cten_clip_grad_positive(Tensor* params, int n_params, float max_value);
 void cten_clip_grad_negative(Tensor* params, int n_params, float min_value);
 
+/* Serialization */
+#define CTEN_MAX_NAME 64  // entry names in a saved file, including the terminating zero
+#define CTEN_DTYPE_FLOAT32 0
+#define CTEN_DTYPE_UINT8 1  // raw bytes, e.g. 8-bit optimizer state or the RNG state
+
+// streams each entry straight from its buffer; the entry table is written by cten_writer_close, which then
+// renames the finished file over path
+cten_writer* cten_writer_open(const char* path);  // NULL if the file cannot be created
+void cten_writer_add(cten_writer* self, const char* name, Tensor t);
+void cten_writer_add_bytes(cten_writer* self, const char* name, const void* data, size_t nbytes);
+bool cten_writer_close(cten_writer* self);  // false if any write failed
+// writes the tensors with their names and shapes; false if the file cannot be written
+bool cten_save(const char* path, int n_tensors, const char* const* names, const Tensor* tensors);
+
+// asynchronous checkpoints: the writer returned by begin copies every entry into a snapshot, and commit hands
+// the snapshot to a background thread, so training may change the tensors right after commit returns
+cten_checkpoint* cten_checkpoint_new();
+cten_writer* cten_checkpoint_begin(cten_checkpoint* self, const char* path);  // waits only if two snapshots are still unwritten
+void cten_checkpoint_commit(cten_checkpoint* self);
+bool cten_checkpoint_done(cten_checkpoint* self);  // true once every committed snapshot is on the disk
+bool cten_checkpoint_wait(cten_checkpoint* self);  // blocks until done; false if a write since the last wait failed
+bool cten_checkpoint_free(cten_checkpoint* self);  // waits, then stops the thread; returns like wait
+
+// maps the file and wraps each payload as a read-only tensor without copying; NULL if the file cannot be
+// opened or is not a valid cten file. The tensors stay valid until cten_file_close.
+cten_file* cten_load(const char* path);
+int cten_file_num_tensors(const cten_file* self);
+const char* cten_file_name(const cten_file* self, int i);
+Tensor cten_file_tensor(const cten_file* self, int i);  // data is NULL for byte entries
+Tensor cten_file_get(const cten_file* self, const char* name);  // data is NULL if there is no such tensor
+const void* cten_file_bytes(const cten_file* self, const char* name, size_t* nbytes);  // NULL if missing
+bool cten_file_read(const cten_file* self, const char* name, Tensor dst);  // copies into dst; false on a missing name or shape mismatch
+void cten_file_close(cten_file* self);
+
+// NumPy interop: little-endian float32 arrays in C order with up to 4 dimensions ('|u1' arrays load as byte
+// entries). Both loaders map the file like cten_load and return NULL for anything else. An .npy holds one entry
+// named "arr_0"; an .npz holds one entry per member, named without ".npy", and must not be compressed. Members
+// of an .npz are not aligned, so those that are not 4-byte aligned in the archive are copied.
+cten_file* cten_load_npy(const char* path);
+cten_file* cten_load_npz(const char* path);
+bool cten_save_npy(const char* path, Tensor t);  // false if the file cannot be written
+
+/* Datasets */
+// streams a CSV/TSV file with one sample per row: numeric features and an integer class label in column
+// label_column (negative counts from the end, -1 is the last column). NULL if the file cannot be opened or
+// its first row is not numeric.
+cten_csv* cten_csv_open(const char* path, char delimiter, bool has_header, int label_column);
+int cten_csv_num_features(const cten_csv* self);
+// parses up to X.shape[0] rows straight into X {rows, n_features} and labels (may be NULL); returns the number
+// of rows read, 0 at the end of the file, or -1 on a malformed row
+int cten_csv_read(cten_csv* self, Tensor X, int* labels);
+int cten_csv_line(const cten_csv* self);  // the line of the last row read, e.g. the malformed one
+void cten_csv_close(cten_csv* self);
+// reads a whole file into a new X {n_samples, n_features} and labels, both in the current pool; returns
+// n_samples, or -1 if the file cannot be read
+int cten_load_csv(const char* path, char delimiter, bool has_header, int label_column, Tensor* X, int** labels);
+
+// binary datasets: packed float feature rows and int labels, plus one-hot float target rows with one_hot.
+// Labels must be non-negative; the class count is the largest label + 1. The writers return false on failure.
+bool cten_dataset_save(const char* path, const float* X, const int* labels, int n_samples, int n_features, bool one_hot);
+bool cten_dataset_convert_csv(const char* csv_path, const char* path, char delimiter, bool has_header,
+                              int label_column, bool one_hot);  // streams, so the CSV may exceed memory
+cten_dataset* cten_dataset_open(const char* path);  // maps the file; NULL if it is not a valid dataset
+int cten_dataset_num_samples(const cten_dataset* self);
+int cten_dataset_num_features(const cten_dataset* self);
+int cten_dataset_num_classes(const cten_dataset* self);
+const int* cten_dataset_labels(const cten_dataset* self);
+// read-only views of rows [begin, begin + n) inside the mapping, valid until cten_dataset_close
+Tensor cten_dataset_features(const cten_dataset* self, int begin, int n);  // {n, n_features}
+Tensor cten_dataset_targets(const cten_dataset* self, int begin, int n);  // {n, n_classes}; data is NULL without targets
+void cten_dataset_close(cten_dataset* self);
+
+// assembles batches of rows [begin, end) on a producer thread, into a ring of n_buffers (>= 2) batch buffers
+// allocated in the current pool; with shuffle every epoch visits the rows in a new order. The batch returned
+// by next stays valid until the following call, which returns false once per epoch, after its last batch.
+cten_dataloader* cten_dataloader_new(const cten_dataset* dataset, int begin, int end, int batch_size, int n_buffers,
+                                     bool shuffle);
+bool cten_dataloader_next(cten_dataloader* self, Tensor* x, Tensor* y);  // x {n, n_features}, one-hot y {n, n_classes}; y may be NULL
+// the same over the listed rows, in that order when not shuffled; rows is copied
+cten_dataloader* cten_dataloader_new_subset(const cten_dataset* dataset, const int* rows, int n_rows, int batch_size,
+                                            int n_buffers, bool shuffle);
+// before the first next: seeds the loader's own RNG (0 keeps the seed drawn from the context), and with
+// block_rows > 1 shuffles blocks of that many consecutive rows and then the rows inside each block, which keeps
+// reads from a mapped file mostly sequential
+void cten_dataloader_config(cten_dataloader* self, uint64_t seed, int block_rows);
+const int* cten_dataloader_labels(const cten_dataloader* self);  // the labels of the current batch
+int cten_dataloader_num_batches(const cten_dataloader* self);  // per epoch
+// before the first next: batches are normalized by the transform of stats while they are assembled
+void cten_dataloader_normalize(cten_dataloader* self, const cten_feature_stats* stats);
+void cten_dataloader_free(cten_dataloader* self);  // stops the producer; the dataset must outlive the loader
+
+// streaming per-feature mean and variance (Welford, merged across threads and updates with Chan's formula)
+cten_feature_stats* cten_feature_stats_new(int n_features);  // in the current pool
+// adds n_rows rows of X {*, n_features}: the listed rows, or the first n_rows when rows is NULL
+void cten_feature_stats_update(cten_feature_stats* self, const float* X, const int* rows, int n_rows);
+void cten_feature_stats_merge(cten_feature_stats* self, const cten_feature_stats* other);
+int64_t cten_feature_stats_count(const cten_feature_stats* self);
+void cten_feature_stats_moments(const cten_feature_stats* self, double* mean, double* variance);  // population variance; either may be NULL
+// the normalization x' = (x - shift) * scale, with scale = 1 / std (1 for a constant feature)
+void cten_feature_stats_transform(const cten_feature_stats* self, float* shift, float* scale);
+// folds the normalization into a linear layer in place, so x W' + b' equals x' W + b for raw inputs x
+void cten_feature_stats_fold(const cten_feature_stats* self, Tensor weight, Tensor bias);
+
+/* Threads */
+void cten_set_num_threads(int n);  // worker threads for optimizer steps and feature statistics; n <= 0 uses every hardware thread
+int cten_get_num_threads();
+
 /* Misc */
 void cten_begin_eval();
 bool cten_is_eval();
@@ -168,9 +376,12 @@ void cten_end_eval();
 bool va_arg_is_present(va_list args);
 
 /* Utils */
-void Tensor_normalize_dataset(const float (*X)[4], float (*X_norm)[4], int n_samples, int n_train_samples, int n_features);
+// X and X_norm hold n_samples rows of n_features floats; the statistics come from the first n_train_samples
+void Tensor_normalize_dataset(const float* X, float* X_norm, int n_samples, int n_train_samples, int n_features);
 Tensor Tensor_detach(Tensor self);
-void Tensor_shuffle_dataset(const float (*X)[4], const int *y,float (*X_shuffled)[4], int *y_shuffled, int n_samples, int n_features);
+// random permutations come from the context RNG, so cten_manual_seed makes them reproducible
+void Tensor_shuffle_indices(int* indices, int n);
+void Tensor_shuffle_dataset(const float* X, const int* y, float* X_shuffled, int* y_shuffled, int n_samples, int n_features);
 void cten_assert(bool cond, const char* fmt, ...);
 void cten_assert_shape(const char* title, TensorShape a, TensorShape b);
 void cten_assert_dim(const char* title, int a, int b);
@@ -1,6 +1,229 @@
 #pragma once
 
 #include "cten.h"
+#include "common/mmap.h"
+#include "common/vector.h"
+
+#include <stdio.h>
+
+#if defined(_MSC_VER)
+#define CTEN_THREAD_LOCAL __declspec(thread)
+#else
+#define CTEN_THREAD_LOCAL _Thread_local
+#endif
+
+typedef struct PoolAllocator {
+    c11_vector /*PoolId*/ stack;
+    c11_vector /*void_p*/ pointers;
+    c11_vector /*void_p*/ pointers_swap_buffer;
+} PoolAllocator;
+
+typedef struct GraphStep GraphStep;
+typedef void (*GraphKernel)(const GraphStep* step);
+
+// one kernel invocation: everything it needs is resolved when the op runs, so it can be replayed
+typedef struct GraphStep {
+    GraphKernel kernel;
+    Tensor out;
+    Tensor inputs[4];
+    int n_inputs;
+    OpParam params[4];
+    Tensor out_aux;  // second output, e.g. the indices of max/min along a dim
+    void* ctx;       // state owned outside the graph, e.g. the optimizer whose hyperparameters a step reads
+} GraphStep;
+
+typedef struct GraphCapture GraphCapture;
+
+// lets an optimizer update each parameter as soon as Tensor_backward has finished its gradient
+typedef struct BackwardHook {
+    void (*begin)(void* ctx);
+    void (*ready)(void* ctx, GradNode* leaf);
+    void (*end)(void* ctx);
+    void* ctx;
+} BackwardHook;
+
+typedef struct cten_context {
+    PoolAllocator allocator;
+    int eval_depth;
+    uint64_t rng_state;
+    GraphCapture* capture;
+    BackwardHook backward_hook;
+} cten_context;
+
+cten_context* _cten_context();
+void _cten_context_ctor(cten_context* self);
+void _cten_context_dtor(cten_context* self);
+float _cten_randf();
+uint64_t _cten_xorshift64(uint64_t* state);  // the generator behind _cten_randf, for RNGs owned by other objects
+void _cten_shuffle(int* indices, int n, uint64_t* rng_state);
+
+// alignment of slabs and flat arenas, enough for any SIMD load
+#define CTEN_ALIGN 64
+
+// every block from _cten_malloc follows a header holding its PoolId and its slot in the pool's block list,
+// sized to keep malloc's alignment
+#define CTEN_POOL_HEADER_SIZE 16
+// the PoolId in the header of a Tensor_from_buffer view, which belongs to no pool
+#define CTEN_POOL_VIEW INT64_MIN
 
 void* _cten_malloc(size_t size);
-void _cten_zero_grad(Tensor* params, int n_params);
\ No newline at end of file
+void* _cten_malloc_aligned(size_t size);
+PoolId _cten_pool_of(const void* p);  // pool a block from _cten_malloc belongs to
+void _cten_free_block(void* p);  // frees one block from _cten_malloc of this thread ahead of cten_free
+void _cten_launch(GraphStep step);
+void _cten_capture_fresh(FloatBuffer* buf);
+void _cten_capture_leaf(GradNode* node);
+
+// Runs fn over [0, n) split into contiguous chunks on the worker pool (see cten_set_num_threads). Chunk
+// boundaries are multiples of CTEN_ALIGN bytes of floats, so chunks of a flat arena never share a cache line.
+typedef void (*cten_parallel_fn)(void* arg, int begin, int end);
+void _cten_parallel_for(int n, cten_parallel_fn fn, void* arg);
+
+// Welford/Chan moments over n_rows rows of X (the listed rows, or the first n_rows when rows is NULL), merged
+// into count, mean and m2; the reduction runs on the worker pool. The transform is x' = (x - shift) * scale.
+void _cten_welford_update(int64_t* count, double* mean, double* m2, int n_features, const float* X, const int* rows,
+                          int n_rows);
+void _cten_normalize_transform(int64_t count, const double* mean, const double* m2, int n_features, float* shift,
+                               float* scale);
+
+typedef struct cten_feature_stats {
+    int n_features;
+    int64_t count;
+    double* mean;
+    double* m2;  // sum of squared deviations from the mean
+} cten_feature_stats;
+
+void Kernel_fill(const GraphStep* s);
+void Kernel_copy(const GraphStep* s);
+
+// Parameters, gradients and optimizer state laid out in flat, aligned buffers. Every parameter starts on a
+// CTEN_ALIGN boundary and the padding stays zero, so an update can run over the whole arena in one loop.
+typedef struct ParamLeaf {
+    const GradNode* node;
+    int i;
+} ParamLeaf;
+
+typedef struct ParamArena {
+    int n_params;
+    Tensor* params;
+    int* offsets;  // start of each parameter in the flat buffers; offsets[n_params] is the total size
+    Tensor data;   // all parameters, params[i].data->flex points into it
+    Tensor grad;   // all gradients; NULL data while stepping in backward, when gradients are backward temporaries
+    Tensor* grads; // per-parameter views of `grad`, installed as params[i].node->grad
+    // gradient clipping folded into the update: clamp to [clip_min, clip_max], then scale to clip_norm
+    float clip_norm;  // 0 when off
+    float clip_min;
+    float clip_max;
+    float* clip_partials;  // one sum of squares per CTEN_CLIP_BLOCK floats of the norm pre-pass
+    // the owning optimizer's step, split so it can run per parameter from inside Tensor_backward
+    void* owner;
+    void (*tick)(void* owner);               // once per step, before any update (may be NULL)
+    void (*update)(void* owner, int i);      // parameter i, or the whole arena when i < 0
+    bool* updated;                           // parameters already stepped during the current backward
+    ParamLeaf* leaves;                       // (node, i) sorted by node, to find a parameter from its leaf
+} ParamArena;
+
+// fixed-size blocks keep the global norm's summation order, and so the result, independent of the thread count
+#define CTEN_CLIP_BLOCK 16384
+
+// what an update loop applies to each raw gradient element this step
+typedef struct GradClip {
+    float min;
+    float max;
+    float scale;
+} GradClip;
+
+static inline float GradClip__apply(const GradClip* self, float g) {
+    g = g < self->min ? self->min : (g > self->max ? self->max : g);
+    return g * self->scale;
+}
+
+void ParamArena__ctor(ParamArena* self, int n_params, Tensor* params);
+Tensor ParamArena__zeros(const ParamArena* self);
+Tensor ParamArena__view(const ParamArena* self, Tensor flat, int i);
+void ParamArena__zero_grad(ParamArena* self);
+void ParamArena__clip_grad_norm(ParamArena* self, float max_norm);
+void ParamArena__clip_grad_value_range(ParamArena* self, float min_value, float max_value);
+GradClip ParamArena__grad_clip(ParamArena* self);  // runs the norm pre-pass; call from an update kernel
+Tensor ParamArena__slice(const ParamArena* self, Tensor flat, int i);  // view of parameter i, or flat if i < 0
+Tensor ParamArena__grad(const ParamArena* self, int i);  // gradient of parameter i, or of the whole arena if i < 0
+void ParamArena__step_in_backward(ParamArena* self, bool enable);
+
+// Block-wise 8-bit optimizer state: each CTEN_QUANT_BLOCK floats share one scale (the block's absmax).
+// Non-negative state (second moments) is stored as the code of its square root, which spreads the codes
+// over the magnitudes an update divides by and keeps small values from rounding to zero before the
+// matching first moment does.
+// Each parameter's state starts on a block boundary, so updating one parameter never re-encodes another's.
+#define CTEN_QUANT_BLOCK 256
+
+typedef struct QuantBuffer {
+    int numel;  // including the padding after each parameter
+    bool nonnegative;
+    int n_params;
+    int* offsets;  // start of parameter i's state, a multiple of CTEN_QUANT_BLOCK; offsets[n_params] == numel
+    uint8_t* codes;
+    float* scales;
+} QuantBuffer;
+
+void QuantBuffer__ctor(QuantBuffer* self, const ParamArena* arena, bool nonnegative);
+int QuantBuffer__n_blocks(const QuantBuffer* self);
+// the arena elements [*begin, *begin + return) whose state is in the given block
+int QuantBuffer__span(const QuantBuffer* self, const ParamArena* arena, int block, int* begin);
+void QuantBuffer__load(const QuantBuffer* self, int block, float* out);
+void QuantBuffer__store(QuantBuffer* self, int block, const float* in);
+size_t QuantBuffer__bytes(const QuantBuffer* self);
+
+// Adafactor-style second moment: a matrix parameter keeps only its row and column averages, and
+// v[i][j] is rebuilt as row[i] * col[j] / mean(row). Vectors keep the full moment.
+typedef struct FactoredMoment {
+    int* offsets;  // start of parameter i's rows (then columns) or full moment in `data`
+    float* data;
+    int numel;
+} FactoredMoment;
+
+void FactoredMoment__ctor(FactoredMoment* self, const ParamArena* arena);
+bool FactoredMoment__is_factored(const ParamArena* arena, int i);
+// folds this step's squared gradients (clipped, plus l2 * p) into the averages; returns 1 / mean(row)
+float FactoredMoment__update(float* row, float* col, const float* p, const float* grad, int rows, int cols,
+                             const GradClip* clip, float l2, float β);
+size_t FactoredMoment__bytes(const FactoredMoment* self);
+
+typedef struct CtenFileEntry {
+    char name[CTEN_MAX_NAME];
+    uint32_t dtype;
+    uint32_t ndim;
+    int32_t shape[4];
+    uint64_t offset;  // from the start of the mapping
+    uint64_t nbytes;
+} CtenFileEntry;
+
+// a cten_file over validated entries of map, which it takes over; the entries must outlive the file
+cten_file* _cten_file_wrap(c11_mmap map, int n_entries, const CtenFileEntry* entries);
+// optimizer state entries are named "<prefix>.<field>"
+void _cten_state_name(char* buf, const char* prefix, const char* field);
+void _cten_writer_add_floats(cten_writer* self, const char* name, const float* data, int numel);
+bool _cten_file_read_floats(const cten_file* self, const char* name, float* dst, int numel);
+bool _cten_file_read_bytes(const cten_file* self, const char* name, void* dst, size_t nbytes);
+// whether the matching read would succeed, so state spread over several entries can be checked before any is copied
+bool _cten_file_matches(const cten_file* self, const char* name, Tensor dst);  // cten_file_read
+bool _cten_file_has_floats(const cten_file* self, const char* name, int numel);
+bool _cten_file_has_bytes(const cten_file* self, const char* name, size_t nbytes);
+// files are written as "<path>.tmp" and renamed over path once complete, so path never holds a partial file
+FILE* _cten_file_create(const char* path, char** tmp_path);  // NULL if it cannot be created
+bool _cten_file_commit(FILE* fp, const char* tmp_path, const char* path, bool ok);
+void QuantBuffer__write(const QuantBuffer* self, cten_writer* writer, const char* prefix, const char* field);
+bool QuantBuffer__read(QuantBuffer* self, const cten_file* file, const char* prefix, const char* field);
+bool QuantBuffer__check(const QuantBuffer* self, const cten_file* file, const char* prefix, const char* field);
+void FactoredMoment__write(const FactoredMoment* self, cten_writer* writer, const char* prefix, const char* field);
+bool FactoredMoment__read(FactoredMoment* self, const cten_file* file, const char* prefix, const char* field);
+bool FactoredMoment__check(const FactoredMoment* self, const cten_file* file, const char* prefix, const char* field);
+
+typedef struct cten_dataset {
+    c11_mmap map;
+    int n_samples;
+    int n_features;
+    int n_classes;
+    const float* features;
+    const float* targets;  // NULL if the file has no one-hot targets
+    const int* labels;
+} cten_dataset;
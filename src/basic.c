@@ -2,6 +2,7 @@
 #include "cten_internal.h"
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,15 +43,23 @@ Tensor Tensor_new(TensorShape shape, bool requires_grad) {
     memcpy(self.shape, shape, ndims * sizeof(int));
 
     int numel = TensorShape_numel(self.shape);
-    self.data = _cten_malloc(sizeof(FloatBuffer) + sizeof(float) * numel);
-    self.data->numel = numel;
+    if(_cten_context()->capture != NULL) {
+        // storage is assigned by the memory planner when the capture ends
+        self.data = _cten_malloc(sizeof(FloatBuffer));
+        self.data->numel = numel;
+        _cten_capture_fresh(self.data);
+    } else {
+        self.data = _cten_malloc(sizeof(FloatBuffer) + sizeof(float) * numel);
+        self.data->numel = numel;
+        self.data->flex = (float*)(self.data + 1);
+    }
     
     //Initialize tensor with random values
     float* data_ptr = self.data->flex;
     for (int i = 0; i < numel; i++) {
-        data_ptr[i] = ((float)rand() / RAND_MAX) * 2.0f - 1.0f;
+        data_ptr[i] = _cten_randf() * 2.0f - 1.0f;
     }
-    
+
     if(requires_grad) {
         self.node = _cten_malloc(sizeof(GradNode));
         memset(self.node, 0, sizeof(GradNode));
@@ -60,20 +69,95 @@ Tensor Tensor_new(TensorShape shape, bool requires_grad) {
     return self;
 }
 
+// The header of a view lives outside the pools, so a view can outlive any cten_free and costs the caller no
+// pool memory; it is freed by Tensor_release together with the caller's buffer. It starts like a pool block,
+// with CTEN_POOL_VIEW where the PoolId would be, so a view can be told apart from a pool tensor.
+typedef struct BufferView {
+    PoolId tag;
+    cten_release_fn release;
+    FloatBuffer buf;
+} BufferView;
+
+_Static_assert(offsetof(BufferView, buf) == CTEN_POOL_HEADER_SIZE, "BufferView must lay out like a pool block");
+
+static BufferView* BufferView__of(Tensor self, const char* fn) {
+    cten_assert(self.data != NULL && _cten_pool_of(self.data) == CTEN_POOL_VIEW,
+                "%s: the tensor was not created by Tensor_from_buffer.", fn);
+    return (BufferView*)((char*)self.data - offsetof(BufferView, buf));
+}
+
+Tensor Tensor_from_buffer(TensorShape shape, float* data, cten_release_fn release) {
+    cten_assert(data != NULL, "Tensor_from_buffer: data is NULL.");
+    Tensor self = {0};
+    memcpy(self.shape, shape, TensorShape_dim(shape) * sizeof(int));
+    BufferView* view = malloc(sizeof(BufferView));
+    cten_assert(view != NULL, "Tensor_from_buffer: out of memory.");
+    view->tag = CTEN_POOL_VIEW;
+    view->release = release;
+    view->buf.numel = TensorShape_numel(self.shape);
+    view->buf.flex = data;
+    self.data = &view->buf;
+    return self;
+}
+
+void Tensor_rebind(Tensor self, float* data) {
+    BufferView* view = BufferView__of(self, "Tensor_rebind");
+    cten_assert(data != NULL, "Tensor_rebind: data is NULL.");
+    if(view->release != NULL && view->buf.flex != data) view->release(view->buf.flex);
+    view->buf.flex = data;
+}
+
+void Tensor_release(Tensor self) {
+    BufferView* view = BufferView__of(self, "Tensor_release");
+    if(view->release != NULL) view->release(view->buf.flex);
+    free(view);
+}
+
+void Kernel_fill(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    float value = s->params[0].f;
+    if(value == 0.0f) {
+        memset(out, 0, sizeof(float) * s->out.data->numel);
+        return;
+    }
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = value;
+    }
+}
+
+void Kernel_copy(const GraphStep* s) {
+    // inputs[0] is repeated when it is smaller than the output (e.g. a scalar broadcast)
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    int in_numel = s->inputs[0].data->numel;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = in[i % in_numel];
+    }
+}
+
 Tensor Tensor_zeros(TensorShape shape, bool requires_grad) {
     Tensor self = Tensor_new(shape, requires_grad);
-    memset(self.data->flex, 0, sizeof(float) * self.data->numel);
+    _cten_launch((GraphStep){Kernel_fill, self, .params = {{.f = 0.0f}}});
     return self;
 }
 
 Tensor Tensor_ones(TensorShape shape, bool requires_grad) {
     Tensor self = Tensor_new(shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        self.data->flex[i] = 1.0f;
-    }
+    _cten_launch((GraphStep){Kernel_fill, self, .params = {{.f = 1.0f}}});
     return self;
 }
 
+static void Kernel_transpose(const GraphStep* s) {
+    Tensor self = s->inputs[0];
+    int rows = self.shape[0];
+    int cols = self.shape[1];
+    for(int i = 0; i < rows; i++) {
+        for(int j = 0; j < cols; j++) {
+            s->out.data->flex[j * rows + i] = self.data->flex[i * cols + j];
+        }
+    }
+}
+
 Tensor Tensor_transpose(Tensor self) {
     int dim = TensorShape_dim(self.shape);
     if(dim < 2){
@@ -86,13 +170,7 @@ Tensor Tensor_transpose(Tensor self) {
         new_shape[i] = self.shape[i];
     }
     Tensor result = Tensor_new(new_shape, false);
-    int rows = self.shape[0];
-    int cols = self.shape[1];
-    for(int i = 0; i < rows; i++) {
-        for(int j = 0; j < cols; j++) {
-            result.data->flex[j * rows + i] = self.data->flex[i * cols + j];
-        }
-    }
+    _cten_launch((GraphStep){Kernel_transpose, result, {self}, 1});
     return result;
 }
 
@@ -120,6 +198,39 @@ Tensor Tensor_detach(Tensor self) {
     return detached;
 }
 
+static void Kernel_accumulate(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[1].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] += in[i];
+    }
+}
+
+// first contribution is taken by reference; a leaf owns its gradient buffer (e.g. a view into an optimizer's
+// arena), so later ones are added into it in place
+static void GradNode__accumulate(GradNode* self, Tensor grad) {
+    if(self->grad.data == NULL) {
+        self->grad = grad;
+    } else if(self->n_inputs == 0) {
+        cten_assert(self->grad.data->numel == grad.data->numel, "Tensor_backward: gradient size mismatch");
+        _cten_launch((GraphStep){Kernel_accumulate, self->grad, {self->grad, grad}, 2});
+    } else {
+        self->grad = Tensor_add(self->grad, grad);
+    }
+    if(self->n_inputs == 0) _cten_capture_leaf(self);
+}
+
+// counts the edges into every node reachable from self; a node is visited when its count leaves zero
+static void Tensor__count_consumers(Tensor self) {
+    for(int i = 0; i < self.node->n_inputs; i++) {
+        GradNode* input = self.node->inputs[i].node;
+        if(input == NULL) continue;
+        if(input->n_pending++ == 0) Tensor__count_consumers(self.node->inputs[i]);
+    }
+}
+
+// Nodes are processed in topological order: a node propagates its gradient only after every consumer has
+// contributed to it, so shared intermediates are visited once and a leaf's gradient is final when it is popped.
 void Tensor_backward(Tensor self, Tensor grad) {
     if(self.node == NULL) {
         return;
@@ -131,76 +242,90 @@ void Tensor_backward(Tensor self, Tensor grad) {
     }
     
     assert(grad.node == NULL);
-    
-    // Accumulate gradient
-    if(self.node->grad.data == NULL) {
-        self.node->grad = grad;
-    } else {
-        self.node->grad = Tensor_add(self.node->grad, grad);
-    }
+    GradNode__accumulate(self.node, grad);
 
-    for(int i = 0; i < self.node->n_inputs; i++) {
-        Tensor input_tensor = self.node->inputs[i];
-        if (input_tensor.node == NULL) {
+    BackwardHook hook = _cten_context()->backward_hook;
+    if(hook.begin != NULL) hook.begin(hook.ctx);
+
+    Tensor__count_consumers(self);
+    c11_vector /*Tensor*/ ready;
+    c11_vector__ctor(&ready, sizeof(Tensor));
+    c11_vector__push(Tensor, &ready, self);
+    while(ready.length > 0) {
+        self = c11_vector__back(Tensor, &ready);
+        c11_vector__pop(&ready);
+        if(self.node->n_inputs == 0) {
+            // every consumer has run its backward, nothing reads this parameter's value any more
+            if(hook.ready != NULL) hook.ready(hook.ctx, self.node);
             continue;
         }
+        for(int i = 0; i < self.node->n_inputs; i++) {
+            Tensor input_tensor = self.node->inputs[i];
+            if (input_tensor.node == NULL) {
+                continue;
+            }
         
-        // Step 1: Get the local gradient (the partial derivative). --> For z = f(x, y), this would be dz/dx or dz/dy.
-        Tensor input_grad = self.node->grad_fn(self, i);
+            // Step 1: Get the local gradient (the partial derivative). --> For z = f(x, y), this would be dz/dx or dz/dy.
+            Tensor input_grad = self.node->grad_fn(self, i);
         
-        // This is the gradient flowing from the output, which we need to propagate backwards.
-        Tensor grad = self.node->grad;
-        int input_ndim = TensorShape_dim(input_tensor.shape);
-        int grad_ndim = TensorShape_dim(grad.shape);
+            // This is the gradient flowing from the output, which we need to propagate backwards.
+            Tensor grad = self.node->grad;
+            int input_ndim = TensorShape_dim(input_tensor.shape);
+            int grad_ndim = TensorShape_dim(grad.shape);
         
-        if ((strcmp(self.node->name, "Sum") == 0 || strcmp(self.node->name, "Mean") == 0 || strcmp(self.node->name, "MaxDim") == 0 || strcmp(self.node->name, "MinDim") == 0) && input_ndim > grad_ndim) {
-            // Find the dimension that was reduced. We assume the non-reduced dimensions match in size.
-            int unsqueeze_dim = -1;
-            int grad_idx = 0;
-            for (int dim_idx = 0; dim_idx < input_ndim; ++dim_idx) {
-                if (grad_idx >= grad_ndim || input_tensor.shape[dim_idx] != grad.shape[grad_idx]) {
-                    // Yes, this is the dimension that was removed.
-                    unsqueeze_dim = dim_idx;
-                    break;
+            if ((strcmp(self.node->name, "Sum") == 0 || strcmp(self.node->name, "Mean") == 0 || strcmp(self.node->name, "MaxDim") == 0 || strcmp(self.node->name, "MinDim") == 0) && input_ndim > grad_ndim) {
+                // Find the dimension that was reduced. We assume the non-reduced dimensions match in size.
+                int unsqueeze_dim = -1;
+                int grad_idx = 0;
+                for (int dim_idx = 0; dim_idx < input_ndim; ++dim_idx) {
+                    if (grad_idx >= grad_ndim || input_tensor.shape[dim_idx] != grad.shape[grad_idx]) {
+                        // Yes, this is the dimension that was removed.
+                        unsqueeze_dim = dim_idx;
+                        break;
+                    }
+                    grad_idx++;
                 }
-                grad_idx++;
-            }
 
-            if (unsqueeze_dim != -1) {
-                grad = Tensor_unsqueeze(grad, unsqueeze_dim);
-            } else {
-                cten_assert(false, "Could not deduce unsqueeze dimension.");
+                if (unsqueeze_dim != -1) {
+                    grad = Tensor_unsqueeze(grad, unsqueeze_dim);
+                } else {
+                    cten_assert(false, "Could not deduce unsqueeze dimension.");
+                }
             }
-        }
         
-        // Step 2: Apply the chain rule (upstream_grad * local_grad)
-        Tensor combined_grad;
-        if (strcmp(self.node->name, "Softmax") == 0) {
-            combined_grad = input_grad;
-        } else if(strcmp(self.node->name, "Matmul") == 0) {
-            if (i == 0) {
-                combined_grad = Tensor_matmul(grad, input_grad);
+            // Step 2: Apply the chain rule (upstream_grad * local_grad)
+            Tensor combined_grad;
+            if (strcmp(self.node->name, "Softmax") == 0) {
+                combined_grad = input_grad;
+            } else if(strcmp(self.node->name, "Matmul") == 0) {
+                if (i == 0) {
+                    combined_grad = Tensor_matmul(grad, input_grad);
+                } else {
+                    combined_grad = Tensor_matmul(input_grad, grad);
+                }
             } else {
-                combined_grad = Tensor_matmul(input_grad, grad);
+                combined_grad = Tensor_mul(grad, input_grad);
             }
-        } else {
-            combined_grad = Tensor_mul(grad, input_grad);
-        }
         
-        // Step 3: Handle broadcasting. --> If the original input was broadcasted, the resulting gradient will have the broadcasted shape, it must be reduced back down to the original input's shape.
-        bool needs_reduction = false;
-        for (int dim = 0; dim < 4; dim++) {
-            if (combined_grad.shape[dim] != input_tensor.shape[dim]) {
-                needs_reduction = true;
-                break;
+            // Step 3: Handle broadcasting. --> If the original input was broadcasted, the resulting gradient will have the broadcasted shape, it must be reduced back down to the original input's shape.
+            bool needs_reduction = false;
+            for (int dim = 0; dim < 4; dim++) {
+                if (combined_grad.shape[dim] != input_tensor.shape[dim]) {
+                    needs_reduction = true;
+                    break;
+                }
             }
-        }
         
-        if (needs_reduction) {
-            combined_grad = reduce_gradient_for_broadcasting(combined_grad, input_tensor.shape, self.shape);
+            if (needs_reduction) {
+                combined_grad = reduce_gradient_for_broadcasting(combined_grad, input_tensor.shape, self.shape);
+            }
+            GradNode__accumulate(input_tensor.node, combined_grad);
+            if(--input_tensor.node->n_pending == 0) c11_vector__push(Tensor, &ready, input_tensor);
         }
-        Tensor_backward(input_tensor, combined_grad);
     }
+    c11_vector__dtor(&ready);
+
+    if(hook.end != NULL) hook.end(hook.ctx);
 }
 
 int Tensor_backward_apply(Tensor self, void (*f)(Tensor, void*), void* ctx) {
@@ -213,6 +338,42 @@ int Tensor_backward_apply(Tensor self, void (*f)(Tensor, void*), void* ctx) {
     return count;
 }
 
+float cten_accumulate_grad(Tensor* params, int n_params, PoolId scratch, int n_samples, int micro_batch_size,
+                           cten_loss_fn loss_fn, void* ctx) {
+    cten_assert(n_samples > 0 && micro_batch_size > 0, "cten_accumulate_grad: n_samples (%d) and micro_batch_size (%d) must be positive.",
+                n_samples, micro_batch_size);
+    // the first contribution to a leaf is taken by reference, which would leave it pointing into the freed
+    // scratch pool; give every parameter a persistent buffer next to its data instead
+    for(int i = 0; i < n_params; i++) {
+        GradNode* node = params[i].node;
+        if(node == NULL) continue;
+        if(node->grad.data == NULL) {
+            cten_begin_malloc(_cten_pool_of(params[i].data));
+            node->grad = Tensor_zeros(params[i].shape, false);
+            cten_end_malloc();
+        }
+        cten_assert(_cten_pool_of(node->grad.data) != scratch, "cten_accumulate_grad: parameter %d's gradient lives in the scratch pool.", i);
+    }
+
+    float loss_sum = 0.0f;
+    for(int begin = 0; begin < n_samples; begin += micro_batch_size) {
+        int end = begin + micro_batch_size < n_samples ? begin + micro_batch_size : n_samples;
+        cten_begin_malloc(scratch);
+        Tensor loss = loss_fn(ctx, begin, end);
+        cten_assert(loss.data->numel == 1, "cten_accumulate_grad: the loss must be a scalar.");
+        // a mean over this micro-batch weighted by its share of the logical batch: the accumulated gradient
+        // equals the gradient of the mean over all n_samples, whatever the last micro-batch's size
+        float scale = (float)(end - begin) / n_samples;
+        Tensor seed = Tensor_new((TensorShape){1}, false);
+        _cten_launch((GraphStep){Kernel_fill, seed, .params = {{.f = scale}}});
+        loss_sum += scale * loss.data->flex[0];
+        Tensor_backward(loss, seed);
+        cten_end_malloc();
+        cten_free(scratch);
+    }
+    return loss_sum;
+}
+
 void Tensor_print(Tensor self) {
     if(self.data == NULL) {
         printf("Tensor()\n");
@@ -241,11 +402,3 @@ void Tensor_print(Tensor self) {
     }
     printf(")\n");
 }
-
-void _cten_zero_grad(Tensor* params, int n_params) {
-    for(int i = 0; i < n_params; i++) {
-        Tensor t = params[i];
-        if(t.node == NULL) continue;
-        t.node->grad = Tensor_zeros(t.shape, false);
-    }
-}
\ No newline at end of file
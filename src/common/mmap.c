@@ -0,0 +1,73 @@
+#include "common/mmap.h"
+
+#if defined(_WIN32)
+
+bool c11_mmap__open(c11_mmap* self, const char* path) {
+    self->data = NULL;
+    self->size = 0;
+    self->mapping = NULL;
+    self->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(self->file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(self->file, &size) || size.QuadPart == 0) {
+        CloseHandle(self->file);
+        return false;
+    }
+    self->mapping = CreateFileMappingA(self->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(self->mapping == NULL) {
+        CloseHandle(self->file);
+        return false;
+    }
+    self->data = MapViewOfFile(self->mapping, FILE_MAP_READ, 0, 0, 0);
+    if(self->data == NULL) {
+        CloseHandle(self->mapping);
+        CloseHandle(self->file);
+        return false;
+    }
+    self->size = (size_t)size.QuadPart;
+    return true;
+}
+
+void c11_mmap__close(c11_mmap* self) {
+    if(self->data == NULL) return;
+    UnmapViewOfFile(self->data);
+    CloseHandle(self->mapping);
+    CloseHandle(self->file);
+    self->data = NULL;
+    self->size = 0;
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool c11_mmap__open(c11_mmap* self, const char* path) {
+    self->data = NULL;
+    self->size = 0;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if(data == MAP_FAILED) return false;
+    self->data = data;
+    self->size = (size_t)st.st_size;
+    return true;
+}
+
+void c11_mmap__close(c11_mmap* self) {
+    if(self->data == NULL) return;
+    munmap((void*)self->data, self->size);
+    self->data = NULL;
+    self->size = 0;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include "common/threads.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+typedef struct {
+    c11_thrd_fn fn;
+    void* arg;
+} c11_thrd_start;
+
+#if defined(_WIN32)
+
+static DWORD WINAPI c11_thrd__entry(LPVOID p) {
+    c11_thrd_start start = *(c11_thrd_start*)p;
+    free(p);
+    start.fn(start.arg);
+    return 0;
+}
+
+bool c11_thrd__create(c11_thrd_t* self, c11_thrd_fn fn, void* arg) {
+    c11_thrd_start* start = malloc(sizeof(c11_thrd_start));
+    assert(start != NULL);
+    start->fn = fn;
+    start->arg = arg;
+    *self = CreateThread(NULL, 0, c11_thrd__entry, start, 0, NULL);
+    if(*self == NULL) {
+        free(start);
+        return false;
+    }
+    return true;
+}
+
+void c11_thrd__join(c11_thrd_t self) {
+    WaitForSingleObject(self, INFINITE);
+    CloseHandle(self);
+}
+
+int c11_thrd__hardware_concurrency() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+
+void c11_mtx__ctor(c11_mtx_t* self) { InitializeCriticalSection(self); }
+
+void c11_mtx__dtor(c11_mtx_t* self) { DeleteCriticalSection(self); }
+
+void c11_mtx__lock(c11_mtx_t* self) { EnterCriticalSection(self); }
+
+void c11_mtx__unlock(c11_mtx_t* self) { LeaveCriticalSection(self); }
+
+void c11_cnd__ctor(c11_cnd_t* self) { InitializeConditionVariable(self); }
+
+void c11_cnd__dtor(c11_cnd_t* self) { (void)self; }
+
+void c11_cnd__wait(c11_cnd_t* self, c11_mtx_t* mtx) { SleepConditionVariableCS(self, mtx, INFINITE); }
+
+void c11_cnd__signal(c11_cnd_t* self) { WakeConditionVariable(self); }
+
+void c11_cnd__broadcast(c11_cnd_t* self) { WakeAllConditionVariable(self); }
+
+#else
+
+#include <unistd.h>
+
+static void* c11_thrd__entry(void* p) {
+    c11_thrd_start start = *(c11_thrd_start*)p;
+    free(p);
+    start.fn(start.arg);
+    return NULL;
+}
+
+bool c11_thrd__create(c11_thrd_t* self, c11_thrd_fn fn, void* arg) {
+    c11_thrd_start* start = malloc(sizeof(c11_thrd_start));
+    assert(start != NULL);
+    start->fn = fn;
+    start->arg = arg;
+    if(pthread_create(self, NULL, c11_thrd__entry, start) != 0) {
+        free(start);
+        return false;
+    }
+    return true;
+}
+
+void c11_thrd__join(c11_thrd_t self) { pthread_join(self, NULL); }
+
+int c11_thrd__hardware_concurrency() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+void c11_mtx__ctor(c11_mtx_t* self) { pthread_mutex_init(self, NULL); }
+
+void c11_mtx__dtor(c11_mtx_t* self) { pthread_mutex_destroy(self); }
+
+void c11_mtx__lock(c11_mtx_t* self) { pthread_mutex_lock(self); }
+
+void c11_mtx__unlock(c11_mtx_t* self) { pthread_mutex_unlock(self); }
+
+void c11_cnd__ctor(c11_cnd_t* self) { pthread_cond_init(self, NULL); }
+
+void c11_cnd__dtor(c11_cnd_t* self) { pthread_cond_destroy(self); }
+
+void c11_cnd__wait(c11_cnd_t* self, c11_mtx_t* mtx) { pthread_cond_wait(self, mtx); }
+
+void c11_cnd__signal(c11_cnd_t* self) { pthread_cond_signal(self); }
+
+void c11_cnd__broadcast(c11_cnd_t* self) { pthread_cond_broadcast(self); }
+
+#endif
@@ -1,10 +1,98 @@
 #include "cten.h"
 #include "cten_internal.h"
 
-static int _eval_depth = 0;
+#include <stdlib.h>
+#include <string.h>
 
-void cten_begin_eval() { _eval_depth++; }
+#define CTEN_DEFAULT_SEED 0x853c49e6748fea9bULL
 
-bool cten_is_eval() { return _eval_depth > 0; }
+// every thread starts with its own default context; `cten_context_bind` swaps in another one
+static CTEN_THREAD_LOCAL cten_context g_default_context;
+static CTEN_THREAD_LOCAL bool g_default_context_ready = false;
+static CTEN_THREAD_LOCAL cten_context* g_current_context = NULL;
 
-void cten_end_eval() { _eval_depth--; }
\ No newline at end of file
+// built on first use, so a thread that never calls cten_initilize still gets working pools and a seeded RNG
+static cten_context* cten_context__default() {
+    if(!g_default_context_ready) {
+        _cten_context_ctor(&g_default_context);
+        g_default_context_ready = true;
+    }
+    return &g_default_context;
+}
+
+cten_context* _cten_context() { return g_current_context != NULL ? g_current_context : cten_context__default(); }
+
+void _cten_context_ctor(cten_context* self) {
+    memset(self, 0, sizeof(cten_context));
+    self->rng_state = CTEN_DEFAULT_SEED;
+    c11_vector__ctor(&self->allocator.stack, sizeof(PoolId));
+    c11_vector__ctor(&self->allocator.pointers, sizeof(void*));
+    c11_vector__ctor(&self->allocator.pointers_swap_buffer, sizeof(void*));
+}
+
+void _cten_context_dtor(cten_context* self) {
+    PoolAllocator* allocator = &self->allocator;
+    for(int i = 0; i < allocator->pointers.length; i++) {
+        void* p = c11__getitem(void*, &allocator->pointers, i);
+        free(p);
+    }
+    assert(allocator->pointers_swap_buffer.length == 0);
+    c11_vector__dtor(&allocator->stack);
+    c11_vector__dtor(&allocator->pointers);
+    c11_vector__dtor(&allocator->pointers_swap_buffer);
+}
+
+void cten_initilize() { cten_context__default(); }
+
+// frees the calling thread's default context; it is built again if the thread uses it afterwards
+void cten_finalize() {
+    if(!g_default_context_ready) return;
+    _cten_context_dtor(&g_default_context);
+    g_default_context_ready = false;
+}
+
+cten_context* cten_context_new() {
+    cten_context* self = malloc(sizeof(cten_context));
+    assert(self != NULL);
+    _cten_context_ctor(self);
+    return self;
+}
+
+void cten_context_delete(cten_context* self) {
+    cten_assert(self != _cten_context(), "cten_context_delete: context is still bound");
+    _cten_context_dtor(self);
+    free(self);
+}
+
+cten_context* cten_context_current() { return _cten_context(); }
+
+cten_context* cten_context_bind(cten_context* ctx) {
+    cten_context* prev = _cten_context();
+    g_current_context = ctx;
+    return prev;
+}
+
+void cten_begin_eval() { _cten_context()->eval_depth++; }
+
+bool cten_is_eval() { return _cten_context()->eval_depth > 0; }
+
+void cten_end_eval() { _cten_context()->eval_depth--; }
+
+void cten_manual_seed(uint64_t seed) { _cten_context()->rng_state = seed != 0 ? seed : CTEN_DEFAULT_SEED; }
+
+// saved with a checkpoint so a resumed run draws the same numbers
+uint64_t cten_get_rng_state() { return _cten_context()->rng_state; }
+
+void cten_set_rng_state(uint64_t state) { cten_manual_seed(state); }
+
+// xorshift64*: no shared state, so concurrent contexts never contend on `rand()`'s lock
+uint64_t _cten_xorshift64(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+float _cten_randf() { return (float)(_cten_xorshift64(&_cten_context()->rng_state) >> 40) / (float)(1 << 24); }
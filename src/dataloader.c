@@ -0,0 +1,233 @@
+#include "cten.h"
+#include "cten_internal.h"
+#include "common/threads.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// A producer thread assembles batches into a ring of preallocated buffers while the training thread works
+// on the previous ones. The consumer owns the batch returned by cten_dataloader_next until its next call,
+// so the producer can fill at most n_buffers - 1 batches ahead.
+typedef struct BatchSlot {
+    FloatBuffer x;  // numel is set to the rows of the batch it holds
+    FloatBuffer y;
+    int* labels;
+    int n;
+} BatchSlot;
+
+typedef struct cten_dataloader {
+    const cten_dataset* dataset;
+    const int* rows;  // the rows to load, in their unshuffled order
+    int n_rows;
+    int batch_size;
+    int n_batches;
+    bool shuffle;
+    int block_rows;
+    uint64_t rng_state;
+    int* order;   // producer only: the rows of the current epoch
+    int* blocks;  // producer only: the block order of a block shuffle
+    float* shift;  // NULL, or the normalization x' = (x - shift) * scale applied while gathering
+    float* scale;
+
+    BatchSlot* slots;
+    int n_slots;
+    c11_thrd_t thread;
+    bool started;
+    c11_mtx_t lock;
+    c11_cnd_t ready;  // a batch was produced
+    c11_cnd_t freed;  // a batch was released, or stop was set
+    uint64_t produced;
+    uint64_t taken;
+    uint64_t released;
+    bool stop;
+    int batch_in_epoch;  // consumer only
+} cten_dataloader;
+
+// Epochs are permutations of row indices; the rows themselves are only read when a batch is gathered. A
+// block shuffle permutes whole blocks of consecutive rows and then the rows inside each block, so a batch
+// reads a few runs of neighbouring rows instead of scattered ones.
+static void cten_dataloader__shuffle(cten_dataloader* self) {
+    if(self->block_rows <= 1) {
+        _cten_shuffle(self->order, self->n_rows, &self->rng_state);
+        return;
+    }
+    int n_blocks = (self->n_rows + self->block_rows - 1) / self->block_rows;
+    _cten_shuffle(self->blocks, n_blocks, &self->rng_state);
+    int* out = self->order;
+    for(int b = 0; b < n_blocks; b++) {
+        int first = self->blocks[b] * self->block_rows;
+        int n = self->n_rows - first < self->block_rows ? self->n_rows - first : self->block_rows;
+        memcpy(out, self->rows + first, sizeof(int) * n);
+        _cten_shuffle(out, n, &self->rng_state);
+        out += n;
+    }
+}
+
+static void cten_dataloader__fill(cten_dataloader* self, BatchSlot* slot, int first) {
+    const cten_dataset* ds = self->dataset;
+    int n_features = ds->n_features, n_classes = ds->n_classes;
+    int n = self->n_rows - first < self->batch_size ? self->n_rows - first : self->batch_size;
+    memset(slot->y.flex, 0, sizeof(float) * n * n_classes);
+    for(int r = 0; r < n; r++) {
+        int row = self->order[first + r];
+        const float* src = ds->features + (size_t)row * n_features;
+        float* dst = slot->x.flex + r * n_features;
+        if(self->shift != NULL) {
+            for(int j = 0; j < n_features; j++) dst[j] = (src[j] - self->shift[j]) * self->scale[j];
+        } else {
+            memcpy(dst, src, sizeof(float) * n_features);
+        }
+        slot->labels[r] = ds->labels[row];
+        slot->y.flex[r * n_classes + ds->labels[row]] = 1.0f;
+    }
+    slot->n = n;
+    slot->x.numel = n * n_features;
+    slot->y.numel = n * n_classes;
+}
+
+static void cten_dataloader__producer(void* arg) {
+    cten_dataloader* self = arg;
+    while(true) {
+        if(self->shuffle) cten_dataloader__shuffle(self);
+        for(int b = 0; b < self->n_batches; b++) {
+            c11_mtx__lock(&self->lock);
+            while(!self->stop && self->produced - self->released == (uint64_t)self->n_slots) {
+                c11_cnd__wait(&self->freed, &self->lock);
+            }
+            bool stop = self->stop;
+            BatchSlot* slot = &self->slots[self->produced % self->n_slots];
+            c11_mtx__unlock(&self->lock);
+            if(stop) return;
+
+            cten_dataloader__fill(self, slot, b * self->batch_size);
+
+            c11_mtx__lock(&self->lock);
+            self->produced++;
+            c11_cnd__signal(&self->ready);
+            c11_mtx__unlock(&self->lock);
+        }
+    }
+}
+
+cten_dataloader* cten_dataloader_new_subset(const cten_dataset* dataset, const int* rows, int n_rows, int batch_size,
+                                            int n_buffers, bool shuffle) {
+    cten_assert(n_rows > 0, "cten_dataloader_new_subset: expected rows, but got %d.", n_rows);
+    cten_assert(batch_size > 0, "cten_dataloader: batch_size must be positive, but got %d.", batch_size);
+    cten_assert(n_buffers >= 2, "cten_dataloader: need at least 2 buffers, but got %d.", n_buffers);
+    for(int i = 0; i < n_rows; i++) {
+        cten_assert(rows[i] >= 0 && rows[i] < dataset->n_samples, "cten_dataloader_new_subset: row %d out of range [0, %d).",
+                    rows[i], dataset->n_samples);
+    }
+    cten_dataloader* self = _cten_malloc(sizeof(cten_dataloader));
+    memset(self, 0, sizeof(cten_dataloader));
+    self->dataset = dataset;
+    int* own_rows = _cten_malloc(sizeof(int) * n_rows);
+    memcpy(own_rows, rows, sizeof(int) * n_rows);
+    self->rows = own_rows;
+    self->n_rows = n_rows;
+    self->batch_size = batch_size;
+    self->n_batches = (n_rows + batch_size - 1) / batch_size;
+    self->shuffle = shuffle;
+    // drawn from the context, so cten_manual_seed makes the epochs reproducible
+    self->rng_state = _cten_xorshift64(&_cten_context()->rng_state) | 1;
+    self->order = _cten_malloc(sizeof(int) * n_rows);
+    memcpy(self->order, rows, sizeof(int) * n_rows);
+
+    self->n_slots = n_buffers;
+    self->slots = _cten_malloc(sizeof(BatchSlot) * n_buffers);
+    for(int i = 0; i < n_buffers; i++) {
+        BatchSlot* slot = &self->slots[i];
+        slot->x.flex = _cten_malloc_aligned(sizeof(float) * batch_size * dataset->n_features);
+        slot->y.flex = _cten_malloc_aligned(sizeof(float) * batch_size * (dataset->n_classes > 0 ? dataset->n_classes : 1));
+        slot->labels = _cten_malloc(sizeof(int) * batch_size);
+    }
+    c11_mtx__ctor(&self->lock);
+    c11_cnd__ctor(&self->ready);
+    c11_cnd__ctor(&self->freed);
+    return self;
+}
+
+cten_dataloader* cten_dataloader_new(const cten_dataset* dataset, int begin, int end, int batch_size, int n_buffers,
+                                     bool shuffle) {
+    cten_assert(begin >= 0 && begin < end && end <= dataset->n_samples,
+                "cten_dataloader_new: rows [%d, %d) out of range [0, %d).", begin, end, dataset->n_samples);
+    int* rows = malloc(sizeof(int) * (end - begin));
+    for(int i = 0; i < end - begin; i++) rows[i] = begin + i;
+    cten_dataloader* self = cten_dataloader_new_subset(dataset, rows, end - begin, batch_size, n_buffers, shuffle);
+    free(rows);
+    return self;
+}
+
+void cten_dataloader_config(cten_dataloader* self, uint64_t seed, int block_rows) {
+    cten_assert(!self->started, "cten_dataloader_config: the loader has already started.");
+    cten_assert(block_rows >= 0, "cten_dataloader_config: block_rows cannot be negative, but got %d.", block_rows);
+    if(seed != 0) self->rng_state = seed;
+    self->block_rows = block_rows;
+    if(block_rows > 1) {
+        int n_blocks = (self->n_rows + block_rows - 1) / block_rows;
+        self->blocks = _cten_malloc(sizeof(int) * n_blocks);
+        for(int b = 0; b < n_blocks; b++) self->blocks[b] = b;
+    }
+}
+
+// fused into the gather, so the normalized rows exist only in the batch buffers
+void cten_dataloader_normalize(cten_dataloader* self, const cten_feature_stats* stats) {
+    cten_assert(!self->started, "cten_dataloader_normalize: the loader has already started.");
+    int n_features = self->dataset->n_features;
+    cten_assert_dim("cten_dataloader_normalize: features", stats->n_features, n_features);
+    if(self->shift == NULL) {
+        self->shift = _cten_malloc(sizeof(float) * 2 * n_features);
+        self->scale = self->shift + n_features;
+    }
+    cten_feature_stats_transform(stats, self->shift, self->scale);
+}
+
+int cten_dataloader_num_batches(const cten_dataloader* self) { return self->n_batches; }
+
+bool cten_dataloader_next(cten_dataloader* self, Tensor* x, Tensor* y) {
+    // started on first use, so the loader can still be configured after cten_dataloader_new
+    if(!self->started) {
+        bool ok = c11_thrd__create(&self->thread, cten_dataloader__producer, self);
+        cten_assert(ok, "cten_dataloader_next: cannot start the producer thread.");
+        self->started = true;
+    }
+    c11_mtx__lock(&self->lock);
+    if(self->taken > self->released) {
+        self->released++;
+        c11_cnd__signal(&self->freed);
+    }
+    if(self->batch_in_epoch == self->n_batches) {
+        self->batch_in_epoch = 0;
+        c11_mtx__unlock(&self->lock);
+        return false;
+    }
+    while(self->taken == self->produced) {
+        c11_cnd__wait(&self->ready, &self->lock);
+    }
+    BatchSlot* slot = &self->slots[self->taken % self->n_slots];
+    self->taken++;
+    self->batch_in_epoch++;
+    c11_mtx__unlock(&self->lock);
+
+    *x = (Tensor){{slot->n, self->dataset->n_features}, &slot->x, NULL};
+    if(y != NULL) *y = (Tensor){{slot->n, self->dataset->n_classes}, &slot->y, NULL};
+    return true;
+}
+
+const int* cten_dataloader_labels(const cten_dataloader* self) {
+    cten_assert(self->taken > self->released, "cten_dataloader_labels: no batch is being used.");
+    return self->slots[(self->taken - 1) % self->n_slots].labels;
+}
+
+void cten_dataloader_free(cten_dataloader* self) {
+    if(self->started) {
+        c11_mtx__lock(&self->lock);
+        self->stop = true;
+        c11_cnd__broadcast(&self->freed);
+        c11_mtx__unlock(&self->lock);
+        c11_thrd__join(self->thread);
+    }
+    c11_cnd__dtor(&self->freed);
+    c11_cnd__dtor(&self->ready);
+    c11_mtx__dtor(&self->lock);
+}
@@ -0,0 +1,440 @@
+#include "cten.h"
+#include "cten_internal.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Streaming CSV/TSV reader. The file is read in chunks of CTEN_CSV_CHUNK bytes; a row cut by the end of a
+// chunk is moved to the front of the buffer before the next chunk is appended, so memory use does not
+// depend on the file size. Rows are parsed straight into the caller's tensor.
+#define CTEN_CSV_CHUNK (1 << 20)
+
+typedef struct cten_csv {
+    FILE* fp;
+    char* buf;
+    size_t capacity;
+    size_t begin, end;  // the unread bytes
+    bool eof;
+    char delimiter;
+    int n_columns;
+    int label_column;
+    int line;
+} cten_csv;
+
+static bool cten_csv__is_space(const cten_csv* self, char c) { return c == ' ' || (c == '\t' && self->delimiter != '\t'); }
+
+static void cten_csv__refill(cten_csv* self) {
+    memmove(self->buf, self->buf + self->begin, self->end - self->begin);
+    self->end -= self->begin;
+    self->begin = 0;
+    if(self->end == self->capacity) {
+        // a single row longer than the buffer
+        self->capacity *= 2;
+        self->buf = realloc(self->buf, self->capacity);
+        cten_assert(self->buf != NULL, "cten_csv: cannot grow the row buffer to %zu bytes.", self->capacity);
+    }
+    size_t n = fread(self->buf + self->end, 1, self->capacity - self->end, self->fp);
+    self->end += n;
+    if(n == 0) self->eof = true;
+}
+
+// the next non-blank line without its line break; valid until the next call
+static bool cten_csv__next_line(cten_csv* self, const char** first, const char** last) {
+    while(true) {
+        char* start = self->buf + self->begin;
+        char* nl = memchr(start, '\n', self->end - self->begin);
+        if(nl == NULL && !self->eof) {
+            cten_csv__refill(self);
+            continue;
+        }
+        if(nl == NULL && self->begin == self->end) return false;
+        const char* end = nl != NULL ? nl : self->buf + self->end;
+        self->begin = nl != NULL ? (size_t)(nl + 1 - self->buf) : self->end;
+        self->line++;
+        if(end > start && end[-1] == '\r') end--;
+        const char* p = start;
+        while(p < end && (*p == ' ' || *p == '\t')) p++;
+        if(p == end) continue;
+        *first = start;
+        *last = end;
+        return true;
+    }
+}
+
+static const double cten_pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// "nan", "inf" and other spellings the digit parser does not know; rare enough for strtof
+static bool cten_csv__parse_special(const char** pp, const char* end, float* out) {
+    char tmp[32];
+    size_t n = (size_t)(end - *pp) < sizeof(tmp) - 1 ? (size_t)(end - *pp) : sizeof(tmp) - 1;
+    memcpy(tmp, *pp, n);
+    tmp[n] = '\0';
+    char* stop;
+    *out = strtof(tmp, &stop);
+    if(stop == tmp) return false;
+    *pp += stop - tmp;
+    return true;
+}
+
+// Decimal to float without strtod: up to 19 significant digits are gathered into an integer, which is
+// scaled by an exact power of ten in double when both are exactly representable (Clinger's fast path) and
+// by pow() otherwise. Either way the double is far more precise than the float it is rounded to.
+static bool cten_csv__parse_float(const char** pp, const char* end, float* out) {
+    const char* p = *pp;
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    uint64_t mantissa = 0;
+    int exp10 = 0, n_significant = 0;
+    bool any = false;
+    for(; p < end && (unsigned)(*p - '0') < 10; p++) {
+        any = true;
+        if(n_significant < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            n_significant += mantissa != 0;
+        } else {
+            exp10++;
+        }
+    }
+    if(p < end && *p == '.') {
+        p++;
+        for(; p < end && (unsigned)(*p - '0') < 10; p++) {
+            any = true;
+            if(n_significant < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                n_significant += mantissa != 0;
+                exp10--;
+            }
+        }
+    }
+    if(!any) return cten_csv__parse_special(pp, end, out);
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool exp_negative = false;
+        if(q < end && (*q == '-' || *q == '+')) exp_negative = *q++ == '-';
+        if(q < end && (unsigned)(*q - '0') < 10) {
+            int e = 0;
+            for(; q < end && (unsigned)(*q - '0') < 10; q++) {
+                if(e < 100000) e = e * 10 + (*q - '0');
+            }
+            exp10 += exp_negative ? -e : e;
+            p = q;
+        }
+    }
+    double value;
+    if(mantissa == 0) {
+        value = 0.0;
+    } else if(mantissa < ((uint64_t)1 << 53) && exp10 >= -22 && exp10 <= 22) {
+        value = exp10 < 0 ? (double)mantissa / cten_pow10[-exp10] : (double)mantissa * cten_pow10[exp10];
+    } else {
+        value = (double)mantissa * pow(10.0, exp10);
+    }
+    *out = (float)(negative ? -value : value);
+    *pp = p;
+    return true;
+}
+
+static bool cten_csv__parse_row(const cten_csv* self, const char* p, const char* end, float* x, int* label) {
+    for(int c = 0; c < self->n_columns; c++) {
+        while(p < end && cten_csv__is_space(self, *p)) p++;
+        float value;
+        if(!cten_csv__parse_float(&p, end, &value)) return false;
+        while(p < end && cten_csv__is_space(self, *p)) p++;
+        if(c + 1 < self->n_columns) {
+            if(p == end || *p != self->delimiter) return false;
+            p++;
+        }
+        if(c == self->label_column) {
+            if(!(fabsf(value) < 1e9f) || value != (float)(int)value) return false;
+            if(label != NULL) *label = (int)value;
+        } else if(x != NULL) {
+            *x++ = value;
+        }
+    }
+    return p == end;
+}
+
+cten_csv* cten_csv_open(const char* path, char delimiter, bool has_header, int label_column) {
+    FILE* fp = fopen(path, "rb");
+    if(fp == NULL) return NULL;
+    cten_csv* self = _cten_malloc(sizeof(cten_csv));
+    memset(self, 0, sizeof(cten_csv));
+    self->fp = fp;
+    self->capacity = CTEN_CSV_CHUNK;
+    self->buf = malloc(self->capacity);
+    cten_assert(self->buf != NULL, "cten_csv_open: out of memory.");
+    self->delimiter = delimiter;
+
+    const char *first, *last;
+    if(has_header && !cten_csv__next_line(self, &first, &last)) {
+        cten_csv_close(self);
+        return NULL;
+    }
+    // the first row fixes the column count; it is left unread
+    if(!cten_csv__next_line(self, &first, &last)) {
+        cten_csv_close(self);
+        return NULL;
+    }
+    self->n_columns = 1;
+    for(const char* p = first; p < last; p++) self->n_columns += *p == delimiter;
+    self->label_column = label_column < 0 ? self->n_columns + label_column : label_column;
+    self->begin = (size_t)(first - self->buf);
+    self->line--;
+    if(self->n_columns < 2 || self->label_column < 0 || self->label_column >= self->n_columns ||
+       !cten_csv__parse_row(self, first, last, NULL, NULL)) {
+        cten_csv_close(self);
+        return NULL;
+    }
+    return self;
+}
+
+int cten_csv_num_features(const cten_csv* self) { return self->n_columns - 1; }
+
+int cten_csv_line(const cten_csv* self) { return self->line; }
+
+int cten_csv_read(cten_csv* self, Tensor X, int* labels) {
+    int n_features = self->n_columns - 1;
+    cten_assert(TensorShape_dim(X.shape) == 2 && X.shape[1] == n_features,
+                "cten_csv_read: X must have shape {rows, %d}.", n_features);
+    int n = 0;
+    const char *first, *last;
+    while(n < X.shape[0] && cten_csv__next_line(self, &first, &last)) {
+        if(!cten_csv__parse_row(self, first, last, X.data->flex + (size_t)n * n_features, labels ? labels + n : NULL)) {
+            return -1;
+        }
+        n++;
+    }
+    return n;
+}
+
+void cten_csv_close(cten_csv* self) {
+    fclose(self->fp);
+    free(self->buf);
+}
+
+int cten_load_csv(const char* path, char delimiter, bool has_header, int label_column, Tensor* X, int** labels) {
+    // a first pass only finds the rows, so the tensor can be allocated once and filled in place
+    cten_csv* csv = cten_csv_open(path, delimiter, has_header, label_column);
+    if(csv == NULL) return -1;
+    int n_rows = 0;
+    const char *first, *last;
+    while(cten_csv__next_line(csv, &first, &last)) n_rows++;
+    cten_csv_close(csv);
+
+    csv = cten_csv_open(path, delimiter, has_header, label_column);
+    if(csv == NULL) return -1;
+    *X = Tensor_new((TensorShape){n_rows, cten_csv_num_features(csv)}, false);
+    *labels = _cten_malloc(sizeof(int) * (n_rows > 0 ? n_rows : 1));
+    int n = cten_csv_read(csv, *X, *labels);
+    cten_csv_close(csv);
+    return n == n_rows ? n : -1;
+}
+
+// Binary dataset file (little-endian):
+//   CtenDatasetHeader
+//   features: float[n_samples][n_features], at a multiple of CTEN_ALIGN
+//   targets:  float[n_samples][n_classes] one-hot rows, at a multiple of CTEN_ALIGN (optional)
+//   labels:   int32[n_samples], at a multiple of CTEN_ALIGN
+// Rows are packed, so any run of consecutive rows is a dense {n, n_features} tensor inside the mapping.
+#define CTEN_DATASET_MAGIC "CTENDS"
+#define CTEN_DATASET_VERSION 1
+
+typedef struct CtenDatasetHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_features;
+    uint32_t n_classes;
+    uint32_t has_targets;
+    uint64_t n_samples;
+    uint64_t features_offset;
+    uint64_t targets_offset;
+    uint64_t labels_offset;
+} CtenDatasetHeader;
+
+// Features are streamed to the file as they arrive; the labels are kept (4 bytes per row) until close,
+// which writes the targets and labels after the features and then the header.
+typedef struct DatasetWriter {
+    FILE* fp;
+    char* tmp_path;
+    uint64_t pos;
+    int n_features;
+    bool ok;
+    c11_vector /*int*/ labels;
+} DatasetWriter;
+
+static void DatasetWriter__write(DatasetWriter* self, const void* data, size_t nbytes) {
+    if(self->ok && nbytes > 0) self->ok = fwrite(data, 1, nbytes, self->fp) == nbytes;
+    self->pos += nbytes;
+}
+
+static void DatasetWriter__pad(DatasetWriter* self) {
+    static const char zeros[CTEN_ALIGN] = {0};
+    DatasetWriter__write(self, zeros, (size_t)((CTEN_ALIGN - self->pos % CTEN_ALIGN) % CTEN_ALIGN));
+}
+
+static bool DatasetWriter__open(DatasetWriter* self, const char* path, int n_features) {
+    self->fp = _cten_file_create(path, &self->tmp_path);
+    if(self->fp == NULL) return false;
+    self->pos = 0;
+    self->n_features = n_features;
+    self->ok = true;
+    c11_vector__ctor(&self->labels, sizeof(int));
+    // patched on close
+    CtenDatasetHeader header = {0};
+    DatasetWriter__write(self, &header, sizeof(header));
+    DatasetWriter__pad(self);
+    return true;
+}
+
+static void DatasetWriter__append(DatasetWriter* self, const float* X, const int* labels, int n) {
+    for(int i = 0; i < n; i++) {
+        if(labels[i] < 0) self->ok = false;
+        c11_vector__push(int, &self->labels, labels[i]);
+    }
+    DatasetWriter__write(self, X, sizeof(float) * (size_t)n * self->n_features);
+}
+
+static bool DatasetWriter__close(DatasetWriter* self, const char* path, bool one_hot) {
+    CtenDatasetHeader header = {CTEN_DATASET_MAGIC, CTEN_DATASET_VERSION, (uint32_t)self->n_features};
+    header.n_samples = (uint64_t)self->labels.length;
+    header.features_offset = sizeof(header) + (CTEN_ALIGN - sizeof(header) % CTEN_ALIGN) % CTEN_ALIGN;
+    const int* labels = self->labels.data;
+    int n_classes = 0;
+    for(int i = 0; i < self->labels.length; i++) {
+        if(labels[i] + 1 > n_classes) n_classes = labels[i] + 1;
+    }
+    header.n_classes = (uint32_t)n_classes;
+    header.has_targets = one_hot;
+
+    DatasetWriter__pad(self);
+    if(one_hot) {
+        header.targets_offset = self->pos;
+        float* row = calloc(n_classes > 0 ? n_classes : 1, sizeof(float));
+        for(int i = 0; i < self->labels.length; i++) {
+            row[labels[i]] = 1.0f;
+            DatasetWriter__write(self, row, sizeof(float) * n_classes);
+            row[labels[i]] = 0.0f;
+        }
+        free(row);
+        DatasetWriter__pad(self);
+    }
+    header.labels_offset = self->pos;
+    DatasetWriter__write(self, labels, sizeof(int) * (size_t)self->labels.length);
+    if(self->ok) self->ok = fseek(self->fp, 0, SEEK_SET) == 0;
+    if(self->ok) self->ok = fwrite(&header, sizeof(header), 1, self->fp) == 1;
+    bool ok = _cten_file_commit(self->fp, self->tmp_path, path, self->ok);
+    c11_vector__dtor(&self->labels);
+    free(self->tmp_path);
+    return ok;
+}
+
+bool cten_dataset_save(const char* path, const float* X, const int* labels, int n_samples, int n_features, bool one_hot) {
+    cten_assert(n_samples > 0 && n_features > 0, "cten_dataset_save: expected samples and features, but got %d x %d.",
+                n_samples, n_features);
+    DatasetWriter writer;
+    if(!DatasetWriter__open(&writer, path, n_features)) return false;
+    DatasetWriter__append(&writer, X, labels, n_samples);
+    return DatasetWriter__close(&writer, path, one_hot);
+}
+
+bool cten_dataset_convert_csv(const char* csv_path, const char* path, char delimiter, bool has_header,
+                              int label_column, bool one_hot) {
+    cten_csv* csv = cten_csv_open(csv_path, delimiter, has_header, label_column);
+    if(csv == NULL) return false;
+    int n_features = cten_csv_num_features(csv);
+    DatasetWriter writer;
+    if(!DatasetWriter__open(&writer, path, n_features)) {
+        cten_csv_close(csv);
+        return false;
+    }
+    // parsed a batch at a time into a scratch buffer, so any file size converts in constant memory
+    enum { BATCH = 4096 };
+    FloatBuffer buffer = {BATCH * n_features, malloc(sizeof(float) * BATCH * n_features)};
+    int* labels = malloc(sizeof(int) * BATCH);
+    Tensor batch = {{BATCH, n_features}, &buffer, NULL};
+    int n;
+    while((n = cten_csv_read(csv, batch, labels)) > 0) {
+        DatasetWriter__append(&writer, buffer.flex, labels, n);
+    }
+    if(n < 0 || writer.labels.length == 0) writer.ok = false;
+    free(buffer.flex);
+    free(labels);
+    cten_csv_close(csv);
+    return DatasetWriter__close(&writer, path, one_hot);
+}
+
+static bool cten_dataset__section_ok(const c11_mmap* map, uint64_t offset, uint64_t nbytes) {
+    return offset % CTEN_ALIGN == 0 && offset >= sizeof(CtenDatasetHeader) && offset <= map->size &&
+           nbytes <= map->size - offset;
+}
+
+cten_dataset* cten_dataset_open(const char* path) {
+    c11_mmap map;
+    if(!c11_mmap__open(&map, path)) return NULL;
+    const CtenDatasetHeader* h = map.data;
+    bool ok = map.size >= sizeof(CtenDatasetHeader) && memcmp(h->magic, CTEN_DATASET_MAGIC, sizeof(CTEN_DATASET_MAGIC)) == 0 &&
+              h->version == CTEN_DATASET_VERSION && h->n_features > 0 && h->n_samples > 0 &&
+              h->n_samples <= INT_MAX && (uint64_t)h->n_features * h->n_samples <= INT_MAX &&
+              (uint64_t)h->n_classes * h->n_samples <= INT_MAX;
+    ok = ok && cten_dataset__section_ok(&map, h->features_offset, sizeof(float) * h->n_features * h->n_samples);
+    ok = ok && (!h->has_targets || cten_dataset__section_ok(&map, h->targets_offset, sizeof(float) * h->n_classes * h->n_samples));
+    ok = ok && cten_dataset__section_ok(&map, h->labels_offset, sizeof(int) * h->n_samples);
+    // labels index the one-hot rows the loaders write, so every one must name a class
+    if(ok) {
+        const int* labels = (const int*)((const char*)map.data + h->labels_offset);
+        for(uint64_t i = 0; i < h->n_samples; i++) {
+            if(labels[i] < 0 || (uint32_t)labels[i] >= h->n_classes) {
+                ok = false;
+                break;
+            }
+        }
+    }
+    if(!ok) {
+        c11_mmap__close(&map);
+        return NULL;
+    }
+    cten_dataset* self = _cten_malloc(sizeof(cten_dataset));
+    self->map = map;
+    self->n_samples = (int)h->n_samples;
+    self->n_features = (int)h->n_features;
+    self->n_classes = (int)h->n_classes;
+    self->features = (const float*)((const char*)map.data + h->features_offset);
+    self->targets = h->has_targets ? (const float*)((const char*)map.data + h->targets_offset) : NULL;
+    self->labels = (const int*)((const char*)map.data + h->labels_offset);
+    return self;
+}
+
+int cten_dataset_num_samples(const cten_dataset* self) { return self->n_samples; }
+
+int cten_dataset_num_features(const cten_dataset* self) { return self->n_features; }
+
+int cten_dataset_num_classes(const cten_dataset* self) { return self->n_classes; }
+
+const int* cten_dataset_labels(const cten_dataset* self) { return self->labels; }
+
+// the rows stay in the mapping; the pages are read-only, so writing through the view faults
+static Tensor cten_dataset__view(const float* rows, int begin, int n, int width) {
+    Tensor t = {{n, width}};
+    t.data = _cten_malloc(sizeof(FloatBuffer));
+    t.data->numel = n * width;
+    t.data->flex = (float*)rows + (size_t)begin * width;
+    return t;
+}
+
+Tensor cten_dataset_features(const cten_dataset* self, int begin, int n) {
+    cten_assert(begin >= 0 && n > 0 && begin <= self->n_samples - n,
+                "cten_dataset_features: rows [%d, %d) out of range [0, %d).", begin, begin + n, self->n_samples);
+    return cten_dataset__view(self->features, begin, n, self->n_features);
+}
+
+Tensor cten_dataset_targets(const cten_dataset* self, int begin, int n) {
+    cten_assert(begin >= 0 && n > 0 && begin <= self->n_samples - n,
+                "cten_dataset_targets: rows [%d, %d) out of range [0, %d).", begin, begin + n, self->n_samples);
+    if(self->targets == NULL) return (Tensor){0};
+    return cten_dataset__view(self->targets, begin, n, self->n_classes);
+}
+
+void cten_dataset_close(cten_dataset* self) { c11_mmap__close(&self->map); }
@@ -0,0 +1,247 @@
+#include "cten.h"
+#include "cten_internal.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct GraphCapture {
+    PoolId pool;
+    c11_vector /*GraphStep*/ steps;
+    c11_vector /*FloatBuffer_p*/ fresh;     // allocated during capture, contents not recorded yet
+    c11_vector /*FloatBuffer_p*/ produced;  // written by a recorded step
+    c11_vector /*FloatBuffer_p*/ kept;      // must still hold their values after a replay
+    c11_vector /*GradNode_p*/ leaves;       // their final gradients are results of the graph
+} GraphCapture;
+
+typedef struct cten_graph {
+    int n_steps;
+    GraphStep* steps;
+    Tensor output;
+    size_t planned_bytes;
+    size_t naive_bytes;
+} cten_graph;
+
+// one buffer allocated during capture, as seen by the memory planner
+typedef struct PlannedBuffer {
+    FloatBuffer* buf;
+    int id;       // allocation order, keeps the layout deterministic
+    int first;    // first step touching the buffer
+    int last;     // last step touching it; INT_MAX keeps it alive after the graph ends
+    bool read;
+    size_t size;
+    size_t offset;
+} PlannedBuffer;
+
+// buffers that existed before the capture (weights, inputs) are read as-is on replay; buffers
+// created during it must have been filled by a recorded step, otherwise replay would read stale data
+static bool GraphCapture__is_recorded(GraphCapture* self, FloatBuffer* buf) {
+    if(!c11_vector__contains(&self->fresh, &buf)) return true;
+    return c11_vector__contains(&self->produced, &buf);
+}
+
+// capture-time storage is scratch memory; cten_graph_capture_end moves the buffers into the slab
+void _cten_capture_fresh(FloatBuffer* buf) {
+    GraphCapture* cap = _cten_context()->capture;
+    assert(cap != NULL);
+    buf->flex = malloc(sizeof(float) * (buf->numel > 0 ? buf->numel : 1));
+    assert(buf->flex != NULL);
+    c11_vector__push(FloatBuffer*, &cap->fresh, buf);
+}
+
+void _cten_capture_leaf(GradNode* node) {
+    GraphCapture* cap = _cten_context()->capture;
+    if(cap == NULL) return;
+    if(!c11_vector__contains(&cap->leaves, &node)) c11_vector__push(GradNode*, &cap->leaves, node);
+}
+
+void cten_graph_capture_keep(Tensor t) {
+    GraphCapture* cap = _cten_context()->capture;
+    cten_assert(cap != NULL, "cten_graph_capture_keep: no capture in progress");
+    c11_vector__push(FloatBuffer*, &cap->kept, t.data);
+}
+
+static int PlannedBuffer__cmp_buf(const void* a, const void* b) {
+    FloatBuffer* x = ((const PlannedBuffer*)a)->buf;
+    FloatBuffer* y = ((const PlannedBuffer*)b)->buf;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static int PlannedBuffer__cmp_size(const void* a, const void* b) {
+    const PlannedBuffer* x = a;
+    const PlannedBuffer* y = b;
+    if(x->size != y->size) return x->size > y->size ? -1 : 1;
+    if(x->first != y->first) return x->first < y->first ? -1 : 1;
+    return x->id - y->id;
+}
+
+static int PlannedBuffer__cmp_offset(const void* a, const void* b) {
+    const PlannedBuffer* x = *(PlannedBuffer* const*)a;
+    const PlannedBuffer* y = *(PlannedBuffer* const*)b;
+    return x->offset < y->offset ? -1 : (x->offset > y->offset ? 1 : 0);
+}
+
+static PlannedBuffer* GraphCapture__find(PlannedBuffer* items, int n, FloatBuffer* buf) {
+    if(buf == NULL) return NULL;
+    PlannedBuffer key = {.buf = buf};
+    return bsearch(&key, items, n, sizeof(PlannedBuffer), PlannedBuffer__cmp_buf);
+}
+
+static void GraphCapture__touch(PlannedBuffer* items, int n, FloatBuffer* buf, int step, bool is_read) {
+    PlannedBuffer* item = GraphCapture__find(items, n, buf);
+    if(item == NULL) return;  // created before the capture, never moved
+    if(item->first < 0) item->first = step;
+    item->last = step;
+    item->read |= is_read;
+}
+
+static void GraphCapture__pin(PlannedBuffer* items, int n, FloatBuffer* buf) {
+    PlannedBuffer* item = GraphCapture__find(items, n, buf);
+    if(item != NULL) item->last = INT_MAX;
+}
+
+// Packs every buffer allocated during capture into one slab. A buffer is live from the first step that
+// touches it to the last one; buffers whose lifetimes don't overlap share memory, the way a register
+// allocator reuses registers. Buffers are placed largest first, each at the lowest offset that doesn't
+// collide with a placed buffer live at the same time. The output, kept tensors, leaf gradients and
+// anything no step reads stay live past the end, so they keep their values after a replay.
+static void GraphCapture__plan(GraphCapture* self, cten_graph* graph) {
+    int n = self->fresh.length;
+    graph->planned_bytes = 0;
+    graph->naive_bytes = 0;
+    if(n == 0) return;
+
+    PlannedBuffer* items = malloc(sizeof(PlannedBuffer) * n);
+    PlannedBuffer** overlapping = malloc(sizeof(PlannedBuffer*) * n);
+    assert(items != NULL && overlapping != NULL);
+    for(int i = 0; i < n; i++) {
+        FloatBuffer* buf = c11__getitem(FloatBuffer*, &self->fresh, i);
+        size_t bytes = sizeof(float) * buf->numel;
+        items[i] = (PlannedBuffer){buf, i, -1, -1, false, (bytes + CTEN_ALIGN - 1) / CTEN_ALIGN * CTEN_ALIGN, 0};
+        graph->naive_bytes += bytes;
+    }
+    qsort(items, n, sizeof(PlannedBuffer), PlannedBuffer__cmp_buf);
+
+    for(int i = 0; i < self->steps.length; i++) {
+        GraphStep* step = c11__at(GraphStep, &self->steps, i);
+        for(int k = 0; k < step->n_inputs; k++) {
+            GraphCapture__touch(items, n, step->inputs[k].data, i, true);
+        }
+        GraphCapture__touch(items, n, step->out.data, i, false);
+        GraphCapture__touch(items, n, step->out_aux.data, i, false);
+    }
+    GraphCapture__pin(items, n, graph->output.data);
+    for(int i = 0; i < self->kept.length; i++) {
+        GraphCapture__pin(items, n, c11__getitem(FloatBuffer*, &self->kept, i));
+    }
+    for(int i = 0; i < self->leaves.length; i++) {
+        GraphCapture__pin(items, n, c11__getitem(GradNode*, &self->leaves, i)->grad.data);
+    }
+    for(int i = 0; i < n; i++) {
+        if(items[i].first < 0) items[i].first = 0;
+        if(!items[i].read) items[i].last = INT_MAX;
+    }
+
+    qsort(items, n, sizeof(PlannedBuffer), PlannedBuffer__cmp_size);
+    size_t peak = 0;
+    for(int i = 0; i < n; i++) {
+        PlannedBuffer* item = &items[i];
+        int n_overlapping = 0;
+        for(int j = 0; j < i; j++) {
+            if(items[j].first <= item->last && item->first <= items[j].last) {
+                overlapping[n_overlapping++] = &items[j];
+            }
+        }
+        qsort(overlapping, n_overlapping, sizeof(PlannedBuffer*), PlannedBuffer__cmp_offset);
+        size_t offset = 0;
+        for(int j = 0; j < n_overlapping; j++) {
+            if(overlapping[j]->offset >= offset + item->size) break;
+            size_t end = overlapping[j]->offset + overlapping[j]->size;
+            if(end > offset) offset = end;
+        }
+        item->offset = offset;
+        if(offset + item->size > peak) peak = offset + item->size;
+    }
+    graph->planned_bytes = peak;
+
+    char* slab = _cten_malloc_aligned(peak);
+    for(int i = 0; i < n; i++) {
+        FloatBuffer* buf = items[i].buf;
+        float* scratch = buf->flex;
+        buf->flex = (float*)(slab + items[i].offset);
+        // only buffers live at the end carry values out of the capture; the rest may share memory
+        if(items[i].last == INT_MAX) memcpy(buf->flex, scratch, sizeof(float) * buf->numel);
+        free(scratch);
+    }
+    free(items);
+    free(overlapping);
+}
+
+void _cten_launch(GraphStep step) {
+    GraphCapture* cap = _cten_context()->capture;
+    if(cap != NULL) {
+        for(int i = 0; i < step.n_inputs; i++) {
+            cten_assert(GraphCapture__is_recorded(cap, step.inputs[i].data),
+                        "graph capture: input %d of a recorded kernel comes from an operation that cannot be captured",
+                        i);
+        }
+        c11_vector__push(GraphStep, &cap->steps, step);
+        if(step.out.data != NULL) c11_vector__push(FloatBuffer*, &cap->produced, step.out.data);
+        if(step.out_aux.data != NULL) c11_vector__push(FloatBuffer*, &cap->produced, step.out_aux.data);
+    }
+    step.kernel(&step);
+}
+
+void cten_graph_capture_begin(PoolId id) {
+    cten_context* ctx = _cten_context();
+    cten_assert(ctx->capture == NULL, "cten_graph_capture_begin: a capture is already in progress");
+    GraphCapture* cap = malloc(sizeof(GraphCapture));
+    assert(cap != NULL);
+    cap->pool = id;
+    c11_vector__ctor(&cap->steps, sizeof(GraphStep));
+    c11_vector__ctor(&cap->fresh, sizeof(FloatBuffer*));
+    c11_vector__ctor(&cap->produced, sizeof(FloatBuffer*));
+    c11_vector__ctor(&cap->kept, sizeof(FloatBuffer*));
+    c11_vector__ctor(&cap->leaves, sizeof(GradNode*));
+    ctx->capture = cap;
+    cten_begin_malloc(id);
+}
+
+cten_graph* cten_graph_capture_end(Tensor output) {
+    cten_context* ctx = _cten_context();
+    GraphCapture* cap = ctx->capture;
+    cten_assert(cap != NULL, "cten_graph_capture_end: no capture in progress");
+    cten_assert(GraphCapture__is_recorded(cap, output.data),
+                "cten_graph_capture_end: output comes from an operation that cannot be captured");
+    ctx->capture = NULL;
+
+    // the plan lives in the capture pool next to its buffers and goes away with cten_free(id)
+    cten_graph* self = _cten_malloc(sizeof(cten_graph));
+    self->n_steps = cap->steps.length;
+    self->steps = _cten_malloc(sizeof(GraphStep) * cap->steps.length);
+    memcpy(self->steps, cap->steps.data, sizeof(GraphStep) * cap->steps.length);
+    self->output = output;
+    GraphCapture__plan(cap, self);
+    cten_end_malloc();
+
+    c11_vector__dtor(&cap->steps);
+    c11_vector__dtor(&cap->fresh);
+    c11_vector__dtor(&cap->produced);
+    c11_vector__dtor(&cap->kept);
+    c11_vector__dtor(&cap->leaves);
+    free(cap);
+    return self;
+}
+
+void cten_graph_replay(const cten_graph* self) {
+    for(int i = 0; i < self->n_steps; i++) {
+        const GraphStep* step = &self->steps[i];
+        step->kernel(step);
+    }
+}
+
+int cten_graph_num_steps(const cten_graph* self) { return self->n_steps; }
+
+size_t cten_graph_planned_bytes(const cten_graph* self) { return self->planned_bytes; }
+
+size_t cten_graph_naive_bytes(const cten_graph* self) { return self->naive_bytes; }
@@ -8,30 +8,39 @@
 #include <time.h>
 #include <stdio.h>
 
-static float elu_alpha_value = 1.0f;
-static float huber_delta_value = 1.0f;
-
 Tensor nn_linear(Tensor input, Tensor weight, Tensor bias) {
     Tensor tmp = Tensor_matmul(input, weight);
     tmp = Tensor_add(tmp, bias);
     return tmp;
 }
 
+static void Kernel_relu_backward(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = in[i] > 0 ? 1.0f : 0.0f;
+    }
+}
+
 static Tensor GradFn_relu(Tensor self, int i) {
     Tensor input = self.node->inputs[i];
     Tensor res = Tensor_new(input.shape, false);
-    for(int i = 0; i < input.data->numel; i++) {
-        res.data->flex[i] = input.data->flex[i] > 0 ? 1.0f : 0.0f;
-    }
+    _cten_launch((GraphStep){Kernel_relu_backward, res, {input}, 1});
     return res;
 }
 
+static void Kernel_relu(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = fmaxf(0, in[i]);
+    }
+}
+
 Tensor nn_relu(Tensor self) {
     bool requires_grad = !cten_is_eval() && self.node != NULL;
-    Tensor res = Tensor_zeros(self.shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = fmaxf(0, self.data->flex[i]);
-    }
+    Tensor res = Tensor_new(self.shape, requires_grad);
+    _cten_launch((GraphStep){Kernel_relu, res, {self}, 1});
 
     if(requires_grad) {
         res.node->grad_fn = GradFn_relu;
@@ -43,21 +52,33 @@ Tensor nn_relu(Tensor self) {
     return res;
 }
 
+static void Kernel_log_backward(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int j = 0; j < s->out.data->numel; j++) {
+        out[j] = 1.0f / in[j];
+    }
+}
+
 static Tensor GradFn_log(Tensor self, int i) {
     Tensor input = self.node->inputs[i];
     Tensor res = Tensor_new(input.shape, false);
-    for(int j = 0; j < input.data->numel; j++) {
-        res.data->flex[j] = 1.0f / input.data->flex[j];
-    }
+    _cten_launch((GraphStep){Kernel_log_backward, res, {input}, 1});
     return res;
 }
 
+static void Kernel_log(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = logf(in[i]);
+    }
+}
+
 Tensor nn_log(Tensor self) {
     bool requires_grad = !cten_is_eval() && self.node != NULL;
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = logf(self.data->flex[i]);
-    }
+    _cten_launch((GraphStep){Kernel_log, res, {self}, 1});
     if(requires_grad) {
         res.node->grad_fn = GradFn_log;
         res.node->inputs[0] = self;
@@ -71,12 +92,18 @@ static Tensor GradFn_exp(Tensor self, int i) {
     return self;
 }
 
+static void Kernel_exp(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = expf(in[i]);
+    }
+}
+
 Tensor nn_exp(Tensor self) {
     bool requires_grad = !cten_is_eval() && self.node != NULL;
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = expf(self.data->flex[i]);
-    }
+    _cten_launch((GraphStep){Kernel_exp, res, {self}, 1});
     if(requires_grad) {
         res.node->grad_fn = GradFn_exp;
         res.node->inputs[0] = self;
@@ -86,21 +113,33 @@ Tensor nn_exp(Tensor self) {
     return res;
 }
 
+static void Kernel_sin_backward(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int j = 0; j < s->out.data->numel; j++) {
+        out[j] = cosf(in[j]);
+    }
+}
+
 static Tensor GradFn_sin(Tensor self, int i) {
     Tensor input = self.node->inputs[i];
     Tensor res = Tensor_new(input.shape, false);
-    for(int j = 0; j < input.data->numel; j++) {
-        res.data->flex[j] = cosf(input.data->flex[j]);
-    }
+    _cten_launch((GraphStep){Kernel_sin_backward, res, {input}, 1});
     return res;
 }
 
+static void Kernel_sin(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = sinf(in[i]);
+    }
+}
+
 Tensor nn_sin(Tensor self) {
     bool requires_grad = !cten_is_eval() && self.node != NULL;
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = sinf(self.data->flex[i]);
-    }
+    _cten_launch((GraphStep){Kernel_sin, res, {self}, 1});
     if(requires_grad) {
         res.node->grad_fn = GradFn_sin;
         res.node->inputs[0] = self;
@@ -110,21 +149,33 @@ Tensor nn_sin(Tensor self) {
     return res;
 }
 
+static void Kernel_cos_backward(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int j = 0; j < s->out.data->numel; j++) {
+        out[j] = -sinf(in[j]);
+    }
+}
+
 static Tensor GradFn_cos(Tensor self, int i) {
     Tensor input = self.node->inputs[i];
     Tensor res = Tensor_new(input.shape, false);
-    for(int j = 0; j < input.data->numel; j++) {
-        res.data->flex[j] = -sinf(input.data->flex[j]);
-    }
+    _cten_launch((GraphStep){Kernel_cos_backward, res, {input}, 1});
     return res;
 }
 
+static void Kernel_cos(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = cosf(in[i]);
+    }
+}
+
 Tensor nn_cos(Tensor self) {
     bool requires_grad = !cten_is_eval() && self.node != NULL;
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = cosf(self.data->flex[i]);
-    }
+    _cten_launch((GraphStep){Kernel_cos, res, {self}, 1});
     if(requires_grad) {
         res.node->grad_fn = GradFn_cos;
         res.node->inputs[0] = self;
@@ -134,22 +185,33 @@ Tensor nn_cos(Tensor self) {
     return res;
 }
 
-static Tensor GradFn_tan(Tensor self, int i) {
+static void Kernel_tan_backward(const GraphStep* s) {
     // d/dx(tan(x)) = 1 + tan^2(x)
-    Tensor res = Tensor_new(self.shape, false);
-    for(int j = 0; j < self.data->numel; j++) {
-        float y = self.data->flex[j];
-        res.data->flex[j] = 1.0f + y*y;
+    float* out = s->out.data->flex;
+    const float* y = s->inputs[0].data->flex;
+    for(int j = 0; j < s->out.data->numel; j++) {
+        out[j] = 1.0f + y[j]*y[j];
     }
+}
+
+static Tensor GradFn_tan(Tensor self, int i) {
+    Tensor res = Tensor_new(self.shape, false);
+    _cten_launch((GraphStep){Kernel_tan_backward, res, {self}, 1});
     return res;
 }
 
+static void Kernel_tan(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = tanf(in[i]);
+    }
+}
+
 Tensor nn_tan(Tensor self) {
     bool requires_grad = !cten_is_eval() && self.node != NULL;
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = tanf(self.data->flex[i]);
-    }
+    _cten_launch((GraphStep){Kernel_tan, res, {self}, 1});
     if(requires_grad) {
         res.node->grad_fn = GradFn_tan;
         res.node->inputs[0] = self;
@@ -159,22 +221,33 @@ Tensor nn_tan(Tensor self) {
     return res;
 }
 
-static Tensor GradFn_sigmoid(Tensor self, int i) {
+static void Kernel_sigmoid_backward(const GraphStep* s) {
     // d/dx sigmoid(x) = sigmoid(x) * (1 - sigmoid(x))
-    Tensor res = Tensor_new(self.shape, false);
-    for(int j = 0; j < self.data->numel; j++) {
-        float y = self.data->flex[j];
-        res.data->flex[j] = y * (1.0f - y);
+    float* out = s->out.data->flex;
+    const float* y = s->inputs[0].data->flex;
+    for(int j = 0; j < s->out.data->numel; j++) {
+        out[j] = y[j] * (1.0f - y[j]);
     }
+}
+
+static Tensor GradFn_sigmoid(Tensor self, int i) {
+    Tensor res = Tensor_new(self.shape, false);
+    _cten_launch((GraphStep){Kernel_sigmoid_backward, res, {self}, 1});
     return res;
 }
 
+static void Kernel_sigmoid(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = 1.0f / (1.0f + expf(-in[i]));
+    }
+}
+
 Tensor nn_sigmoid(Tensor self) {
     bool requires_grad = !cten_is_eval() && self.node != NULL;
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = 1.0f / (1.0f + expf(-self.data->flex[i]));
-    }
+    _cten_launch((GraphStep){Kernel_sigmoid, res, {self}, 1});
     if(requires_grad) {
         res.node->grad_fn = GradFn_sigmoid;
         res.node->inputs[0] = self;
@@ -184,22 +257,33 @@ Tensor nn_sigmoid(Tensor self) {
     return res;
 }
 
-static Tensor GradFn_tanh(Tensor self, int i) {
+static void Kernel_tanh_backward(const GraphStep* s) {
     // d/dx tanh(x) = 1 - tanh^2(x)
-    Tensor res = Tensor_new(self.shape, false);
-    for(int j = 0; j < self.data->numel; j++) {
-        float y = self.data->flex[j];
-        res.data->flex[j] = 1.0f - y*y;
+    float* out = s->out.data->flex;
+    const float* y = s->inputs[0].data->flex;
+    for(int j = 0; j < s->out.data->numel; j++) {
+        out[j] = 1.0f - y[j]*y[j];
     }
+}
+
+static Tensor GradFn_tanh(Tensor self, int i) {
+    Tensor res = Tensor_new(self.shape, false);
+    _cten_launch((GraphStep){Kernel_tanh_backward, res, {self}, 1});
     return res;
 }
 
+static void Kernel_tanh(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = tanhf(in[i]);
+    }
+}
+
 Tensor nn_tanh(Tensor self) {
     bool requires_grad = !cten_is_eval() && self.node != NULL;
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = tanhf(self.data->flex[i]);
-    }
+    _cten_launch((GraphStep){Kernel_tanh, res, {self}, 1});
     if(requires_grad) {
         res.node->grad_fn = GradFn_tanh;
         res.node->inputs[0] = self;
@@ -209,73 +293,98 @@ Tensor nn_tanh(Tensor self) {
     return res;
 }
 
+static void Kernel_elu_backward(const GraphStep* s) {
+    float alpha = s->params[0].f;
+    const float* in = s->inputs[0].data->flex;
+    const float* y = s->inputs[1].data->flex;
+    float* out = s->out.data->flex;
+    for(int j = 0; j < s->out.data->numel; j++) {
+        if (in[j] > 0) {
+            out[j] = 1.0f;
+        } else {
+            // derivative is alpha * e^x = alpha * (e^x - 1) + alpha = y + alpha
+            out[j] = y[j] + alpha;
+        }
+    }
+}
+
 static Tensor GradFn_elu(Tensor self, int i) {
-    float alpha = elu_alpha_value;
     Tensor input = self.node->inputs[0];
     Tensor grad = Tensor_new(input.shape, false);
-    for(int j = 0; j < input.data->numel; j++) {
-        float x = input.data->flex[j];
+    _cten_launch((GraphStep){Kernel_elu_backward, grad, {input, self}, 2, .params = {self.node->params[0]}});
+    return grad;
+}
+
+static void Kernel_elu(const GraphStep* s) {
+    float alpha = s->params[0].f;
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        float x = in[i];
         if (x > 0) {
-            grad.data->flex[j] = 1.0f;
+            out[i] = x;
         } else {
-            // derivative is alpha * e^x = alpha * (e^x - 1) + alpha = y + alpha
-            grad.data->flex[j] = self.data->flex[j] + alpha;
+            out[i] = alpha * (expf(x) - 1.0f);
         }
     }
-    return grad;
 }
 
 Tensor nn_elu(Tensor self, float alpha) {
-    elu_alpha_value = alpha;
     bool requires_grad = !cten_is_eval() && self.node != NULL;
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        float x = self.data->flex[i];
-        if (x > 0) {
-            res.data->flex[i] = x;
-        } else {
-            res.data->flex[i] = alpha * (expf(x) - 1.0f);
-        }
-    }
+    _cten_launch((GraphStep){Kernel_elu, res, {self}, 1, .params = {{.f = alpha}}});
     if(requires_grad) {
         res.node->grad_fn = GradFn_elu;
         res.node->inputs[0] = self;
         res.node->n_inputs = 1;
         res.node->name = "Elu";
+        res.node->params[0].f = alpha;
     }
     return res;
 }
 
-static Tensor GradFn_selu(Tensor self, int i) {
-    Tensor input = self.node->inputs[0];
-    Tensor grad = Tensor_new(input.shape, false);
+static void Kernel_selu_backward(const GraphStep* s) {
     const float alpha = 1.67326324f;
     const float lambda = 1.05070098f;
-    for(int j = 0; j < input.data->numel; j++) {
-        float x = input.data->flex[j];
-        if (x > 0) {
-            grad.data->flex[j] = lambda;
+    const float* in = s->inputs[0].data->flex;
+    const float* y = s->inputs[1].data->flex;
+    float* out = s->out.data->flex;
+    for(int j = 0; j < s->out.data->numel; j++) {
+        if (in[j] > 0) {
+            out[j] = lambda;
         } else {
             // derivative is lambda * alpha * e^x = y + lambda*alpha
-            grad.data->flex[j] = self.data->flex[j] + lambda * alpha;
+            out[j] = y[j] + lambda * alpha;
         }
     }
+}
+
+static Tensor GradFn_selu(Tensor self, int i) {
+    Tensor input = self.node->inputs[0];
+    Tensor grad = Tensor_new(input.shape, false);
+    _cten_launch((GraphStep){Kernel_selu_backward, grad, {input, self}, 2});
     return grad;
 }
 
-Tensor nn_selu(Tensor self) {
-    bool requires_grad = !cten_is_eval() && self.node != NULL;
-    Tensor res = Tensor_new(self.shape, requires_grad);
+static void Kernel_selu(const GraphStep* s) {
     const float alpha = 1.67326324f;
     const float lambda = 1.05070098f;
-    for(int i = 0; i < self.data->numel; i++) {
-        float x = self.data->flex[i];
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        float x = in[i];
         if (x > 0) {
-            res.data->flex[i] = lambda * x;
+            out[i] = lambda * x;
         } else {
-            res.data->flex[i] = lambda * alpha * (expf(x) - 1);
+            out[i] = lambda * alpha * (expf(x) - 1);
         }
     }
+}
+
+Tensor nn_selu(Tensor self) {
+    bool requires_grad = !cten_is_eval() && self.node != NULL;
+    Tensor res = Tensor_new(self.shape, requires_grad);
+    _cten_launch((GraphStep){Kernel_selu, res, {self}, 1});
     if(requires_grad) {
         res.node->grad_fn = GradFn_selu;
         res.node->inputs[0] = self;
@@ -292,18 +401,19 @@ Tensor Glorot_init(TensorShape shape, bool requires_grad) {
     float scale = sqrtf(6.0f / (fan_in + fan_out));
     
     for(int i = 0; i < res.data->numel; i++) {
-        float r = (float)rand() / RAND_MAX * 2.0f - 1.0f; 
+        float r = _cten_randf() * 2.0f - 1.0f;
         res.data->flex[i] = r * scale;
     }
     return res;
 }
 
-static Tensor GradFn_softmax(Tensor self, int i) {
-    Tensor input = self.node->inputs[i];
-    Tensor grad = Tensor_new(input.shape, false);
-    
-    int dim = self.node->params[0];
-    int input_ndim = TensorShape_dim(input.shape);
+static void Kernel_softmax_backward(const GraphStep* s) {
+    Tensor self = s->inputs[0];
+    Tensor upstream = s->inputs[1];
+    Tensor grad = s->out;
+
+    int dim = s->params[0].i;
+    int input_ndim = TensorShape_dim(grad.shape);
     
     int dim_size = self.shape[dim];
     int outer_size = 1;
@@ -316,7 +426,7 @@ static Tensor GradFn_softmax(Tensor self, int i) {
     }
 
     float* s_data = self.data->flex; // Softmax output data (s)
-    float* upstream_grad_data = self.node->grad.data->flex; // Upstream grad (dL/ds)
+    float* upstream_grad_data = upstream.data->flex; // Upstream grad (dL/ds)
     float* input_grad_data = grad.data->flex; // Resulting grad (dL/dz)
     for (int outer = 0; outer < outer_size; outer++) {
         for (int inner = 0; inner < inner_size; inner++) {
@@ -335,14 +445,20 @@ static Tensor GradFn_softmax(Tensor self, int i) {
             }
         }
     }
+}
+
+static Tensor GradFn_softmax(Tensor self, int i) {
+    Tensor input = self.node->inputs[i];
+    Tensor grad = Tensor_new(input.shape, false);
+    _cten_launch((GraphStep){Kernel_softmax_backward, grad, {self, self.node->grad}, 2, .params = {self.node->params[0]}});
     return grad;
 }
 
-Tensor nn_softmax(Tensor self, int dim) {
-    bool requires_grad = !cten_is_eval() && self.node != NULL;
-    Tensor res = Tensor_new(self.shape, requires_grad);
+static void Kernel_softmax(const GraphStep* s) {
+    Tensor self = s->inputs[0];
+    Tensor res = s->out;
+    int dim = s->params[0].i;
     int self_dim = TensorShape_dim(self.shape);
-    assert(dim >= 0 && dim < self_dim);
     int dim_size = self.shape[dim];
     int outer_size = 1;
     for(int i = 0; i < dim; i++) {
@@ -374,56 +490,62 @@ Tensor nn_softmax(Tensor self, int dim) {
             }
         }
     }
+}
+
+Tensor nn_softmax(Tensor self, int dim) {
+    bool requires_grad = !cten_is_eval() && self.node != NULL;
+    Tensor res = Tensor_new(self.shape, requires_grad);
+    int self_dim = TensorShape_dim(self.shape);
+    assert(dim >= 0 && dim < self_dim);
+    _cten_launch((GraphStep){Kernel_softmax, res, {self}, 1, .params = {{.i = dim}}});
 
     if(requires_grad) {
         res.node->grad_fn = GradFn_softmax;
         res.node->inputs[0] = self;
         res.node->n_inputs = 1; 
         res.node->name = "Softmax";     
-        res.node->params[0] = dim;
+        res.node->params[0].i = dim;
     }
     return res;
 }
 
+static void Kernel_crossentropy_backward(const GraphStep* s) {
+    Tensor y_true = s->inputs[0];
+    Tensor y_pred = s->inputs[1];
+    Tensor grad = s->out;
+    int n_samples = y_true.shape[0];
+    int n_classes = y_true.shape[1];
+
+    for (int i = 0; i < n_samples; i++) {
+        for (int j = 0; j < n_classes; j++) {
+            float y_true_val = y_true.data->flex[i * n_classes + j];
+            float y_pred_val = y_pred.data->flex[i * n_classes + j];
+            if (y_true_val == 0) {
+                grad.data->flex[i * n_classes + j] = 0;
+            } else {
+                grad.data->flex[i * n_classes + j] = -y_true_val / y_pred_val;
+            }
+        }
+    }
+}
+
 static Tensor GradFn_crossentropy(Tensor self, int i) {
     if (i == 1) { // Gradient w.r.t. y_pred
         Tensor y_true = self.node->inputs[0];
         Tensor y_pred = self.node->inputs[1];
-        int n_samples = y_true.shape[0];
-        int n_classes = y_true.shape[1];
-        
         Tensor grad = Tensor_new(y_pred.shape, false);
-        
-        for (int i = 0; i < n_samples; i++) {
-            for (int j = 0; j < n_classes; j++) {
-                float y_true_val = y_true.data->flex[i * n_classes + j];
-                float y_pred_val = y_pred.data->flex[i * n_classes + j];
-                if (y_true_val == 0) {
-                    grad.data->flex[i * n_classes + j] = 0;
-                } else {
-                    grad.data->flex[i * n_classes + j] = -y_true_val / y_pred_val;
-                }
-            }
-        }
+        _cten_launch((GraphStep){Kernel_crossentropy_backward, grad, {y_true, y_pred}, 2});
         return grad;
     }
     return Tensor_zeros((TensorShape){1}, false);
 }
 
-Tensor nn_crossentropy(Tensor y_true, Tensor y_pred) {
-    // y_true: [None, n_classes]
-    // y_pred: [None, n_classes]
-    assert(TensorShape_dim(y_true.shape) == 2);
-    assert(TensorShape_dim(y_pred.shape) == 2);
-
+static void Kernel_crossentropy(const GraphStep* s) {
+    Tensor y_true = s->inputs[0];
+    Tensor y_pred = s->inputs[1];
     int n_samples = y_true.shape[0];
     int n_classes = y_true.shape[1];
-    assert(n_samples == y_pred.shape[0]);
-    assert(n_classes == y_pred.shape[1]);
 
-    bool requires_grad = !cten_is_eval() && (y_true.node != NULL || y_pred.node != NULL); //No eval but rather training so requires grad is True
-    Tensor res = Tensor_zeros((TensorShape){1}, requires_grad);
-    
     // Calculate cross-entropy loss
     float total_loss = 0.0f;
     for(int i = 0; i < n_samples; i++) {
@@ -438,8 +560,24 @@ Tensor nn_crossentropy(Tensor y_true, Tensor y_pred) {
         }
         total_loss += sample_loss;
     }
-    
-    res.data->flex[0] = total_loss / n_samples;
+
+    s->out.data->flex[0] = total_loss / n_samples;
+}
+
+Tensor nn_crossentropy(Tensor y_true, Tensor y_pred) {
+    // y_true: [None, n_classes]
+    // y_pred: [None, n_classes]
+    assert(TensorShape_dim(y_true.shape) == 2);
+    assert(TensorShape_dim(y_pred.shape) == 2);
+
+    int n_samples = y_true.shape[0];
+    int n_classes = y_true.shape[1];
+    assert(n_samples == y_pred.shape[0]);
+    assert(n_classes == y_pred.shape[1]);
+
+    bool requires_grad = !cten_is_eval() && (y_true.node != NULL || y_pred.node != NULL); //No eval but rather training so requires grad is True
+    Tensor res = Tensor_new((TensorShape){1}, requires_grad);
+    _cten_launch((GraphStep){Kernel_crossentropy, res, {y_true, y_pred}, 2});
     
     if(requires_grad) {
         res.node->grad_fn = GradFn_crossentropy;
@@ -452,48 +590,54 @@ Tensor nn_crossentropy(Tensor y_true, Tensor y_pred) {
     return res;
 }
 
-static Tensor GradFn_softmax_crossentropy(Tensor self, int i) {
-    if (i == 1) {
-        Tensor y_true = self.node->inputs[0];
-        Tensor logits = self.node->inputs[1];
-        
-        Tensor y_pred = Tensor_new(logits.shape, false);
-        int self_dim = TensorShape_dim(logits.shape);
-        int last_dim_size = logits.shape[self_dim - 1];
-        int outer_size = logits.data->numel / last_dim_size;
+static void Kernel_softmax_crossentropy_backward(const GraphStep* s) {
+    Tensor y_true = s->inputs[0];
+    Tensor logits = s->inputs[1];
+    
+    // softmax is computed straight into the gradient buffer, then y_true is subtracted in place
+    Tensor y_pred = s->out;
+    int self_dim = TensorShape_dim(logits.shape);
+    int last_dim_size = logits.shape[self_dim - 1];
+    int outer_size = logits.data->numel / last_dim_size;
 
-        for(int outer = 0; outer < outer_size; outer++) {
-            float max_val = -INFINITY;
-            float sum = 0;
+    for(int outer = 0; outer < outer_size; outer++) {
+        float max_val = -INFINITY;
+        float sum = 0;
 
-            for(int d = 0; d < last_dim_size; d++) {
-                int index = outer * last_dim_size + d;
-                max_val = fmaxf(max_val, logits.data->flex[index]);
-            }
+        for(int d = 0; d < last_dim_size; d++) {
+            int index = outer * last_dim_size + d;
+            max_val = fmaxf(max_val, logits.data->flex[index]);
+        }
 
-            for(int d = 0; d < last_dim_size; d++) {
-                int index = outer * last_dim_size + d;
-                y_pred.data->flex[index] = expf(logits.data->flex[index] - max_val);
-                sum += y_pred.data->flex[index];
-            }
+        for(int d = 0; d < last_dim_size; d++) {
+            int index = outer * last_dim_size + d;
+            y_pred.data->flex[index] = expf(logits.data->flex[index] - max_val);
+            sum += y_pred.data->flex[index];
+        }
 
-            for(int d = 0; d < last_dim_size; d++) {
-                int index = outer * last_dim_size + d;
-                y_pred.data->flex[index] /= sum;
-            }
+        for(int d = 0; d < last_dim_size; d++) {
+            int index = outer * last_dim_size + d;
+            y_pred.data->flex[index] /= sum;
         }
-        
-        Tensor grad = Tensor_new(y_pred.shape, false);
-        int n_samples = y_pred.shape[0];
-        int n_classes = y_pred.shape[1];
-        
-        for (int i = 0; i < n_samples; i++) {
-            for (int j = 0; j < n_classes; j++) {
-                grad.data->flex[i * n_classes + j] = 
-                    y_pred.data->flex[i * n_classes + j] - y_true.data->flex[i * n_classes + j];
-            }
+    }
+    
+    int n_samples = y_pred.shape[0];
+    int n_classes = y_pred.shape[1];
+    
+    for (int i = 0; i < n_samples; i++) {
+        for (int j = 0; j < n_classes; j++) {
+            y_pred.data->flex[i * n_classes + j] =
+                y_pred.data->flex[i * n_classes + j] - y_true.data->flex[i * n_classes + j];
         }
-        
+    }
+}
+
+static Tensor GradFn_softmax_crossentropy(Tensor self, int i) {
+    if (i == 1) {
+        Tensor y_true = self.node->inputs[0];
+        Tensor logits = self.node->inputs[1];
+        Tensor grad = Tensor_new(logits.shape, false);
+        _cten_launch((GraphStep){Kernel_softmax_crossentropy_backward, grad, {y_true, logits}, 2});
         return grad;
     }
     return Tensor_zeros((TensorShape){1}, false);
@@ -507,8 +651,8 @@ Tensor nn_softmax_crossentropy(Tensor y_true, Tensor logits) {
     Tensor y_pred = nn_softmax(logits, last_dim_logits);
     Tensor loss = nn_crossentropy(y_true, y_pred);
     cten_end_eval();
-    Tensor res = Tensor_zeros((TensorShape){1}, requires_grad);
-    res.data->flex[0] = loss.data->flex[0];
+    Tensor res = Tensor_new((TensorShape){1}, requires_grad);
+    _cten_launch((GraphStep){Kernel_copy, res, {loss}, 1});
     
     if(requires_grad) {
         res.node->grad_fn = GradFn_softmax_crossentropy;
@@ -521,16 +665,22 @@ Tensor nn_softmax_crossentropy(Tensor y_true, Tensor logits) {
     return res;
 }
 
+static void Kernel_mse_loss_backward(const GraphStep* s) {
+    Tensor y_true = s->inputs[0];
+    Tensor y_pred = s->inputs[1];
+    Tensor grad = s->out;
+    int n = y_pred.data->numel;
+    for (int j = 0; j < n; j++) {
+        grad.data->flex[j] = 2.0f * (y_pred.data->flex[j] - y_true.data->flex[j]) / n;
+    }
+}
+
 static Tensor GradFn_mse_loss(Tensor self, int i) {
     if (i == 1) {  // Gradient w.r.t y_pred
         Tensor y_true = self.node->inputs[0];
         Tensor y_pred = self.node->inputs[1];
-        int n = y_pred.data->numel;
-
         Tensor grad = Tensor_new(y_pred.shape, false);
-        for (int j = 0; j < n; j++) {
-            grad.data->flex[j] = 2.0f * (y_pred.data->flex[j] - y_true.data->flex[j]) / n;
-        }
+        _cten_launch((GraphStep){Kernel_mse_loss_backward, grad, {y_true, y_pred}, 2});
         return grad;
     }
     return Tensor_zeros((TensorShape){1}, false);
@@ -546,7 +696,7 @@ Tensor nn_mse_loss(Tensor y_true, Tensor y_pred) {
     cten_end_eval();
 
     Tensor res = Tensor_new((TensorShape){1}, requires_grad);
-    res.data->flex[0] = loss.data->flex[0];
+    _cten_launch((GraphStep){Kernel_copy, res, {loss}, 1});
 
     if (requires_grad) {
         res.node->grad_fn = GradFn_mse_loss;
@@ -558,23 +708,29 @@ Tensor nn_mse_loss(Tensor y_true, Tensor y_pred) {
     return res;
 }
 
+static void Kernel_mae_loss_backward(const GraphStep* s) {
+    Tensor y_true = s->inputs[0];
+    Tensor y_pred = s->inputs[1];
+    Tensor grad = s->out;
+    int n = y_pred.data->numel;
+    for (int j = 0; j < n; j++) {
+        float error = y_pred.data->flex[j] - y_true.data->flex[j];
+        if (error > 0) {
+            grad.data->flex[j] = 1.0f / n;
+        } else if (error < 0) {
+            grad.data->flex[j] = -1.0f / n;
+        } else {
+            grad.data->flex[j] = 0.0f;
+        }
+    }
+}
+
 static Tensor GradFn_mae_loss(Tensor self, int i) {
     if (i == 1) { // Gradient w.r.t y_pred
         Tensor y_true = self.node->inputs[0];
         Tensor y_pred = self.node->inputs[1];
-        int n = y_pred.data->numel;
-
         Tensor grad = Tensor_new(y_pred.shape, false);
-        for (int j = 0; j < n; j++) {
-            float error = y_pred.data->flex[j] - y_true.data->flex[j];
-            if (error > 0) {
-                grad.data->flex[j] = 1.0f / n;
-            } else if (error < 0) {
-                grad.data->flex[j] = -1.0f / n;
-            } else {
-                grad.data->flex[j] = 0.0f;
-            }
-        }
+        _cten_launch((GraphStep){Kernel_mae_loss_backward, grad, {y_true, y_pred}, 2});
         return grad;
     }
     return Tensor_zeros((TensorShape){1}, false);
@@ -590,7 +746,7 @@ Tensor nn_mae_loss(Tensor y_true, Tensor y_pred) {
     cten_end_eval();
 
     Tensor res = Tensor_new((TensorShape){1}, requires_grad);
-    res.data->flex[0] = loss.data->flex[0];
+    _cten_launch((GraphStep){Kernel_copy, res, {loss}, 1});
 
     if (requires_grad) {
         res.node->grad_fn = GradFn_mae_loss;
@@ -602,37 +758,43 @@ Tensor nn_mae_loss(Tensor y_true, Tensor y_pred) {
     return res;
 }
 
+static void Kernel_huber_loss_backward(const GraphStep* s) {
+    Tensor y_true = s->inputs[0];
+    Tensor y_pred = s->inputs[1];
+    Tensor grad = s->out;
+    float delta = s->params[0].f;
+    int n = y_pred.data->numel;
+    // Gradient of Huber loss is (error / n) for small errors,
+    // and (delta * sign(error) / n) for large errors.
+    for (int j = 0; j < n; j++) {
+        float error = y_pred.data->flex[j] - y_true.data->flex[j];
+        if (fabsf(error) <= delta) {
+            grad.data->flex[j] = error / n;
+        } else {
+            if (error > 0) {
+                grad.data->flex[j] = delta / n;
+            } else {
+                grad.data->flex[j] = -delta / n;
+            }
+        }
+    }
+}
+
 static Tensor GradFn_huber_loss(Tensor self, int i) {
     if (i == 1) { // Gradient w.r.t y_pred
         Tensor y_true = self.node->inputs[0];
         Tensor y_pred = self.node->inputs[1];
-        float delta = huber_delta_value;
-        int n = y_pred.data->numel;
-
         Tensor grad = Tensor_new(y_pred.shape, false);
-        // Gradient of Huber loss is (error / n) for small errors,
-        // and (delta * sign(error) / n) for large errors.
-        for (int j = 0; j < n; j++) {
-            float error = y_pred.data->flex[j] - y_true.data->flex[j];
-            if (fabsf(error) <= delta) {
-                grad.data->flex[j] = error / n;
-            } else {
-                if (error > 0) {
-                    grad.data->flex[j] = delta / n;
-                } else {
-                    grad.data->flex[j] = -delta / n;
-                }
-            }
-        }
+        _cten_launch((GraphStep){Kernel_huber_loss_backward, grad, {y_true, y_pred}, 2, .params = {self.node->params[0]}});
         return grad;
     }
     return Tensor_zeros((TensorShape){1}, false);
 }
 
-Tensor nn_huber_loss(Tensor y_true, Tensor y_pred, float delta) {
-    huber_delta_value = delta; // Store delta for the backward pass
-    bool requires_grad = !cten_is_eval() && y_pred.node != NULL;
-
+static void Kernel_huber_loss(const GraphStep* s) {
+    Tensor y_true = s->inputs[0];
+    Tensor y_pred = s->inputs[1];
+    float delta = s->params[0].f;
     int n = y_pred.data->numel;
     float total_loss = 0.0f;
     for (int i = 0; i < n; i++) {
@@ -645,8 +807,13 @@ Tensor nn_huber_loss(Tensor y_true, Tensor y_pred, float delta) {
         }
     }
 
+    s->out.data->flex[0] = total_loss / n; // Mean Huber Loss
+}
+
+Tensor nn_huber_loss(Tensor y_true, Tensor y_pred, float delta) {
+    bool requires_grad = !cten_is_eval() && y_pred.node != NULL;
     Tensor res = Tensor_new((TensorShape){1}, requires_grad);
-    res.data->flex[0] = total_loss / n; // Mean Huber Loss
+    _cten_launch((GraphStep){Kernel_huber_loss, res, {y_true, y_pred}, 2, .params = {{.f = delta}}});
 
     if (requires_grad) {
         res.node->grad_fn = GradFn_huber_loss;
@@ -654,6 +821,7 @@ Tensor nn_huber_loss(Tensor y_true, Tensor y_pred, float delta) {
         res.node->inputs[1] = y_pred;
         res.node->n_inputs = 2;
         res.node->name = "HuberLoss";
+        res.node->params[0].f = delta; // Store delta for the backward pass
     }
     return res;
 }
\ No newline at end of file
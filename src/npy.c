@@ -0,0 +1,251 @@
+#include "cten.h"
+#include "cten_internal.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NumPy interop. An .npy file is a magic string, a format version, a Python dict literal such as
+//   {'descr': '<f4', 'fortran_order': False, 'shape': (150, 4), }
+// padded with spaces to a multiple of 64 bytes, and then the raw array. A mapped .npy is therefore used in
+// place, like a cten file. An .npz is a zip archive of .npy members; members that are stored rather than
+// deflated are mapped the same way. Only little-endian hosts are supported, as for cten files.
+#define CTEN_NPY_MAGIC "\x93NUMPY"
+#define CTEN_NPY_MAGIC_LEN 6
+#define CTEN_NPY_ALIGN 64
+
+static uint64_t cten_npy__u16(const char* p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t cten_npy__u32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t cten_npy__u64(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// the text after "'key':" in the header dict, or NULL
+static const char* cten_npy__value(const char* p, const char* end, const char* key) {
+    size_t n = strlen(key);
+    for(; p + n + 2 < end; p++) {
+        if(p[0] != '\'' || memcmp(p + 1, key, n) != 0 || p[n + 1] != '\'') continue;
+        p += n + 2;
+        while(p < end && (*p == ' ' || *p == ':')) p++;
+        return p;
+    }
+    return NULL;
+}
+
+// parses the .npy image [data, data + size), which starts at base in the mapping, into entry (not its name)
+static bool cten_npy__parse(const char* data, uint64_t size, uint64_t base, CtenFileEntry* entry) {
+    if(size < 10 || memcmp(data, CTEN_NPY_MAGIC, CTEN_NPY_MAGIC_LEN) != 0) return false;
+    uint64_t start, header_len;
+    if(data[6] == 1) {
+        start = 10;
+        header_len = cten_npy__u16(data + 8);
+    } else if((data[6] == 2 || data[6] == 3) && size >= 12) {
+        start = 12;
+        header_len = cten_npy__u32(data + 8);
+    } else {
+        return false;
+    }
+    if(header_len > size - start) return false;
+    const char* header = data + start;
+    const char* end = header + header_len;
+
+    const char* descr = cten_npy__value(header, end, "descr");
+    if(descr == NULL || end - descr < 5 || (descr[0] != '\'' && descr[0] != '"') || descr[4] != descr[0]) return false;
+    if(memcmp(descr + 1, "<f4", 3) == 0) {
+        entry->dtype = CTEN_DTYPE_FLOAT32;
+    } else if(memcmp(descr + 1, "|u1", 3) == 0) {
+        entry->dtype = CTEN_DTYPE_UINT8;
+    } else {
+        return false;
+    }
+    uint64_t elem_size = entry->dtype == CTEN_DTYPE_FLOAT32 ? sizeof(float) : 1;
+
+    const char* order = cten_npy__value(header, end, "fortran_order");
+    if(order == NULL || end - order < 5 || memcmp(order, "False", 5) != 0) return false;
+
+    const char* p = cten_npy__value(header, end, "shape");
+    if(p == NULL || p >= end || *p++ != '(') return false;
+    uint64_t numel = 1;
+    entry->ndim = 0;
+    while(true) {
+        while(p < end && (*p == ' ' || *p == ',')) p++;
+        if(p < end && *p == ')') break;
+        if(p >= end || *p < '0' || *p > '9' || entry->ndim == 4) return false;
+        uint64_t dim = 0;
+        while(p < end && *p >= '0' && *p <= '9' && dim <= INT_MAX) dim = dim * 10 + (uint64_t)(*p++ - '0');
+        // an empty array has no tensor to view
+        if(dim == 0 || dim > INT_MAX) return false;
+        entry->shape[entry->ndim++] = (int32_t)dim;
+        numel *= dim;
+        if(numel > INT_MAX) return false;
+    }
+    for(uint32_t d = entry->ndim; d < 4; d++) entry->shape[d] = 0;
+
+    entry->nbytes = numel * elem_size;
+    if(entry->nbytes > size - start - header_len) return false;
+    entry->offset = base + start + header_len;
+    return true;
+}
+
+cten_file* cten_load_npy(const char* path) {
+    c11_mmap map;
+    if(!c11_mmap__open(&map, path)) return NULL;
+    CtenFileEntry* entry = _cten_malloc(sizeof(CtenFileEntry));
+    memset(entry, 0, sizeof(CtenFileEntry));
+    strcpy(entry->name, "arr_0");
+    if(!cten_npy__parse(map.data, map.size, 0, entry)) {
+        c11_mmap__close(&map);
+        return NULL;
+    }
+    return _cten_file_wrap(map, 1, entry);
+}
+
+// Zip records used by an .npz (all little-endian): the end of central directory record at the end of the file,
+// its zip64 variant for large archives, one central directory entry per member and a local header in front of
+// each member's data. Only the local header gives the exact data offset, since its extra field may differ.
+#define CTEN_ZIP_EOCD 0x06054b50
+#define CTEN_ZIP_EOCD64 0x06064b50
+#define CTEN_ZIP_EOCD64_LOCATOR 0x07064b50
+#define CTEN_ZIP_CENTRAL 0x02014b50
+#define CTEN_ZIP_LOCAL 0x04034b50
+#define CTEN_ZIP_EOCD_SIZE 22
+#define CTEN_ZIP_CENTRAL_SIZE 46
+#define CTEN_ZIP_LOCAL_SIZE 30
+
+// the central directory [*begin, *begin + *size) and its entry count; false if there is none
+static bool cten_npz__directory(const c11_mmap* map, uint64_t* begin, uint64_t* size, uint64_t* n_entries) {
+    const char* data = map->data;
+    if(map->size < CTEN_ZIP_EOCD_SIZE) return false;
+    // the record is followed by a comment of at most 64 KB
+    uint64_t eocd = map->size - CTEN_ZIP_EOCD_SIZE;
+    uint64_t lowest = eocd > 0xffff ? eocd - 0xffff : 0;
+    while(cten_npy__u32(data + eocd) != CTEN_ZIP_EOCD) {
+        if(eocd == lowest) return false;
+        eocd--;
+    }
+    *n_entries = cten_npy__u16(data + eocd + 10);
+    *size = cten_npy__u32(data + eocd + 12);
+    *begin = cten_npy__u32(data + eocd + 16);
+    if(*n_entries == 0xffff || *size == 0xffffffff || *begin == 0xffffffff) {
+        if(eocd < 20 || cten_npy__u32(data + eocd - 20) != CTEN_ZIP_EOCD64_LOCATOR) return false;
+        uint64_t eocd64 = cten_npy__u64(data + eocd - 12);
+        if(map->size < 56 || eocd64 > map->size - 56 || cten_npy__u32(data + eocd64) != CTEN_ZIP_EOCD64) return false;
+        *n_entries = cten_npy__u64(data + eocd64 + 32);
+        *size = cten_npy__u64(data + eocd64 + 40);
+        *begin = cten_npy__u64(data + eocd64 + 48);
+    }
+    return *begin <= map->size && *size <= map->size - *begin && *n_entries <= *size / CTEN_ZIP_CENTRAL_SIZE;
+}
+
+// a member: the ".npy" name without its suffix, and the offset and size of its data; false if it is not a
+// stored .npy file
+static bool cten_npz__member(const c11_mmap* map, const char* p, const char* end, CtenFileEntry* entry,
+                             uint64_t* offset, uint64_t* size) {
+    const char* data = map->data;
+    uint64_t flags = cten_npy__u16(p + 8), method = cten_npy__u16(p + 10);
+    uint64_t compressed = cten_npy__u32(p + 20);
+    uint64_t uncompressed = cten_npy__u32(p + 24);
+    uint64_t name_len = cten_npy__u16(p + 28), extra_len = cten_npy__u16(p + 30);
+    uint64_t local = cten_npy__u32(p + 42);
+    const char* name = p + CTEN_ZIP_CENTRAL_SIZE;
+    const char* extra = name + name_len;
+    if(extra_len > (uint64_t)(end - extra)) return false;
+    // the zip64 extra field holds, in order, whichever of these did not fit in 32 bits
+    for(const char* q = extra; q + 4 <= extra + extra_len;) {
+        uint64_t id = cten_npy__u16(q), len = cten_npy__u16(q + 2);
+        const char* field = q + 4;
+        q = field + len;
+        if(id != 0x0001 || q > extra + extra_len) continue;
+        if(uncompressed == 0xffffffff && field + 8 <= q) {
+            uncompressed = cten_npy__u64(field);
+            field += 8;
+        }
+        if(compressed == 0xffffffff && field + 8 <= q) {
+            compressed = cten_npy__u64(field);
+            field += 8;
+        }
+        if(local == 0xffffffff && field + 8 <= q) local = cten_npy__u64(field);
+    }
+    // compressed and encrypted members cannot be mapped
+    if(method != 0 || (flags & 1) || compressed != uncompressed) return false;
+    if(name_len < 4 || name_len - 4 >= CTEN_MAX_NAME || memcmp(name + name_len - 4, ".npy", 4) != 0) return false;
+    memcpy(entry->name, name, name_len - 4);
+    entry->name[name_len - 4] = '\0';
+
+    if(local > map->size - CTEN_ZIP_LOCAL_SIZE || cten_npy__u32(data + local) != CTEN_ZIP_LOCAL) return false;
+    *offset = local + CTEN_ZIP_LOCAL_SIZE + cten_npy__u16(data + local + 26) + cten_npy__u16(data + local + 28);
+    *size = uncompressed;
+    return *offset <= map->size && *size <= map->size - *offset;
+}
+
+cten_file* cten_load_npz(const char* path) {
+    c11_mmap map;
+    if(!c11_mmap__open(&map, path)) return NULL;
+    uint64_t begin, size, n_entries;
+    if(!cten_npz__directory(&map, &begin, &size, &n_entries)) {
+        c11_mmap__close(&map);
+        return NULL;
+    }
+    const char* p = (const char*)map.data + begin;
+    const char* end = p + size;
+    CtenFileEntry* entries = _cten_malloc(sizeof(CtenFileEntry) * (n_entries > 0 ? n_entries : 1));
+    memset(entries, 0, sizeof(CtenFileEntry) * (n_entries > 0 ? n_entries : 1));
+    bool ok = true;
+    for(uint64_t i = 0; i < n_entries && ok; i++) {
+        ok = end - p >= CTEN_ZIP_CENTRAL_SIZE && cten_npy__u32(p) == CTEN_ZIP_CENTRAL;
+        if(!ok) break;
+        const char* next = p + CTEN_ZIP_CENTRAL_SIZE + cten_npy__u16(p + 28) + cten_npy__u16(p + 30) +
+                           cten_npy__u16(p + 32);
+        uint64_t offset, nbytes;
+        ok = next <= end && cten_npz__member(&map, p, next, &entries[i], &offset, &nbytes) &&
+             cten_npy__parse((const char*)map.data + offset, nbytes, offset, &entries[i]);
+        p = next;
+    }
+    if(!ok) {
+        c11_mmap__close(&map);
+        return NULL;
+    }
+    return _cten_file_wrap(map, (int)n_entries, entries);
+}
+
+bool cten_save_npy(const char* path, Tensor t) {
+    int ndim = TensorShape_dim(t.shape);
+    cten_assert(t.data != NULL && t.data->numel == TensorShape_numel(t.shape),
+                "cten_save_npy: the tensor has no data of its shape.");
+    char header[CTEN_NPY_ALIGN * 2];
+    int n = snprintf(header, sizeof(header), "{'descr': '<f4', 'fortran_order': False, 'shape': (");
+    for(int d = 0; d < ndim; d++) {
+        n += snprintf(header + n, sizeof(header) - n, d + 1 < ndim ? "%d, " : ndim == 1 ? "%d," : "%d", t.shape[d]);
+    }
+    n += snprintf(header + n, sizeof(header) - n, "), }");
+    // spaces and a newline pad the header so the data starts on a 64-byte boundary
+    int padded = (10 + n + 1 + CTEN_NPY_ALIGN - 1) / CTEN_NPY_ALIGN * CTEN_NPY_ALIGN - 10;
+    memset(header + n, ' ', padded - n - 1);
+    header[padded - 1] = '\n';
+
+    char* tmp_path;
+    FILE* fp = _cten_file_create(path, &tmp_path);
+    if(fp == NULL) return false;
+    char preamble[10] = CTEN_NPY_MAGIC "\x01";  // format 1.0, then the header length
+    uint16_t header_len = (uint16_t)padded;
+    memcpy(preamble + 8, &header_len, sizeof(header_len));
+    size_t nbytes = sizeof(float) * (size_t)t.data->numel;
+    bool ok = fwrite(preamble, 1, sizeof(preamble), fp) == sizeof(preamble) &&
+              fwrite(header, 1, padded, fp) == (size_t)padded && fwrite(t.data->flex, 1, nbytes, fp) == nbytes;
+    ok = _cten_file_commit(fp, tmp_path, path, ok);
+    free(tmp_path);
+    return ok;
+}
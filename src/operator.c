@@ -32,6 +32,15 @@ static Tensor GradFn_mul(Tensor self, int i) {
     return Tensor_detach(self.node->inputs[1 - i]);
 }
 
+static void Kernel_add(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* a = s->inputs[0].data->flex;
+    const float* b = s->inputs[1].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
 Tensor Tensor_add(Tensor self, Tensor other) {
     Tensor orig_self = self;
     Tensor orig_other = other;
@@ -42,10 +51,7 @@ Tensor Tensor_add(Tensor self, Tensor other) {
     
     bool requires_grad = !cten_is_eval() && (orig_self.node != NULL || orig_other.node != NULL);
     Tensor res = Tensor_new(self.shape, requires_grad);
-    
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = self.data->flex[i] + other.data->flex[i];
-    }
+    _cten_launch((GraphStep){Kernel_add, res, {self, other}, 2});
     
     if(requires_grad) {
         res.node->grad_fn = GradFn_add;
@@ -57,6 +63,15 @@ Tensor Tensor_add(Tensor self, Tensor other) {
     return res;
 }
 
+static void Kernel_mul(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* a = s->inputs[0].data->flex;
+    const float* b = s->inputs[1].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
 Tensor Tensor_mul(Tensor self, Tensor other) {
     Tensor orig_self = self;
     Tensor orig_other = other;
@@ -67,10 +82,7 @@ Tensor Tensor_mul(Tensor self, Tensor other) {
     
     bool requires_grad = !cten_is_eval() && (orig_self.node != NULL || orig_other.node != NULL);
     Tensor res = Tensor_new(self.shape, requires_grad);
-    
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = self.data->flex[i] * other.data->flex[i];
-    }
+    _cten_launch((GraphStep){Kernel_mul, res, {self, other}, 2});
     
     if(requires_grad) {
         res.node->grad_fn = GradFn_mul;
@@ -84,9 +96,7 @@ Tensor Tensor_mul(Tensor self, Tensor other) {
 
 Tensor Tensor_mulf(Tensor self, float other) {
     Tensor tmp = Tensor_new(self.shape, false);
-    for(int i = 0; i < tmp.data->numel; i++) {
-        tmp.data->flex[i] = other;
-    }
+    _cten_launch((GraphStep){Kernel_fill, tmp, .params = {{.f = other}}});
     Tensor res = Tensor_mul(self, tmp);
     return res;
 }
@@ -140,10 +150,7 @@ Tensor GradFn_mean(Tensor self, int i) {
     
     // gradient value is 1 divided by the number of elements that were averaged.
     float grad_val = 1.0f / divisor;
-    
-    for(int j = 0; j < res.data->numel; j++) {
-        res.data->flex[j] = grad_val;
-    }   
+    _cten_launch((GraphStep){Kernel_fill, res, .params = {{.f = grad_val}}});
     return res;
 }
 
@@ -234,32 +241,43 @@ static Tensor GradFn_matmul(Tensor self, int i) {
     return Tensor_transpose(Tensor_detach(self.node->inputs[1-i]));;
 }
 
-Tensor Tensor_matmul(Tensor self, Tensor other) {
+static void Kernel_matmul(const GraphStep* s) {
+    Tensor self = s->inputs[0];
+    Tensor other = s->inputs[1];
     int self_dim = TensorShape_dim(self.shape);
     int other_dim = TensorShape_dim(other.shape);
-    assert(self_dim >= 2);
-    assert(other_dim >= 2);
-
     int m = self.shape[self_dim - 2];
     int n = self.shape[self_dim - 1];
     int p = other.shape[other_dim - 1];
 
-    assert(n == other.shape[other_dim - 2]);
-
-    TensorShape res_shape;
-    memcpy(res_shape, self.shape, sizeof(TensorShape));
-    res_shape[self_dim - 1] = p;
-    Tensor res = Tensor_new(res_shape, self.node != NULL || other.node != NULL); //here weight/bias have .node != NULL, so res have GradNode
-
     for(int i = 0; i < m; i++) {
         for(int j = 0; j < p; j++) {
             float sum = 0;
             for(int k = 0; k < n; k++) {
                 sum += self.data->flex[i * n + k] * other.data->flex[k * p + j];
             }
-            res.data->flex[i * p + j] = sum;
+            s->out.data->flex[i * p + j] = sum;
         }
     }
+}
+
+Tensor Tensor_matmul(Tensor self, Tensor other) {
+    int self_dim = TensorShape_dim(self.shape);
+    int other_dim = TensorShape_dim(other.shape);
+    assert(self_dim >= 2);
+    assert(other_dim >= 2);
+
+    int n = self.shape[self_dim - 1];
+    int p = other.shape[other_dim - 1];
+
+    assert(n == other.shape[other_dim - 2]);
+
+    TensorShape res_shape;
+    memcpy(res_shape, self.shape, sizeof(TensorShape));
+    res_shape[self_dim - 1] = p;
+    bool requires_grad = !cten_is_eval() && (self.node != NULL || other.node != NULL);
+    Tensor res = Tensor_new(res_shape, requires_grad); //here weight/bias have .node != NULL, so res have GradNode
+    _cten_launch((GraphStep){Kernel_matmul, res, {self, other}, 2});
 
     if(res.node != NULL) {
         res.node->grad_fn = GradFn_matmul;
@@ -282,12 +300,12 @@ static Tensor GradFn_sub(Tensor self, int i) {
     return res;
 }
 
-static Tensor GradFn_div(Tensor self, int i) {
-    Tensor res = Tensor_new(self.shape, false);
-    Tensor x = self.node->inputs[0];
-    Tensor y = self.node->inputs[1];
+static void Kernel_div_backward(const GraphStep* s) {
+    Tensor res = s->out;
+    Tensor x = s->inputs[0];
+    Tensor y = s->inputs[1];
 
-    if (i == 0) { // Gradient w.r.t. x: 1/y
+    if (s->params[0].i == 0) { // Gradient w.r.t. x: 1/y
         for (int j = 0; j < res.data->numel; j++) {
             res.data->flex[j] = 1.0f / y.data->flex[j % y.data->numel];
         }
@@ -298,9 +316,23 @@ static Tensor GradFn_div(Tensor self, int i) {
             res.data->flex[j] = -x_val / (y_val * y_val);
         }
     }
+}
+
+static Tensor GradFn_div(Tensor self, int i) {
+    Tensor res = Tensor_new(self.shape, false);
+    _cten_launch((GraphStep){Kernel_div_backward, res, {self.node->inputs[0], self.node->inputs[1]}, 2, .params = {{.i = i}}});
     return res;
 }
 
+static void Kernel_div(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* a = s->inputs[0].data->flex;
+    const float* b = s->inputs[1].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = a[i] / b[i];
+    }
+}
+
 Tensor Tensor_div(Tensor self, Tensor other) {
     Tensor orig_self = self;
     Tensor orig_other = other;
@@ -310,9 +342,7 @@ Tensor Tensor_div(Tensor self, Tensor other) {
     }
     bool requires_grad = !cten_is_eval() && (orig_self.node != NULL || orig_other.node != NULL);
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for (int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = self.data->flex[i] / other.data->flex[i];
-    }
+    _cten_launch((GraphStep){Kernel_div, res, {self, other}, 2});
     if (requires_grad) {
         res.node->grad_fn = GradFn_div;
         res.node->inputs[0] = orig_self;
@@ -323,23 +353,34 @@ Tensor Tensor_div(Tensor self, Tensor other) {
     return res;
 }
 
-static Tensor GradFn_square(Tensor self, int i) {
+static void Kernel_square_backward(const GraphStep* s) {
     // f(x) = x²; f'(x) = 2x
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for (int j = 0; j < s->out.data->numel; j++) {
+        out[j] = 2.0f * in[j];
+    }
+}
+
+static Tensor GradFn_square(Tensor self, int i) {
     Tensor input = self.node->inputs[i];
     Tensor res = Tensor_new(input.shape, false);
-    for (int j = 0; j < res.data->numel; j++) {
-        res.data->flex[j] = 2.0f * input.data->flex[j];
-    }
+    _cten_launch((GraphStep){Kernel_square_backward, res, {input}, 1});
     return res;
 }
 
+static void Kernel_square(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = in[i] * in[i];
+    }
+}
+
 Tensor Tensor_square(Tensor self) {
     bool requires_grad = !cten_is_eval() && (self.node != NULL);
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for (int i = 0; i < self.data->numel; i++) {
-        float val = self.data->flex[i];
-        res.data->flex[i] = val * val;
-    }
+    _cten_launch((GraphStep){Kernel_square, res, {self}, 1});
     if (requires_grad) {
         res.node->grad_fn = GradFn_square;
         res.node->inputs[0] = self;
@@ -349,23 +390,34 @@ Tensor Tensor_square(Tensor self) {
     return res;
 }
 
-static Tensor GradFn_reciprocal(Tensor self, int i) {
+static void Kernel_reciprocal_backward(const GraphStep* s) {
     // f(x) = 1/x; f'(x) = -1/x^2
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for (int j = 0; j < s->out.data->numel; j++) {
+        out[j] = -1.0f / (in[j] * in[j]);
+    }
+}
+
+static Tensor GradFn_reciprocal(Tensor self, int i) {
     Tensor input = self.node->inputs[i];
     Tensor res = Tensor_new(input.shape, false);
-    for (int j = 0; j < res.data->numel; j++) {
-        float x_val = input.data->flex[j];
-        res.data->flex[j] = -1.0f / (x_val * x_val);
-    }
+    _cten_launch((GraphStep){Kernel_reciprocal_backward, res, {input}, 1});
     return res;
 }
 
+static void Kernel_reciprocal(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = 1.0f / in[i];
+    }
+}
+
 Tensor Tensor_reciprocal(Tensor self) {
     bool requires_grad = !cten_is_eval() && (self.node != NULL);
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for (int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = 1.0f / self.data->flex[i];
-    }
+    _cten_launch((GraphStep){Kernel_reciprocal, res, {self}, 1});
     if (requires_grad) {
         res.node->grad_fn = GradFn_reciprocal;
         res.node->inputs[0] = self;
@@ -375,13 +427,14 @@ Tensor Tensor_reciprocal(Tensor self) {
     return res;
 }
 
-static Tensor GradFn_pow(Tensor self, int i) {
+static void Kernel_pow_backward(const GraphStep* s) {
     // f(x, y) = x^y;  ∂f/∂x = y*x^(y-1);  ∂f/∂y = x^y * ln(x)
-    Tensor res = Tensor_new(self.shape, false);
-    Tensor x = self.node->inputs[0];
-    Tensor y = self.node->inputs[1];
+    Tensor res = s->out;
+    Tensor x = s->inputs[0];
+    Tensor y = s->inputs[1];
+    Tensor self = s->inputs[2];
     
-    if (i == 0) {
+    if (s->params[0].i == 0) {
         // Gradient w.r.t. x: y*x^(y-1)
         for (int j = 0; j < res.data->numel; j++) {
             float x_val = x.data->flex[j % x.data->numel];
@@ -411,9 +464,23 @@ static Tensor GradFn_pow(Tensor self, int i) {
             }
         }
     }
+}
+
+static Tensor GradFn_pow(Tensor self, int i) {
+    Tensor res = Tensor_new(self.shape, false);
+    _cten_launch((GraphStep){Kernel_pow_backward, res, {self.node->inputs[0], self.node->inputs[1], self}, 3, .params = {{.i = i}}});
     return res;
 }
 
+static void Kernel_pow(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* a = s->inputs[0].data->flex;
+    const float* b = s->inputs[1].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = powf(a[i], b[i]);
+    }
+}
+
 Tensor Tensor_pow(Tensor self, Tensor other) {
     Tensor orig_self = self;
     Tensor orig_other = other;
@@ -422,9 +489,7 @@ Tensor Tensor_pow(Tensor self, Tensor other) {
     }
     bool requires_grad = !cten_is_eval() && (orig_self.node != NULL || orig_other.node != NULL);
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for (int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = powf(self.data->flex[i], other.data->flex[i]);
-    }
+    _cten_launch((GraphStep){Kernel_pow, res, {self, other}, 2});
     if (requires_grad) {
         res.node->grad_fn = GradFn_pow;
         res.node->inputs[0] = orig_self;
@@ -435,6 +500,15 @@ Tensor Tensor_pow(Tensor self, Tensor other) {
     return res;
 }
 
+static void Kernel_sub(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* a = s->inputs[0].data->flex;
+    const float* b = s->inputs[1].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = a[i] - b[i];
+    }
+}
+
 Tensor Tensor_sub(Tensor self, Tensor other) {
     Tensor orig_self = self;
     Tensor orig_other = other;
@@ -443,9 +517,7 @@ Tensor Tensor_sub(Tensor self, Tensor other) {
     }
     bool requires_grad = !cten_is_eval() && (orig_self.node != NULL || orig_other.node != NULL);
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for (int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = self.data->flex[i] - other.data->flex[i];
-    }
+    _cten_launch((GraphStep){Kernel_sub, res, {self, other}, 2});
     if (requires_grad) {
         res.node->grad_fn = GradFn_sub;
         res.node->inputs[0] = orig_self;
@@ -456,49 +528,61 @@ Tensor Tensor_sub(Tensor self, Tensor other) {
     return res;
 }
 
-Tensor GradFn_reduce_dim(Tensor self, int i) {
-    Tensor input = self.node->inputs[0];
-    Tensor indices_tensor = self.node->inputs[1];
-    Tensor grad_out = Tensor_zeros(input.shape, false);
-
+// scatters 1 to the selected positions; `indices` has the shape of the reduced output
+static void Kernel_reduce_dim_backward(const GraphStep* s) {
+    Tensor grad_out = s->out;
+    Tensor indices_tensor = s->inputs[0];
+    int reduced_dim = s->params[0].i;
     int out_numel = indices_tensor.data->numel;
-    int ndim = TensorShape_dim(input.shape);
-    int reduced_dim = -1;
+    int ndim = TensorShape_dim(grad_out.shape);
+    int out_ndim = TensorShape_dim(indices_tensor.shape);
+    memset(grad_out.data->flex, 0, sizeof(float) * grad_out.data->numel);
 
-    for(int d = 0, out_d = 0; d < ndim; d++){
-        if(out_d >= TensorShape_dim(self.shape) || input.shape[d] != self.shape[out_d]){
-            reduced_dim = d;
-            break;
-        }
-        out_d++;
-    }
-    cten_assert(reduced_dim != -1, "Could not determine reduced dimension in gradient calculation");
-    
     for (int j = 0; j < out_numel; j++) {
         int index_along_dim = (int)indices_tensor.data->flex[j];
         
-        int linear_idx = 0, stride = 1, out_j_rem = j, out_shape_idx = TensorShape_dim(self.shape) - 1;
+        int linear_idx = 0, stride = 1, out_j_rem = j, out_shape_idx = out_ndim - 1;
         for (int k = ndim - 1; k >= 0; --k) {
             int current_dim_idx;
             if (k == reduced_dim) {
                 current_dim_idx = index_along_dim;
             } else {
-                int dim_k = self.shape[out_shape_idx--];
+                int dim_k = indices_tensor.shape[out_shape_idx--];
                 current_dim_idx = out_j_rem % dim_k;
                 out_j_rem /= dim_k;
             }
             linear_idx += current_dim_idx * stride;
-            stride *= input.shape[k];
+            stride *= grad_out.shape[k];
         }
         grad_out.data->flex[linear_idx] = 1.0f;
     }
+}
+
+Tensor GradFn_reduce_dim(Tensor self, int i) {
+    Tensor input = self.node->inputs[0];
+    Tensor indices_tensor = self.node->inputs[1];
+    Tensor grad_out = Tensor_new(input.shape, false);
+
+    int ndim = TensorShape_dim(input.shape);
+    int reduced_dim = -1;
+
+    for(int d = 0, out_d = 0; d < ndim; d++){
+        if(out_d >= TensorShape_dim(self.shape) || input.shape[d] != self.shape[out_d]){
+            reduced_dim = d;
+            break;
+        }
+        out_d++;
+    }
+    cten_assert(reduced_dim != -1, "Could not determine reduced dimension in gradient calculation");
+    _cten_launch((GraphStep){Kernel_reduce_dim_backward, grad_out, {indices_tensor}, 1, .params = {{.i = reduced_dim}}});
     return grad_out;
 }
 
-Tensor GradFn_max_all(Tensor self, int i) {
-    Tensor input = self.node->inputs[i];
-    Tensor res = Tensor_zeros(input.shape, false);
-    float max_val = self.data->flex[0];
+// spreads the gradient evenly over every element equal to the maximum
+static void Kernel_max_all_backward(const GraphStep* s) {
+    Tensor input = s->inputs[0];
+    Tensor res = s->out;
+    float max_val = s->inputs[1].data->flex[0];
     
     int max_count = 0;
     for (int j = 0; j < input.data->numel; j++) {
@@ -507,8 +591,14 @@ Tensor GradFn_max_all(Tensor self, int i) {
     
     float grad_value = (max_count > 0) ? 1.0f / max_count : 0.0f;
     for (int j = 0; j < input.data->numel; j++) {
-        if (input.data->flex[j] == max_val) res.data->flex[j] = grad_value;
+        res.data->flex[j] = input.data->flex[j] == max_val ? grad_value : 0.0f;
     }
+}
+
+Tensor GradFn_max_all(Tensor self, int i) {
+    Tensor input = self.node->inputs[i];
+    Tensor res = Tensor_new(input.shape, false);
+    _cten_launch((GraphStep){Kernel_max_all_backward, res, {input, self}, 2});
     return res;
 }
 
@@ -538,10 +628,11 @@ Tensor Tensor_max(Tensor self) {
     return res;
 }
 
-Tensor GradFn_min_all(Tensor self, int i) {
-    Tensor input = self.node->inputs[i];
-    Tensor res = Tensor_zeros(input.shape, false);
-    float min_val = self.data->flex[0];
+// spreads the gradient evenly over every element equal to the minimum
+static void Kernel_min_all_backward(const GraphStep* s) {
+    Tensor input = s->inputs[0];
+    Tensor res = s->out;
+    float min_val = s->inputs[1].data->flex[0];
     
     int min_count = 0;
     for (int j = 0; j < input.data->numel; j++) {
@@ -550,8 +641,14 @@ Tensor GradFn_min_all(Tensor self, int i) {
     
     float grad_value = (min_count > 0) ? 1.0f / min_count : 0.0f;
     for (int j = 0; j < input.data->numel; j++) {
-        if (input.data->flex[j] == min_val) res.data->flex[j] = grad_value;
+        res.data->flex[j] = input.data->flex[j] == min_val ? grad_value : 0.0f;
     }
+}
+
+Tensor GradFn_min_all(Tensor self, int i) {
+    Tensor input = self.node->inputs[i];
+    Tensor res = Tensor_new(input.shape, false);
+    _cten_launch((GraphStep){Kernel_min_all_backward, res, {input, self}, 2});
     return res;
 }
 
@@ -582,28 +679,40 @@ Tensor Tensor_min(Tensor self) {
     return res;
 }
 
-static Tensor GradFn_abs(Tensor self, int i) {
-    Tensor input = self.node->inputs[i];
-    Tensor res = Tensor_new(input.shape, false);
-    for(int j = 0; j < input.data->numel; j++) {
-        float val = input.data->flex[j];
+static void Kernel_abs_backward(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int j = 0; j < s->out.data->numel; j++) {
+        float val = in[j];
         if (val > 0) {
-            res.data->flex[j] = 1.0f;
+            out[j] = 1.0f;
         } else if (val < 0) {
-            res.data->flex[j] = -1.0f;
+            out[j] = -1.0f;
         } else {
-            res.data->flex[j] = 0.0f;
+            out[j] = 0.0f;
         }
     }
+}
+
+static Tensor GradFn_abs(Tensor self, int i) {
+    Tensor input = self.node->inputs[i];
+    Tensor res = Tensor_new(input.shape, false);
+    _cten_launch((GraphStep){Kernel_abs_backward, res, {input}, 1});
     return res;
 }
 
+static void Kernel_abs(const GraphStep* s) {
+    float* out = s->out.data->flex;
+    const float* in = s->inputs[0].data->flex;
+    for(int i = 0; i < s->out.data->numel; i++) {
+        out[i] = fabsf(in[i]);
+    }
+}
+
 Tensor Tensor_abs(Tensor self) {
     bool requires_grad = !cten_is_eval() && self.node != NULL;
     Tensor res = Tensor_new(self.shape, requires_grad);
-    for(int i = 0; i < self.data->numel; i++) {
-        res.data->flex[i] = fabsf(self.data->flex[i]);
-    }
+    _cten_launch((GraphStep){Kernel_abs, res, {self}, 1});
 
     if(requires_grad) {
         res.node->grad_fn = GradFn_abs;
@@ -9,12 +9,13 @@ typedef struct optim_adagrad {
     float lr;
     float ε;
     float weight_decay;
-    Tensor* sum_sq_grad;
-    Tensor* params;
-    int n_params;
+    ParamArena arena;
+    Tensor sum_sq_grad;
 
 } optim_adagrad;
 
+static void optim_adagrad__update(void* self, int i);
+
 optim_adagrad* optim_adagrad_new(int n_params, Tensor* params, float lr, float ε,float weight_decay) {
     cten_assert(n_params >= 0, "AdaGrad: n_params cannot be negative, but got %d.", n_params);
     if(n_params > 0) {
@@ -25,36 +26,81 @@ optim_adagrad* optim_adagrad_new(int n_params, Tensor* params, float lr, float 
     cten_assert(weight_decay >= 0.0f, "AdaGrad: weight decay must be non-negative, but got %f.", weight_decay);
 
     optim_adagrad* self = _cten_malloc(sizeof(optim_adagrad));
-    self->n_params = n_params;
-    self->params = params;
+    ParamArena__ctor(&self->arena, n_params, params);
     self->lr = lr;
     self->ε = ε;
-    self->sum_sq_grad = _cten_malloc(sizeof(Tensor) * n_params);
+    self->sum_sq_grad = ParamArena__zeros(&self->arena);
     self->weight_decay = weight_decay;
-    for(int i = 0; i < n_params; i++) {
-        self->sum_sq_grad[i] = Tensor_zeros(params[i].shape, false);
-    }
+    self->arena.owner = self;
+    self->arena.update = optim_adagrad__update;
     return self;
 }
 
-void optim_adagrad_zerograd(optim_adagrad* self) { _cten_zero_grad(self->params, self->n_params); }
+void optim_adagrad_zerograd(optim_adagrad* self) { ParamArena__zero_grad(&self->arena); }
+
+void optim_adagrad_clip_grad_norm(optim_adagrad* self, float max_norm) { ParamArena__clip_grad_norm(&self->arena, max_norm); }
+
+void optim_adagrad_clip_grad_value_range(optim_adagrad* self, float min_value, float max_value) {
+    ParamArena__clip_grad_value_range(&self->arena, min_value, max_value);
+}
 
-void optim_adagrad_step(optim_adagrad* self) {
-    for(int i = 0; i < self->n_params; i++) {
-        Tensor t = self->params[i];
-        if(t.node == NULL || t.node->grad.data == NULL) continue;
+typedef struct AdaGradUpdate {
+    const optim_adagrad* self;
+    float* p;
+    const float* grad;
+    float* sum_sq;
+    GradClip clip;
+} AdaGradUpdate;
 
-        Tensor grad = t.node->grad;
-        Tensor* sum_sq = &self->sum_sq_grad[i];
+// each thread updates a contiguous shard [begin, end) of the parameters and their squared-gradient sums
+static void AdaGradUpdate__run(void* arg, int begin, int end) {
+    const AdaGradUpdate* u = arg;
+    const optim_adagrad* self = u->self;
 
-        for(int j = 0; j < t.data->numel; j++) {
-            float g = grad.data->flex[j];
+    for(int j = begin; j < end; j++) {
+        float g = GradClip__apply(&u->clip, u->grad[j]);
 
-            if (self->weight_decay > 0.0f){
-                g += self->weight_decay * t.data->flex[j];
-            }
-            sum_sq->data->flex[j] += g * g;
-            t.data->flex[j] -= self->lr * g / (sqrtf(sum_sq->data->flex[j]) + self->ε);
+        if (self->weight_decay > 0.0f){
+            g += self->weight_decay * u->p[j];
         }
+        u->sum_sq[j] += g * g;
+        u->p[j] -= self->lr * g / (sqrtf(u->sum_sq[j]) + self->ε);
     }
 }
+
+static void Kernel_adagrad_update(const GraphStep* s) {
+    optim_adagrad* self = s->ctx;
+    AdaGradUpdate u = {
+        .self = self,
+        .p = s->out.data->flex,
+        .grad = s->inputs[0].data->flex,
+        .sum_sq = s->inputs[1].data->flex,
+        .clip = ParamArena__grad_clip(&self->arena),
+    };
+    _cten_parallel_for(s->out.data->numel, AdaGradUpdate__run, &u);
+}
+
+static void optim_adagrad__update(void* ctx, int i) {
+    optim_adagrad* self = ctx;
+    ParamArena* arena = &self->arena;
+    Tensor data = ParamArena__slice(arena, arena->data, i);
+    Tensor grad = ParamArena__grad(arena, i);
+    Tensor sum_sq_grad = ParamArena__slice(arena, self->sum_sq_grad, i);
+    _cten_launch((GraphStep){Kernel_adagrad_update, data, {grad, sum_sq_grad}, 2, .ctx = self});
+}
+
+void optim_adagrad_step(optim_adagrad* self) { optim_adagrad__update(self, -1); }
+
+void optim_adagrad_step_in_backward(optim_adagrad* self, bool enable) { ParamArena__step_in_backward(&self->arena, enable); }
+
+void optim_adagrad_save_state(const optim_adagrad* self, cten_writer* writer, const char* prefix) {
+    char name[CTEN_MAX_NAME];
+    _cten_state_name(name, prefix, "sum_sq_grad");
+    cten_writer_add(writer, name, self->sum_sq_grad);
+}
+
+bool optim_adagrad_load_state(optim_adagrad* self, const cten_file* file, const char* prefix) {
+    char name[CTEN_MAX_NAME];
+    _cten_state_name(name, prefix, "sum_sq_grad");
+    return cten_file_read(file, name, self->sum_sq_grad);
+}
@@ -11,15 +11,24 @@ typedef struct optim_adam {
     float β2;
     float ε;
     float weight_decay;
-    Tensor* m;
-    Tensor* v;
-    Tensor* params;
-    int n_params;
+    bool decoupled;  // AdamW: decay the parameters directly instead of adding weight_decay * p to the gradient
+    bool layerwise;  // LAMB: scale each tensor's step by its trust ratio
+    OptimState state;
+    ParamArena arena;
+    Tensor m;  // fp32 and factored
+    Tensor v;  // fp32
+    FactoredMoment v_factored;
+    QuantBuffer m_8bit;
+    QuantBuffer v_8bit;
     int t;
 
 } optim_adam;
 
-optim_adam* optim_adam_new(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay) {
+static void optim_adam__tick(void* self);
+static void optim_adam__update(void* self, int i);
+
+static optim_adam* optim_adam__new(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay,
+                                   bool decoupled, OptimState state) {
     cten_assert(n_params >= 0, "Adam: n_params cannot be negative, but got %d.", n_params);
     if(n_params > 0) {
         cten_assert(params != NULL, "Adam: params array cannot be NULL when n_params > 0.");
@@ -29,49 +38,318 @@ optim_adam* optim_adam_new(int n_params, Tensor* params, float lr, float β1, fl
     cten_assert(β2 >= 0.0f && β2 < 1.0f, "Adam: beta2 must be in [0, 1), but got %f.", β2);
     cten_assert(ε >= 0.0f, "Adam: epsilon must be non-negative, but got %f.", ε);
     cten_assert(weight_decay >= 0.0f, "Adam: weight decay must be non-negative, but got %f.", weight_decay);
+    cten_assert(state >= OptimState_fp32 && state <= OptimState_8bit, "Adam: unknown state type %d.", (int)state);
 
     optim_adam* self = _cten_malloc(sizeof(optim_adam));
-    self->n_params = n_params;
-    self->params = params;
+    memset(self, 0, sizeof(optim_adam));
+    ParamArena__ctor(&self->arena, n_params, params);
     self->lr = lr;
     self->β1 = β1;
     self->β2 = β2;
     self->ε = ε;
     self->t = 0;
     self->weight_decay = weight_decay;
+    self->decoupled = decoupled;
+    self->state = state;
 
-    self->m = _cten_malloc(sizeof(Tensor) * n_params);
-    self->v = _cten_malloc(sizeof(Tensor) * n_params);
-    for(int i = 0; i < n_params; i++) {
-        self->m[i] = Tensor_zeros(params[i].shape, false);
-        self->v[i] = Tensor_zeros(params[i].shape, false);
+    switch(state) {
+        case OptimState_fp32:
+            self->m = ParamArena__zeros(&self->arena);
+            self->v = ParamArena__zeros(&self->arena);
+            break;
+        case OptimState_factored:
+            self->m = ParamArena__zeros(&self->arena);
+            FactoredMoment__ctor(&self->v_factored, &self->arena);
+            break;
+        case OptimState_8bit:
+            QuantBuffer__ctor(&self->m_8bit, &self->arena, false);
+            QuantBuffer__ctor(&self->v_8bit, &self->arena, true);
+            break;
     }
+    self->arena.owner = self;
+    self->arena.tick = optim_adam__tick;
+    self->arena.update = optim_adam__update;
     return self;
 }
 
-void optim_adam_zerograd(optim_adam* self) { _cten_zero_grad(self->params, self->n_params); }
+optim_adam* optim_adam_new(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay) {
+    return optim_adam__new(n_params, params, lr, β1, β2, ε, weight_decay, false, OptimState_fp32);
+}
+
+optim_adam* optim_adamw_new(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay) {
+    return optim_adam__new(n_params, params, lr, β1, β2, ε, weight_decay, true, OptimState_fp32);
+}
 
-void optim_adam_step(optim_adam* self) {
+optim_adam* optim_lamb_new(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay) {
+    optim_adam* self = optim_adam__new(n_params, params, lr, β1, β2, ε, weight_decay, false, OptimState_fp32);
+    self->layerwise = true;
+    return self;
+}
+
+optim_adam* optim_adam_new_with_state(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay,
+                                      OptimState state) {
+    return optim_adam__new(n_params, params, lr, β1, β2, ε, weight_decay, false, state);
+}
+
+optim_adam* optim_adamw_new_with_state(int n_params, Tensor* params, float lr, float β1, float β2, float ε, float weight_decay,
+                                       OptimState state) {
+    return optim_adam__new(n_params, params, lr, β1, β2, ε, weight_decay, true, state);
+}
+
+size_t optim_adam_state_bytes(const optim_adam* self) {
+    size_t n = sizeof(float) * self->arena.offsets[self->arena.n_params];
+    switch(self->state) {
+        case OptimState_fp32: return 2 * n;
+        case OptimState_factored: return n + FactoredMoment__bytes(&self->v_factored);
+        case OptimState_8bit: return QuantBuffer__bytes(&self->m_8bit) + QuantBuffer__bytes(&self->v_8bit);
+    }
+    return 0;
+}
+
+void optim_adam_zerograd(optim_adam* self) { ParamArena__zero_grad(&self->arena); }
+
+void optim_adam_clip_grad_norm(optim_adam* self, float max_norm) { ParamArena__clip_grad_norm(&self->arena, max_norm); }
+
+void optim_adam_clip_grad_value_range(optim_adam* self, float min_value, float max_value) {
+    ParamArena__clip_grad_value_range(&self->arena, min_value, max_value);
+}
+
+// the step counter is state too: a replayed step must advance it like an eager one
+static void Kernel_adam_tick(const GraphStep* s) {
+    optim_adam* self = s->ctx;
     self->t++;
-    for(int i = 0; i < self->n_params; i++) {
-        Tensor p = self->params[i];
-        if(p.node == NULL || p.node->grad.data == NULL) continue;
-
-        Tensor grad = p.node->grad;
-        Tensor* m = &self->m[i];
-        Tensor* v = &self->v[i];
-
-        for(int j = 0; j < p.data->numel; j++) {
-            float g = grad.data->flex[j];
-            if (self->weight_decay > 0.0f){
-                g += self->weight_decay * p.data->flex[j];
-            }
-            m->data->flex[j] = self->β1 * m->data->flex[j] + (1 - self->β1) * g;
-            v->data->flex[j] = self->β2 * v->data->flex[j] + (1 - self->β2) * g * g;
+}
+
+// everything the inner loop needs, resolved once per step
+typedef struct AdamUpdate {
+    optim_adam* self;
+    float* p;
+    const float* grad;  // the launch's gradient, indexed from begin
+    float* m;
+    float* v;
+    int begin, end;  // range of the flat arena this launch updates
+    int first_block;  // 8-bit: the first block of that range's state
+    float lr, β1, β2, ε;
+    float l2;     // coupled weight decay, folded into the gradient
+    float decay;  // decoupled weight decay, multiplied into the parameter
+    float bc1, bc2;
+    GradClip clip;
+} AdamUpdate;
+
+static void AdamUpdate__apply(const AdamUpdate* u, float* restrict p, const float* restrict grad, float* restrict m,
+                              float* restrict v, int n) {
+    // no branches: with clipping off, l2 == 0 and decay == 1 this is plain Adam, so the compiler can vectorize it as is
+    for(int j = 0; j < n; j++) {
+        float g = GradClip__apply(&u->clip, grad[j]) + u->l2 * p[j];
+        m[j] = u->β1 * m[j] + (1 - u->β1) * g;
+        v[j] = u->β2 * v[j] + (1 - u->β2) * g * g;
+        float m_hat = m[j] / u->bc1;
+        float v_hat = v[j] / u->bc2;
+        p[j] = p[j] * u->decay - u->lr * m_hat / (sqrtf(v_hat) + u->ε);
+    }
+}
+
+static void AdamUpdate__run(void* arg, int begin, int end) {
+    const AdamUpdate* u = arg;
+    AdamUpdate__apply(u, u->p + begin, u->grad + begin, u->m + begin, u->v + begin, end - begin);
+}
+
+// blocks are decoded to fp32, updated by the same loop and encoded again with fresh scales
+static void AdamUpdate__run_8bit(void* arg, int begin, int end) {
+    const AdamUpdate* u = arg;
+    float m[CTEN_QUANT_BLOCK], v[CTEN_QUANT_BLOCK];
+    for(int b = u->first_block + begin; b < u->first_block + end; b++) {
+        int lo;
+        int n = QuantBuffer__span(&u->self->m_8bit, &u->self->arena, b, &lo);
+        QuantBuffer__load(&u->self->m_8bit, b, m);
+        QuantBuffer__load(&u->self->v_8bit, b, v);
+        AdamUpdate__apply(u, u->p + lo, u->grad + lo - u->begin, m, v, n);
+        QuantBuffer__store(&u->self->m_8bit, b, m);
+        QuantBuffer__store(&u->self->v_8bit, b, v);
+    }
+}
 
-            float m_hat = m->data->flex[j] / (1 - powf(self->β1, self->t));
-            float v_hat = v->data->flex[j] / (1 - powf(self->β2, self->t));
-            p.data->flex[j] -= self->lr * m_hat / (sqrtf(v_hat) + self->ε);
+static void AdamUpdate__run_factored(const AdamUpdate* u, int i) {
+    const ParamArena* arena = &u->self->arena;
+    const FactoredMoment* fm = &u->self->v_factored;
+    int offset = arena->offsets[i];
+    float* p = u->p + offset;
+    const float* grad = u->grad + offset - u->begin;
+    float* m = u->m + offset;
+    float* v = fm->data + fm->offsets[i];
+    if(!FactoredMoment__is_factored(arena, i)) {
+        AdamUpdate__apply(u, p, grad, m, v, arena->params[i].data->numel);
+        return;
+    }
+    int rows = arena->params[i].shape[0];
+    int cols = arena->params[i].shape[1];
+    float* row = v;
+    float* col = v + rows;
+    float inv_row_mean = FactoredMoment__update(row, col, p, grad, rows, cols, &u->clip, u->l2, u->β2);
+    for(int r = 0; r < rows; r++) {
+        for(int c = 0; c < cols; c++) {
+            int j = r * cols + c;
+            float g = GradClip__apply(&u->clip, grad[j]) + u->l2 * p[j];
+            m[j] = u->β1 * m[j] + (1 - u->β1) * g;
+            float m_hat = m[j] / u->bc1;
+            float v_hat = row[r] * col[c] * inv_row_mean / u->bc2;
+            p[j] = p[j] * u->decay - u->lr * m_hat / (sqrtf(v_hat) + u->ε);
+        }
+    }
+}
+
+// LAMB: r = m_hat / (sqrt(v_hat) + ε) + wd * p, p -= lr * trust * r with trust = |p| / |r| per tensor.
+// The moment update also accumulates both norms, so the second pass only rereads m, v and p.
+static void LAMB__update_tensor(const AdamUpdate* u, const optim_adam* self, float* restrict p, const float* restrict grad,
+                                float* restrict m, float* restrict v, int n) {
+    float p_sq = 0.0f, r_sq = 0.0f;
+    for(int j = 0; j < n; j++) {
+        float g = GradClip__apply(&u->clip, grad[j]);
+        m[j] = u->β1 * m[j] + (1 - u->β1) * g;
+        v[j] = u->β2 * v[j] + (1 - u->β2) * g * g;
+        float r = (m[j] / u->bc1) / (sqrtf(v[j] / u->bc2) + u->ε) + self->weight_decay * p[j];
+        p_sq += p[j] * p[j];
+        r_sq += r * r;
+    }
+    float p_norm = sqrtf(p_sq), r_norm = sqrtf(r_sq);
+    float trust = p_norm > 0.0f && r_norm > 0.0f ? p_norm / r_norm : 1.0f;
+
+    for(int j = 0; j < n; j++) {
+        float r = (m[j] / u->bc1) / (sqrtf(v[j] / u->bc2) + u->ε) + self->weight_decay * p[j];
+        p[j] -= u->lr * trust * r;
+    }
+}
+
+// params[0].i is the parameter to update, or -1 for the whole arena
+static void Kernel_adam_update(const GraphStep* s) {
+    optim_adam* self = s->ctx;
+    const ParamArena* arena = &self->arena;
+    int i = s->params[0].i;
+    AdamUpdate u = {
+        .self = self,
+        .p = arena->data.data->flex,
+        .grad = s->inputs[0].data->flex,
+        .m = self->m.data != NULL ? self->m.data->flex : NULL,
+        .v = self->v.data != NULL ? self->v.data->flex : NULL,
+        .begin = i < 0 ? 0 : arena->offsets[i],
+        .end = i < 0 ? arena->offsets[arena->n_params] : arena->offsets[i] + arena->params[i].data->numel,
+        .lr = self->lr,
+        .β1 = self->β1,
+        .β2 = self->β2,
+        .ε = self->ε,
+        .l2 = self->decoupled ? 0.0f : self->weight_decay,
+        .decay = self->decoupled ? 1.0f - self->lr * self->weight_decay : 1.0f,
+        .bc1 = 1 - powf(self->β1, self->t),
+        .bc2 = 1 - powf(self->β2, self->t),
+        .clip = ParamArena__grad_clip(&self->arena),
+    };
+    if(u.begin >= u.end) return;
+    if(self->layerwise) {
+        for(int k = i < 0 ? 0 : i; k < (i < 0 ? arena->n_params : i + 1); k++) {
+            int offset = arena->offsets[k];
+            LAMB__update_tensor(&u, self, u.p + offset, u.grad + offset - u.begin, u.m + offset, u.v + offset, arena->params[k].data->numel);
+        }
+        return;
+    }
+    switch(self->state) {
+        case OptimState_fp32: {
+            // the shard offsets are relative to the launch range, like the gradient's
+            u.p += u.begin;
+            u.m += u.begin;
+            u.v += u.begin;
+            _cten_parallel_for(u.end - u.begin, AdamUpdate__run, &u);
+            break;
         }
+        case OptimState_factored: {
+            for(int k = i < 0 ? 0 : i; k < (i < 0 ? arena->n_params : i + 1); k++) {
+                AdamUpdate__run_factored(&u, k);
+            }
+            break;
+        }
+        case OptimState_8bit: {
+            const int* offsets = self->m_8bit.offsets;
+            u.first_block = offsets[i < 0 ? 0 : i] / CTEN_QUANT_BLOCK;
+            int n_blocks = (offsets[i < 0 ? arena->n_params : i + 1] - offsets[i < 0 ? 0 : i]) / CTEN_QUANT_BLOCK;
+            _cten_parallel_for(n_blocks, AdamUpdate__run_8bit, &u);
+            break;
+        }
+    }
+}
+
+static void optim_adam__tick(void* self) { _cten_launch((GraphStep){Kernel_adam_tick, .ctx = self}); }
+
+static void optim_adam__update(void* ctx, int i) {
+    optim_adam* self = ctx;
+    ParamArena* arena = &self->arena;
+    Tensor data = ParamArena__slice(arena, arena->data, i);
+    Tensor grad = ParamArena__grad(arena, i);
+    _cten_launch((GraphStep){Kernel_adam_update, data, {grad}, 1, .params = {{.i = i}}, .ctx = self});
+}
+
+void optim_adam_step(optim_adam* self) {
+    optim_adam__tick(self);
+    optim_adam__update(self, -1);
+}
+
+void optim_adam_step_in_backward(optim_adam* self, bool enable) { ParamArena__step_in_backward(&self->arena, enable); }
+
+// the entries depend on the state format, so the state is restored only into an optimizer created with the same one
+void optim_adam_save_state(const optim_adam* self, cten_writer* writer, const char* prefix) {
+    char name[CTEN_MAX_NAME];
+    _cten_state_name(name, prefix, "t");
+    int32_t t = self->t;
+    cten_writer_add_bytes(writer, name, &t, sizeof(t));
+    switch(self->state) {
+        case OptimState_fp32:
+            _cten_state_name(name, prefix, "m");
+            cten_writer_add(writer, name, self->m);
+            _cten_state_name(name, prefix, "v");
+            cten_writer_add(writer, name, self->v);
+            break;
+        case OptimState_factored:
+            _cten_state_name(name, prefix, "m");
+            cten_writer_add(writer, name, self->m);
+            FactoredMoment__write(&self->v_factored, writer, prefix, "v_factored");
+            break;
+        case OptimState_8bit:
+            QuantBuffer__write(&self->m_8bit, writer, prefix, "m_8bit");
+            QuantBuffer__write(&self->v_8bit, writer, prefix, "v_8bit");
+            break;
+    }
+}
+
+// every entry is checked before any is copied, so a file that does not fit leaves the optimizer as it was
+static bool optim_adam__check_state(const optim_adam* self, const cten_file* file, const char* prefix) {
+    char name[CTEN_MAX_NAME], v_name[CTEN_MAX_NAME];
+    _cten_state_name(name, prefix, "t");
+    if(!_cten_file_has_bytes(file, name, sizeof(int32_t))) return false;
+    _cten_state_name(name, prefix, "m");
+    _cten_state_name(v_name, prefix, "v");
+    switch(self->state) {
+        case OptimState_fp32: return _cten_file_matches(file, name, self->m) && _cten_file_matches(file, v_name, self->v);
+        case OptimState_factored:
+            return _cten_file_matches(file, name, self->m) && FactoredMoment__check(&self->v_factored, file, prefix, "v_factored");
+        case OptimState_8bit:
+            return QuantBuffer__check(&self->m_8bit, file, prefix, "m_8bit") && QuantBuffer__check(&self->v_8bit, file, prefix, "v_8bit");
     }
-}
\ No newline at end of file
+    return false;
+}
+
+bool optim_adam_load_state(optim_adam* self, const cten_file* file, const char* prefix) {
+    if(!optim_adam__check_state(self, file, prefix)) return false;
+    char name[CTEN_MAX_NAME], v_name[CTEN_MAX_NAME];
+    _cten_state_name(name, prefix, "t");
+    int32_t t;
+    _cten_file_read_bytes(file, name, &t, sizeof(t));
+    self->t = t;
+    _cten_state_name(name, prefix, "m");
+    _cten_state_name(v_name, prefix, "v");
+    switch(self->state) {
+        case OptimState_fp32: return cten_file_read(file, name, self->m) && cten_file_read(file, v_name, self->v);
+        case OptimState_factored:
+            return cten_file_read(file, name, self->m) && FactoredMoment__read(&self->v_factored, file, prefix, "v_factored");
+        case OptimState_8bit:
+            return QuantBuffer__read(&self->m_8bit, file, prefix, "m_8bit") && QuantBuffer__read(&self->v_8bit, file, prefix, "v_8bit");
+    }
+    return false;
+}
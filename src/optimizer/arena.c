@@ -0,0 +1,225 @@
+#include "cten.h"
+#include "cten_internal.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CTEN_ALIGN_FLOATS ((int)(CTEN_ALIGN / sizeof(float)))
+
+static void ParamArena__first_touch(void* arg, int begin, int end) {
+    float* flex = arg;
+    memset(flex + begin, 0, sizeof(float) * (end - begin));
+}
+
+// zeroed by the thread pool with the same shards a full step uses, so on NUMA systems each shard's pages
+// are placed on the node of the thread that will update them (set the thread count before creating optimizers).
+// The FloatBuffer and its floats are one pool block, so _cten_free_block(self.data) releases both.
+static Tensor ParamArena__flat(int numel) {
+    Tensor self = {0};
+    self.shape[0] = numel;
+    self.data = _cten_malloc(sizeof(FloatBuffer) + sizeof(float) * numel + CTEN_ALIGN);
+    self.data->numel = numel;
+    char* flex = (char*)(self.data + 1);
+    self.data->flex = (float*)(flex + (CTEN_ALIGN - (uintptr_t)flex % CTEN_ALIGN) % CTEN_ALIGN);
+    _cten_parallel_for(numel, ParamArena__first_touch, self.data->flex);
+    return self;
+}
+
+void ParamArena__ctor(ParamArena* self, int n_params, Tensor* params) {
+    self->n_params = n_params;
+    self->params = params;
+    self->offsets = _cten_malloc(sizeof(int) * (n_params + 1));
+    int numel = 0;
+    for(int i = 0; i < n_params; i++) {
+        self->offsets[i] = numel;
+        numel += (params[i].data->numel + CTEN_ALIGN_FLOATS - 1) / CTEN_ALIGN_FLOATS * CTEN_ALIGN_FLOATS;
+    }
+    self->offsets[n_params] = numel;
+
+    // the parameters and their gradients move into the pool the parameters were created in: they are
+    // allocated once and outlive both the optimizer and whatever pool is active during backward
+    if(n_params > 0) cten_begin_malloc(_cten_pool_of(params[0].data));
+    self->data = ParamArena__flat(numel);
+    self->grad = ParamArena__flat(numel);
+    self->grads = _cten_malloc(sizeof(Tensor) * n_params);
+
+    for(int i = 0; i < n_params; i++) {
+        FloatBuffer* buf = params[i].data;
+        cten_assert(_cten_pool_of(buf) == _cten_pool_of(params[0].data),
+                    "optimizer parameters must all be allocated in the same pool");
+        float* dst = self->data.data->flex + self->offsets[i];
+        memcpy(dst, buf->flex, sizeof(float) * buf->numel);
+        buf->flex = dst;
+        self->grads[i] = ParamArena__view(self, self->grad, i);
+        if(params[i].node != NULL) params[i].node->grad = self->grads[i];
+    }
+    if(n_params > 0) cten_end_malloc();
+
+    self->clip_norm = 0.0f;
+    self->clip_min = -INFINITY;
+    self->clip_max = INFINITY;
+    self->clip_partials = _cten_malloc(sizeof(float) * (numel / CTEN_CLIP_BLOCK + 1));
+    self->owner = NULL;
+    self->tick = NULL;
+    self->update = NULL;
+    self->updated = _cten_malloc(sizeof(bool) * (n_params + 1));
+    memset(self->updated, 0, sizeof(bool) * (n_params + 1));
+    self->leaves = _cten_malloc(sizeof(ParamLeaf) * (n_params + 1));
+}
+
+Tensor ParamArena__zeros(const ParamArena* self) { return ParamArena__flat(self->offsets[self->n_params]); }
+
+Tensor ParamArena__view(const ParamArena* self, Tensor flat, int i) {
+    Tensor view = {0};
+    memcpy(view.shape, self->params[i].shape, sizeof(TensorShape));
+    view.data = _cten_malloc(sizeof(FloatBuffer));
+    view.data->numel = self->params[i].data->numel;
+    view.data->flex = flat.data->flex + self->offsets[i];
+    return view;
+}
+
+Tensor ParamArena__slice(const ParamArena* self, Tensor flat, int i) {
+    return i < 0 ? flat : ParamArena__view(self, flat, i);
+}
+
+// while stepping in backward the arena holds no gradients: a parameter's is what backward left on its leaf
+Tensor ParamArena__grad(const ParamArena* self, int i) {
+    if(self->grad.data != NULL) return ParamArena__slice(self, self->grad, i);
+    cten_assert(i >= 0, "optim_*_step needs every gradient, call optim_*_step_in_backward(self, false) first");
+    GradNode* node = self->params[i].node;
+    return node != NULL ? node->grad : Tensor_zeros(self->params[i].shape, false);
+}
+
+// a single memset over the persistent flat buffer, nothing is allocated
+void ParamArena__zero_grad(ParamArena* self) {
+    if(self->grad.data != NULL) _cten_launch((GraphStep){Kernel_fill, self->grad, .params = {{.f = 0.0f}}});
+    // backward accumulates into whatever a leaf holds, so put the arena views back if they were replaced
+    // (or, while stepping in backward, drop what an earlier backward left there)
+    for(int i = 0; i < self->n_params; i++) {
+        GradNode* node = self->params[i].node;
+        if(node != NULL) node->grad = self->grad.data != NULL ? self->grads[i] : (Tensor){0};
+    }
+}
+
+void ParamArena__clip_grad_norm(ParamArena* self, float max_norm) {
+    cten_assert(max_norm >= 0.0f, "clip_grad_norm: max_norm must be non-negative, but got %f", max_norm);
+    self->clip_norm = max_norm;
+}
+
+void ParamArena__clip_grad_value_range(ParamArena* self, float min_value, float max_value) {
+    cten_assert(min_value <= max_value, "min_value must be less than or equal to max_value");
+    self->clip_min = min_value;
+    self->clip_max = max_value;
+}
+
+typedef struct ClipNormPass {
+    const ParamArena* arena;
+    const float* grad;
+    int numel;
+} ClipNormPass;
+
+static void ClipNormPass__run(void* arg, int begin, int end) {
+    const ClipNormPass* pass = arg;
+    const ParamArena* arena = pass->arena;
+    for(int b = begin; b < end; b++) {
+        int j_end = (b + 1) * CTEN_CLIP_BLOCK < pass->numel ? (b + 1) * CTEN_CLIP_BLOCK : pass->numel;
+        float sum = 0.0f;
+        for(int j = b * CTEN_CLIP_BLOCK; j < j_end; j++) {
+            float g = pass->grad[j];
+            g = g < arena->clip_min ? arena->clip_min : (g > arena->clip_max ? arena->clip_max : g);
+            sum += g * g;
+        }
+        arena->clip_partials[b] = sum;
+    }
+}
+
+// Only the global norm needs a pass of its own (a read, no write); clamping and scaling happen in the update loop
+GradClip ParamArena__grad_clip(ParamArena* self) {
+    GradClip clip = {self->clip_min, self->clip_max, 1.0f};
+    if(self->clip_norm <= 0.0f) return clip;
+
+    int numel = self->grad.data->numel;
+    int n_blocks = (numel + CTEN_CLIP_BLOCK - 1) / CTEN_CLIP_BLOCK;
+    ClipNormPass pass = {self, self->grad.data->flex, numel};
+    _cten_parallel_for(n_blocks, ClipNormPass__run, &pass);
+    float total_sq = 0.0f;
+    for(int b = 0; b < n_blocks; b++) {
+        total_sq += self->clip_partials[b];
+    }
+    float total_norm = sqrtf(total_sq);
+    if(total_norm > self->clip_norm) clip.scale = self->clip_norm / total_norm;
+    return clip;
+}
+
+// The gradient has been consumed by the update, so free it right away and let the next backward start from
+// none (zerograd is implied). A captured step's buffers belong to the memory planner, which sees the last use.
+static void ParamArena__update_and_release(ParamArena* self, int i) {
+    GradNode* node = self->params[i].node;
+    if(node != NULL && node->grad.data == NULL) node->grad = Tensor_zeros(self->params[i].shape, false);
+    self->update(self->owner, i);
+    if(node != NULL) {
+        if(_cten_context()->capture == NULL) _cten_free_block(node->grad.data);
+        node->grad = (Tensor){0};
+    }
+    self->updated[i] = true;
+}
+
+static void ParamArena__on_backward_begin(void* ctx) {
+    ParamArena* self = ctx;
+    cten_assert(self->clip_norm <= 0.0f, "global norm clipping needs every gradient, it cannot step inside backward");
+    if(self->tick != NULL) self->tick(self->owner);
+}
+
+static int ParamLeaf__cmp(const void* a, const void* b) {
+    const GradNode* x = ((const ParamLeaf*)a)->node;
+    const GradNode* y = ((const ParamLeaf*)b)->node;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void ParamArena__on_grad_ready(void* ctx, GradNode* leaf) {
+    ParamArena* self = ctx;
+    ParamLeaf key = {leaf, -1};
+    const ParamLeaf* found = bsearch(&key, self->leaves, self->n_params, sizeof(ParamLeaf), ParamLeaf__cmp);
+    if(found != NULL && !self->updated[found->i]) ParamArena__update_and_release(self, found->i);
+}
+
+// parameters backward never reached still take part in the step, as they would in optim_*_step
+static void ParamArena__on_backward_end(void* ctx) {
+    ParamArena* self = ctx;
+    for(int i = 0; i < self->n_params; i++) {
+        if(!self->updated[i]) ParamArena__update_and_release(self, i);
+        self->updated[i] = false;
+    }
+}
+
+// Gradients are only needed until their parameter is stepped, so the flat gradient buffer is freed while this
+// is enabled. Backward leaves each gradient on its leaf as a temporary, which the step frees straight away.
+void ParamArena__step_in_backward(ParamArena* self, bool enable) {
+    cten_assert(self->update != NULL, "step_in_backward: optimizer did not register its update");
+    BackwardHook* hook = &_cten_context()->backward_hook;
+    if(enable) {
+        cten_assert(self->clip_norm <= 0.0f, "global norm clipping needs every gradient, it cannot step inside backward");
+        *hook = (BackwardHook){ParamArena__on_backward_begin, ParamArena__on_grad_ready, ParamArena__on_backward_end, self};
+        if(self->grad.data == NULL) return;
+        for(int i = 0; i < self->n_params; i++) {
+            self->leaves[i] = (ParamLeaf){self->params[i].node, i};
+            if(self->params[i].node != NULL) self->params[i].node->grad = (Tensor){0};
+        }
+        qsort(self->leaves, self->n_params, sizeof(ParamLeaf), ParamLeaf__cmp);
+        _cten_free_block(self->grad.data);
+        self->grad = (Tensor){0};
+        return;
+    }
+    if(hook->ctx == self) *hook = (BackwardHook){0};
+    if(self->grad.data != NULL) return;
+    // back to accumulating: a zeroed flat buffer in the parameters' pool, with the views pointing into it
+    cten_begin_malloc(_cten_pool_of(self->data.data));
+    self->grad = ParamArena__flat(self->offsets[self->n_params]);
+    cten_end_malloc();
+    for(int i = 0; i < self->n_params; i++) {
+        self->grads[i].data->flex = self->grad.data->flex + self->offsets[i];
+        if(self->params[i].node != NULL) self->params[i].node->grad = self->grads[i];
+    }
+}
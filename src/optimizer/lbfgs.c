@@ -0,0 +1,339 @@
+#include "cten.h"
+#include "cten_internal.h"
+#include <math.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Full-batch L-BFGS with a strong-Wolfe line search, following Nocedal & Wright (algorithms 7.4, 3.5 and 3.6).
+// Every vector is a flat buffer laid out like the parameter arena, so parameters and gradients are read and
+// written in place; the padding between parameters stays zero in all of them.
+
+#define LBFGS_C1 1e-4             // sufficient decrease
+#define LBFGS_C2 0.9              // curvature
+#define LBFGS_MAX_LS 25           // function evaluations per line search
+#define LBFGS_TOLERANCE_GRAD 1e-7f
+#define LBFGS_TOLERANCE_CHANGE 1e-9f
+
+typedef struct optim_lbfgs {
+    float lr;
+    int max_iter;
+    int max_eval;
+    ParamArena arena;
+    int numel;
+    // history ring buffer: pair k lives in row (head + k) % history_size of s and y
+    int history_size;
+    int n_history;
+    int head;
+    float* s;
+    float* y;
+    double* ro;
+    double* al;
+    double h_diag;
+    // flat vectors
+    float* d;
+    float* flat_grad;
+    float* prev_flat_grad;
+    float* x_init;
+    float* ls_grad[3];  // g_prev and the two bracket ends of the line search
+    double t;
+    int n_iter;
+    int func_evals;
+} optim_lbfgs;
+
+static float* optim_lbfgs__vector(int numel) {
+    float* self = _cten_malloc_aligned(sizeof(float) * (numel > 0 ? numel : 1));
+    memset(self, 0, sizeof(float) * numel);
+    return self;
+}
+
+optim_lbfgs* optim_lbfgs_new(int n_params, Tensor* params, float lr, int max_iter, int history_size) {
+    cten_assert(n_params >= 0, "L-BFGS: n_params cannot be negative, but got %d.", n_params);
+    if(n_params > 0) {
+        cten_assert(params != NULL, "L-BFGS: params array cannot be NULL when n_params > 0.");
+    }
+    cten_assert(lr > 0.0f, "L-BFGS: learning rate must be positive, but got %f.", lr);
+    cten_assert(max_iter > 0, "L-BFGS: max_iter must be positive, but got %d.", max_iter);
+    cten_assert(history_size > 0, "L-BFGS: history_size must be positive, but got %d.", history_size);
+
+    optim_lbfgs* self = _cten_malloc(sizeof(optim_lbfgs));
+    memset(self, 0, sizeof(optim_lbfgs));
+    ParamArena__ctor(&self->arena, n_params, params);
+    self->lr = lr;
+    self->max_iter = max_iter;
+    self->max_eval = max_iter * 5 / 4;
+    self->numel = self->arena.offsets[n_params];
+    self->history_size = history_size;
+    int numel = self->numel;
+    self->s = _cten_malloc_aligned(sizeof(float) * ((size_t)history_size * numel + 1));
+    self->y = _cten_malloc_aligned(sizeof(float) * ((size_t)history_size * numel + 1));
+    self->ro = _cten_malloc(sizeof(double) * history_size);
+    self->al = _cten_malloc(sizeof(double) * history_size);
+    self->d = optim_lbfgs__vector(numel);
+    self->flat_grad = optim_lbfgs__vector(numel);
+    self->prev_flat_grad = optim_lbfgs__vector(numel);
+    self->x_init = optim_lbfgs__vector(numel);
+    for(int k = 0; k < 3; k++) {
+        self->ls_grad[k] = optim_lbfgs__vector(numel);
+    }
+    return self;
+}
+
+int optim_lbfgs_func_evals(const optim_lbfgs* self) { return self->func_evals; }
+
+static double dot(const float* a, const float* b, int n) {
+    double sum = 0.0;
+    for(int j = 0; j < n; j++) sum += (double)a[j] * b[j];
+    return sum;
+}
+
+static float abs_max(const float* a, int n) {
+    float m = 0.0f;
+    for(int j = 0; j < n; j++) m = fmaxf(m, fabsf(a[j]));
+    return m;
+}
+
+// loss and gradient at the current parameters; everything the closure allocates is freed again
+static float optim_lbfgs__evaluate(optim_lbfgs* self, cten_closure closure, void* ctx, PoolId scratch) {
+    cten_begin_malloc(scratch);
+    ParamArena__zero_grad(&self->arena);
+    Tensor loss = closure(ctx);
+    cten_assert(loss.data->numel == 1, "L-BFGS: the closure must return a scalar loss.");
+    float f = loss.data->flex[0];
+    Tensor_backward(loss, (Tensor){0});
+    cten_end_malloc();
+    cten_free(scratch);
+    self->func_evals++;
+    return f;
+}
+
+typedef struct LineSearch {
+    optim_lbfgs* self;
+    cten_closure closure;
+    void* ctx;
+    PoolId scratch;
+    int evals;
+} LineSearch;
+
+// loss at x_init + t * d; the gradient is left in the arena
+static double LineSearch__evaluate(LineSearch* ls, double t, double* gtd) {
+    optim_lbfgs* self = ls->self;
+    float* p = self->arena.data.data->flex;
+    for(int j = 0; j < self->numel; j++) {
+        p[j] = self->x_init[j] + (float)t * self->d[j];
+    }
+    double f = optim_lbfgs__evaluate(self, ls->closure, ls->ctx, ls->scratch);
+    *gtd = dot(self->arena.grad.data->flex, self->d, self->numel);
+    ls->evals++;
+    return f;
+}
+
+// minimizer of the cubic through (x1, f1, g1) and (x2, f2, g2), clamped to [lo, hi]
+static double cubic_interpolate(double x1, double f1, double g1, double x2, double f2, double g2, double lo, double hi) {
+    double d1 = g1 + g2 - 3 * (f1 - f2) / (x1 - x2);
+    double d2_square = d1 * d1 - g1 * g2;
+    if(d2_square < 0) return (lo + hi) / 2;
+    double d2 = sqrt(d2_square);
+    double min_pos = x1 <= x2 ? x2 - (x2 - x1) * ((g2 + d2 - d1) / (g2 - g1 + 2 * d2))
+                              : x1 - (x1 - x2) * ((g1 + d2 - d1) / (g1 - g2 + 2 * d2));
+    return fmin(fmax(min_pos, lo), hi);
+}
+
+// Searches along d from x_init for a step satisfying the strong Wolfe conditions. On return flat_grad holds
+// the gradient at the accepted step; the parameters are not moved.
+static double LineSearch__strong_wolfe(LineSearch* ls, double t, double f, double gtd, double* f_out) {
+    optim_lbfgs* self = ls->self;
+    int n = self->numel;
+    const float* arena_grad = self->arena.grad.data->flex;
+    float* g_prev = self->ls_grad[0];
+    float* bracket_g[2] = {self->ls_grad[1], self->ls_grad[2]};
+    double d_norm = abs_max(self->d, n);
+
+    double gtd_new;
+    double f_new = LineSearch__evaluate(ls, t, &gtd_new);
+    double t_prev = 0, f_prev = f, gtd_prev = gtd;
+    memcpy(g_prev, self->flat_grad, sizeof(float) * n);
+
+    double bracket[2], bracket_f[2], bracket_gtd[2];
+    int n_bracket = 0;
+    bool done = false;
+    int ls_iter = 0;
+    while(ls_iter < LBFGS_MAX_LS) {
+        bool overshot = f_new > f + LBFGS_C1 * t * gtd || (ls_iter > 1 && f_new >= f_prev);
+        if(!overshot && fabs(gtd_new) <= -LBFGS_C2 * gtd) {
+            bracket[0] = bracket[1] = t, bracket_f[0] = bracket_f[1] = f_new;
+            memcpy(bracket_g[0], arena_grad, sizeof(float) * n);
+            n_bracket = 1;
+            done = true;
+            break;
+        }
+        if(overshot || gtd_new >= 0) {
+            bracket[0] = t_prev, bracket_f[0] = f_prev, bracket_gtd[0] = gtd_prev;
+            bracket[1] = t, bracket_f[1] = f_new, bracket_gtd[1] = gtd_new;
+            memcpy(bracket_g[0], g_prev, sizeof(float) * n);
+            memcpy(bracket_g[1], arena_grad, sizeof(float) * n);
+            n_bracket = 2;
+            break;
+        }
+        // extrapolate
+        double min_step = t + 0.01 * (t - t_prev);
+        double max_step = t * 10;
+        double t_next = cubic_interpolate(t_prev, f_prev, gtd_prev, t, f_new, gtd_new, min_step, max_step);
+        t_prev = t, f_prev = f_new, gtd_prev = gtd_new;
+        memcpy(g_prev, arena_grad, sizeof(float) * n);
+        t = t_next;
+        f_new = LineSearch__evaluate(ls, t, &gtd_new);
+        ls_iter++;
+    }
+    if(ls_iter == LBFGS_MAX_LS) {
+        // no bracket found: take the better of the start and the last step
+        bracket[0] = 0, bracket_f[0] = f;
+        bracket[1] = t, bracket_f[1] = f_new;
+        memcpy(bracket_g[0], self->flat_grad, sizeof(float) * n);
+        memcpy(bracket_g[1], arena_grad, sizeof(float) * n);
+        n_bracket = 2;
+    }
+
+    // zoom into the bracket
+    bool insuf_progress = false;
+    int low = bracket_f[0] <= bracket_f[n_bracket - 1] ? 0 : 1, high = 1 - low;
+    while(!done && ls_iter < LBFGS_MAX_LS) {
+        double lo = fmin(bracket[0], bracket[1]), hi = fmax(bracket[0], bracket[1]);
+        if((hi - lo) * d_norm < LBFGS_TOLERANCE_CHANGE) break;
+        t = cubic_interpolate(bracket[0], bracket_f[0], bracket_gtd[0], bracket[1], bracket_f[1], bracket_gtd[1], lo, hi);
+        // keep the trial point away from the ends of the bracket
+        double eps = 0.1 * (hi - lo);
+        if(fmin(hi - t, t - lo) < eps) {
+            if(insuf_progress || t >= hi || t <= lo) {
+                t = fabs(t - hi) < fabs(t - lo) ? hi - eps : lo + eps;
+                insuf_progress = false;
+            } else {
+                insuf_progress = true;
+            }
+        } else {
+            insuf_progress = false;
+        }
+
+        f_new = LineSearch__evaluate(ls, t, &gtd_new);
+        ls_iter++;
+        if(f_new > f + LBFGS_C1 * t * gtd || f_new >= bracket_f[low]) {
+            bracket[high] = t, bracket_f[high] = f_new, bracket_gtd[high] = gtd_new;
+            memcpy(bracket_g[high], arena_grad, sizeof(float) * n);
+            low = bracket_f[0] <= bracket_f[1] ? 0 : 1, high = 1 - low;
+        } else {
+            if(fabs(gtd_new) <= -LBFGS_C2 * gtd) {
+                done = true;
+            } else if(gtd_new * (bracket[high] - bracket[low]) >= 0) {
+                bracket[high] = bracket[low], bracket_f[high] = bracket_f[low], bracket_gtd[high] = bracket_gtd[low];
+                float* tmp = bracket_g[high];
+                bracket_g[high] = bracket_g[low];
+                bracket_g[low] = tmp;
+            }
+            bracket[low] = t, bracket_f[low] = f_new, bracket_gtd[low] = gtd_new;
+            memcpy(bracket_g[low], arena_grad, sizeof(float) * n);
+        }
+    }
+
+    memcpy(self->flat_grad, bracket_g[low], sizeof(float) * n);
+    *f_out = bracket_f[low];
+    return bracket[low];
+}
+
+// d = -H * g by the two-loop recursion over the stored (s, y) pairs
+static void optim_lbfgs__direction(optim_lbfgs* self) {
+    int n = self->numel;
+    float* q = self->d;
+    for(int j = 0; j < n; j++) q[j] = -self->flat_grad[j];
+    for(int k = self->n_history - 1; k >= 0; k--) {
+        int row = (self->head + k) % self->history_size;
+        const float* s = self->s + (size_t)row * n;
+        const float* y = self->y + (size_t)row * n;
+        self->al[row] = dot(s, q, n) * self->ro[row];
+        for(int j = 0; j < n; j++) q[j] -= (float)self->al[row] * y[j];
+    }
+    for(int j = 0; j < n; j++) q[j] *= (float)self->h_diag;
+    for(int k = 0; k < self->n_history; k++) {
+        int row = (self->head + k) % self->history_size;
+        const float* s = self->s + (size_t)row * n;
+        const float* y = self->y + (size_t)row * n;
+        double be = dot(y, q, n) * self->ro[row];
+        for(int j = 0; j < n; j++) q[j] += s[j] * (float)(self->al[row] - be);
+    }
+}
+
+// stores s = t * d and y = g - g_prev, dropping the oldest pair when the ring is full
+static void optim_lbfgs__update_history(optim_lbfgs* self) {
+    int n = self->numel;
+    // when the ring is full the new pair goes into the oldest one's row, so it is only written once accepted
+    double ys = 0.0;
+    for(int j = 0; j < n; j++) {
+        ys += (double)(self->flat_grad[j] - self->prev_flat_grad[j]) * (self->d[j] * (float)self->t);
+    }
+    // skip pairs that would break positive definiteness
+    if(ys <= 1e-10) return;
+    int row = (self->head + self->n_history) % self->history_size;
+    float* s = self->s + (size_t)row * n;
+    float* y = self->y + (size_t)row * n;
+    for(int j = 0; j < n; j++) {
+        s[j] = self->d[j] * (float)self->t;
+        y[j] = self->flat_grad[j] - self->prev_flat_grad[j];
+    }
+    if(self->n_history == self->history_size) {
+        self->head = (self->head + 1) % self->history_size;
+    } else {
+        self->n_history++;
+    }
+    self->ro[row] = 1.0 / ys;
+    self->h_diag = ys / dot(y, y, n);
+}
+
+float optim_lbfgs_step(optim_lbfgs* self, cten_closure closure, void* ctx, PoolId scratch) {
+    int n = self->numel;
+    float* p = self->arena.data.data->flex;
+    LineSearch ls = {self, closure, ctx, scratch, 0};
+
+    double loss = optim_lbfgs__evaluate(self, closure, ctx, scratch);
+    int current_evals = 1;
+    memcpy(self->flat_grad, self->arena.grad.data->flex, sizeof(float) * n);
+    if(abs_max(self->flat_grad, n) <= LBFGS_TOLERANCE_GRAD) return (float)loss;
+
+    for(int iter = 1; iter <= self->max_iter; iter++) {
+        self->n_iter++;
+        if(self->n_iter == 1) {
+            self->n_history = 0;
+            self->head = 0;
+            self->h_diag = 1.0;
+        } else {
+            optim_lbfgs__update_history(self);
+        }
+        optim_lbfgs__direction(self);
+        memcpy(self->prev_flat_grad, self->flat_grad, sizeof(float) * n);
+        double prev_loss = loss;
+
+        // the very first step is scaled down to a unit L1 gradient
+        if(self->n_iter == 1) {
+            double g_l1 = 0.0;
+            for(int j = 0; j < n; j++) g_l1 += fabsf(self->flat_grad[j]);
+            self->t = fmin(1.0, 1.0 / g_l1) * self->lr;
+        } else {
+            self->t = self->lr;
+        }
+        double gtd = dot(self->flat_grad, self->d, n);
+        // not a descent direction
+        if(gtd > -LBFGS_TOLERANCE_CHANGE) break;
+
+        memcpy(self->x_init, p, sizeof(float) * n);
+        ls.evals = 0;
+        self->t = LineSearch__strong_wolfe(&ls, self->t, loss, gtd, &loss);
+        for(int j = 0; j < n; j++) {
+            p[j] = self->x_init[j] + (float)self->t * self->d[j];
+        }
+        current_evals += ls.evals;
+
+        if(current_evals >= self->max_eval) break;
+        if(abs_max(self->flat_grad, n) <= LBFGS_TOLERANCE_GRAD) break;
+        if(abs_max(self->d, n) * fabs(self->t) <= LBFGS_TOLERANCE_CHANGE) break;
+        if(fabs(loss - prev_loss) < LBFGS_TOLERANCE_CHANGE) break;
+    }
+    return (float)loss;
+}
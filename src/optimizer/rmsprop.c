@@ -11,12 +11,17 @@ typedef struct optim_rmsprop {
     float β;
     float ε;
     float weight_decay;
-    Tensor* params;
-    Tensor* squared_avg;
-    int n_params;
+    OptimState state;
+    ParamArena arena;
+    Tensor squared_avg;  // fp32
+    FactoredMoment squared_avg_factored;
+    QuantBuffer squared_avg_8bit;
 } optim_rmsprop;
 
-optim_rmsprop* optim_rmsprop_new(int n_params, Tensor* params, float lr, float β, float ε, float weight_decay) {
+static void optim_rmsprop__update(void* self, int i);
+
+optim_rmsprop* optim_rmsprop_new_with_state(int n_params, Tensor* params, float lr, float β, float ε, float weight_decay,
+                                            OptimState state) {
     cten_assert(n_params >= 0, "RMSProp: n_params cannot be negative, but got %d.", n_params);
     if(n_params > 0) {
         cten_assert(params != NULL, "RMSProp: params array cannot be NULL when n_params > 0.");
@@ -27,39 +32,187 @@ optim_rmsprop* optim_rmsprop_new(int n_params, Tensor* params, float lr, float 
                 β);
     cten_assert(ε >= 0.0f, "RMSProp: epsilon must be non-negative, but got %f.", ε);
     cten_assert(weight_decay >= 0.0f, "RMSProp: weight decay must be non-negative, but got %f.", weight_decay);
+    cten_assert(state >= OptimState_fp32 && state <= OptimState_8bit, "RMSProp: unknown state type %d.", (int)state);
 
     optim_rmsprop* self = _cten_malloc(sizeof(optim_rmsprop));
-    self->n_params = n_params;
-    self->params = params;
+    memset(self, 0, sizeof(optim_rmsprop));
+    ParamArena__ctor(&self->arena, n_params, params);
     self->lr = lr;
     self->β = β;
     self->ε = ε;
     self->weight_decay = weight_decay;
 
-    self->squared_avg = _cten_malloc(sizeof(Tensor) * n_params);
-    for(int i = 0; i < n_params; i++) {
-        self->squared_avg[i] = Tensor_zeros(params[i].shape, false);
+    self->state = state;
+
+    switch(state) {
+        case OptimState_fp32: self->squared_avg = ParamArena__zeros(&self->arena); break;
+        case OptimState_factored: FactoredMoment__ctor(&self->squared_avg_factored, &self->arena); break;
+        case OptimState_8bit: QuantBuffer__ctor(&self->squared_avg_8bit, &self->arena, true); break;
     }
+    self->arena.owner = self;
+    self->arena.update = optim_rmsprop__update;
     return self;
 }
 
-void optim_rmsprop_zerograd(optim_rmsprop* self) { _cten_zero_grad(self->params, self->n_params); }
+optim_rmsprop* optim_rmsprop_new(int n_params, Tensor* params, float lr, float β, float ε, float weight_decay) {
+    return optim_rmsprop_new_with_state(n_params, params, lr, β, ε, weight_decay, OptimState_fp32);
+}
+
+size_t optim_rmsprop_state_bytes(const optim_rmsprop* self) {
+    switch(self->state) {
+        case OptimState_fp32: return sizeof(float) * self->arena.offsets[self->arena.n_params];
+        case OptimState_factored: return FactoredMoment__bytes(&self->squared_avg_factored);
+        case OptimState_8bit: return QuantBuffer__bytes(&self->squared_avg_8bit);
+    }
+    return 0;
+}
 
-void optim_rmsprop_step(optim_rmsprop* self) {
-    for(int i = 0; i < self->n_params; i++) {
-        Tensor t = self->params[i];
-        if(t.node == NULL || t.node->grad.data == NULL) continue;
+void optim_rmsprop_zerograd(optim_rmsprop* self) { ParamArena__zero_grad(&self->arena); }
 
-        Tensor grad = t.node->grad;
-        Tensor* sq_avg = &self->squared_avg[i];
+void optim_rmsprop_clip_grad_norm(optim_rmsprop* self, float max_norm) { ParamArena__clip_grad_norm(&self->arena, max_norm); }
+
+void optim_rmsprop_clip_grad_value_range(optim_rmsprop* self, float min_value, float max_value) {
+    ParamArena__clip_grad_value_range(&self->arena, min_value, max_value);
+}
+
+typedef struct RMSPropUpdate {
+    optim_rmsprop* self;
+    float* p;
+    const float* grad;  // the launch's gradient, indexed from begin
+    float* sq;
+    int begin, end;  // range of the flat arena this launch updates
+    int first_block;  // 8-bit: the first block of that range's state
+    float lr, β, ε;
+    float l2;
+    GradClip clip;
+} RMSPropUpdate;
+
+static void RMSPropUpdate__apply(const RMSPropUpdate* u, float* restrict p, const float* restrict grad, float* restrict sq, int n) {
+    for(int j = 0; j < n; j++) {
+        float g = GradClip__apply(&u->clip, grad[j]) + u->l2 * p[j];
+        sq[j] = u->β * sq[j] + (1 - u->β) * g * g;
+        p[j] -= u->lr * g / (sqrtf(sq[j]) + u->ε);
+    }
+}
+
+static void RMSPropUpdate__run(void* arg, int begin, int end) {
+    const RMSPropUpdate* u = arg;
+    RMSPropUpdate__apply(u, u->p + begin, u->grad + begin, u->sq + begin, end - begin);
+}
+
+static void RMSPropUpdate__run_8bit(void* arg, int begin, int end) {
+    const RMSPropUpdate* u = arg;
+    float sq[CTEN_QUANT_BLOCK];
+    for(int b = u->first_block + begin; b < u->first_block + end; b++) {
+        int lo;
+        int n = QuantBuffer__span(&u->self->squared_avg_8bit, &u->self->arena, b, &lo);
+        QuantBuffer__load(&u->self->squared_avg_8bit, b, sq);
+        RMSPropUpdate__apply(u, u->p + lo, u->grad + lo - u->begin, sq, n);
+        QuantBuffer__store(&u->self->squared_avg_8bit, b, sq);
+    }
+}
 
-        for(int j = 0; j < t.data->numel; j++) {
-            float g = grad.data->flex[j];
-            if (self->weight_decay > 0.0f){
-                g+= self->weight_decay * t.data->flex[j];
+static void RMSPropUpdate__run_factored(const RMSPropUpdate* u, int i) {
+    const ParamArena* arena = &u->self->arena;
+    const FactoredMoment* fm = &u->self->squared_avg_factored;
+    int offset = arena->offsets[i];
+    float* p = u->p + offset;
+    const float* grad = u->grad + offset - u->begin;
+    float* sq = fm->data + fm->offsets[i];
+    if(!FactoredMoment__is_factored(arena, i)) {
+        RMSPropUpdate__apply(u, p, grad, sq, arena->params[i].data->numel);
+        return;
+    }
+    int rows = arena->params[i].shape[0];
+    int cols = arena->params[i].shape[1];
+    float* row = sq;
+    float* col = sq + rows;
+    float inv_row_mean = FactoredMoment__update(row, col, p, grad, rows, cols, &u->clip, u->l2, u->β);
+    for(int r = 0; r < rows; r++) {
+        for(int c = 0; c < cols; c++) {
+            int j = r * cols + c;
+            float g = GradClip__apply(&u->clip, grad[j]) + u->l2 * p[j];
+            p[j] -= u->lr * g / (sqrtf(row[r] * col[c] * inv_row_mean) + u->ε);
+        }
+    }
+}
+
+// params[0].i is the parameter to update, or -1 for the whole arena
+static void Kernel_rmsprop_update(const GraphStep* s) {
+    optim_rmsprop* self = s->ctx;
+    const ParamArena* arena = &self->arena;
+    int i = s->params[0].i;
+    RMSPropUpdate u = {
+        .self = self,
+        .p = arena->data.data->flex,
+        .grad = s->inputs[0].data->flex,
+        .sq = self->squared_avg.data != NULL ? self->squared_avg.data->flex : NULL,
+        .begin = i < 0 ? 0 : arena->offsets[i],
+        .end = i < 0 ? arena->offsets[arena->n_params] : arena->offsets[i] + arena->params[i].data->numel,
+        .lr = self->lr,
+        .β = self->β,
+        .ε = self->ε,
+        .l2 = self->weight_decay,
+        .clip = ParamArena__grad_clip(&self->arena),
+    };
+    if(u.begin >= u.end) return;
+    switch(self->state) {
+        case OptimState_fp32: {
+            // the shard offsets are relative to the launch range, like the gradient's
+            u.p += u.begin;
+            u.sq += u.begin;
+            _cten_parallel_for(u.end - u.begin, RMSPropUpdate__run, &u);
+            break;
+        }
+        case OptimState_factored: {
+            for(int k = i < 0 ? 0 : i; k < (i < 0 ? arena->n_params : i + 1); k++) {
+                RMSPropUpdate__run_factored(&u, k);
             }
-            sq_avg->data->flex[j] = self->β * sq_avg->data->flex[j] + (1 - self->β) * g * g;
-            t.data->flex[j] -= self->lr * g / (sqrtf(sq_avg->data->flex[j]) + self->ε);
+            break;
+        }
+        case OptimState_8bit: {
+            const int* offsets = self->squared_avg_8bit.offsets;
+            u.first_block = offsets[i < 0 ? 0 : i] / CTEN_QUANT_BLOCK;
+            int n_blocks = (offsets[i < 0 ? arena->n_params : i + 1] - offsets[i < 0 ? 0 : i]) / CTEN_QUANT_BLOCK;
+            _cten_parallel_for(n_blocks, RMSPropUpdate__run_8bit, &u);
+            break;
         }
     }
-}
\ No newline at end of file
+}
+
+static void optim_rmsprop__update(void* ctx, int i) {
+    optim_rmsprop* self = ctx;
+    ParamArena* arena = &self->arena;
+    Tensor data = ParamArena__slice(arena, arena->data, i);
+    Tensor grad = ParamArena__grad(arena, i);
+    _cten_launch((GraphStep){Kernel_rmsprop_update, data, {grad}, 1, .params = {{.i = i}}, .ctx = self});
+}
+
+void optim_rmsprop_step(optim_rmsprop* self) { optim_rmsprop__update(self, -1); }
+
+void optim_rmsprop_step_in_backward(optim_rmsprop* self, bool enable) { ParamArena__step_in_backward(&self->arena, enable); }
+
+// the entries depend on the state format, so the state is restored only into an optimizer created with the same one
+void optim_rmsprop_save_state(const optim_rmsprop* self, cten_writer* writer, const char* prefix) {
+    char name[CTEN_MAX_NAME];
+    switch(self->state) {
+        case OptimState_fp32:
+            _cten_state_name(name, prefix, "squared_avg");
+            cten_writer_add(writer, name, self->squared_avg);
+            break;
+        case OptimState_factored: FactoredMoment__write(&self->squared_avg_factored, writer, prefix, "squared_avg_factored"); break;
+        case OptimState_8bit: QuantBuffer__write(&self->squared_avg_8bit, writer, prefix, "squared_avg_8bit"); break;
+    }
+}
+
+bool optim_rmsprop_load_state(optim_rmsprop* self, const cten_file* file, const char* prefix) {
+    char name[CTEN_MAX_NAME];
+    switch(self->state) {
+        case OptimState_fp32:
+            _cten_state_name(name, prefix, "squared_avg");
+            return cten_file_read(file, name, self->squared_avg);
+        case OptimState_factored: return FactoredMoment__read(&self->squared_avg_factored, file, prefix, "squared_avg_factored");
+        case OptimState_8bit: return QuantBuffer__read(&self->squared_avg_8bit, file, prefix, "squared_avg_8bit");
+    }
+    return false;
+}
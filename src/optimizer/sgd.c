@@ -9,11 +9,13 @@ typedef struct optim_sgd {
     float lr;
     float momentum;
     float weight_decay;
-    Tensor* velocity;
-    Tensor* params;
-    int n_params;
+    float trust_coefficient;  // LARS: > 0 scales each tensor's step by its trust ratio
+    ParamArena arena;
+    Tensor velocity;
 } optim_sgd;
 
+static void optim_sgd__update(void* self, int i);
+
 optim_sgd* optim_sgd_new(int n_params, Tensor* params, float weight_decay) {
     cten_assert(n_params >= 0, "n_params cannot be negative, but got %d.", n_params);
     if(n_params > 0) {
@@ -21,12 +23,21 @@ optim_sgd* optim_sgd_new(int n_params, Tensor* params, float weight_decay) {
     }
 
     optim_sgd* self = _cten_malloc(sizeof(optim_sgd));
-    self->n_params = n_params;
-    self->params = params;
+    ParamArena__ctor(&self->arena, n_params, params);
     self->lr = 0.001f;
     self->momentum = 0.0f;
-    self->velocity = NULL;
+    self->velocity = (Tensor){0};
     self->weight_decay = weight_decay;
+    self->trust_coefficient = 0.0f;
+    self->arena.owner = self;
+    self->arena.update = optim_sgd__update;
+    return self;
+}
+
+optim_sgd* optim_lars_new(int n_params, Tensor* params, float weight_decay, float trust_coefficient) {
+    cten_assert(trust_coefficient > 0.0f, "LARS: trust coefficient must be positive, but got %f.", trust_coefficient);
+    optim_sgd* self = optim_sgd_new(n_params, params, weight_decay);
+    self->trust_coefficient = trust_coefficient;
     return self;
 }
 
@@ -35,50 +46,152 @@ void optim_sgd_config(optim_sgd* self, float lr, float momentum) {
     self->lr = lr;
     self->momentum = momentum;
 
-    if(self->velocity == NULL && self->momentum > 0.0f) {
-        self->velocity = _cten_malloc(sizeof(Tensor) * self->n_params);
-        for(int i = 0; i < self->n_params; i++) {
-            self->velocity[i] = Tensor_zeros(self->params[i].shape, false);
-        }
+    if(self->velocity.data == NULL && self->momentum > 0.0f) {
+        self->velocity = ParamArena__zeros(&self->arena);
     }
 }
 
-void optim_sgd_zerograd(optim_sgd* self) { _cten_zero_grad(self->params, self->n_params); }
+void optim_sgd_zerograd(optim_sgd* self) { ParamArena__zero_grad(&self->arena); }
 
-void optim_sgd_step(optim_sgd* self) {
-    for(int i = 0; i < self->n_params; i++) {
-        Tensor t = self->params[i];
-        if(t.node == NULL || t.node->grad.data == NULL) { continue; }
+void optim_sgd_clip_grad_norm(optim_sgd* self, float max_norm) { ParamArena__clip_grad_norm(&self->arena, max_norm); }
 
-        float* param_data = t.data->flex;
-        float* grad_data = t.node->grad.data->flex;
+void optim_sgd_clip_grad_value_range(optim_sgd* self, float min_value, float max_value) {
+    ParamArena__clip_grad_value_range(&self->arena, min_value, max_value);
+}
 
-        if(self->momentum > 0.0f) {
-            // v = momentum * v + grad
-            // p = p - lr * v
-            cten_assert(self->velocity != NULL,
-                        "Velocity buffer is NULL. Did you configure momentum?");
-            float* velocity_data = self->velocity[i].data->flex;
-            for(int j = 0; j < t.data->numel; j++) {
-                float grad_val = grad_data[j];
-
-                if(self->weight_decay > 0.0f){
-                    grad_val += self->weight_decay * param_data[j];
-                }
-                velocity_data[j] = self->momentum * velocity_data[j] + grad_val;
-                param_data[j] -= self->lr * velocity_data[j];
+typedef struct SGDUpdate {
+    const optim_sgd* self;
+    float* p;
+    const float* grad;
+    float* velocity;  // NULL without momentum
+    GradClip clip;
+} SGDUpdate;
+
+// each thread updates a contiguous shard [begin, end) of the parameters and their velocity
+static void SGDUpdate__run(void* arg, int begin, int end) {
+    const SGDUpdate* u = arg;
+    const optim_sgd* self = u->self;
+    float* param_data = u->p;
+    const float* grad_data = u->grad;
+
+    if(u->velocity != NULL) {
+        // v = momentum * v + grad
+        // p = p - lr * v
+        float* velocity_data = u->velocity;
+        for(int j = begin; j < end; j++) {
+            float grad_val = GradClip__apply(&u->clip, grad_data[j]);
+
+            if(self->weight_decay > 0.0f){
+                grad_val += self->weight_decay * param_data[j];
             }
+            velocity_data[j] = self->momentum * velocity_data[j] + grad_val;
+            param_data[j] -= self->lr * velocity_data[j];
+        }
 
-        } else {
-            // p = p - lr * grad
-            for(int j = 0; j < t.data->numel; j++) {
-                float grad_val = grad_data[j];
-
-                if(self->weight_decay > 0.0f) {
-                    grad_val += self->weight_decay * param_data[j];
-                }
-                param_data[j] -= self->lr * grad_val;
+    } else {
+        // p = p - lr * grad
+        for(int j = begin; j < end; j++) {
+            float grad_val = GradClip__apply(&u->clip, grad_data[j]);
+
+            if(self->weight_decay > 0.0f) {
+                grad_val += self->weight_decay * param_data[j];
             }
+            param_data[j] -= self->lr * grad_val;
+        }
+    }
+}
+
+static void Kernel_sgd_update(const GraphStep* s) {
+    optim_sgd* self = s->ctx;
+    SGDUpdate u = {
+        .self = self,
+        .p = s->out.data->flex,
+        .grad = s->inputs[0].data->flex,
+        .velocity = s->n_inputs == 2 ? s->inputs[1].data->flex : NULL,  // velocity was bound, i.e. momentum > 0
+        .clip = ParamArena__grad_clip(&self->arena),
+    };
+    _cten_parallel_for(s->out.data->numel, SGDUpdate__run, &u);
+}
+
+// LARS: v = momentum * v + trust * (g + wd * p), p -= lr * v, with one trust ratio per tensor,
+// trust = η * |p| / (|g| + wd * |p|). The norms come from a read-only pass over the tensor, the update from a second one.
+static void LARS__update_tensor(const optim_sgd* self, const GradClip* clip, float* restrict p, const float* restrict grad,
+                                float* restrict velocity, int n) {
+    float p_sq = 0.0f, g_sq = 0.0f;
+    for(int j = 0; j < n; j++) {
+        float g = GradClip__apply(clip, grad[j]);
+        p_sq += p[j] * p[j];
+        g_sq += g * g;
+    }
+    float p_norm = sqrtf(p_sq), g_norm = sqrtf(g_sq);
+    float denom = g_norm + self->weight_decay * p_norm;
+    float trust = p_norm > 0.0f && denom > 0.0f ? self->trust_coefficient * p_norm / denom : 1.0f;
+
+    for(int j = 0; j < n; j++) {
+        float g = trust * (GradClip__apply(clip, grad[j]) + self->weight_decay * p[j]);
+        if(velocity != NULL) {
+            velocity[j] = self->momentum * velocity[j] + g;
+            g = velocity[j];
         }
+        p[j] -= self->lr * g;
+    }
+}
+
+// params[0].i is the parameter to update, or -1 for every parameter
+static void Kernel_lars_update(const GraphStep* s) {
+    optim_sgd* self = s->ctx;
+    const ParamArena* arena = &self->arena;
+    GradClip clip = ParamArena__grad_clip(&self->arena);
+    int i = s->params[0].i;
+    int begin = i < 0 ? 0 : arena->offsets[i];  // inputs[0] is the gradient of the launch, which starts here
+    for(int k = i < 0 ? 0 : i; k < (i < 0 ? arena->n_params : i + 1); k++) {
+        int offset = arena->offsets[k];
+        float* velocity = s->n_inputs == 2 ? self->velocity.data->flex + offset : NULL;
+        LARS__update_tensor(self, &clip, arena->data.data->flex + offset, s->inputs[0].data->flex + offset - begin,
+                            velocity, arena->params[k].data->numel);
     }
-}
\ No newline at end of file
+}
+
+static void optim_sgd__update(void* ctx, int i) {
+    optim_sgd* self = ctx;
+    ParamArena* arena = &self->arena;
+    Tensor data = ParamArena__slice(arena, arena->data, i);
+    Tensor grad = ParamArena__grad(arena, i);
+    if(self->trust_coefficient > 0.0f) {
+        if(self->momentum > 0.0f) {
+            Tensor velocity = ParamArena__slice(arena, self->velocity, i);
+            _cten_launch((GraphStep){Kernel_lars_update, data, {grad, velocity}, 2, .params = {{.i = i}}, .ctx = self});
+        } else {
+            _cten_launch((GraphStep){Kernel_lars_update, data, {grad}, 1, .params = {{.i = i}}, .ctx = self});
+        }
+    } else if(self->momentum > 0.0f) {
+        cten_assert(self->velocity.data != NULL,
+                    "Velocity buffer is NULL. Did you configure momentum?");
+        Tensor velocity = ParamArena__slice(arena, self->velocity, i);
+        _cten_launch((GraphStep){Kernel_sgd_update, data, {grad, velocity}, 2, .ctx = self});
+    } else {
+        _cten_launch((GraphStep){Kernel_sgd_update, data, {grad}, 1, .ctx = self});
+    }
+}
+
+// one pass over the whole arena
+void optim_sgd_step(optim_sgd* self) { optim_sgd__update(self, -1); }
+
+void optim_sgd_step_in_backward(optim_sgd* self, bool enable) { ParamArena__step_in_backward(&self->arena, enable); }
+
+void optim_sgd_save_state(const optim_sgd* self, cten_writer* writer, const char* prefix) {
+    char name[CTEN_MAX_NAME];
+    if(self->velocity.data != NULL) {
+        _cten_state_name(name, prefix, "velocity");
+        cten_writer_add(writer, name, self->velocity);
+    }
+}
+
+// the optimizer must be configured like the saved one: momentum state is restored only into momentum state
+bool optim_sgd_load_state(optim_sgd* self, const cten_file* file, const char* prefix) {
+    char name[CTEN_MAX_NAME];
+    _cten_state_name(name, prefix, "velocity");
+    bool saved = cten_file_get(file, name).data != NULL;
+    if(saved != (self->velocity.data != NULL)) return false;
+    return !saved || cten_file_read(file, name, self->velocity);
+}
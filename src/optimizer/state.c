@@ -0,0 +1,193 @@
+#include "cten.h"
+#include "cten_internal.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// zero state: every code decodes to 0 with a zero scale. Blocks are touched first by the threads that will
+// update them, like the fp32 arena buffers.
+static void QuantBuffer__first_touch(void* arg, int begin, int end) {
+    QuantBuffer* self = arg;
+    memset(self->codes + (size_t)begin * CTEN_QUANT_BLOCK, self->nonnegative ? 0 : 127,
+           (size_t)(end - begin) * CTEN_QUANT_BLOCK);
+    memset(self->scales + begin, 0, sizeof(float) * (end - begin));
+}
+
+void QuantBuffer__ctor(QuantBuffer* self, const ParamArena* arena, bool nonnegative) {
+    self->nonnegative = nonnegative;
+    self->n_params = arena->n_params;
+    self->offsets = _cten_malloc(sizeof(int) * (arena->n_params + 1));
+    int numel = 0;
+    for(int i = 0; i < arena->n_params; i++) {
+        self->offsets[i] = numel;
+        numel += (arena->params[i].data->numel + CTEN_QUANT_BLOCK - 1) / CTEN_QUANT_BLOCK * CTEN_QUANT_BLOCK;
+    }
+    self->offsets[arena->n_params] = numel;
+    self->numel = numel;
+    int n_blocks = QuantBuffer__n_blocks(self);
+    self->codes = _cten_malloc_aligned(numel);
+    self->scales = _cten_malloc_aligned(sizeof(float) * n_blocks);
+    _cten_parallel_for(n_blocks, QuantBuffer__first_touch, self);
+}
+
+int QuantBuffer__n_blocks(const QuantBuffer* self) { return self->numel / CTEN_QUANT_BLOCK; }
+
+int QuantBuffer__span(const QuantBuffer* self, const ParamArena* arena, int block, int* begin) {
+    int q = block * CTEN_QUANT_BLOCK;
+    // the last parameter starting at or before q; an empty parameter starts where the next one does
+    int lo = 0, hi = self->n_params - 1;
+    while(lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if(self->offsets[mid] <= q) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    *begin = arena->offsets[lo] + q - self->offsets[lo];
+    int n = arena->offsets[lo] + arena->params[lo].data->numel - *begin;
+    return n < CTEN_QUANT_BLOCK ? n : CTEN_QUANT_BLOCK;
+}
+
+// the padding decodes to zero and encodes back to zero, so whole blocks are always loaded and stored
+void QuantBuffer__load(const QuantBuffer* self, int block, float* out) {
+    const uint8_t* codes = self->codes + (size_t)block * CTEN_QUANT_BLOCK;
+    float scale = self->scales[block];
+    if(self->nonnegative) {
+        for(int j = 0; j < CTEN_QUANT_BLOCK; j++) {
+            float root = codes[j] * scale;
+            out[j] = root * root;
+        }
+    } else {
+        for(int j = 0; j < CTEN_QUANT_BLOCK; j++) {
+            out[j] = ((int)codes[j] - 127) * scale;
+        }
+    }
+}
+
+void QuantBuffer__store(QuantBuffer* self, int block, const float* in) {
+    uint8_t* codes = self->codes + (size_t)block * CTEN_QUANT_BLOCK;
+    if(self->nonnegative) {
+        float absmax = 0.0f;
+        for(int j = 0; j < CTEN_QUANT_BLOCK; j++) {
+            absmax = fmaxf(absmax, sqrtf(in[j]));
+        }
+        float scale = absmax / 255.0f;
+        float inv = absmax > 0.0f ? 255.0f / absmax : 0.0f;
+        for(int j = 0; j < CTEN_QUANT_BLOCK; j++) {
+            codes[j] = (uint8_t)fminf(lrintf(sqrtf(in[j]) * inv), 255.0f);
+        }
+        self->scales[block] = scale;
+    } else {
+        float absmax = 0.0f;
+        for(int j = 0; j < CTEN_QUANT_BLOCK; j++) {
+            absmax = fmaxf(absmax, fabsf(in[j]));
+        }
+        float scale = absmax / 127.0f;
+        float inv = absmax > 0.0f ? 127.0f / absmax : 0.0f;
+        for(int j = 0; j < CTEN_QUANT_BLOCK; j++) {
+            float code = fmaxf(fminf(lrintf(in[j] * inv), 127.0f), -127.0f);
+            codes[j] = (uint8_t)(code + 127.0f);
+        }
+        self->scales[block] = scale;
+    }
+}
+
+size_t QuantBuffer__bytes(const QuantBuffer* self) {
+    return (size_t)self->numel + sizeof(float) * QuantBuffer__n_blocks(self);
+}
+
+// a bias row {1, n} or a vector gains nothing from factoring
+bool FactoredMoment__is_factored(const ParamArena* arena, int i) {
+    const int* shape = arena->params[i].shape;
+    return TensorShape_dim((int*)shape) == 2 && shape[0] > 1 && shape[1] > 1;
+}
+
+void FactoredMoment__ctor(FactoredMoment* self, const ParamArena* arena) {
+    self->offsets = _cten_malloc(sizeof(int) * (arena->n_params + 1));
+    int numel = 0;
+    for(int i = 0; i < arena->n_params; i++) {
+        self->offsets[i] = numel;
+        const int* shape = arena->params[i].shape;
+        numel += FactoredMoment__is_factored(arena, i) ? shape[0] + shape[1] : arena->params[i].data->numel;
+    }
+    self->offsets[arena->n_params] = numel;
+    self->numel = numel;
+    self->data = _cten_malloc_aligned(sizeof(float) * (numel > 0 ? numel : 1));
+    memset(self->data, 0, sizeof(float) * numel);
+}
+
+float FactoredMoment__update(float* row, float* col, const float* p, const float* grad, int rows, int cols,
+                             const GradClip* clip, float l2, float β) {
+    // Adafactor's ε1 keeps the averages, and so the rebuilt moment, from reaching zero
+    const float eps = 1e-30f;
+    for(int c = 0; c < cols; c++) {
+        col[c] *= β;
+    }
+    float row_sum = 0.0f;
+    for(int r = 0; r < rows; r++) {
+        float sum = 0.0f;
+        for(int c = 0; c < cols; c++) {
+            int j = r * cols + c;
+            float g = GradClip__apply(clip, grad[j]) + l2 * p[j];
+            float g2 = g * g + eps;
+            sum += g2;
+            col[c] += (1 - β) * g2 / rows;
+        }
+        row[r] = β * row[r] + (1 - β) * sum / cols;
+        row_sum += row[r];
+    }
+    return row_sum > 0.0f ? rows / row_sum : 0.0f;
+}
+
+size_t FactoredMoment__bytes(const FactoredMoment* self) { return sizeof(float) * self->numel; }
+
+void QuantBuffer__write(const QuantBuffer* self, cten_writer* writer, const char* prefix, const char* field) {
+    char name[CTEN_MAX_NAME], buf[CTEN_MAX_NAME];
+    snprintf(buf, sizeof(buf), "%s.codes", field);
+    _cten_state_name(name, prefix, buf);
+    cten_writer_add_bytes(writer, name, self->codes, (size_t)self->numel);
+    snprintf(buf, sizeof(buf), "%s.scales", field);
+    _cten_state_name(name, prefix, buf);
+    _cten_writer_add_floats(writer, name, self->scales, QuantBuffer__n_blocks(self));
+}
+
+bool QuantBuffer__check(const QuantBuffer* self, const cten_file* file, const char* prefix, const char* field) {
+    char name[CTEN_MAX_NAME], buf[CTEN_MAX_NAME];
+    snprintf(buf, sizeof(buf), "%s.codes", field);
+    _cten_state_name(name, prefix, buf);
+    if(!_cten_file_has_bytes(file, name, (size_t)self->numel)) return false;
+    snprintf(buf, sizeof(buf), "%s.scales", field);
+    _cten_state_name(name, prefix, buf);
+    return _cten_file_has_floats(file, name, QuantBuffer__n_blocks(self));
+}
+
+// codes and scales are checked together first, so a bad file never leaves codes paired with stale scales
+bool QuantBuffer__read(QuantBuffer* self, const cten_file* file, const char* prefix, const char* field) {
+    if(!QuantBuffer__check(self, file, prefix, field)) return false;
+    char name[CTEN_MAX_NAME], buf[CTEN_MAX_NAME];
+    snprintf(buf, sizeof(buf), "%s.codes", field);
+    _cten_state_name(name, prefix, buf);
+    _cten_file_read_bytes(file, name, self->codes, (size_t)self->numel);
+    snprintf(buf, sizeof(buf), "%s.scales", field);
+    _cten_state_name(name, prefix, buf);
+    return _cten_file_read_floats(file, name, self->scales, QuantBuffer__n_blocks(self));
+}
+
+void FactoredMoment__write(const FactoredMoment* self, cten_writer* writer, const char* prefix, const char* field) {
+    char name[CTEN_MAX_NAME];
+    _cten_state_name(name, prefix, field);
+    _cten_writer_add_floats(writer, name, self->data, self->numel);
+}
+
+bool FactoredMoment__check(const FactoredMoment* self, const cten_file* file, const char* prefix, const char* field) {
+    char name[CTEN_MAX_NAME];
+    _cten_state_name(name, prefix, field);
+    return _cten_file_has_floats(file, name, self->numel);
+}
+
+bool FactoredMoment__read(FactoredMoment* self, const cten_file* file, const char* prefix, const char* field) {
+    char name[CTEN_MAX_NAME];
+    _cten_state_name(name, prefix, field);
+    return _cten_file_read_floats(file, name, self->data, self->numel);
+}
@@ -0,0 +1,152 @@
+#include "cten.h"
+#include "cten_internal.h"
+#include "common/threads.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Process-wide worker pool for data-parallel kernels. The calling thread always runs the first chunk,
+// so with one thread (the default) nothing is spawned and _cten_parallel_for is a plain call.
+typedef struct ThreadPool {
+    bool initialized;
+    c11_mtx_t submit;  // one job at a time when several contexts share the pool
+    c11_mtx_t lock;
+    c11_cnd_t wake;
+    c11_cnd_t done;
+    c11_thrd_t* workers;
+    int n_threads;
+    uint64_t generation;
+    int pending;
+    bool stop;
+    // current job
+    cten_parallel_fn fn;
+    void* arg;
+    int n;
+    int chunk;
+} ThreadPool;
+
+typedef struct ThreadPoolWorker {
+    ThreadPool* pool;
+    int index;
+    uint64_t seen;  // the last generation run; jobs submitted before the worker started are not its own
+} ThreadPoolWorker;
+
+static ThreadPool g_pool = {.n_threads = 1};
+
+static void ThreadPool__run_chunk(ThreadPool* self, int index) {
+    int begin = index * self->chunk;
+    int end = begin + self->chunk < self->n ? begin + self->chunk : self->n;
+    if(begin < end) self->fn(self->arg, begin, end);
+}
+
+static void ThreadPool__worker(void* p) {
+    ThreadPoolWorker* worker = p;
+    ThreadPool* self = worker->pool;
+    uint64_t seen = worker->seen;
+    while(true) {
+        c11_mtx__lock(&self->lock);
+        while(!self->stop && self->generation == seen) {
+            c11_cnd__wait(&self->wake, &self->lock);
+        }
+        if(self->stop) {
+            c11_mtx__unlock(&self->lock);
+            break;
+        }
+        seen = self->generation;
+        c11_mtx__unlock(&self->lock);
+
+        ThreadPool__run_chunk(self, worker->index);
+
+        c11_mtx__lock(&self->lock);
+        if(--self->pending == 0) c11_cnd__signal(&self->done);
+        c11_mtx__unlock(&self->lock);
+    }
+    free(worker);
+}
+
+static void ThreadPool__shutdown(ThreadPool* self) {
+    if(self->workers == NULL) return;
+    c11_mtx__lock(&self->lock);
+    self->stop = true;
+    c11_cnd__broadcast(&self->wake);
+    c11_mtx__unlock(&self->lock);
+    for(int i = 0; i < self->n_threads - 1; i++) {
+        c11_thrd__join(self->workers[i]);
+    }
+    free(self->workers);
+    self->workers = NULL;
+    self->stop = false;
+}
+
+void cten_set_num_threads(int n) {
+    ThreadPool* self = &g_pool;
+    if(n <= 0) n = c11_thrd__hardware_concurrency();
+    if(!self->initialized) {
+        c11_mtx__ctor(&self->submit);
+        c11_mtx__ctor(&self->lock);
+        c11_cnd__ctor(&self->wake);
+        c11_cnd__ctor(&self->done);
+        self->initialized = true;
+    }
+    c11_mtx__lock(&self->submit);
+    ThreadPool__shutdown(self);
+    self->n_threads = n;
+    if(n > 1) {
+        self->workers = malloc(sizeof(c11_thrd_t) * (n - 1));
+        assert(self->workers != NULL);
+        for(int i = 0; i < n - 1; i++) {
+            ThreadPoolWorker* worker = malloc(sizeof(ThreadPoolWorker));
+            assert(worker != NULL);
+            worker->pool = self;
+            worker->index = i + 1;
+            worker->seen = self->generation;
+            bool ok = c11_thrd__create(&self->workers[i], ThreadPool__worker, worker);
+            cten_assert(ok, "cten_set_num_threads: failed to start worker thread %d", i);
+        }
+    }
+    c11_mtx__unlock(&self->submit);
+}
+
+int cten_get_num_threads() { return g_pool.n_threads; }
+
+void _cten_parallel_for(int n, cten_parallel_fn fn, void* arg) {
+    ThreadPool* self = &g_pool;
+    // a pool resized meanwhile only changes whether this job could have been split
+    if(self->n_threads == 1) {
+        if(n > 0) fn(arg, 0, n);
+        return;
+    }
+
+    // the chunk size and the number of workers must come from the same pool, so both are read under submit,
+    // which cten_set_num_threads holds while it resizes
+    c11_mtx__lock(&self->submit);
+    // chunks are whole multiples of CTEN_ALIGN so no two threads write the same cache line of a flat arena
+    const int align = (int)(CTEN_ALIGN / sizeof(float));
+    int chunk = (n + self->n_threads - 1) / self->n_threads;
+    chunk = (chunk + align - 1) / align * align;
+    if(self->n_threads == 1 || chunk >= n) {
+        c11_mtx__unlock(&self->submit);
+        if(n > 0) fn(arg, 0, n);
+        return;
+    }
+
+    c11_mtx__lock(&self->lock);
+    self->fn = fn;
+    self->arg = arg;
+    self->n = n;
+    self->chunk = chunk;
+    self->pending = self->n_threads - 1;
+    self->generation++;
+    c11_cnd__broadcast(&self->wake);
+    c11_mtx__unlock(&self->lock);
+
+    ThreadPool__run_chunk(self, 0);
+
+    c11_mtx__lock(&self->lock);
+    while(self->pending > 0) {
+        c11_cnd__wait(&self->done, &self->lock);
+    }
+    c11_mtx__unlock(&self->lock);
+    c11_mtx__unlock(&self->submit);
+}
@@ -1,53 +1,40 @@
 #include "cten.h"
+#include "cten_internal.h"
 
 #include "common/vector.h"
 #include <stddef.h>
 
-typedef struct {
-    c11_vector /*PoolId*/ stack;
-    c11_vector /*void_p*/ pointers;
-    c11_vector /*void_p*/ pointers_swap_buffer;
-} PoolAllocator;
+// the header in front of every block; index is the block's slot in allocator.pointers, kept current so a
+// single block can be freed without a search
+typedef struct PoolHeader {
+    PoolId id;
+    int64_t index;
+} PoolHeader;
 
-static PoolAllocator g_allocator;
-
-void cten_initilize() {
-    c11_vector__ctor(&g_allocator.stack, sizeof(PoolId));
-    c11_vector__ctor(&g_allocator.pointers, sizeof(void*));
-    c11_vector__ctor(&g_allocator.pointers_swap_buffer, sizeof(void*));
-}
-
-void cten_finalize() {
-    for(int i = 0; i < g_allocator.pointers.length; i++) {
-        void* p = c11__getitem(void*, &g_allocator.pointers, i);
-        free(p);
-    }
-    assert(g_allocator.pointers_swap_buffer.length == 0);
-    c11_vector__dtor(&g_allocator.stack);
-    c11_vector__dtor(&g_allocator.pointers);
-    c11_vector__dtor(&g_allocator.pointers_swap_buffer);
-}
+_Static_assert(sizeof(PoolHeader) == CTEN_POOL_HEADER_SIZE, "PoolHeader must fill the block header");
 
 void cten_begin_malloc(PoolId id) {
-    c11_vector* self = &g_allocator.stack;
+    c11_vector* self = &_cten_context()->allocator.stack;
     c11_vector__push(PoolId, self, id);
 }
 
 void cten_end_malloc() {
-    c11_vector* self = &g_allocator.stack;
+    c11_vector* self = &_cten_context()->allocator.stack;
     assert(self->length > 0);
     c11_vector__pop(self);
 }
 
 void cten_free(PoolId id) {
-    c11_vector* pointers = &g_allocator.pointers;
-    c11_vector* swap_buffer = &g_allocator.pointers_swap_buffer;
+    PoolAllocator* allocator = &_cten_context()->allocator;
+    c11_vector* pointers = &allocator->pointers;
+    c11_vector* swap_buffer = &allocator->pointers_swap_buffer;
     for(int i = 0; i < pointers->length; i++) {
-        void* p = c11__getitem(void*, pointers, i);
-        if(((PoolId*)p)[0] == id) {
+        PoolHeader* p = c11__getitem(PoolHeader*, pointers, i);
+        if(p->id == id) {
             free(p);
         } else {
-            c11_vector__push(void*, swap_buffer, p);
+            p->index = swap_buffer->length;
+            c11_vector__push(PoolHeader*, swap_buffer, p);
         }
     }
     c11_vector__swap(pointers, swap_buffer);
@@ -55,12 +42,34 @@ void cten_free(PoolId id) {
 }
 
 void* _cten_malloc(size_t size) {
-    assert(g_allocator.stack.length > 0);
-    PoolId id = c11_vector__back(PoolId, &g_allocator.stack);
-    c11_vector* pointers = &g_allocator.pointers;
-    void* p = malloc(sizeof(PoolId) + size);
+    PoolAllocator* allocator = &_cten_context()->allocator;
+    assert(allocator->stack.length > 0);
+    PoolId id = c11_vector__back(PoolId, &allocator->stack);
+    c11_vector* pointers = &allocator->pointers;
+    PoolHeader* p = malloc(CTEN_POOL_HEADER_SIZE + size);
     assert(p != NULL);
-    ((PoolId*)p)[0] = id;
-    c11_vector__push(void*, pointers, p);
-    return (PoolId*)p + 1;
+    p->id = id;
+    p->index = pointers->length;
+    c11_vector__push(PoolHeader*, pointers, p);
+    return (char*)p + CTEN_POOL_HEADER_SIZE;
 }
+
+// the last block takes over the freed slot, so this is O(1) however many blocks the pools hold
+void _cten_free_block(void* p) {
+    c11_vector* pointers = &_cten_context()->allocator.pointers;
+    PoolHeader* header = (PoolHeader*)((char*)p - CTEN_POOL_HEADER_SIZE);
+    assert(header->id != CTEN_POOL_VIEW);
+    assert(header->index < pointers->length && c11__getitem(PoolHeader*, pointers, header->index) == header);
+    PoolHeader* last = c11_vector__back(PoolHeader*, pointers);
+    last->index = header->index;
+    c11__setitem(PoolHeader*, pointers, header->index, last);
+    c11_vector__pop(pointers);
+    free(header);
+}
+
+void* _cten_malloc_aligned(size_t size) {
+    char* p = _cten_malloc(size + CTEN_ALIGN);
+    return p + (CTEN_ALIGN - (uintptr_t)p % CTEN_ALIGN) % CTEN_ALIGN;
+}
+
+PoolId _cten_pool_of(const void* p) { return *(const PoolId*)((const char*)p - CTEN_POOL_HEADER_SIZE); }
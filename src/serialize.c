@@ -0,0 +1,482 @@
+#include "cten.h"
+#include "cten_internal.h"
+#include "common/mmap.h"
+#include "common/threads.h"
+#include "common/vector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// File layout (little-endian):
+//   CtenFileHeader
+//   payloads, each starting at a multiple of CTEN_ALIGN from the start of the file
+//   CtenFileEntry[n_entries], at header.table_offset
+// The payloads are raw tensor data, so a mapped file can be used in place. The table comes last so a writer
+// can stream each payload straight from its buffer and only has to remember the small entries.
+// A file is written under "<path>.tmp" and renamed over <path> once complete, so <path> always holds either the
+// previous file or the new one.
+
+#define CTEN_FILE_MAGIC "CTENSOR"
+// version 1 had the table right after the header; version 2 moved it to the end
+#define CTEN_FILE_VERSION 2
+
+typedef struct CtenFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_entries;
+    uint64_t table_offset;
+} CtenFileHeader;
+
+typedef struct cten_writer {
+    FILE* fp;  // NULL for a snapshot, which builds the file image in memory instead
+    char* path;
+    char* tmp_path;
+    uint64_t pos;
+    bool ok;
+    c11_vector /*CtenFileEntry*/ entries;
+    // snapshot only
+    char* image;
+    size_t capacity;
+} cten_writer;
+
+typedef struct cten_file {
+    c11_mmap map;
+    int n_entries;
+    const CtenFileEntry* entries;
+    Tensor* tensors;  // data is NULL for entries that are not float32
+} cten_file;
+
+static uint64_t cten_file__align(uint64_t offset) { return (offset + CTEN_ALIGN - 1) / CTEN_ALIGN * CTEN_ALIGN; }
+
+static void cten_writer__write(cten_writer* self, const void* data, size_t nbytes) {
+    if(self->fp == NULL) {
+        if(self->pos + nbytes > self->capacity) {
+            // grows geometrically and is kept, so later snapshots of the same model do not allocate
+            size_t capacity = self->capacity > 0 ? self->capacity : 4096;
+            while(capacity < self->pos + nbytes) capacity *= 2;
+            self->image = realloc(self->image, capacity);
+            cten_assert(self->image != NULL, "cten_checkpoint: cannot allocate a %zu-byte snapshot.", capacity);
+            self->capacity = capacity;
+        }
+        memcpy(self->image + self->pos, data, nbytes);
+    } else if(self->ok && nbytes > 0) {
+        self->ok = fwrite(data, 1, nbytes, self->fp) == nbytes;
+    }
+    self->pos += nbytes;
+}
+
+static void cten_writer__pad(cten_writer* self) {
+    static const char zeros[CTEN_ALIGN] = {0};
+    cten_writer__write(self, zeros, (size_t)(cten_file__align(self->pos) - self->pos));
+}
+
+static char* cten_file__strcat(const char* a, const char* b) {
+    size_t n = strlen(a), m = strlen(b);
+    char* s = malloc(n + m + 1);
+    cten_assert(s != NULL, "cten_writer: out of memory.");
+    memcpy(s, a, n);
+    memcpy(s + n, b, m + 1);
+    return s;
+}
+
+static void cten_writer__begin(cten_writer* self) {
+    self->pos = 0;
+    self->ok = true;
+    c11_vector__clear(&self->entries);
+    // patched with the entry count and table offset on close
+    CtenFileHeader header = {CTEN_FILE_MAGIC, CTEN_FILE_VERSION, 0, 0};
+    cten_writer__write(self, &header, sizeof(header));
+}
+
+// appends the entry table and returns the finished header
+static CtenFileHeader cten_writer__end(cten_writer* self) {
+    cten_writer__pad(self);
+    CtenFileHeader header = {CTEN_FILE_MAGIC, CTEN_FILE_VERSION, (uint32_t)self->entries.length, self->pos};
+    cten_writer__write(self, self->entries.data, sizeof(CtenFileEntry) * (size_t)self->entries.length);
+    return header;
+}
+
+FILE* _cten_file_create(const char* path, char** tmp_path) {
+    *tmp_path = cten_file__strcat(path, ".tmp");
+    FILE* fp = fopen(*tmp_path, "wb");
+    if(fp == NULL) {
+        free(*tmp_path);
+        *tmp_path = NULL;
+    }
+    return fp;
+}
+
+// flushes fp to the disk, closes it and moves tmp_path over path; tmp_path is removed if anything failed
+bool _cten_file_commit(FILE* fp, const char* tmp_path, const char* path, bool ok) {
+    ok = ok && fflush(fp) == 0;
+#if defined(_WIN32)
+    ok = ok && _commit(_fileno(fp)) == 0;
+#else
+    ok = ok && fsync(fileno(fp)) == 0;
+#endif
+    ok = fclose(fp) == 0 && ok;
+#if defined(_WIN32)
+    ok = ok && MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    ok = ok && rename(tmp_path, path) == 0;
+#endif
+    if(!ok) remove(tmp_path);
+    return ok;
+}
+
+cten_writer* cten_writer_open(const char* path) {
+    char* tmp_path;
+    FILE* fp = _cten_file_create(path, &tmp_path);
+    if(fp == NULL) return NULL;
+    // outside the pools, like the file it writes: saving needs no active pool
+    cten_writer* self = malloc(sizeof(cten_writer));
+    cten_assert(self != NULL, "cten_writer_open: out of memory.");
+    memset(self, 0, sizeof(cten_writer));
+    self->fp = fp;
+    self->path = cten_file__strcat(path, "");
+    self->tmp_path = tmp_path;
+    c11_vector__ctor(&self->entries, sizeof(CtenFileEntry));
+    cten_writer__begin(self);
+    return self;
+}
+
+static void cten_writer__add(cten_writer* self, const char* name, uint32_t dtype, const int* shape, const void* data,
+                             size_t nbytes) {
+    cten_assert(strlen(name) < CTEN_MAX_NAME, "cten_writer: name '%s' is longer than %d characters.", name, CTEN_MAX_NAME - 1);
+    cten_writer__pad(self);
+    CtenFileEntry entry = {0};
+    strcpy(entry.name, name);
+    entry.dtype = dtype;
+    entry.ndim = TensorShape_dim((int*)shape);
+    for(int d = 0; d < 4; d++) entry.shape[d] = shape[d];
+    entry.offset = self->pos;
+    entry.nbytes = nbytes;
+    c11_vector__push(CtenFileEntry, &self->entries, entry);
+    cten_writer__write(self, data, nbytes);
+}
+
+void cten_writer_add(cten_writer* self, const char* name, Tensor t) {
+    cten_writer__add(self, name, CTEN_DTYPE_FLOAT32, t.shape, t.data->flex, sizeof(float) * (size_t)t.data->numel);
+}
+
+void cten_writer_add_bytes(cten_writer* self, const char* name, const void* data, size_t nbytes) {
+    cten_assert(nbytes > 0 && nbytes <= INT_MAX, "cten_writer_add_bytes: '%s' must hold 1 to INT_MAX bytes.", name);
+    TensorShape shape = {(int)nbytes};
+    cten_writer__add(self, name, CTEN_DTYPE_UINT8, shape, data, nbytes);
+}
+
+void _cten_writer_add_floats(cten_writer* self, const char* name, const float* data, int numel) {
+    FloatBuffer buffer = {numel, (float*)data};
+    Tensor t = {{numel}, &buffer, NULL};
+    cten_writer_add(self, name, t);
+}
+
+bool cten_writer_close(cten_writer* self) {
+    cten_assert(self->fp != NULL, "cten_writer_close: a checkpoint snapshot is finished by cten_checkpoint_commit.");
+    CtenFileHeader header = cten_writer__end(self);
+    if(self->ok) self->ok = fseek(self->fp, 0, SEEK_SET) == 0;
+    if(self->ok) self->ok = fwrite(&header, sizeof(header), 1, self->fp) == 1;
+    bool ok = _cten_file_commit(self->fp, self->tmp_path, self->path, self->ok);
+    c11_vector__dtor(&self->entries);
+    free(self->path);
+    free(self->tmp_path);
+    free(self);
+    return ok;
+}
+
+bool cten_save(const char* path, int n_tensors, const char* const* names, const Tensor* tensors) {
+    cten_assert(n_tensors >= 0, "cten_save: n_tensors cannot be negative, but got %d.", n_tensors);
+    cten_writer* writer = cten_writer_open(path);
+    if(writer == NULL) return false;
+    for(int i = 0; i < n_tensors; i++) {
+        cten_writer_add(writer, names[i], tensors[i]);
+    }
+    return cten_writer_close(writer);
+}
+
+// Asynchronous checkpoints. Each slot holds a writer that copies the entries into an in-memory file image; a
+// background thread writes committed images in order. With two slots the next snapshot can be taken while the
+// previous one is still on its way to the disk, and only a third one has to wait.
+#define CTEN_CHECKPOINT_SLOTS 2
+
+typedef struct CheckpointSlot {
+    cten_writer writer;
+    bool pending;  // committed and not yet written
+} CheckpointSlot;
+
+typedef struct cten_checkpoint {
+    c11_thrd_t thread;
+    c11_mtx_t lock;
+    c11_cnd_t cond;  // signals both new commits and finished writes
+    CheckpointSlot slots[CTEN_CHECKPOINT_SLOTS];
+    int fill;        // the slot the next snapshot goes into
+    int next_write;  // the oldest committed slot
+    int n_pending;
+    bool open;    // between begin and commit
+    bool failed;  // some write since the last wait failed
+    bool stop;
+} cten_checkpoint;
+
+static bool CheckpointSlot__write(CheckpointSlot* self) {
+    cten_writer* w = &self->writer;
+    FILE* fp = fopen(w->tmp_path, "wb");
+    if(fp == NULL) return false;
+    bool ok = fwrite(w->image, 1, (size_t)w->pos, fp) == (size_t)w->pos;
+    return _cten_file_commit(fp, w->tmp_path, w->path, ok);
+}
+
+static void cten_checkpoint__worker(void* arg) {
+    cten_checkpoint* self = arg;
+    c11_mtx__lock(&self->lock);
+    while(true) {
+        while(!self->stop && self->n_pending == 0) {
+            c11_cnd__wait(&self->cond, &self->lock);
+        }
+        if(self->n_pending == 0) break;
+        CheckpointSlot* slot = &self->slots[self->next_write];
+        c11_mtx__unlock(&self->lock);
+
+        bool ok = CheckpointSlot__write(slot);
+
+        c11_mtx__lock(&self->lock);
+        if(!ok) self->failed = true;
+        slot->pending = false;
+        self->next_write = (self->next_write + 1) % CTEN_CHECKPOINT_SLOTS;
+        self->n_pending--;
+        c11_cnd__broadcast(&self->cond);
+    }
+    c11_mtx__unlock(&self->lock);
+}
+
+cten_checkpoint* cten_checkpoint_new() {
+    cten_checkpoint* self = malloc(sizeof(cten_checkpoint));
+    cten_assert(self != NULL, "cten_checkpoint_new: out of memory.");
+    memset(self, 0, sizeof(cten_checkpoint));
+    for(int i = 0; i < CTEN_CHECKPOINT_SLOTS; i++) {
+        c11_vector__ctor(&self->slots[i].writer.entries, sizeof(CtenFileEntry));
+    }
+    c11_mtx__ctor(&self->lock);
+    c11_cnd__ctor(&self->cond);
+    bool ok = c11_thrd__create(&self->thread, cten_checkpoint__worker, self);
+    cten_assert(ok, "cten_checkpoint_new: cannot start the writer thread.");
+    return self;
+}
+
+cten_writer* cten_checkpoint_begin(cten_checkpoint* self, const char* path) {
+    cten_assert(!self->open, "cten_checkpoint_begin: the previous snapshot has not been committed.");
+    CheckpointSlot* slot = &self->slots[self->fill];
+    c11_mtx__lock(&self->lock);
+    while(slot->pending) {
+        c11_cnd__wait(&self->cond, &self->lock);
+    }
+    c11_mtx__unlock(&self->lock);
+
+    cten_writer* w = &slot->writer;
+    free(w->path);
+    free(w->tmp_path);
+    w->path = cten_file__strcat(path, "");
+    w->tmp_path = cten_file__strcat(path, ".tmp");
+    cten_writer__begin(w);
+    self->open = true;
+    return w;
+}
+
+void cten_checkpoint_commit(cten_checkpoint* self) {
+    cten_assert(self->open, "cten_checkpoint_commit: no snapshot was begun.");
+    CheckpointSlot* slot = &self->slots[self->fill];
+    CtenFileHeader header = cten_writer__end(&slot->writer);
+    memcpy(slot->writer.image, &header, sizeof(header));
+    self->open = false;
+    self->fill = (self->fill + 1) % CTEN_CHECKPOINT_SLOTS;
+
+    c11_mtx__lock(&self->lock);
+    slot->pending = true;
+    self->n_pending++;
+    c11_cnd__broadcast(&self->cond);
+    c11_mtx__unlock(&self->lock);
+}
+
+bool cten_checkpoint_done(cten_checkpoint* self) {
+    c11_mtx__lock(&self->lock);
+    bool done = self->n_pending == 0;
+    c11_mtx__unlock(&self->lock);
+    return done;
+}
+
+bool cten_checkpoint_wait(cten_checkpoint* self) {
+    c11_mtx__lock(&self->lock);
+    while(self->n_pending > 0) {
+        c11_cnd__wait(&self->cond, &self->lock);
+    }
+    bool ok = !self->failed;
+    self->failed = false;
+    c11_mtx__unlock(&self->lock);
+    return ok;
+}
+
+bool cten_checkpoint_free(cten_checkpoint* self) {
+    cten_assert(!self->open, "cten_checkpoint_free: the current snapshot has not been committed.");
+    bool ok = cten_checkpoint_wait(self);
+    c11_mtx__lock(&self->lock);
+    self->stop = true;
+    c11_cnd__broadcast(&self->cond);
+    c11_mtx__unlock(&self->lock);
+    c11_thrd__join(self->thread);
+    for(int i = 0; i < CTEN_CHECKPOINT_SLOTS; i++) {
+        cten_writer* w = &self->slots[i].writer;
+        c11_vector__dtor(&w->entries);
+        free(w->path);
+        free(w->tmp_path);
+        free(w->image);
+    }
+    c11_cnd__dtor(&self->cond);
+    c11_mtx__dtor(&self->lock);
+    free(self);
+    return ok;
+}
+
+// checks everything load relies on, so a truncated or foreign file is rejected instead of read out of bounds
+static bool cten_file__validate(const c11_mmap* map) {
+    if(map->size < sizeof(CtenFileHeader)) return false;
+    const CtenFileHeader* header = map->data;
+    if(memcmp(header->magic, CTEN_FILE_MAGIC, sizeof(header->magic)) != 0) return false;
+    if(header->version != CTEN_FILE_VERSION) return false;
+    uint64_t table_bytes = sizeof(CtenFileEntry) * (uint64_t)header->n_entries;
+    if(header->table_offset % CTEN_ALIGN != 0 || header->table_offset < sizeof(CtenFileHeader)) return false;
+    if(header->table_offset > map->size || table_bytes > map->size - header->table_offset) return false;
+    const CtenFileEntry* entries = (const CtenFileEntry*)((const char*)map->data + header->table_offset);
+    for(uint32_t i = 0; i < header->n_entries; i++) {
+        const CtenFileEntry* e = &entries[i];
+        if(memchr(e->name, 0, CTEN_MAX_NAME) == NULL) return false;
+        if((e->dtype != CTEN_DTYPE_FLOAT32 && e->dtype != CTEN_DTYPE_UINT8) || e->ndim > 4) return false;
+        uint64_t numel = 1;
+        for(uint32_t d = 0; d < e->ndim; d++) {
+            if(e->shape[d] <= 0) return false;
+            numel *= (uint64_t)e->shape[d];
+        }
+        uint64_t elem_size = e->dtype == CTEN_DTYPE_FLOAT32 ? sizeof(float) : 1;
+        if(numel > INT_MAX || e->nbytes != elem_size * numel) return false;
+        if(e->offset % CTEN_ALIGN != 0 || e->offset < sizeof(CtenFileHeader)) return false;
+        if(e->nbytes > header->table_offset || e->offset > header->table_offset - e->nbytes) return false;
+    }
+    return true;
+}
+
+cten_file* _cten_file_wrap(c11_mmap map, int n_entries, const CtenFileEntry* entries) {
+    cten_file* self = _cten_malloc(sizeof(cten_file));
+    self->map = map;
+    self->n_entries = n_entries;
+    self->entries = entries;
+    self->tensors = _cten_malloc(sizeof(Tensor) * (n_entries > 0 ? n_entries : 1));
+    for(int i = 0; i < n_entries; i++) {
+        const CtenFileEntry* e = &entries[i];
+        Tensor t = {0};
+        if(e->dtype == CTEN_DTYPE_FLOAT32) {
+            for(uint32_t d = 0; d < e->ndim; d++) t.shape[d] = e->shape[d];
+            t.data = _cten_malloc(sizeof(FloatBuffer));
+            t.data->numel = (int)(e->nbytes / sizeof(float));
+            const char* payload = (const char*)map.data + e->offset;
+            if(e->offset % sizeof(float) == 0) {
+                // the payload stays in the mapping; the pages are read-only, so writing through it faults
+                t.data->flex = (float*)payload;
+            } else {
+                // only foreign files (e.g. .npz members) can misalign a payload; those are copied
+                t.data->flex = _cten_malloc_aligned(e->nbytes);
+                memcpy(t.data->flex, payload, e->nbytes);
+            }
+        }
+        self->tensors[i] = t;
+    }
+    return self;
+}
+
+cten_file* cten_load(const char* path) {
+    c11_mmap map;
+    if(!c11_mmap__open(&map, path)) return NULL;
+    if(!cten_file__validate(&map)) {
+        c11_mmap__close(&map);
+        return NULL;
+    }
+    const CtenFileHeader* header = map.data;
+    const CtenFileEntry* entries = (const CtenFileEntry*)((const char*)map.data + header->table_offset);
+    return _cten_file_wrap(map, (int)header->n_entries, entries);
+}
+
+int cten_file_num_tensors(const cten_file* self) { return self->n_entries; }
+
+const char* cten_file_name(const cten_file* self, int i) {
+    cten_assert(i >= 0 && i < self->n_entries, "cten_file_name: index %d out of range [0, %d).", i, self->n_entries);
+    return self->entries[i].name;
+}
+
+Tensor cten_file_tensor(const cten_file* self, int i) {
+    cten_assert(i >= 0 && i < self->n_entries, "cten_file_tensor: index %d out of range [0, %d).", i, self->n_entries);
+    return self->tensors[i];
+}
+
+static int cten_file__find(const cten_file* self, const char* name) {
+    for(int i = 0; i < self->n_entries; i++) {
+        if(strcmp(self->entries[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+Tensor cten_file_get(const cten_file* self, const char* name) {
+    int i = cten_file__find(self, name);
+    return i < 0 ? (Tensor){0} : self->tensors[i];
+}
+
+const void* cten_file_bytes(const cten_file* self, const char* name, size_t* nbytes) {
+    int i = cten_file__find(self, name);
+    if(i < 0 || self->entries[i].dtype != CTEN_DTYPE_UINT8) return NULL;
+    if(nbytes != NULL) *nbytes = (size_t)self->entries[i].nbytes;
+    return (const char*)self->map.data + self->entries[i].offset;
+}
+
+bool _cten_file_matches(const cten_file* self, const char* name, Tensor dst) {
+    Tensor src = cten_file_get(self, name);
+    return src.data != NULL && memcmp(src.shape, dst.shape, sizeof(TensorShape)) == 0;
+}
+
+bool _cten_file_has_floats(const cten_file* self, const char* name, int numel) {
+    Tensor src = cten_file_get(self, name);
+    return src.data != NULL && src.data->numel == numel;
+}
+
+bool _cten_file_has_bytes(const cten_file* self, const char* name, size_t nbytes) {
+    size_t n;
+    return cten_file_bytes(self, name, &n) != NULL && n == nbytes;
+}
+
+bool cten_file_read(const cten_file* self, const char* name, Tensor dst) {
+    if(!_cten_file_matches(self, name, dst)) return false;
+    memcpy(dst.data->flex, cten_file_get(self, name).data->flex, sizeof(float) * (size_t)dst.data->numel);
+    return true;
+}
+
+bool _cten_file_read_floats(const cten_file* self, const char* name, float* dst, int numel) {
+    if(!_cten_file_has_floats(self, name, numel)) return false;
+    memcpy(dst, cten_file_get(self, name).data->flex, sizeof(float) * (size_t)numel);
+    return true;
+}
+
+bool _cten_file_read_bytes(const cten_file* self, const char* name, void* dst, size_t nbytes) {
+    if(!_cten_file_has_bytes(self, name, nbytes)) return false;
+    memcpy(dst, cten_file_bytes(self, name, NULL), nbytes);
+    return true;
+}
+
+void cten_file_close(cten_file* self) { c11_mmap__close(&self->map); }
+
+void _cten_state_name(char* buf, const char* prefix, const char* field) {
+    int n = snprintf(buf, CTEN_MAX_NAME, "%s.%s", prefix, field);
+    cten_assert(n < CTEN_MAX_NAME, "state name '%s.%s' is longer than %d characters.", prefix, field, CTEN_MAX_NAME - 1);
+}
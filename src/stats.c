@@ -0,0 +1,142 @@
+#include "cten.h"
+#include "cten_internal.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per-feature mean and variance in one streaming pass. Rows are split into at most CTEN_STATS_BLOCKS blocks
+// that the worker pool reduces with Welford's update; the block partials are then merged in block order
+// with Chan's formula. The block size depends only on the row count, so the result is the same whatever
+// the number of threads.
+#define CTEN_STATS_BLOCKS 256
+#define CTEN_STATS_MIN_BLOCK 256
+
+typedef struct WelfordJob {
+    const float* X;
+    const int* rows;  // NULL for the first n_rows rows
+    int n_rows;
+    int n_features;
+    int block_rows;
+    double* partials;  // per block: mean[n_features], then m2[n_features]
+} WelfordJob;
+
+static void Welford__blocks(void* arg, int begin, int end) {
+    WelfordJob* job = arg;
+    int n_features = job->n_features;
+    for(int b = begin; b < end; b++) {
+        double* mean = job->partials + (size_t)b * 2 * n_features;
+        double* m2 = mean + n_features;
+        memset(mean, 0, sizeof(double) * 2 * n_features);
+        int first = b * job->block_rows;
+        int last = first + job->block_rows < job->n_rows ? first + job->block_rows : job->n_rows;
+        for(int i = first; i < last; i++) {
+            const float* x = job->X + (size_t)(job->rows != NULL ? job->rows[i] : i) * n_features;
+            double inv_count = 1.0 / (i - first + 1);
+            for(int j = 0; j < n_features; j++) {
+                double delta = x[j] - mean[j];
+                mean[j] += delta * inv_count;
+                m2[j] += delta * (x[j] - mean[j]);
+            }
+        }
+    }
+}
+
+// Chan et al.: the moments of the union of two disjoint sets of rows
+static void Welford__merge(int64_t* count, double* mean, double* m2, int64_t count_b, const double* mean_b,
+                           const double* m2_b, int n_features) {
+    if(count_b == 0) return;
+    int64_t n = *count + count_b;
+    double weight_b = (double)count_b / n;
+    double weight_ab = (double)*count * weight_b;
+    for(int j = 0; j < n_features; j++) {
+        double delta = mean_b[j] - mean[j];
+        mean[j] += delta * weight_b;
+        m2[j] += m2_b[j] + delta * delta * weight_ab;
+    }
+    *count = n;
+}
+
+void _cten_welford_update(int64_t* count, double* mean, double* m2, int n_features, const float* X, const int* rows,
+                          int n_rows) {
+    if(n_rows <= 0) return;
+    int block_rows = (n_rows + CTEN_STATS_BLOCKS - 1) / CTEN_STATS_BLOCKS;
+    if(block_rows < CTEN_STATS_MIN_BLOCK) block_rows = CTEN_STATS_MIN_BLOCK;
+    int n_blocks = (n_rows + block_rows - 1) / block_rows;
+    WelfordJob job = {X, rows, n_rows, n_features, block_rows, malloc(sizeof(double) * 2 * n_features * n_blocks)};
+    cten_assert(job.partials != NULL, "cten_feature_stats: out of memory for %d features.", n_features);
+    _cten_parallel_for(n_blocks, Welford__blocks, &job);
+    for(int b = 0; b < n_blocks; b++) {
+        const double* mean_b = job.partials + (size_t)b * 2 * n_features;
+        int first = b * block_rows;
+        int count_b = first + block_rows < n_rows ? block_rows : n_rows - first;
+        Welford__merge(count, mean, m2, count_b, mean_b, mean_b + n_features, n_features);
+    }
+    free(job.partials);
+}
+
+void _cten_normalize_transform(int64_t count, const double* mean, const double* m2, int n_features, float* shift,
+                               float* scale) {
+    for(int j = 0; j < n_features; j++) {
+        double std = count > 0 ? sqrt(m2[j] / count) : 0.0;
+        shift[j] = (float)mean[j];
+        // a constant feature is only centered
+        scale[j] = std > 0 ? (float)(1.0 / std) : 1.0f;
+    }
+}
+
+cten_feature_stats* cten_feature_stats_new(int n_features) {
+    cten_assert(n_features > 0, "cten_feature_stats_new: expected features, but got %d.", n_features);
+    cten_feature_stats* self = _cten_malloc(sizeof(cten_feature_stats));
+    self->n_features = n_features;
+    self->count = 0;
+    self->mean = _cten_malloc(sizeof(double) * 2 * n_features);
+    self->m2 = self->mean + n_features;
+    memset(self->mean, 0, sizeof(double) * 2 * n_features);
+    return self;
+}
+
+void cten_feature_stats_update(cten_feature_stats* self, const float* X, const int* rows, int n_rows) {
+    cten_assert(n_rows >= 0, "cten_feature_stats_update: negative row count %d.", n_rows);
+    _cten_welford_update(&self->count, self->mean, self->m2, self->n_features, X, rows, n_rows);
+}
+
+void cten_feature_stats_merge(cten_feature_stats* self, const cten_feature_stats* other) {
+    cten_assert_dim("cten_feature_stats_merge: features", self->n_features, other->n_features);
+    Welford__merge(&self->count, self->mean, self->m2, other->count, other->mean, other->m2, self->n_features);
+}
+
+int64_t cten_feature_stats_count(const cten_feature_stats* self) { return self->count; }
+
+void cten_feature_stats_moments(const cten_feature_stats* self, double* mean, double* variance) {
+    for(int j = 0; j < self->n_features; j++) {
+        if(mean != NULL) mean[j] = self->mean[j];
+        if(variance != NULL) variance[j] = self->count > 0 ? self->m2[j] / self->count : 0.0;
+    }
+}
+
+void cten_feature_stats_transform(const cten_feature_stats* self, float* shift, float* scale) {
+    _cten_normalize_transform(self->count, self->mean, self->m2, self->n_features, shift, scale);
+}
+
+// x' = (x - shift) * scale feeding x' W + b is the same as x (scale W) + (b - (shift * scale) W)
+void cten_feature_stats_fold(const cten_feature_stats* self, Tensor weight, Tensor bias) {
+    int n_features = self->n_features;
+    cten_assert(TensorShape_dim(weight.shape) == 2 && weight.shape[0] == n_features,
+                "cten_feature_stats_fold: weight must be {%d, out}.", n_features);
+    int n_out = weight.shape[1];
+    cten_assert_dim("cten_feature_stats_fold: bias", bias.data->numel, n_out);
+    float* shift = malloc(sizeof(float) * 2 * n_features);
+    float* scale = shift + n_features;
+    cten_feature_stats_transform(self, shift, scale);
+    float* w = weight.data->flex;
+    for(int k = 0; k < n_out; k++) {
+        double offset = 0.0;
+        for(int j = 0; j < n_features; j++) offset += (double)shift[j] * scale[j] * w[j * n_out + k];
+        bias.data->flex[k] -= (float)offset;
+    }
+    for(int j = 0; j < n_features; j++) {
+        for(int k = 0; k < n_out; k++) w[j * n_out + k] *= scale[j];
+    }
+    free(shift);
+}
@@ -1,4 +1,5 @@
 #include "cten.h"
+#include "cten_internal.h"
 
 #include <assert.h>
 #include <stdarg.h>
@@ -6,7 +7,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <time.h>
 #include <limits.h>
 
 bool va_arg_is_present(va_list args) {
@@ -20,12 +20,18 @@ Tensor GradFn_max_all(Tensor self, int i);
 Tensor GradFn_min_all(Tensor self, int i);
 Tensor GradFn_reduce_dim(Tensor self, int i);
 
-Tensor Tensor_mean_all(Tensor self) {
+static void Kernel_sum_all(const GraphStep* s) {
+    Tensor self = s->inputs[0];
     float total = 0.0f;
     for(int i = 0; i < self.data->numel; i++)
         total += self.data->flex[i];
-    Tensor res = Tensor_new((TensorShape){1, 0, 0, 0}, self.node != NULL);
-    res.data->flex[0] = total / self.data->numel;
+    s->out.data->flex[0] = s->params[0].i ? total / self.data->numel : total;
+}
+
+Tensor Tensor_mean_all(Tensor self) {
+    bool requires_grad = !cten_is_eval() && (self.node != NULL);
+    Tensor res = Tensor_new((TensorShape){1, 0, 0, 0}, requires_grad);
+    _cten_launch((GraphStep){Kernel_sum_all, res, {self}, 1, .params = {{.i = true}}});
     if(res.node != NULL) {
         res.node->grad_fn = GradFn_mean;
         res.node->inputs[0] = self;
@@ -47,11 +53,9 @@ Tensor Tensor_mean_dim(Tensor self, int dim) {
 }
 
 Tensor Tensor_sum_all(Tensor self) {
-    float total = 0.0f;
-    for(int i = 0; i < self.data->numel; i++)
-        total += self.data->flex[i];
-    Tensor res = Tensor_new((TensorShape){1, 0, 0, 0}, self.node != NULL);
-    res.data->flex[0] = total;
+    bool requires_grad = !cten_is_eval() && (self.node != NULL);
+    Tensor res = Tensor_new((TensorShape){1, 0, 0, 0}, requires_grad);
+    _cten_launch((GraphStep){Kernel_sum_all, res, {self}, 1, .params = {{.i = false}}});
     if(res.node != NULL) {
         res.node->grad_fn = GradFn_sum;
         res.node->inputs[0] = self;
@@ -72,16 +76,21 @@ Tensor Tensor_sum_dim(Tensor self, int dim) {
     return res;
 }
 
+static void Kernel_max_all(const GraphStep* s) {
+    Tensor self = s->inputs[0];
+    float max_val = self.data->flex[0];
+    for(int i = 1; i < self.data->numel; i++) {
+        if(self.data->flex[i] > max_val) { max_val = self.data->flex[i]; }
+    }
+    s->out.data->flex[0] = max_val;
+}
+
 Tensor Tensor_max_all(Tensor self) {
     bool requires_grad = !cten_is_eval() && (self.node != NULL);
     Tensor res = Tensor_new((TensorShape){1, 0, 0, 0}, requires_grad);
 
     if(self.data->numel == 0) cten_assert(false, "max on empty tensor");
-    float max_val = self.data->flex[0];
-    for(int i = 1; i < self.data->numel; i++) {
-        if(self.data->flex[i] > max_val) { max_val = self.data->flex[i]; }
-    }
-    res.data->flex[0] = max_val;
+    _cten_launch((GraphStep){Kernel_max_all, res, {self}, 1});
 
     if(requires_grad) {
         res.node->grad_fn = GradFn_max_all;
@@ -92,19 +101,14 @@ Tensor Tensor_max_all(Tensor self) {
     return res;
 }
 
-TensorMaxMinResult Tensor_max_dim(Tensor self, int dim) {
+static void Kernel_max_dim(const GraphStep* s) {
+    Tensor self = s->inputs[0];
+    Tensor values = s->out;
+    Tensor indices = s->out_aux;
     int ndim = TensorShape_dim(self.shape);
-    dim = TensorShape_asdim(self.shape, dim);
-
-    TensorShape out_shape = {0};
-    int out_shape_len = 0;
-    for(int i = 0; i < ndim; i++) {
-        if(i != dim) out_shape[out_shape_len++] = self.shape[i];
-    }
-
-    bool requires_grad = !cten_is_eval() && (self.node != NULL);
-    Tensor values = Tensor_new(out_shape, requires_grad);
-    Tensor indices = Tensor_new(out_shape, false);
+    int dim = s->params[0].i;
+    const int* out_shape = values.shape;
+    int out_shape_len = ndim - 1;
 
     int dim_size = self.shape[dim];
     for(int i = 0; i < values.data->numel; ++i) {
@@ -134,6 +138,23 @@ TensorMaxMinResult Tensor_max_dim(Tensor self, int dim) {
         values.data->flex[i] = best_val;
         indices.data->flex[i] = (float)best_idx;
     }
+}
+
+TensorMaxMinResult Tensor_max_dim(Tensor self, int dim) {
+    int ndim = TensorShape_dim(self.shape);
+    dim = TensorShape_asdim(self.shape, dim);
+
+    TensorShape out_shape = {0};
+    int out_shape_len = 0;
+    for(int i = 0; i < ndim; i++) {
+        if(i != dim) out_shape[out_shape_len++] = self.shape[i];
+    }
+
+    bool requires_grad = !cten_is_eval() && (self.node != NULL);
+    Tensor values = Tensor_new(out_shape, requires_grad);
+    Tensor indices = Tensor_new(out_shape, false);
+
+    _cten_launch((GraphStep){Kernel_max_dim, values, {self}, 1, .params = {{.i = dim}}, .out_aux = indices});
 
     if(requires_grad) {
         values.node->grad_fn = GradFn_reduce_dim;
@@ -147,16 +168,21 @@ TensorMaxMinResult Tensor_max_dim(Tensor self, int dim) {
     return result;
 }
 
+static void Kernel_min_all(const GraphStep* s) {
+    Tensor self = s->inputs[0];
+    float min_val = self.data->flex[0];
+    for(int i = 1; i < self.data->numel; i++) {
+        if(self.data->flex[i] < min_val) { min_val = self.data->flex[i]; }
+    }
+    s->out.data->flex[0] = min_val;
+}
+
 Tensor Tensor_min_all(Tensor self) {
     bool requires_grad = !cten_is_eval() && (self.node != NULL);
     Tensor res = Tensor_new((TensorShape){1, 0, 0, 0}, requires_grad);
 
     if(self.data->numel == 0) cten_assert(false, "min on empty tensor");
-    float min_val = self.data->flex[0];
-    for(int i = 1; i < self.data->numel; i++) {
-        if(self.data->flex[i] < min_val) { min_val = self.data->flex[i]; }
-    }
-    res.data->flex[0] = min_val;
+    _cten_launch((GraphStep){Kernel_min_all, res, {self}, 1});
 
     if(requires_grad) {
         res.node->grad_fn = GradFn_min_all;
@@ -167,19 +193,14 @@ Tensor Tensor_min_all(Tensor self) {
     return res;
 }
 
-TensorMaxMinResult Tensor_min_dim(Tensor self, int dim) {
+static void Kernel_min_dim(const GraphStep* s) {
+    Tensor self = s->inputs[0];
+    Tensor values = s->out;
+    Tensor indices = s->out_aux;
     int ndim = TensorShape_dim(self.shape);
-    dim = TensorShape_asdim(self.shape, dim);
-
-    TensorShape out_shape = {0};
-    int out_shape_len = 0;
-    for(int i = 0; i < ndim; i++) {
-        if(i != dim) out_shape[out_shape_len++] = self.shape[i];
-    }
-
-    bool requires_grad = !cten_is_eval() && (self.node != NULL);
-    Tensor values = Tensor_new(out_shape, requires_grad);
-    Tensor indices = Tensor_new(out_shape, false);
+    int dim = s->params[0].i;
+    const int* out_shape = values.shape;
+    int out_shape_len = ndim - 1;
 
     int dim_size = self.shape[dim];
     for(int i = 0; i < values.data->numel; ++i) {
@@ -209,6 +230,23 @@ TensorMaxMinResult Tensor_min_dim(Tensor self, int dim) {
         values.data->flex[i] = best_val;
         indices.data->flex[i] = (float)best_idx;
     }
+}
+
+TensorMaxMinResult Tensor_min_dim(Tensor self, int dim) {
+    int ndim = TensorShape_dim(self.shape);
+    dim = TensorShape_asdim(self.shape, dim);
+
+    TensorShape out_shape = {0};
+    int out_shape_len = 0;
+    for(int i = 0; i < ndim; i++) {
+        if(i != dim) out_shape[out_shape_len++] = self.shape[i];
+    }
+
+    bool requires_grad = !cten_is_eval() && (self.node != NULL);
+    Tensor values = Tensor_new(out_shape, requires_grad);
+    Tensor indices = Tensor_new(out_shape, false);
+
+    _cten_launch((GraphStep){Kernel_min_dim, values, {self}, 1, .params = {{.i = dim}}, .out_aux = indices});
 
     if(requires_grad) {
         values.node->grad_fn = GradFn_reduce_dim;
@@ -246,6 +284,35 @@ void cten_assert_dim(const char* title, int a, int b) {
     cten_assert(a == b, "%s: %d != %d", title, a, b);
 }
 
+// expands inputs[0] to the shape of `out`, numpy-style (dims aligned from the right)
+static void Kernel_broadcast(const GraphStep* s) {
+    Tensor orig = s->inputs[0];
+    Tensor res = s->out;
+    int max_ndims = TensorShape_dim(res.shape);
+    int orig_ndims = TensorShape_dim(orig.shape);
+    for(int i = 0; i < res.data->numel; i++) {
+        int rem = i;
+        int idx[4] = {0};
+        for(int d = max_ndims - 1; d >= 0; d--) {
+            idx[d] = rem % res.shape[d];
+            rem /= res.shape[d];
+        }
+
+        int source_idx = 0;
+        int stride = 1;
+        // iterating backwards over the original tensor's dimensions
+        for(int d = orig_ndims - 1; d >= 0; d--) {
+            int original_dim_size = orig.shape[d];
+            int result_dim_coord = idx[max_ndims - orig_ndims + d];
+            // if original dimension was 1, it's broadcast; its index is 0.
+            int dim_idx = (original_dim_size == 1) ? 0 : result_dim_coord;
+            source_idx += dim_idx * stride;
+            stride *= original_dim_size;
+        }
+        res.data->flex[i] = orig.data->flex[source_idx];
+    }
+}
+
 bool cten_elemwise_broadcast(Tensor* a, Tensor* b) {
     Tensor orig_a = *a;
     Tensor orig_b = *b;
@@ -274,53 +341,15 @@ bool cten_elemwise_broadcast(Tensor* a, Tensor* b) {
 
     // 2. Check if tensor 'a' needs to be expanded
     if(memcmp(orig_a.shape, result_shape, sizeof(TensorShape)) != 0) {
-        Tensor new_a = Tensor_new(result_shape, orig_a.node != NULL);
-        for(int i = 0; i < new_a.data->numel; i++) {
-            int rem = i;
-            int idx[4] = {0};
-            for(int d = max_ndims - 1; d >= 0; d--) {
-                idx[d] = rem % result_shape[d];
-                rem /= result_shape[d];
-            }
-
-            int source_idx = 0;
-            int stride = 1;
-            // iterating backwards over the original tensor's dimensions
-            for(int d = a_ndims - 1; d >= 0; d--) {
-                int original_dim_size = orig_a.shape[d];
-                int result_dim_coord = idx[max_ndims - a_ndims + d];
-                // if original dimension was 1, it's broadcast; its index is 0.
-                int dim_idx = (original_dim_size == 1) ? 0 : result_dim_coord;
-                source_idx += dim_idx * stride;
-                stride *= original_dim_size;
-            }
-            new_a.data->flex[i] = orig_a.data->flex[source_idx];
-        }
+        Tensor new_a = Tensor_new(result_shape, false);
+        _cten_launch((GraphStep){Kernel_broadcast, new_a, {orig_a}, 1});
         *a = new_a;
     }
 
     // 3. Check if tensor 'b' needs to be expanded
     if(memcmp(orig_b.shape, result_shape, sizeof(TensorShape)) != 0) {
-        Tensor new_b = Tensor_new(result_shape, orig_b.node != NULL);
-        for(int i = 0; i < new_b.data->numel; i++) {
-            int rem = i;
-            int idx[4] = {0};
-            for(int d = max_ndims - 1; d >= 0; d--) {
-                idx[d] = rem % result_shape[d];
-                rem /= result_shape[d];
-            }
-
-            int source_idx = 0;
-            int stride = 1;
-            for(int d = b_ndims - 1; d >= 0; d--) {
-                int original_dim_size = orig_b.shape[d];
-                int result_dim_coord = idx[max_ndims - b_ndims + d];
-                int dim_idx = (original_dim_size == 1) ? 0 : result_dim_coord;
-                source_idx += dim_idx * stride;
-                stride *= original_dim_size;
-            }
-            new_b.data->flex[i] = orig_b.data->flex[source_idx];
-        }
+        Tensor new_b = Tensor_new(result_shape, false);
+        _cten_launch((GraphStep){Kernel_broadcast, new_b, {orig_b}, 1});
         *b = new_b;
     }
     return true;
@@ -345,16 +374,7 @@ Tensor reduce_gradient_for_broadcasting(Tensor grad,
                                      result.shape[3]};
             new_shape[dim] = 1;
             result = Tensor_new(new_shape, false);
-
-            if(summed.data->numel == 1) {
-                for(int i = 0; i < result.data->numel; i++) {
-                    result.data->flex[i] = summed.data->flex[0];
-                }
-            } else {
-                for(int i = 0; i < result.data->numel && i < summed.data->numel; i++) {
-                    result.data->flex[i] = summed.data->flex[i];
-                }
-            }
+            _cten_launch((GraphStep){Kernel_copy, result, {summed}, 1});
         }
         // Case 2: dim was added (original was 0, broadcasted > 0)
         else if(orig_size == 0 && broad_size > 0 && grad_size == broad_size) {
@@ -369,9 +389,7 @@ Tensor reduce_gradient_for_broadcasting(Tensor grad,
             }
             new_shape[3] = 0;  // clearing last dim
             result = Tensor_new(new_shape, false);
-            for(int i = 0; i < result.data->numel && i < summed.data->numel; i++) {
-                result.data->flex[i] = summed.data->flex[i];
-            }
+            _cten_launch((GraphStep){Kernel_copy, result, {summed}, 1});
         }
         // Case 3: no broadcasting on this dim
         else if(orig_size == broad_size && grad_size == broad_size) {
@@ -384,43 +402,43 @@ Tensor reduce_gradient_for_broadcasting(Tensor grad,
     return result;
 }
 
-void Tensor_normalize_dataset(const float (*X)[4],
-                              float (*X_norm)[4],
+void Tensor_normalize_dataset(const float* X,
+                              float* X_norm,
                               int n_samples,
                               int n_train_samples,
                               int n_features) {
-    float mean[4] = {0}, std[4] = {0};
+    double* mean = calloc(2 * n_features, sizeof(double));
+    double* m2 = mean + n_features;
+    float* shift = malloc(sizeof(float) * 2 * n_features);
+    float* scale = shift + n_features;
+    int64_t count = 0;
+    _cten_welford_update(&count, mean, m2, n_features, X, NULL, n_train_samples);
+    _cten_normalize_transform(count, mean, m2, n_features, shift, scale);
 
-    for(int i = 0; i < n_train_samples; i++) {
-        for(int j = 0; j < n_features; j++) {
-            mean[j] += X[i][j];
-        }
-    }
-    for(int j = 0; j < n_features; j++) {
-        mean[j] /= n_train_samples;
-    }
-
-    for(int i = 0; i < n_train_samples; i++) {
+    for(int i = 0; i < n_samples; i++) {
         for(int j = 0; j < n_features; j++) {
-            std[j] += (X[i][j] - mean[j]) * (X[i][j] - mean[j]);
+            X_norm[i * n_features + j] = (X[i * n_features + j] - shift[j]) * scale[j];
         }
     }
-    for(int j = 0; j < n_features; j++) {
-        std[j] = sqrtf(std[j] / n_train_samples);
-        // Avoid division by zero
-        if(std[j] == 0) std[j] = 1.0f;
-    }
+    free(shift);
+    free(mean);
+}
 
-    for(int i = 0; i < n_samples; i++) {
-        for(int j = 0; j < n_features; j++) {
-            X_norm[i][j] = (X[i][j] - mean[j]) / std[j];
-        }
+// Fisher-Yates; j is drawn by multiply-shift instead of a modulo
+void _cten_shuffle(int* indices, int n, uint64_t* rng_state) {
+    for(int i = n - 1; i > 0; i--) {
+        int j = (int)(((_cten_xorshift64(rng_state) >> 32) * (uint64_t)(i + 1)) >> 32);
+        int tmp = indices[i];
+        indices[i] = indices[j];
+        indices[j] = tmp;
     }
 }
 
-void Tensor_shuffle_dataset(const float (*X)[4],
+void Tensor_shuffle_indices(int* indices, int n) { _cten_shuffle(indices, n, &_cten_context()->rng_state); }
+
+void Tensor_shuffle_dataset(const float* X,
                             const int* y,
-                            float (*X_shuffled)[4],
+                            float* X_shuffled,
                             int* y_shuffled,
                             int n_samples,
                             int n_features) {
@@ -428,20 +446,12 @@ void Tensor_shuffle_dataset(const float (*X)[4],
     for(int i = 0; i < n_samples; i++) {
         indices[i] = i;
     }
-
-    // Fisher-Yates shuffle
-    srand((unsigned)time(NULL));
-    for(int i = n_samples - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        int tmp = indices[i];
-        indices[i] = indices[j];
-        indices[j] = tmp;
-    }
+    Tensor_shuffle_indices(indices, n_samples);
 
     for(int i = 0; i < n_samples; i++) {
         int idx = indices[i];
         for(int j = 0; j < n_features; j++) {
-            X_shuffled[i][j] = X[idx][j];
+            X_shuffled[i * n_features + j] = X[idx * n_features + j];
         }
         y_shuffled[i] = y[idx];
     }
@@ -449,29 +459,15 @@ void Tensor_shuffle_dataset(const float (*X)[4],
     free(indices);
 }
 
-Tensor Tensor_reduce_dim(Tensor self, int dim, const char* operation) {
+static void Kernel_reduce_dim(const GraphStep* s) {
+    Tensor self = s->inputs[0];
+    Tensor res = s->out;
     int ndim = TensorShape_dim(self.shape);
-    if(dim < 0) {
-        if(dim < -ndim) {
-            printf("dim %d out of range", dim);
-            exit(-1);
-        }
-        dim += ndim;
-    }
-    if(dim >= ndim) {
-        printf("dim %d out of range", dim);
-        exit(-1);
-    }
-
-    TensorShape out_shape = {0, 0, 0, 0};
-    int out_idx = 0;
-    for(int i = 0; i < ndim; i++) {
-        if(i != dim) { out_shape[out_idx++] = self.shape[i]; }
-    }
-
+    int dim = s->params[0].i;
+    bool is_mean = s->params[1].i;
+    const int* out_shape = res.shape;
+    int out_idx = ndim - 1;
     int dim_size = self.shape[dim];
-    Tensor res = Tensor_zeros(out_shape, self.node != NULL);
-
     int total_out_elements = res.data->numel;
 
     for(int out_i = 0; out_i < total_out_elements; out_i++) {
@@ -482,6 +478,7 @@ Tensor Tensor_reduce_dim(Tensor self, int dim, const char* operation) {
             remaining /= out_shape[j];
         }
 
+        res.data->flex[out_i] = 0.0f;
         for(int d = 0; d < dim_size; d++) {
             int in_indices[4] = {0};
             int out_pos = 0;
@@ -503,9 +500,34 @@ Tensor Tensor_reduce_dim(Tensor self, int dim, const char* operation) {
             res.data->flex[out_i] += self.data->flex[in_linear];
         }
 
-        if(strcmp(operation, "mean") == 0) { res.data->flex[out_i] /= dim_size; }
+        if(is_mean) { res.data->flex[out_i] /= dim_size; }
+    }
+}
+
+Tensor Tensor_reduce_dim(Tensor self, int dim, const char* operation) {
+    int ndim = TensorShape_dim(self.shape);
+    if(dim < 0) {
+        if(dim < -ndim) {
+            printf("dim %d out of range", dim);
+            exit(-1);
+        }
+        dim += ndim;
+    }
+    if(dim >= ndim) {
+        printf("dim %d out of range", dim);
+        exit(-1);
     }
 
+    TensorShape out_shape = {0, 0, 0, 0};
+    int out_idx = 0;
+    for(int i = 0; i < ndim; i++) {
+        if(i != dim) { out_shape[out_idx++] = self.shape[i]; }
+    }
+
+    bool requires_grad = !cten_is_eval() && (self.node != NULL);
+    Tensor res = Tensor_new(out_shape, requires_grad);
+    bool is_mean = strcmp(operation, "mean") == 0;
+    _cten_launch((GraphStep){Kernel_reduce_dim, res, {self}, 1, .params = {{.i = dim}, {.i = is_mean}}});
     return res;
 }
 
@@ -530,28 +552,67 @@ Tensor Tensor_unsqueeze(Tensor self, int dim) {
     return res;
 }
 
+static void Kernel_sumsq_accumulate(const GraphStep* s) {
+    float total_norm = s->out.data->flex[0];
+    const float* g = s->inputs[0].data->flex;
+    for(int j = 0; j < s->inputs[0].data->numel; j++) {
+        total_norm += g[j] * g[j];
+    }
+    s->out.data->flex[0] = total_norm;
+}
+
+static void Kernel_clip_norm(const GraphStep* s) {
+    float max_norm = s->params[0].f;
+    float total_norm = sqrtf(s->inputs[1].data->flex[0]);
+    if(total_norm > max_norm) {
+        float scale = max_norm / total_norm;
+        float* g = s->out.data->flex;
+        for(int j = 0; j < s->out.data->numel; j++) {
+            g[j] *= scale;
+        }
+    }
+}
+
+static void Kernel_clip_range(const GraphStep* s) {
+    float min_value = s->params[0].f;
+    float max_value = s->params[1].f;
+    float* g = s->out.data->flex;
+    for(int j = 0; j < s->out.data->numel; j++) {
+        if(g[j] > max_value) {
+            g[j] = max_value;
+        } else if(g[j] < min_value) {
+            g[j] = min_value;
+        }
+    }
+}
+
+// clipping rewrites the gradients in place, one kernel per tensor, so a captured training step
+// replays it; the global norm goes through a one-element buffer shared by both passes
 void cten_clip_grad_norm(Tensor* params, int n_params, float max_norm) {
     if(max_norm <= 0.0f) { return; }
     if(n_params <= 0 || params == NULL) { return; }
-    float total_norm = 0.0f;
+    Tensor total_sq = Tensor_new((TensorShape){1}, false);
+    _cten_launch((GraphStep){Kernel_fill, total_sq, .params = {{.f = 0.0f}}});
     for(int i = 0; i < n_params; i++) {
         Tensor t = params[i];
         if(t.node == NULL || t.node->grad.data == NULL) { continue; }
-        for(int j = 0; j < t.data->numel; j++) {
-            float g = t.node->grad.data->flex[j];
-            total_norm += g * g;
-        }
+        _cten_launch((GraphStep){Kernel_sumsq_accumulate, total_sq, {t.node->grad, total_sq}, 2});
     }
-    total_norm = sqrtf(total_norm);
-    if(total_norm > max_norm) {
-        float scale = max_norm / total_norm;
-        for(int i = 0; i < n_params; i++) {
-            Tensor t = params[i];
-            if(t.node == NULL || t.node->grad.data == NULL) { continue; }
-            for(int j = 0; j < t.data->numel; j++) {
-                t.node->grad.data->flex[j] *= scale;
-            }
-        }
+    for(int i = 0; i < n_params; i++) {
+        Tensor t = params[i];
+        if(t.node == NULL || t.node->grad.data == NULL) { continue; }
+        Tensor grad = t.node->grad;
+        _cten_launch((GraphStep){Kernel_clip_norm, grad, {grad, total_sq}, 2, .params = {{.f = max_norm}}});
+    }
+}
+
+static void cten_clip_grad__range(Tensor* params, int n_params, float min_value, float max_value) {
+    if(n_params <= 0 || params == NULL) { return; }
+    for(int i = 0; i < n_params; i++) {
+        Tensor t = params[i];
+        if(t.node == NULL || t.node->grad.data == NULL) { continue; }
+        Tensor grad = t.node->grad;
+        _cten_launch((GraphStep){Kernel_clip_range, grad, {grad}, 1, .params = {{.f = min_value}, {.f = max_value}}});
     }
 }
 
@@ -563,68 +624,15 @@ void cten_clip_grad_value_range(Tensor* params, int n_params, float min_value, f
     if(min_value > max_value) {
         cten_assert(false, "min_value must be less than or equal to max_value");
     }
-    if(n_params <= 0 || params == NULL) { return; }
-    int clipped_count = 0;
-    int total_count = 0;
-    for(int i = 0; i < n_params; i++) {
-        Tensor t = params[i];
-        if(t.node == NULL || t.node->grad.data == NULL) { continue; }
-
-        for(int j = 0; j < t.data->numel; j++) {
-            float* grad_ptr = &t.node->grad.data->flex[j];
-            float grad_val = *grad_ptr;
-            total_count++;
-            if(grad_val > max_value) {
-                *grad_ptr = max_value;
-                clipped_count++;
-            } else if(grad_val < min_value) {
-                *grad_ptr = min_value;
-                clipped_count++;
-            }
-        }
-    }
+    cten_clip_grad__range(params, n_params, min_value, max_value);
 }
 
 void cten_clip_grad_positive(Tensor* params, int n_params, float max_value) {
     // Only clip positive gradients, leave negative ones unchanged
-    int clipped_count = 0;
-    int total_count = 0;
-
-    for(int i = 0; i < n_params; i++) {
-        Tensor t = params[i];
-        if(t.node == NULL || t.node->grad.data == NULL) continue;
-
-        for(int j = 0; j < t.data->numel; j++) {
-            float* grad_ptr = &t.node->grad.data->flex[j];
-            float grad_val = *grad_ptr;
-            total_count++;
-
-            if(grad_val > max_value) {
-                *grad_ptr = max_value;
-                clipped_count++;
-            }
-        }
-    }
+    cten_clip_grad__range(params, n_params, -INFINITY, max_value);
 }
 
 void cten_clip_grad_negative(Tensor* params, int n_params, float min_value) {
     // Only clip negative gradients, leave positive ones unchanged
-    int clipped_count = 0;
-    int total_count = 0;
-
-    for(int i = 0; i < n_params; i++) {
-        Tensor t = params[i];
-        if(t.node == NULL || t.node->grad.data == NULL) continue;
-
-        for(int j = 0; j < t.data->numel; j++) {
-            float* grad_ptr = &t.node->grad.data->flex[j];
-            float grad_val = *grad_ptr;
-            total_count++;
-
-            if(grad_val < min_value) {
-                *grad_ptr = min_value;
-                clipped_count++;
-            }
-        }
-    }
-}
\ No newline at end of file
+    cten_clip_grad__range(params, n_params, min_value, INFINITY);
+}
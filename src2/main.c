@@ -2,12 +2,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include <time.h>  
 
 enum MemoryPoolIds {
     PoolId_Default = 0,
     PoolId_Model = 1,
     PoolId_Optimizer = 2,
+    PoolId_Graph = 3,
+    PoolId_Data = 4,
 };
 
 typedef struct Model {
@@ -23,34 +26,68 @@ Tensor Model_forward(Model* model, Tensor x) {
 }
 
 
-int main() {
+int main(int argc, char** argv) {
     cten_initilize();
     
-    // load iris dataset
-    const float(*X)[4];
+    // load the dataset: a CSV file given on the command line (a header row, the features, then the class
+    // label), or the built-in iris dataset
+    const float* X;
     const int* y;
-    int n_samples = load_iris_dataset(&X, &y);
-    int n_features = 4;
-    int n_classes = 3;
+    int n_samples, n_features;
+    if(argc > 1) {
+        Tensor features;
+        int* labels;
+        cten_begin_malloc(PoolId_Data);
+        n_samples = cten_load_csv(argv[1], ',', true, -1, &features, &labels);
+        cten_end_malloc();
+        if(n_samples <= 0) {
+            fprintf(stderr, "cannot read %s\n", argv[1]);
+            return 1;
+        }
+        X = features.data->flex;
+        y = labels;
+        n_features = features.shape[1];
+    } else {
+        const float(*iris_X)[4];
+        n_samples = load_iris_dataset(&iris_X, &y);
+        X = (const float*)iris_X;
+        n_features = 4;
+    }
 
-    // Shuffle the dataset
-    float (*X_shuffled)[4] = malloc(n_samples * sizeof(*X_shuffled));
-    int* y_shuffled = malloc(n_samples * sizeof(int));
-    Tensor_shuffle_dataset(X, y, X_shuffled, y_shuffled, n_samples, n_features);
-    X = (const float(*)[4])X_shuffled;
-    y = (const int*)y_shuffled;
+    // store the raw rows in a temporary file, removed at exit; batches are gathered from its mapping
+    const char* tmp_dir = getenv("TMPDIR");
+    if(tmp_dir == NULL) tmp_dir = getenv("TEMP");
+    if(tmp_dir == NULL) tmp_dir = "/tmp";
+    char dataset_path[1024];
+    snprintf(dataset_path, sizeof(dataset_path), "%s/cten_iris_%ld.ctds", tmp_dir, (long)time(NULL));
+    if(!cten_dataset_save(dataset_path, X, y, n_samples, n_features, false)) {
+        fprintf(stderr, "cannot write %s\n", dataset_path);
+        return 1;
+    }
+    cten_begin_malloc(PoolId_Data);
+    cten_dataset* dataset = cten_dataset_open(dataset_path);
+    // every row of the mapping, for the statistics and the evaluation
+    float* features = cten_dataset_features(dataset, 0, n_samples).data->flex;
+    cten_end_malloc();
+    y = cten_dataset_labels(dataset);
+    int n_classes = cten_dataset_num_classes(dataset);
 
+    // split a random permutation of the rows: the first 80% train, the rest test
     int n_train_samples = n_samples * 0.8; 
     int n_test_samples = n_samples - n_train_samples; 
+    int* rows = malloc(sizeof(int) * n_samples);
+    for(int i = 0; i < n_samples; i++) rows[i] = i;
+    Tensor_shuffle_indices(rows, n_samples);
     
     printf("n_samples: %d\n", n_samples);
     printf("n_train_samples: %d\n", n_train_samples);
     printf("n_test_samples: %d\n", n_test_samples);
 
-    //normalize the dataset
-    float(*X_norm)[4] = malloc(n_samples * sizeof(*X_norm));
-    Tensor_normalize_dataset(X, X_norm, n_samples, n_train_samples, n_features);
-    X = (const float(*)[4])X_norm;
+    // normalization statistics of the training rows, in one pass over the mapping
+    cten_begin_malloc(PoolId_Data);
+    cten_feature_stats* stats = cten_feature_stats_new(n_features);
+    cten_end_malloc();
+    cten_feature_stats_update(stats, features, rows, n_train_samples);
 
     // create model
     Model model;
@@ -67,27 +104,21 @@ int main() {
     optim_sgd_config(optimizer, 0.01f, 0.0f);
     cten_end_malloc();
 
-    // train model
+    // train model: a producer thread assembles shuffled batches while the model trains on the previous one
     int batch_size = 8;
+    cten_begin_malloc(PoolId_Data);
+    cten_dataloader* loader = cten_dataloader_new_subset(dataset, rows, n_train_samples, batch_size, 3, true);
+    // rows are normalized as batches are assembled, so no normalized copy of the dataset exists
+    cten_dataloader_normalize(loader, stats);
+    cten_end_malloc();
     for(int epoch = 0; epoch < 3; epoch++) {
         printf("==> epoch: %d\n", epoch);
         float epoch_loss = 0.0f;
         int num_batches = 0;
-        for(int i = 0; i < n_train_samples; i += batch_size) {
-            int actual_batch_size = i + batch_size <= n_train_samples ? batch_size : n_train_samples - i;
-                printf(" batch: %d/%d samples\n", i, n_train_samples);
+        Tensor input, y_true;
+        while(cten_dataloader_next(loader, &input, &y_true)) {
+            printf(" batch: %d/%d\n", num_batches, cten_dataloader_num_batches(loader));
             cten_begin_malloc(PoolId_Default);            
-            Tensor input = Tensor_zeros((TensorShape){actual_batch_size, n_features}, false);
-            Tensor y_true = Tensor_zeros((TensorShape){actual_batch_size, n_classes}, false);
-
-            for(int j = 0; j < actual_batch_size; j++) {
-                for(int k = 0; k < n_features; k++) {
-                    input.data->flex[j * n_features + k] = X[i + j][k];
-                }
-                // one-hot encoding
-                y_true.data->flex[j * n_classes + y[i + j]] = 1.0f;
-
-            }
             // zero the gradients
             optim_sgd_zerograd(optimizer);
             // forward pass
@@ -107,41 +138,58 @@ int main() {
         }
         printf("Epoch %d average loss: %.6f\n", epoch, epoch_loss / num_batches);
     }
+    cten_dataloader_free(loader);
 
     // free optimizer
     cten_free(PoolId_Optimizer);
 
-    // evaluate model
+    // fold the normalization into the first layer: from here on the model takes raw features
+    cten_feature_stats_fold(stats, model.weight_1, model.bias_1);
+
+    // evaluate model: the forward pass is captured once and replayed for every test sample
     cten_begin_eval();
+    // the input views the mapped rows directly; each sample only rebinds it
+    Tensor input = Tensor_from_buffer((TensorShape){1, n_features}, features, NULL);
+
+    cten_graph_capture_begin(PoolId_Graph);
+    Tensor logit = Model_forward(&model, input);
+    Tensor y_pred = nn_softmax(logit, 1);
+    cten_graph* graph = cten_graph_capture_end(y_pred);
+
     int correct = 0;
-    for(int i = n_train_samples; i < n_samples; i++) {
-        cten_begin_malloc(PoolId_Default);
-        // prepare input and target
-        Tensor input = Tensor_zeros((TensorShape){1, n_features}, false);
-        Tensor y_true = Tensor_zeros((TensorShape){1, n_classes}, false);
-        for(int j = 0; j < n_features; j++) {
-            input.data->flex[j] = X[i][j];
-        }
-        y_true.data->flex[0 * n_classes + y[i]] = 1.0f; //Writing 0 here just to follow the architecture of the code
+    for(int t = n_train_samples; t < n_samples; t++) {
+        int i = rows[t];
+        // prepare input
+        Tensor_rebind(input, features + i * n_features);
 
         // forward pass
-        Tensor logit = Model_forward(&model, input);
-        Tensor y_pred = nn_softmax(logit,1);
-        Tensor loss = nn_crossentropy(y_true, y_pred);
+        cten_graph_replay(graph);
         // calculate accuracy
         int pred_classes[1];
         Tensor_argmax(y_pred, pred_classes);
         if(pred_classes[0] == y[i]) correct++;
-        printf("Sample %d - True: %d, Pred: %d\n", i - n_train_samples, y[i], pred_classes[0]);
-        cten_end_malloc();
-        // free temporary tensors
-        cten_free(PoolId_Default);
+        printf("Sample %d - True: %d, Pred: %d\n", t - n_train_samples, y[i], pred_classes[0]);
     }
     printf("accuracy: %.4f\n", (float)correct / n_test_samples);
     cten_end_eval();
 
-    // free model
+    // free the captured graph and the input view
+    cten_free(PoolId_Graph);
+    Tensor_release(input);
+    cten_free(PoolId_Default);
+
+    // save the trained weights; cten_load maps them back without copying
+    const char* names[] = {"weight_1", "weight_2", "bias_1", "bias_2"};
+    if(cten_save("iris_mlp.cten", 4, names, (Tensor*)&model)) {
+        printf("model saved to iris_mlp.cten\n");
+    }
+
+    // free model and data
     cten_free(PoolId_Model); 
+    cten_dataset_close(dataset);
+    remove(dataset_path);
+    cten_free(PoolId_Data);
+    free(rows);
 
     cten_finalize();
     return 0;
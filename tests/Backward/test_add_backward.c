@@ -258,6 +258,22 @@ void test_add_backward() {
             compare_tensors(&t_row.node->grad, &expected_grad_row, op_name, tc_name, 2, TEST_FLOAT_TOLERANCE);
             compare_tensors(&t_col.node->grad, &expected_grad_col, op_name, tc_name, 2, TEST_FLOAT_TOLERANCE);
         }
+
+        // Sub-test 3: Shared intermediate a + a with a = 2x
+        {
+            TensorShape v_shape = {2};
+            float x_data[] = {1.0f, -3.0f};
+            float exp_grad_x[] = {4.0f, 4.0f};
+
+            Tensor x = create_test_tensor(v_shape, x_data, true);
+            Tensor a = Tensor_mulf(x, 2.0f);
+            Tensor l = Tensor_sum(Tensor_add(a, a));
+
+            Tensor_backward(l, (Tensor){0});
+
+            Tensor expected_grad_x = create_test_tensor(v_shape, exp_grad_x, false);
+            compare_tensors(&x.node->grad, &expected_grad_x, op_name, tc_name, 3, TEST_FLOAT_TOLERANCE);
+        }
     }
 
     // Test Case 4: Broadcasting with other ops
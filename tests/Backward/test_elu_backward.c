@@ -0,0 +1,56 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <stdio.h>
+
+void test_elu_backward() {
+    const char* op_name = "elu_backward";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    // Test Case 1: Simple ELU backward
+    {
+        const char* tc_name = "Simple_elu_backward";
+        TensorShape v_shape = {3};
+        float d1[] = {2.0f, -1.0f, 0.0f};
+        // x > 0: 1, x <= 0: alpha * e^x
+        float exp_grad1[] = {1.0f, 0.18393972f, 0.5f};
+
+        Tensor t1 = create_test_tensor(v_shape, d1, true);
+        Tensor z = nn_elu(t1, 0.5f);
+        Tensor l = Tensor_sum(z);
+
+        Tensor_backward(l, (Tensor){0});
+
+        Tensor expected_grad1 = create_test_tensor(v_shape, exp_grad1, false);
+        compare_tensors(&t1.node->grad, &expected_grad1, op_name, tc_name, 1, TEST_FLOAT_TOLERANCE);
+    }
+
+    // Test Case 2: alpha is kept per node, not overwritten by a later forward call
+    {
+        const char* tc_name = "Interleaved_alpha_elu_backward";
+        TensorShape v_shape = {2};
+        float d1[] = {-1.0f, 3.0f};
+        float d2[] = {-2.0f, 1.0f};
+        float exp_grad1[] = {0.18393972f, 1.0f};  // alpha = 0.5
+        float exp_grad2[] = {0.27067057f, 1.0f};  // alpha = 2.0
+
+        Tensor t1 = create_test_tensor(v_shape, d1, true);
+        Tensor t2 = create_test_tensor(v_shape, d2, true);
+        Tensor z1 = nn_elu(t1, 0.5f);
+        Tensor z2 = nn_elu(t2, 2.0f);
+        Tensor l1 = Tensor_sum(z1);
+        Tensor l2 = Tensor_sum(z2);
+
+        Tensor_backward(l1, (Tensor){0});
+        Tensor_backward(l2, (Tensor){0});
+
+        Tensor expected_grad1 = create_test_tensor(v_shape, exp_grad1, false);
+        Tensor expected_grad2 = create_test_tensor(v_shape, exp_grad2, false);
+        compare_tensors(&t1.node->grad, &expected_grad1, op_name, tc_name, 1, TEST_FLOAT_TOLERANCE);
+        compare_tensors(&t2.node->grad, &expected_grad2, op_name, tc_name, 2, TEST_FLOAT_TOLERANCE);
+    }
+
+    cten_free(pool_id);
+}
@@ -0,0 +1,86 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <stdio.h>
+#include <string.h>
+
+void test_graph_capture() {
+    const char* op_name = "graph_capture";
+    PoolId pool_id = 0;
+    PoolId graph_pool_id = 100;
+    cten_begin_malloc(pool_id);
+    cten_begin_eval();
+
+    // Test Case 1: linear -> relu -> softmax, replayed with new input data
+    {
+        const char* tc_name = "Replay_linear_relu_softmax";
+        TensorShape x_shape = {2, 3};
+        TensorShape w_shape = {3, 2};
+        TensorShape b_shape = {1, 2};
+        float x_data[] = {1.0f, -2.0f, 0.5f, 0.0f, 3.0f, -1.0f};
+        float x_data2[] = {-1.5f, 2.0f, 1.0f, 4.0f, -0.5f, 2.5f};
+        float w_data[] = {0.2f, -0.4f, 0.7f, 0.1f, -0.3f, 0.9f};
+        float b_data[] = {0.05f, -0.1f};
+
+        Tensor x = create_test_tensor(x_shape, x_data, false);
+        Tensor w = create_test_tensor(w_shape, w_data, true);
+        Tensor b = create_test_tensor(b_shape, b_data, true);
+
+        cten_graph_capture_begin(graph_pool_id);
+        Tensor y = nn_softmax(nn_relu(nn_linear(x, w, b)), 1);
+        cten_graph* graph = cten_graph_capture_end(y);
+
+        // Sub-test 1: replaying with unchanged input reproduces the captured output
+        Tensor expected1 = nn_softmax(nn_relu(nn_linear(x, w, b)), 1);
+        cten_graph_replay(graph);
+        compare_tensors(&y, &expected1, op_name, tc_name, 1, TEST_FLOAT_TOLERANCE);
+
+        // Sub-test 2: new input data flows through the captured buffers
+        memcpy(x.data->flex, x_data2, sizeof(x_data2));
+        Tensor expected2 = nn_softmax(nn_relu(nn_linear(x, w, b)), 1);
+        cten_graph_replay(graph);
+        compare_tensors(&y, &expected2, op_name, tc_name, 2, TEST_FLOAT_TOLERANCE);
+
+        // Sub-test 3: updated weights are picked up as well
+        w.data->flex[0] = -1.0f;
+        Tensor expected3 = nn_softmax(nn_relu(nn_linear(x, w, b)), 1);
+        cten_graph_replay(graph);
+        compare_tensors(&y, &expected3, op_name, tc_name, 3, TEST_FLOAT_TOLERANCE);
+
+        cten_free(graph_pool_id);
+    }
+
+    // Test Case 2: reductions with two outputs and broadcasting
+    {
+        const char* tc_name = "Replay_reductions";
+        TensorShape x_shape = {2, 3};
+        TensorShape s_shape = {3};
+        float x_data[] = {1.0f, 5.0f, -2.0f, 4.0f, 0.0f, 3.0f};
+        float x_data2[] = {-3.0f, 2.0f, 8.0f, 1.0f, 7.0f, -4.0f};
+        float s_data[] = {0.5f, 2.0f, -1.0f};
+
+        Tensor x = create_test_tensor(x_shape, x_data, false);
+        Tensor scale = create_test_tensor(s_shape, s_data, false);
+
+        cten_graph_capture_begin(graph_pool_id);
+        Tensor scaled = Tensor_mul(x, scale);
+        TensorMaxMinResult max_res = Tensor_max(scaled, 1);
+        Tensor out = Tensor_add(Tensor_mean(max_res.values), Tensor_sum(scaled, 0));
+        cten_graph* graph = cten_graph_capture_end(out);
+
+        memcpy(x.data->flex, x_data2, sizeof(x_data2));
+        Tensor exp_scaled = Tensor_mul(x, scale);
+        TensorMaxMinResult exp_max = Tensor_max(exp_scaled, 1);
+        Tensor expected = Tensor_add(Tensor_mean(exp_max.values), Tensor_sum(exp_scaled, 0));
+        cten_graph_replay(graph);
+
+        compare_tensors(&out, &expected, op_name, tc_name, 1, TEST_FLOAT_TOLERANCE);
+        compare_tensors(&max_res.indices, &exp_max.indices, op_name, tc_name, 2, TEST_FLOAT_TOLERANCE);
+
+        cten_free(graph_pool_id);
+    }
+
+    cten_end_eval();
+    cten_free(pool_id);
+}
@@ -0,0 +1,148 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+// a replayed step runs the very same kernels in the same order, so it must match the eager step bit for bit;
+// differences of two floats are exact, so anything below the smallest denormal means "equal"
+#define EXACT_TOLERANCE FLT_TRUE_MIN
+
+typedef struct {
+    Tensor w1, b1, w2, b2;
+} TinyMLP;
+
+static float w1_data[] = {0.2f, -0.4f, 0.7f, 0.1f, -0.3f, 0.9f, 0.5f, -0.6f, 0.05f, 0.3f, -0.8f, 0.25f};
+static float b1_data[] = {0.05f, -0.1f, 0.2f, 0.0f};
+static float w2_data[] = {0.3f, -0.2f, -0.5f, 0.4f, 0.6f, 0.1f, -0.7f, 0.8f};
+static float b2_data[] = {0.1f, -0.05f};
+
+static float x_batches[3][6] = {
+    {1.0f, -2.0f, 0.5f, 0.0f, 3.0f, -1.0f},
+    {-1.5f, 2.0f, 1.0f, 4.0f, -0.5f, 2.5f},
+    {0.3f, 0.7f, -0.9f, -2.0f, 1.2f, 0.4f},
+};
+static float y_batches[3][4] = {
+    {1.0f, 0.0f, 0.0f, 1.0f},
+    {0.0f, 1.0f, 1.0f, 0.0f},
+    {1.0f, 0.0f, 1.0f, 0.0f},
+};
+
+static TinyMLP TinyMLP_new() {
+    TinyMLP m;
+    m.w1 = create_test_tensor((TensorShape){3, 4}, w1_data, true);
+    m.b1 = create_test_tensor((TensorShape){1, 4}, b1_data, true);
+    m.w2 = create_test_tensor((TensorShape){4, 2}, w2_data, true);
+    m.b2 = create_test_tensor((TensorShape){1, 2}, b2_data, true);
+    return m;
+}
+
+static Tensor TinyMLP_loss(TinyMLP* m, Tensor x, Tensor y, bool mse) {
+    Tensor h = nn_tanh(nn_linear(x, m->w1, m->b1));
+    Tensor logits = nn_linear(h, m->w2, m->b2);
+    if(mse) return nn_mse_loss(y, nn_sigmoid(logits));
+    return nn_softmax_crossentropy(y, logits);
+}
+
+static void compare_models(TinyMLP* a, TinyMLP* b, const char* op_name, const char* tc_name, int base) {
+    compare_tensors(&a->w1, &b->w1, op_name, tc_name, base + 0, EXACT_TOLERANCE);
+    compare_tensors(&a->b1, &b->b1, op_name, tc_name, base + 1, EXACT_TOLERANCE);
+    compare_tensors(&a->w2, &b->w2, op_name, tc_name, base + 2, EXACT_TOLERANCE);
+    compare_tensors(&a->b2, &b->b2, op_name, tc_name, base + 3, EXACT_TOLERANCE);
+}
+
+void test_graph_training() {
+    const char* op_name = "graph_training";
+    PoolId pool_id = 0;
+    PoolId graph_pool_id = 100;
+    cten_begin_malloc(pool_id);
+
+    // Test Case 1: SGD with momentum and global-norm clipping, softmax cross-entropy
+    {
+        const char* tc_name = "Replay_sgd_momentum_clip_norm";
+        TinyMLP eager = TinyMLP_new();
+        TinyMLP graph = TinyMLP_new();
+        Tensor eager_params[] = {eager.w1, eager.b1, eager.w2, eager.b2};
+        Tensor graph_params[] = {graph.w1, graph.b1, graph.w2, graph.b2};
+        optim_sgd* eager_opt = optim_sgd_new(4, eager_params, 0.01f);
+        optim_sgd_config(eager_opt, 0.1f, 0.9f);
+        optim_sgd* graph_opt = optim_sgd_new(4, graph_params, 0.01f);
+        optim_sgd_config(graph_opt, 0.1f, 0.9f);
+
+        Tensor x = create_test_tensor((TensorShape){2, 3}, x_batches[0], false);
+        Tensor y = create_test_tensor((TensorShape){2, 2}, y_batches[0], false);
+
+        cten_graph_capture_begin(graph_pool_id);
+        optim_sgd_zerograd(graph_opt);
+        Tensor loss = TinyMLP_loss(&graph, x, y, false);
+        Tensor_backward(loss, (Tensor){0});
+        cten_clip_grad_norm(graph_params, 4, 0.5f);
+        optim_sgd_step(graph_opt);
+        cten_graph* step = cten_graph_capture_end(loss);
+
+        for(int b = 0; b < 3; b++) {
+            // capturing already ran the first step
+            if(b > 0) {
+                memcpy(x.data->flex, x_batches[b], sizeof(x_batches[b]));
+                memcpy(y.data->flex, y_batches[b], sizeof(y_batches[b]));
+                cten_graph_replay(step);
+            }
+            Tensor ex = create_test_tensor((TensorShape){2, 3}, x_batches[b], false);
+            Tensor ey = create_test_tensor((TensorShape){2, 2}, y_batches[b], false);
+            optim_sgd_zerograd(eager_opt);
+            Tensor eager_loss = TinyMLP_loss(&eager, ex, ey, false);
+            Tensor_backward(eager_loss, (Tensor){0});
+            cten_clip_grad_norm(eager_params, 4, 0.5f);
+            optim_sgd_step(eager_opt);
+
+            compare_tensors(&loss, &eager_loss, op_name, tc_name, b * 10 + 1, EXACT_TOLERANCE);
+            compare_models(&graph, &eager, op_name, tc_name, b * 10 + 2);
+        }
+        cten_free(graph_pool_id);
+    }
+
+    // Test Case 2: Adam (step counter advances on replay) with value clipping, MSE on sigmoid outputs
+    {
+        const char* tc_name = "Replay_adam_clip_value";
+        TinyMLP eager = TinyMLP_new();
+        TinyMLP graph = TinyMLP_new();
+        Tensor eager_params[] = {eager.w1, eager.b1, eager.w2, eager.b2};
+        Tensor graph_params[] = {graph.w1, graph.b1, graph.w2, graph.b2};
+        optim_adam* eager_opt = optim_adam_new(4, eager_params, 0.05f, 0.9f, 0.999f, 1e-8f, 0.0f);
+        optim_adam* graph_opt = optim_adam_new(4, graph_params, 0.05f, 0.9f, 0.999f, 1e-8f, 0.0f);
+
+        Tensor x = create_test_tensor((TensorShape){2, 3}, x_batches[0], false);
+        Tensor y = create_test_tensor((TensorShape){2, 2}, y_batches[0], false);
+
+        cten_graph_capture_begin(graph_pool_id);
+        optim_adam_zerograd(graph_opt);
+        Tensor loss = TinyMLP_loss(&graph, x, y, true);
+        Tensor_backward(loss, (Tensor){0});
+        cten_clip_grad_value(graph_params, 4, 0.05f);
+        optim_adam_step(graph_opt);
+        cten_graph* step = cten_graph_capture_end(loss);
+
+        for(int b = 0; b < 3; b++) {
+            if(b > 0) {
+                memcpy(x.data->flex, x_batches[b], sizeof(x_batches[b]));
+                memcpy(y.data->flex, y_batches[b], sizeof(y_batches[b]));
+                cten_graph_replay(step);
+            }
+            Tensor ex = create_test_tensor((TensorShape){2, 3}, x_batches[b], false);
+            Tensor ey = create_test_tensor((TensorShape){2, 2}, y_batches[b], false);
+            optim_adam_zerograd(eager_opt);
+            Tensor eager_loss = TinyMLP_loss(&eager, ex, ey, true);
+            Tensor_backward(eager_loss, (Tensor){0});
+            cten_clip_grad_value(eager_params, 4, 0.05f);
+            optim_adam_step(eager_opt);
+
+            compare_tensors(&loss, &eager_loss, op_name, tc_name, b * 10 + 1, EXACT_TOLERANCE);
+            compare_models(&graph, &eager, op_name, tc_name, b * 10 + 2);
+        }
+        cten_free(graph_pool_id);
+    }
+
+    cten_free(pool_id);
+}
@@ -0,0 +1,284 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include "../../include/common/threads.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Training resumed from a checkpoint (parameters, optimizer state, RNG) must continue exactly like the
+// run that was never interrupted.
+
+#define TEST_FILE "cten_test_checkpoint.cten"
+#define TEST_FILE_2 "cten_test_checkpoint_2.cten"
+#define N_STEPS 5
+#define N_BEFORE 3
+#define EXACT_TOLERANCE FLT_TRUE_MIN
+
+typedef enum { Kind_SGD, Kind_AdaGrad, Kind_RMSProp8bit, Kind_Adam, Kind_AdamFactored, Kind_Adam8bit } OptimKind;
+
+typedef struct {
+    Tensor params[2];
+    OptimKind kind;
+    void* opt;
+} Trainer;
+
+static const char* param_names[2] = {"w", "b"};
+
+static void Trainer_init(Trainer* self, OptimKind kind, float fill) {
+    float w[6], b[3];
+    for(int j = 0; j < 6; j++) w[j] = fill == 0.0f ? sinf(1.1f * j) : fill;
+    for(int j = 0; j < 3; j++) b[j] = fill == 0.0f ? cosf(0.7f * j) : fill;
+    self->params[0] = create_test_tensor((TensorShape){2, 3}, w, true);
+    self->params[1] = create_test_tensor((TensorShape){3}, b, true);
+    self->kind = kind;
+    switch(kind) {
+        case Kind_SGD:
+            self->opt = optim_sgd_new(2, self->params, 0.01f);
+            optim_sgd_config(self->opt, 0.1f, 0.9f);
+            break;
+        case Kind_AdaGrad: self->opt = optim_adagrad_new(2, self->params, 0.1f, 1e-8f, 0.0f); break;
+        case Kind_RMSProp8bit:
+            self->opt = optim_rmsprop_new_with_state(2, self->params, 0.01f, 0.9f, 1e-8f, 0.0f, OptimState_8bit);
+            break;
+        case Kind_Adam: self->opt = optim_adamw_new(2, self->params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.01f); break;
+        case Kind_AdamFactored:
+            self->opt = optim_adam_new_with_state(2, self->params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.0f, OptimState_factored);
+            break;
+        case Kind_Adam8bit:
+            self->opt = optim_adam_new_with_state(2, self->params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.0f, OptimState_8bit);
+            break;
+    }
+}
+
+static void Trainer_step(Trainer* self, int k) {
+    for(int i = 0; i < 2; i++) {
+        float* g = self->params[i].node->grad.data->flex;
+        for(int j = 0; j < self->params[i].data->numel; j++) g[j] = sinf(0.9f * j + 1.3f * k + i);
+    }
+    switch(self->kind) {
+        case Kind_SGD: optim_sgd_step(self->opt); break;
+        case Kind_AdaGrad: optim_adagrad_step(self->opt); break;
+        case Kind_RMSProp8bit: optim_rmsprop_step(self->opt); break;
+        default: optim_adam_step(self->opt); break;
+    }
+}
+
+static void Trainer_write(Trainer* self, cten_writer* writer) {
+    for(int i = 0; i < 2; i++) cten_writer_add(writer, param_names[i], self->params[i]);
+    switch(self->kind) {
+        case Kind_SGD: optim_sgd_save_state(self->opt, writer, "optim"); break;
+        case Kind_AdaGrad: optim_adagrad_save_state(self->opt, writer, "optim"); break;
+        case Kind_RMSProp8bit: optim_rmsprop_save_state(self->opt, writer, "optim"); break;
+        default: optim_adam_save_state(self->opt, writer, "optim"); break;
+    }
+}
+
+static bool Trainer_save(Trainer* self, const char* path) {
+    cten_writer* writer = cten_writer_open(path);
+    if(writer == NULL) return false;
+    Trainer_write(self, writer);
+    return cten_writer_close(writer);
+}
+
+static bool file_exists(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if(fp != NULL) fclose(fp);
+    return fp != NULL;
+}
+
+static bool Trainer_load(Trainer* self, const char* path) {
+    cten_file* file = cten_load(path);
+    if(file == NULL) return false;
+    bool ok = cten_file_read(file, param_names[0], self->params[0]) && cten_file_read(file, param_names[1], self->params[1]);
+    switch(self->kind) {
+        case Kind_SGD: ok = ok && optim_sgd_load_state(self->opt, file, "optim"); break;
+        case Kind_AdaGrad: ok = ok && optim_adagrad_load_state(self->opt, file, "optim"); break;
+        case Kind_RMSProp8bit: ok = ok && optim_rmsprop_load_state(self->opt, file, "optim"); break;
+        default: ok = ok && optim_adam_load_state(self->opt, file, "optim"); break;
+    }
+    cten_file_close(file);
+    return ok;
+}
+
+// runs on a thread that never calls cten_initilize, so its default context is built on first use
+static void draw_on_fresh_thread(void* arg) {
+    float* out = arg;
+    cten_begin_malloc(0);
+    Tensor t = Glorot_init((TensorShape){4, 4}, false);
+    memcpy(out, t.data->flex, sizeof(float) * 16);
+    cten_end_malloc();
+    cten_free(0);
+    cten_finalize();
+}
+
+void test_checkpoint() {
+    const char* op_name = "checkpoint";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    // Test Cases 1-6: every optimizer and state format
+    const char* tc_names[] = {"SGD_momentum", "AdaGrad", "RMSProp_8bit", "AdamW", "Adam_factored", "Adam_8bit"};
+    for(int kind = Kind_SGD; kind <= Kind_Adam8bit; kind++) {
+        Trainer ref, interrupted, resumed;
+        Trainer_init(&ref, kind, 0.0f);
+        Trainer_init(&interrupted, kind, 0.0f);
+        Trainer_init(&resumed, kind, 0.5f);  // overwritten by the checkpoint
+        for(int k = 0; k < N_STEPS; k++) Trainer_step(&ref, k);
+        for(int k = 0; k < N_BEFORE; k++) Trainer_step(&interrupted, k);
+
+        bool ok = Trainer_save(&interrupted, TEST_FILE) && Trainer_load(&resumed, TEST_FILE);
+        csv_reporter_record_result(op_name, tc_names[kind], 1, ok ? "/" : "save_or_load_failed/" PLATFORM_NAME);
+        for(int k = N_BEFORE; k < N_STEPS; k++) Trainer_step(&resumed, k);
+        compare_tensors(&resumed.params[0], &ref.params[0], op_name, tc_names[kind], 2, EXACT_TOLERANCE);
+        compare_tensors(&resumed.params[1], &ref.params[1], op_name, tc_names[kind], 3, EXACT_TOLERANCE);
+    }
+
+    // Test Case 7: state saved under another format is rejected
+    {
+        const char* tc_name = "State_mismatch";
+        Trainer fp32, lean;
+        Trainer_init(&fp32, Kind_Adam, 0.0f);
+        Trainer_init(&lean, Kind_Adam8bit, 0.0f);
+        bool rejected = Trainer_save(&fp32, TEST_FILE) && !Trainer_load(&lean, TEST_FILE);
+        csv_reporter_record_result(op_name, tc_name, 1, rejected ? "/" : "accepted/" PLATFORM_NAME);
+    }
+
+    // Test Case 8: a file missing a later entry is rejected before any state is copied
+    {
+        const char* tc_name = "Partial_state";
+        // everything but the last entry each format writes
+        const char* adam_entries[] = {"optim.t", "optim.m", NULL};
+        const char* adam8_entries[] = {"optim.t", "optim.m_8bit.codes", "optim.m_8bit.scales", "optim.v_8bit.codes", NULL};
+        const char** entries[] = {adam_entries, adam8_entries};
+        OptimKind kinds[] = {Kind_Adam, Kind_Adam8bit};
+        for(int c = 0; c < 2; c++) {
+            Trainer saved, loaded, untouched;
+            Trainer_init(&saved, kinds[c], 0.0f);
+            Trainer_init(&loaded, kinds[c], 0.5f);
+            Trainer_init(&untouched, kinds[c], 0.5f);
+            for(int k = 0; k < N_BEFORE; k++) {
+                Trainer_step(&saved, N_STEPS + k);  // other gradients, so the saved moments differ
+                Trainer_step(&loaded, k);
+                Trainer_step(&untouched, k);
+            }
+            Trainer_save(&saved, TEST_FILE_2);
+            cten_file* full = cten_load(TEST_FILE_2);
+            cten_writer* writer = cten_writer_open(TEST_FILE);
+            for(int i = 0; full != NULL && entries[c][i] != NULL; i++) {
+                size_t nbytes;
+                const void* bytes = cten_file_bytes(full, entries[c][i], &nbytes);
+                if(bytes != NULL) {
+                    cten_writer_add_bytes(writer, entries[c][i], bytes, nbytes);
+                } else {
+                    cten_writer_add(writer, entries[c][i], cten_file_get(full, entries[c][i]));
+                }
+            }
+            bool written = full != NULL && cten_writer_close(writer);
+            if(full != NULL) cten_file_close(full);
+
+            cten_file* file = cten_load(TEST_FILE);
+            bool rejected = written && file != NULL && !optim_adam_load_state(loaded.opt, file, "optim");
+            if(file != NULL) cten_file_close(file);
+            csv_reporter_record_result(op_name, tc_name, 1 + 3 * c, rejected ? "/" : "accepted/" PLATFORM_NAME);
+            for(int k = N_BEFORE; k < N_STEPS; k++) {
+                Trainer_step(&loaded, k);
+                Trainer_step(&untouched, k);
+            }
+            compare_tensors(&loaded.params[0], &untouched.params[0], op_name, tc_name, 2 + 3 * c, EXACT_TOLERANCE);
+            compare_tensors(&loaded.params[1], &untouched.params[1], op_name, tc_name, 3 + 3 * c, EXACT_TOLERANCE);
+        }
+    }
+
+    // Test Case 9: the RNG continues from the saved state
+    {
+        const char* tc_name = "RNG";
+        cten_manual_seed(1234);
+        Glorot_init((TensorShape){4, 4}, false);
+        uint64_t state = cten_get_rng_state();
+        cten_writer* writer = cten_writer_open(TEST_FILE);
+        cten_writer_add_bytes(writer, "rng", &state, sizeof(state));
+        cten_writer_close(writer);
+        Tensor expected = Glorot_init((TensorShape){4, 4}, false);
+
+        cten_manual_seed(99);
+        cten_file* file = cten_load(TEST_FILE);
+        uint64_t restored = 0;
+        size_t nbytes = 0;
+        const void* bytes = cten_file_bytes(file, "rng", &nbytes);
+        if(bytes != NULL && nbytes == sizeof(restored)) memcpy(&restored, bytes, sizeof(restored));
+        cten_file_close(file);
+        cten_set_rng_state(restored);
+        Tensor observed = Glorot_init((TensorShape){4, 4}, false);
+        compare_tensors(&observed, &expected, op_name, tc_name, 1, EXACT_TOLERANCE);
+
+        // another thread's RNG starts from the default seed, like this one's after cten_manual_seed(0)
+        float drawn[16] = {0};
+        c11_thrd_t thread;
+        bool started = c11_thrd__create(&thread, draw_on_fresh_thread, drawn);
+        if(started) c11_thrd__join(thread);
+        csv_reporter_record_result(op_name, tc_name, 2, started ? "/" : "thread/" PLATFORM_NAME);
+        cten_manual_seed(0);
+        Tensor fresh = Glorot_init((TensorShape){4, 4}, false);
+        Tensor drawn_tensor = create_test_tensor((TensorShape){4, 4}, drawn, false);
+        compare_tensors(&drawn_tensor, &fresh, op_name, tc_name, 3, EXACT_TOLERANCE);
+    }
+
+    // Test Case 10: an asynchronous checkpoint holds the state at commit, although training continues meanwhile
+    {
+        const char* tc_name = "Async";
+        Trainer ref, trained, resumed;
+        Trainer_init(&ref, Kind_Adam, 0.0f);
+        Trainer_init(&trained, Kind_Adam, 0.0f);
+        Trainer_init(&resumed, Kind_Adam, 0.5f);
+        for(int k = 0; k < N_STEPS; k++) Trainer_step(&ref, k);
+        for(int k = 0; k < N_BEFORE; k++) Trainer_step(&trained, k);
+
+        cten_checkpoint* ckpt = cten_checkpoint_new();
+        Trainer_write(&trained, cten_checkpoint_begin(ckpt, TEST_FILE));
+        cten_checkpoint_commit(ckpt);
+        for(int k = N_BEFORE; k < N_STEPS; k++) Trainer_step(&trained, k);
+        bool ok = cten_checkpoint_wait(ckpt) && cten_checkpoint_done(ckpt) && !file_exists(TEST_FILE ".tmp");
+        ok = ok && Trainer_load(&resumed, TEST_FILE);
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "write_or_load_failed/" PLATFORM_NAME);
+        for(int k = N_BEFORE; k < N_STEPS; k++) Trainer_step(&resumed, k);
+        compare_tensors(&resumed.params[0], &ref.params[0], op_name, tc_name, 2, EXACT_TOLERANCE);
+        compare_tensors(&resumed.params[1], &ref.params[1], op_name, tc_name, 3, EXACT_TOLERANCE);
+
+        // Test Case 11: snapshots queued back to back land in order, each replacing its file whole
+        tc_name = "Async_queue";
+        for(int k = 0; k < 6; k++) {
+            Trainer_step(&trained, N_STEPS + k);
+            Trainer_write(&trained, cten_checkpoint_begin(ckpt, k % 2 == 0 ? TEST_FILE : TEST_FILE_2));
+            cten_checkpoint_commit(ckpt);
+        }
+        Tensor latest = trained.params[0];
+        Trainer last;
+        Trainer_init(&last, Kind_Adam, 0.5f);
+        ok = cten_checkpoint_free(ckpt) && Trainer_load(&last, TEST_FILE_2);
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "write_or_load_failed/" PLATFORM_NAME);
+        compare_tensors(&last.params[0], &latest, op_name, tc_name, 2, EXACT_TOLERANCE);
+    }
+
+    // Test Case 12: a failed write leaves no file behind and is reported by wait
+    {
+        const char* tc_name = "Async_failure";
+        Trainer t;
+        Trainer_init(&t, Kind_SGD, 0.0f);
+        cten_checkpoint* ckpt = cten_checkpoint_new();
+        Trainer_write(&t, cten_checkpoint_begin(ckpt, "cten_no_such_dir/ckpt.cten"));
+        cten_checkpoint_commit(ckpt);
+        bool failed = !cten_checkpoint_wait(ckpt);
+        // the error is reported once
+        Trainer_write(&t, cten_checkpoint_begin(ckpt, TEST_FILE));
+        cten_checkpoint_commit(ckpt);
+        bool recovered = cten_checkpoint_free(ckpt);
+        csv_reporter_record_result(op_name, tc_name, 1, failed && recovered ? "/" : "status/" PLATFORM_NAME);
+    }
+
+    remove(TEST_FILE);
+    remove(TEST_FILE_2);
+    cten_free(pool_id);
+}
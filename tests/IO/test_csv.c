@@ -0,0 +1,140 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The CSV reader must give the same floats as strtof, for any column count and label position, also when
+// rows straddle the chunks the file is streamed in.
+
+#define TEST_FILE "cten_test_dataset.csv"
+
+static void write_file(const char* text) {
+    FILE* fp = fopen(TEST_FILE, "wb");
+    fputs(text, fp);
+    fclose(fp);
+}
+
+// deterministic field text of many shapes: integers, decimals, exponents, signs
+static void format_field(char* buf, size_t size, int row, int col) {
+    uint32_t h = (uint32_t)(row * 2654435761u) ^ (uint32_t)(col * 40503u + 17u);
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    float v = (float)(h % 2000001u) / 1000.0f - 1000.0f;
+    switch(h % 5) {
+        case 0: snprintf(buf, size, "%.7g", v); break;
+        case 1: snprintf(buf, size, "%.3e", v * 1e-7f); break;
+        case 2: snprintf(buf, size, "%d", (int)v); break;
+        case 3: snprintf(buf, size, "%.9f", v * 1e-3f); break;
+        default: snprintf(buf, size, "%+.2E", v * 1e20f); break;
+    }
+}
+
+void test_csv() {
+    const char* op_name = "csv";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    // Test Case 1: header, label last, spaces, CRLF, a blank line and no final line break
+    {
+        const char* tc_name = "Basic";
+        write_file("a,b,c,label\r\n"
+                   "5.1, 3.5 ,1.4,0\r\n"
+                   "\r\n"
+                   "-0.25,+12,1e-3,2\n"
+                   "7,.5,-6.02E23,1");
+        Tensor X;
+        int* y;
+        int n = cten_load_csv(TEST_FILE, ',', true, -1, &X, &y);
+        float expected_data[9] = {5.1f, 3.5f, 1.4f, -0.25f, 12.0f, 1e-3f, 7.0f, 0.5f, -6.02e23f};
+        Tensor expected = create_test_tensor((TensorShape){3, 3}, expected_data, false);
+        bool ok = n == 3 && y[0] == 0 && y[1] == 2 && y[2] == 1;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "rows_or_labels/" PLATFORM_NAME);
+        if(n == 3) compare_tensors(&X, &expected, op_name, tc_name, 2, FLT_TRUE_MIN);
+    }
+
+    // Test Case 2: TSV with the label in the first column
+    {
+        const char* tc_name = "TSV";
+        write_file("4\t0.5\t-1.5\n"
+                   "9\t2e2\t3.25\n");
+        cten_csv* csv = cten_csv_open(TEST_FILE, '\t', false, 0);
+        bool ok = csv != NULL && cten_csv_num_features(csv) == 2;
+        if(ok) {
+            Tensor X = Tensor_zeros((TensorShape){4, 2}, false);
+            int y[4];
+            int n = cten_csv_read(csv, X, y);
+            ok = n == 2 && y[0] == 4 && y[1] == 9 && cten_csv_read(csv, X, y) == 0;
+            float expected_data[4] = {0.5f, -1.5f, 200.0f, 3.25f};
+            Tensor expected = create_test_tensor((TensorShape){2, 2}, expected_data, false);
+            Tensor rows = Tensor_zeros((TensorShape){2, 2}, false);
+            memcpy(rows.data->flex, X.data->flex, sizeof(float) * 4);
+            compare_tensors(&rows, &expected, op_name, tc_name, 2, FLT_TRUE_MIN);
+            cten_csv_close(csv);
+        }
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "rows_or_labels/" PLATFORM_NAME);
+    }
+
+    // Test Case 3: a file of several chunks, read in small batches and checked against strtof
+    {
+        const char* tc_name = "Chunked";
+        enum { N_ROWS = 40000, N_FEATURES = 7, BATCH = 999 };
+        char field[64];
+        FILE* fp = fopen(TEST_FILE, "wb");
+        for(int r = 0; r < N_ROWS; r++) {
+            for(int c = 0; c < N_FEATURES; c++) {
+                format_field(field, sizeof(field), r, c);
+                fprintf(fp, "%s,", field);
+            }
+            fprintf(fp, "%d\n", r % 3);
+        }
+        long size = ftell(fp);
+        fclose(fp);
+
+        cten_csv* csv = cten_csv_open(TEST_FILE, ',', false, -1);
+        Tensor X = Tensor_zeros((TensorShape){BATCH, N_FEATURES}, false);
+        int y[BATCH];
+        int n_rows = 0, n_mismatch = 0, n;
+        while((n = cten_csv_read(csv, X, y)) > 0) {
+            for(int i = 0; i < n; i++, n_rows++) {
+                n_mismatch += y[i] != n_rows % 3;
+                for(int c = 0; c < N_FEATURES; c++) {
+                    format_field(field, sizeof(field), n_rows, c);
+                    n_mismatch += X.data->flex[i * N_FEATURES + c] != strtof(field, NULL);
+                }
+            }
+        }
+        cten_csv_close(csv);
+        bool ok = size > 2 * (1 << 20) && n == 0 && n_rows == N_ROWS && n_mismatch == 0;
+        char detail[96];
+        snprintf(detail, sizeof(detail), "rows=%d mismatches=%d/" PLATFORM_NAME, n_rows, n_mismatch);
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : detail);
+    }
+
+    // Test Case 4: malformed rows are reported with their line
+    {
+        const char* tc_name = "Malformed";
+        write_file("1,2,0\n"
+                   "3,4,1\n"
+                   "5,x,1\n");
+        cten_csv* csv = cten_csv_open(TEST_FILE, ',', false, -1);
+        Tensor X = Tensor_zeros((TensorShape){8, 2}, false);
+        bool ok = csv != NULL && cten_csv_read(csv, X, NULL) == -1 && cten_csv_line(csv) == 3;
+        if(csv != NULL) cten_csv_close(csv);
+        // a missing column, and a fractional label
+        int* y;
+        write_file("1,2,0\n3,1\n");
+        ok = ok && cten_load_csv(TEST_FILE, ',', false, -1, &X, &y) == -1;
+        write_file("1,2,0.5\n");
+        ok = ok && cten_csv_open(TEST_FILE, ',', false, -1) == NULL;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "accepted/" PLATFORM_NAME);
+    }
+
+    remove(TEST_FILE);
+    cten_free(pool_id);
+}
@@ -0,0 +1,174 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <stdio.h>
+#include <string.h>
+
+// Batches assembled on the producer thread must cover the selected rows once per epoch, with matching
+// one-hot targets, and shuffling must follow the seed.
+
+#define TEST_FILE "cten_test_dataloader.ctds"
+#define N_SAMPLES 50
+#define N_FEATURES 3
+#define N_CLASSES 4
+
+// row r is {r, -r, 0.5r} with label r % 4, so each batch row tells which sample it is
+static void make_dataset() {
+    float X[N_SAMPLES * N_FEATURES];
+    int y[N_SAMPLES];
+    for(int r = 0; r < N_SAMPLES; r++) {
+        X[r * N_FEATURES + 0] = (float)r;
+        X[r * N_FEATURES + 1] = (float)-r;
+        X[r * N_FEATURES + 2] = 0.5f * r;
+        y[r] = r % N_CLASSES;
+    }
+    cten_dataset_save(TEST_FILE, X, y, N_SAMPLES, N_FEATURES, false);
+}
+
+// checks one epoch and writes the visited rows to order; false on any inconsistency
+static bool run_epoch(cten_dataloader* loader, int begin, int end, int batch_size, int* order) {
+    int seen[N_SAMPLES] = {0};
+    int n_rows = 0, n_batches = 0;
+    Tensor x, y;
+    while(cten_dataloader_next(loader, &x, &y)) {
+        int n = x.shape[0];
+        bool last = n_batches == cten_dataloader_num_batches(loader) - 1;
+        if(n != (last ? end - begin - batch_size * n_batches : batch_size)) return false;
+        if(x.shape[1] != N_FEATURES || y.shape[0] != n || y.shape[1] != N_CLASSES || x.data->numel != n * N_FEATURES) {
+            return false;
+        }
+        const int* labels = cten_dataloader_labels(loader);
+        for(int i = 0; i < n; i++) {
+            const float* row = x.data->flex + i * N_FEATURES;
+            int r = (int)row[0];
+            if(r < begin || r >= end || seen[r]++ || row[1] != -row[0] || row[2] != 0.5f * row[0]) return false;
+            if(labels[i] != r % N_CLASSES) return false;
+            for(int c = 0; c < N_CLASSES; c++) {
+                if(y.data->flex[i * N_CLASSES + c] != (c == labels[i] ? 1.0f : 0.0f)) return false;
+            }
+            order[n_rows++] = r;
+        }
+        n_batches++;
+    }
+    return n_rows == end - begin && n_batches == cten_dataloader_num_batches(loader);
+}
+
+void test_dataloader() {
+    const char* op_name = "dataloader";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+    make_dataset();
+    cten_dataset* ds = cten_dataset_open(TEST_FILE);
+
+    // Test Case 1: in order, a partial last batch, repeated epochs
+    {
+        const char* tc_name = "Sequential";
+        cten_dataloader* loader = cten_dataloader_new(ds, 5, 45, 16, 2, false);
+        int order[N_SAMPLES];
+        bool ok = cten_dataloader_num_batches(loader) == 3;
+        for(int epoch = 0; epoch < 3 && ok; epoch++) {
+            ok = run_epoch(loader, 5, 45, 16, order);
+            for(int i = 0; i < 40 && ok; i++) ok = order[i] == 5 + i;
+        }
+        cten_dataloader_free(loader);
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "batches/" PLATFORM_NAME);
+    }
+
+    // Test Case 2: shuffled epochs are permutations, differ from each other and repeat under the same seed
+    {
+        const char* tc_name = "Shuffled";
+        int first[2][N_SAMPLES], second[2][N_SAMPLES];
+        bool ok = true;
+        for(int run = 0; run < 2; run++) {
+            cten_manual_seed(7);
+            cten_dataloader* loader = cten_dataloader_new(ds, 0, N_SAMPLES, 8, 3, true);
+            ok = ok && run_epoch(loader, 0, N_SAMPLES, 8, first[run]) && run_epoch(loader, 0, N_SAMPLES, 8, second[run]);
+            cten_dataloader_free(loader);
+        }
+        bool shuffled = memcmp(first[0], second[0], sizeof(first[0])) != 0;
+        bool repeated = memcmp(first[0], first[1], sizeof(first[0])) == 0 && memcmp(second[0], second[1], sizeof(second[0])) == 0;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "batches/" PLATFORM_NAME);
+        csv_reporter_record_result(op_name, tc_name, 2, shuffled && repeated ? "/" : "order/" PLATFORM_NAME);
+    }
+
+    // Test Case 3: freeing a loader whose producer is waiting for a buffer, or that never started
+    {
+        const char* tc_name = "Free";
+        cten_dataloader* loader = cten_dataloader_new(ds, 0, N_SAMPLES, 4, 2, true);
+        Tensor x;
+        bool ok = cten_dataloader_next(loader, &x, NULL) && x.shape[0] == 4;
+        cten_dataloader_free(loader);
+        cten_dataloader_free(cten_dataloader_new(ds, 0, N_SAMPLES, 4, 2, true));
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "next/" PLATFORM_NAME);
+    }
+
+    // Test Case 4: an explicit seed fixes the order whatever the context RNG, and so does cten_manual_seed for
+    // Tensor_shuffle_indices
+    {
+        const char* tc_name = "Seed";
+        int orders[3][N_SAMPLES];
+        bool ok = true;
+        for(int run = 0; run < 3; run++) {
+            cten_manual_seed(100 + run);
+            cten_dataloader* loader = cten_dataloader_new(ds, 0, N_SAMPLES, 16, 2, true);
+            cten_dataloader_config(loader, run < 2 ? 1234 : 4321, 0);
+            ok = ok && run_epoch(loader, 0, N_SAMPLES, 16, orders[run]);
+            cten_dataloader_free(loader);
+        }
+        ok = ok && memcmp(orders[0], orders[1], sizeof(orders[0])) == 0 && memcmp(orders[0], orders[2], sizeof(orders[0])) != 0;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "loader_order/" PLATFORM_NAME);
+
+        int a[N_SAMPLES], b[N_SAMPLES];
+        for(int i = 0; i < N_SAMPLES; i++) a[i] = b[i] = i;
+        cten_manual_seed(9);
+        Tensor_shuffle_indices(a, N_SAMPLES);
+        cten_manual_seed(9);
+        Tensor_shuffle_indices(b, N_SAMPLES);
+        int sum = 0;
+        for(int i = 0; i < N_SAMPLES; i++) sum += a[i];
+        ok = memcmp(a, b, sizeof(a)) == 0 && sum == N_SAMPLES * (N_SAMPLES - 1) / 2;
+        csv_reporter_record_result(op_name, tc_name, 2, ok ? "/" : "indices/" PLATFORM_NAME);
+    }
+
+    // Test Case 5: a block shuffle keeps each block of consecutive rows together
+    {
+        const char* tc_name = "Block_shuffle";
+        enum { BLOCK = 5 };
+        cten_dataloader* loader = cten_dataloader_new(ds, 0, N_SAMPLES, 8, 3, true);
+        cten_dataloader_config(loader, 77, BLOCK);
+        int order[N_SAMPLES];
+        bool ok = true, blocks_moved = false, rows_moved = false;
+        for(int epoch = 0; epoch < 2; epoch++) {
+            ok = ok && run_epoch(loader, 0, N_SAMPLES, 8, order);
+            for(int i = 0; i < N_SAMPLES && ok; i++) {
+                int block = order[i - i % BLOCK] / BLOCK;
+                ok = order[i] / BLOCK == block;
+                blocks_moved |= block != i / BLOCK;
+                rows_moved |= order[i] % BLOCK != i % BLOCK;
+            }
+        }
+        cten_dataloader_free(loader);
+        csv_reporter_record_result(op_name, tc_name, 1, ok && blocks_moved && rows_moved ? "/" : "order/" PLATFORM_NAME);
+    }
+
+    // Test Case 6: a subset is loaded in the listed order
+    {
+        const char* tc_name = "Subset";
+        int rows[N_SAMPLES / 2];
+        for(int i = 0; i < N_SAMPLES / 2; i++) rows[i] = N_SAMPLES - 1 - 2 * i;
+        cten_dataloader* loader = cten_dataloader_new_subset(ds, rows, N_SAMPLES / 2, 10, 2, false);
+        int n_rows = 0;
+        bool ok = true;
+        Tensor x;
+        while(cten_dataloader_next(loader, &x, NULL)) {
+            for(int i = 0; i < x.shape[0]; i++, n_rows++) ok = ok && x.data->flex[i * N_FEATURES] == (float)rows[n_rows];
+        }
+        cten_dataloader_free(loader);
+        csv_reporter_record_result(op_name, tc_name, 1, ok && n_rows == N_SAMPLES / 2 ? "/" : "order/" PLATFORM_NAME);
+    }
+
+    cten_dataset_close(ds);
+    remove(TEST_FILE);
+    cten_free(pool_id);
+}
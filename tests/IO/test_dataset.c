@@ -0,0 +1,120 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// A binary dataset maps back with its rows, labels and one-hot targets intact, and batches are views into
+// the mapping rather than copies.
+
+#define TEST_FILE "cten_test_dataset.ctds"
+#define TEST_CSV "cten_test_dataset_src.csv"
+
+void test_dataset() {
+    const char* op_name = "dataset";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    enum { N_SAMPLES = 7, N_FEATURES = 3 };
+    float X[N_SAMPLES * N_FEATURES];
+    for(int i = 0; i < N_SAMPLES * N_FEATURES; i++) X[i] = (float)i / 3.0f - 2.0f;
+    int labels[N_SAMPLES] = {2, 0, 1, 4, 0, 2, 1};
+
+    // Test Case 1: rows, labels and targets survive the round trip
+    {
+        const char* tc_name = "Round_trip";
+        bool saved = cten_dataset_save(TEST_FILE, X, labels, N_SAMPLES, N_FEATURES, true);
+        cten_dataset* ds = cten_dataset_open(TEST_FILE);
+        bool ok = saved && ds != NULL && cten_dataset_num_samples(ds) == N_SAMPLES &&
+                  cten_dataset_num_features(ds) == N_FEATURES && cten_dataset_num_classes(ds) == 5;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "header/" PLATFORM_NAME);
+        if(ok) {
+            ok = memcmp(cten_dataset_labels(ds), labels, sizeof(labels)) == 0;
+            csv_reporter_record_result(op_name, tc_name, 2, ok ? "/" : "labels/" PLATFORM_NAME);
+
+            Tensor all = cten_dataset_features(ds, 0, N_SAMPLES);
+            Tensor expected = create_test_tensor((TensorShape){N_SAMPLES, N_FEATURES}, X, false);
+            compare_tensors(&all, &expected, op_name, tc_name, 3, FLT_TRUE_MIN);
+
+            float one_hot[3 * 5] = {0};
+            for(int i = 0; i < 3; i++) one_hot[i * 5 + labels[2 + i]] = 1.0f;
+            Tensor targets = cten_dataset_targets(ds, 2, 3);
+            Tensor expected_targets = create_test_tensor((TensorShape){3, 5}, one_hot, false);
+            compare_tensors(&targets, &expected_targets, op_name, tc_name, 4, FLT_TRUE_MIN);
+        }
+
+        // Test Case 2: batches alias the mapped rows
+        tc_name = "Views";
+        if(ds != NULL) {
+            Tensor all = cten_dataset_features(ds, 0, N_SAMPLES);
+            Tensor batch = cten_dataset_features(ds, 4, 2);
+            bool aliased = batch.data->flex == all.data->flex + 4 * N_FEATURES && batch.shape[0] == 2 &&
+                           batch.shape[1] == N_FEATURES && batch.data->numel == 2 * N_FEATURES &&
+                           (uintptr_t)all.data->flex % 64 == 0 && batch.node == NULL;
+            csv_reporter_record_result(op_name, tc_name, 1, aliased ? "/" : "copied/" PLATFORM_NAME);
+            cten_dataset_close(ds);
+        }
+    }
+
+    // Test Case 3: a streamed CSV conversion holds what the CSV loader reads
+    {
+        const char* tc_name = "Convert_CSV";
+        FILE* fp = fopen(TEST_CSV, "wb");
+        fputs("x0,x1,y\n", fp);
+        for(int i = 0; i < 5000; i++) fprintf(fp, "%d.5,%g,%d\n", i, i * -0.01, i % 3);
+        fclose(fp);
+        Tensor csv_X;
+        int* csv_y;
+        int n = cten_load_csv(TEST_CSV, ',', true, -1, &csv_X, &csv_y);
+        bool converted = cten_dataset_convert_csv(TEST_CSV, TEST_FILE, ',', true, -1, false);
+        cten_dataset* ds = cten_dataset_open(TEST_FILE);
+        bool ok = n == 5000 && converted && ds != NULL && cten_dataset_num_samples(ds) == n &&
+                  cten_dataset_targets(ds, 0, 1).data == NULL &&
+                  memcmp(cten_dataset_labels(ds), csv_y, sizeof(int) * n) == 0;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "convert/" PLATFORM_NAME);
+        if(ok) {
+            Tensor rows = cten_dataset_features(ds, 0, n);
+            compare_tensors(&rows, &csv_X, op_name, tc_name, 2, FLT_TRUE_MIN);
+        }
+        if(ds != NULL) cten_dataset_close(ds);
+    }
+
+    // Test Case 4: invalid input is rejected and leaves no file
+    {
+        const char* tc_name = "Invalid";
+        remove(TEST_FILE);
+        int negative[N_SAMPLES] = {0, 1, -1, 0, 0, 0, 0};
+        bool ok = !cten_dataset_save(TEST_FILE, X, negative, N_SAMPLES, N_FEATURES, false) &&
+                  cten_dataset_open(TEST_FILE) == NULL;
+
+        // a truncated file
+        cten_dataset_save(TEST_FILE, X, labels, N_SAMPLES, N_FEATURES, true);
+        FILE* fp = fopen(TEST_FILE, "rb");
+        char buf[4096];
+        size_t size = fread(buf, 1, sizeof(buf), fp);
+        fclose(fp);
+        fp = fopen(TEST_FILE, "wb");
+        fwrite(buf, 1, size - 4, fp);
+        fclose(fp);
+        ok = ok && cten_dataset_open(TEST_FILE) == NULL;
+        // a label outside [0, n_classes) in an otherwise complete file; the labels are the last section
+        int32_t patched[] = {-1, 1000};
+        for(int i = 0; i < 2; i++) {
+            memcpy(buf + size - sizeof(int32_t), &patched[i], sizeof(int32_t));
+            fp = fopen(TEST_FILE, "wb");
+            fwrite(buf, 1, size, fp);
+            fclose(fp);
+            ok = ok && cten_dataset_open(TEST_FILE) == NULL;
+        }
+        // a text file
+        ok = ok && cten_dataset_open(TEST_CSV) == NULL;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "accepted/" PLATFORM_NAME);
+    }
+
+    remove(TEST_FILE);
+    remove(TEST_CSV);
+    cten_free(pool_id);
+}
@@ -0,0 +1,158 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Streaming moments must match a two-pass reference and not depend on the thread count or on how the rows
+// are split between updates; the transform is applied by the loader and can be folded into a linear layer.
+
+#define TEST_FILE "cten_test_feature_stats.ctds"
+
+// a large offset with a small spread is where a naive sum of squares loses every digit
+static void fill_rows(float* X, int n_rows, int n_features) {
+    for(int i = 0; i < n_rows; i++) {
+        for(int j = 0; j < n_features; j++) {
+            X[i * n_features + j] = 10000.0f * j + sinf(0.37f * i + j) * (j + 1);
+        }
+    }
+}
+
+static bool moments_close(const cten_feature_stats* stats, const float* X, const int* rows, int n_rows,
+                          int n_features) {
+    double mean[8], variance[8];
+    cten_feature_stats_moments(stats, mean, variance);
+    for(int j = 0; j < n_features; j++) {
+        double sum = 0.0, sq = 0.0;
+        for(int i = 0; i < n_rows; i++) sum += X[(rows ? rows[i] : i) * n_features + j];
+        double ref_mean = sum / n_rows;
+        for(int i = 0; i < n_rows; i++) {
+            double d = X[(rows ? rows[i] : i) * n_features + j] - ref_mean;
+            sq += d * d;
+        }
+        double ref_variance = sq / n_rows;
+        if(fabs(mean[j] - ref_mean) > 1e-9 * (fabs(ref_mean) + 1.0)) return false;
+        if(fabs(variance[j] - ref_variance) > 1e-9 * ref_variance) return false;
+    }
+    return cten_feature_stats_count(stats) == n_rows;
+}
+
+void test_feature_stats() {
+    const char* op_name = "feature_stats";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    enum { N_ROWS = 20000, N_FEATURES = 5 };
+    float* X = malloc(sizeof(float) * N_ROWS * N_FEATURES);
+    fill_rows(X, N_ROWS, N_FEATURES);
+
+    // Test Case 1: one update matches the two-pass moments
+    {
+        const char* tc_name = "Moments";
+        cten_feature_stats* stats = cten_feature_stats_new(N_FEATURES);
+        cten_feature_stats_update(stats, X, NULL, N_ROWS);
+        bool ok = moments_close(stats, X, NULL, N_ROWS, N_FEATURES);
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "moments/" PLATFORM_NAME);
+    }
+
+    // Test Case 2: the worker pool gives the same bits as one thread
+    {
+        const char* tc_name = "Threads";
+        double moments[2][2][N_FEATURES];
+        for(int run = 0; run < 2; run++) {
+            cten_set_num_threads(run == 0 ? 1 : 4);
+            cten_feature_stats* stats = cten_feature_stats_new(N_FEATURES);
+            cten_feature_stats_update(stats, X, NULL, N_ROWS);
+            cten_feature_stats_moments(stats, moments[run][0], moments[run][1]);
+        }
+        cten_set_num_threads(1);
+        bool ok = memcmp(moments[0], moments[1], sizeof(moments[0])) == 0;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "threads/" PLATFORM_NAME);
+    }
+
+    // Test Case 3: merged partial updates and listed rows
+    {
+        const char* tc_name = "Merge";
+        cten_feature_stats* a = cten_feature_stats_new(N_FEATURES);
+        cten_feature_stats* b = cten_feature_stats_new(N_FEATURES);
+        cten_feature_stats_update(a, X, NULL, 300);
+        cten_feature_stats_update(a, X + 300 * N_FEATURES, NULL, 7000);
+        cten_feature_stats_update(b, X + 7300 * N_FEATURES, NULL, N_ROWS - 7300);
+        cten_feature_stats_merge(a, b);
+        bool ok = moments_close(a, X, NULL, N_ROWS, N_FEATURES);
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "merge/" PLATFORM_NAME);
+
+        int rows[999];
+        for(int i = 0; i < 999; i++) rows[i] = (i * 7919) % N_ROWS;
+        cten_feature_stats* subset = cten_feature_stats_new(N_FEATURES);
+        cten_feature_stats_update(subset, X, rows, 999);
+        ok = moments_close(subset, X, rows, 999, N_FEATURES);
+        csv_reporter_record_result(op_name, tc_name, 2, ok ? "/" : "rows/" PLATFORM_NAME);
+    }
+
+    // Test Case 4: the loader normalizes while gathering, like Tensor_normalize_dataset does on a copy
+    {
+        const char* tc_name = "Loader";
+        enum { N = 100 };
+        cten_feature_stats* stats = cten_feature_stats_new(N_FEATURES);
+        cten_feature_stats_update(stats, X, NULL, 80);
+        float* X_norm = malloc(sizeof(float) * N * N_FEATURES);
+        Tensor_normalize_dataset(X, X_norm, N, 80, N_FEATURES);
+
+        int labels[N] = {0};
+        cten_dataset_save(TEST_FILE, X, labels, N, N_FEATURES, false);
+        cten_dataset* ds = cten_dataset_open(TEST_FILE);
+        cten_dataloader* loader = cten_dataloader_new(ds, 0, N, 32, 2, false);
+        cten_dataloader_normalize(loader, stats);
+        Tensor x;
+        int first = 0, index = 1;
+        while(cten_dataloader_next(loader, &x, NULL)) {
+            Tensor expected = create_test_tensor((TensorShape){x.shape[0], N_FEATURES}, X_norm + first * N_FEATURES, false);
+            compare_tensors(&x, &expected, op_name, tc_name, index++, FLT_TRUE_MIN);
+            first += x.shape[0];
+        }
+        cten_dataloader_free(loader);
+        cten_dataset_close(ds);
+        remove(TEST_FILE);
+
+        // the training rows come out standardized
+        bool ok = first == N;
+        for(int j = 0; j < N_FEATURES; j++) {
+            double sum = 0.0, sq = 0.0;
+            for(int i = 0; i < 80; i++) sum += X_norm[i * N_FEATURES + j];
+            for(int i = 0; i < 80; i++) sq += X_norm[i * N_FEATURES + j] * X_norm[i * N_FEATURES + j];
+            ok = ok && fabs(sum / 80) < 1e-3 && fabs(sq / 80 - 1.0) < 1e-3;
+        }
+        csv_reporter_record_result(op_name, tc_name, index, ok ? "/" : "standardized/" PLATFORM_NAME);
+        free(X_norm);
+    }
+
+    // Test Case 5: a folded layer on raw rows equals the layer on normalized rows
+    {
+        const char* tc_name = "Fold";
+        enum { N = 16, N_OUT = 3 };
+        // offsets comparable to the spread: folding moves the centering into the bias, in float
+        float raw[N * N_FEATURES], shift[N_FEATURES], scale[N_FEATURES], normalized[N * N_FEATURES];
+        for(int i = 0; i < N * N_FEATURES; i++) raw[i] = (float)(i % N_FEATURES) + sinf((float)i) * (i % 3 + 1);
+        cten_feature_stats* stats = cten_feature_stats_new(N_FEATURES);
+        cten_feature_stats_update(stats, raw, NULL, N);
+        cten_feature_stats_transform(stats, shift, scale);
+        for(int i = 0; i < N * N_FEATURES; i++) normalized[i] = (raw[i] - shift[i % N_FEATURES]) * scale[i % N_FEATURES];
+        float w[N_FEATURES * N_OUT], b[N_OUT] = {0.5f, -1.0f, 0.25f};
+        for(int i = 0; i < N_FEATURES * N_OUT; i++) w[i] = (float)(i % 7) * 0.3f - 0.9f;
+
+        Tensor weight = create_test_tensor((TensorShape){N_FEATURES, N_OUT}, w, false);
+        Tensor bias = create_test_tensor((TensorShape){1, N_OUT}, b, false);
+        Tensor expected = nn_linear(create_test_tensor((TensorShape){N, N_FEATURES}, normalized, false), weight, bias);
+        cten_feature_stats_fold(stats, weight, bias);
+        Tensor folded = nn_linear(create_test_tensor((TensorShape){N, N_FEATURES}, raw, false), weight, bias);
+        compare_tensors(&folded, &expected, op_name, tc_name, 1, 1e-4f);
+    }
+
+    free(X);
+    cten_free(pool_id);
+}
@@ -0,0 +1,202 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// .npy files written here must carry the exact header NumPy writes, and .npy/.npz files laid out the way NumPy
+// lays them out must map back as tensors.
+
+#define TEST_NPY "cten_test_array.npy"
+#define TEST_NPZ "cten_test_arrays.npz"
+
+// writes little-endian fields, one per digit of layout giving its size in bytes; 8-byte fields are uint64_t
+static void put_fields(FILE* fp, const char* layout, ...) {
+    va_list args;
+    va_start(args, layout);
+    for(const char* f = layout; *f; f++) {
+        uint64_t v = *f == '8' ? va_arg(args, uint64_t) : va_arg(args, unsigned);
+        fwrite(&v, *f - '0', 1, fp);
+    }
+    va_end(args);
+}
+
+// an .npy image with the given header dict, padded as NumPy pads it; returns its size
+static size_t make_npy(char* buf, const char* dict, const void* data, size_t nbytes) {
+    size_t n = strlen(dict);
+    size_t padded = (10 + n + 1 + 63) / 64 * 64 - 10;
+    memcpy(buf, "\x93NUMPY\x01\x00", 8);
+    uint16_t header_len = (uint16_t)padded;
+    memcpy(buf + 8, &header_len, 2);
+    memcpy(buf + 10, dict, n);
+    memset(buf + 10 + n, ' ', padded - n - 1);
+    buf[10 + padded - 1] = '\n';
+    memcpy(buf + 10 + padded, data, nbytes);
+    return 10 + padded + nbytes;
+}
+
+// a zip archive of stored members, like np.savez: each local header carries a zip64 extra field that the
+// central directory does not, so the data offset can only be taken from the local header
+static void make_npz(const char* path, int n, const char* const* names, char* const* images, const size_t* sizes,
+                     unsigned method) {
+    FILE* fp = fopen(path, "wb");
+    unsigned offsets[4];
+    for(int i = 0; i < n; i++) {
+        offsets[i] = (unsigned)ftell(fp);
+        unsigned size = (unsigned)sizes[i], name_len = (unsigned)strlen(names[i]);
+        put_fields(fp, "42222244422", 0x04034b50, 45, 0, method, 0, 0, 0, size, size, name_len, 20);
+        fwrite(names[i], 1, name_len, fp);
+        put_fields(fp, "2288", 0x0001, 16, (uint64_t)size, (uint64_t)size);
+        fwrite(images[i], 1, sizes[i], fp);
+    }
+    unsigned directory = (unsigned)ftell(fp);
+    for(int i = 0; i < n; i++) {
+        unsigned size = (unsigned)sizes[i], name_len = (unsigned)strlen(names[i]);
+        put_fields(fp, "4222222444222224", 0x02014b50, 45, 45, 0, method, 0, 0, 0, size, size, name_len, 0, 0, 0, 0,
+                   0);
+        put_fields(fp, "4", offsets[i]);
+        fwrite(names[i], 1, name_len, fp);
+    }
+    unsigned directory_size = (unsigned)ftell(fp) - directory;
+    put_fields(fp, "42222442", 0x06054b50, 0, 0, n, n, directory_size, directory, 0);
+    fclose(fp);
+}
+
+static void write_file(const char* path, const char* data, size_t size) {
+    FILE* fp = fopen(path, "wb");
+    fwrite(data, 1, size, fp);
+    fclose(fp);
+}
+
+void test_npy() {
+    const char* op_name = "npy";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    float values[12];
+    for(int i = 0; i < 12; i++) values[i] = (float)i * 0.25f - 1.0f;
+
+    // Test Case 1: saved files carry NumPy's header and map back in place
+    {
+        const char* tc_name = "Round_trip";
+        Tensor t = create_test_tensor((TensorShape){3, 4}, values, false);
+        bool saved = cten_save_npy(TEST_NPY, t);
+        char buf[256];
+        FILE* fp = fopen(TEST_NPY, "rb");
+        size_t size = fp != NULL ? fread(buf, 1, sizeof(buf), fp) : 0;
+        if(fp != NULL) fclose(fp);
+        const char* dict = "{'descr': '<f4', 'fortran_order': False, 'shape': (3, 4), }";
+        bool ok = saved && size == 128 + sizeof(values) && memcmp(buf, "\x93NUMPY\x01\x00\x76\x00", 10) == 0 &&
+                  memcmp(buf + 10, dict, strlen(dict)) == 0 && buf[127] == '\n';
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "header/" PLATFORM_NAME);
+
+        cten_file* file = cten_load_npy(TEST_NPY);
+        Tensor loaded = file != NULL ? cten_file_get(file, "arr_0") : (Tensor){0};
+        ok = loaded.data != NULL && (uintptr_t)loaded.data->flex % 64 == 0;
+        csv_reporter_record_result(op_name, tc_name, 2, ok ? "/" : "mapped/" PLATFORM_NAME);
+        if(ok) compare_tensors(&loaded, &t, op_name, tc_name, 3, FLT_TRUE_MIN);
+        if(file != NULL) cten_file_close(file);
+
+        // a vector is written as (12,) and a scalar as ()
+        Tensor v = create_test_tensor((TensorShape){12}, values, false);
+        cten_save_npy(TEST_NPY, v);
+        file = cten_load_npy(TEST_NPY);
+        ok = file != NULL && cten_file_tensor(file, 0).shape[0] == 12 && cten_file_tensor(file, 0).shape[1] == 0;
+        if(file != NULL) cten_file_close(file);
+        Tensor s = create_test_tensor((TensorShape){0}, values, false);
+        cten_save_npy(TEST_NPY, s);
+        file = cten_load_npy(TEST_NPY);
+        ok = ok && file != NULL && cten_file_tensor(file, 0).shape[0] == 0 &&
+             cten_file_tensor(file, 0).data->numel == 1 && cten_file_tensor(file, 0).data->flex[0] == values[0];
+        if(file != NULL) cten_file_close(file);
+        csv_reporter_record_result(op_name, tc_name, 4, ok ? "/" : "shapes/" PLATFORM_NAME);
+    }
+
+    // Test Case 2: an archive of stored members, one of them misaligned by its name
+    {
+        const char* tc_name = "Npz";
+        static char weight[256], bias[256], mask[256];
+        uint8_t bytes[3] = {1, 0, 1};
+        const char* names[] = {"weight.npy", "b.npy", "mask.npy"};
+        char* images[] = {weight, bias, mask};
+        size_t sizes[] = {
+            make_npy(weight, "{'descr': '<f4', 'fortran_order': False, 'shape': (2, 3), }", values, 6 * sizeof(float)),
+            make_npy(bias, "{'descr': '<f4', 'fortran_order': False, 'shape': (3,), }", values + 6, 3 * sizeof(float)),
+            make_npy(mask, "{'descr': '|u1', 'fortran_order': False, 'shape': (3,), }", bytes, 3),
+        };
+        make_npz(TEST_NPZ, 3, names, images, sizes, 0);
+        cten_file* file = cten_load_npz(TEST_NPZ);
+        bool ok = file != NULL && cten_file_num_tensors(file) == 3 && strcmp(cten_file_name(file, 1), "b") == 0;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "open/" PLATFORM_NAME);
+        if(ok) {
+            Tensor w = cten_file_get(file, "weight");
+            Tensor b = cten_file_get(file, "b");
+            Tensor expected_w = create_test_tensor((TensorShape){2, 3}, values, false);
+            Tensor expected_b = create_test_tensor((TensorShape){3}, values + 6, false);
+            compare_tensors(&w, &expected_w, op_name, tc_name, 2, FLT_TRUE_MIN);
+            compare_tensors(&b, &expected_b, op_name, tc_name, 3, FLT_TRUE_MIN);
+            size_t n;
+            const uint8_t* m = cten_file_bytes(file, "mask", &n);
+            ok = m != NULL && n == 3 && memcmp(m, bytes, 3) == 0;
+            csv_reporter_record_result(op_name, tc_name, 4, ok ? "/" : "bytes/" PLATFORM_NAME);
+        }
+        if(file != NULL) cten_file_close(file);
+    }
+
+    // Test Case 3: a version 2 header is read like a version 1 header
+    {
+        const char* tc_name = "Version_2";
+        char buf[256];
+        size_t size = make_npy(buf + 2, "{'descr': '<f4', 'fortran_order': False, 'shape': (4, 3), }", values, sizeof(values));
+        uint16_t header_len;
+        memcpy(&header_len, buf + 10, 2);
+        memcpy(buf, "\x93NUMPY\x02\x00", 8);
+        uint32_t header_len32 = header_len;
+        memcpy(buf + 8, &header_len32, 4);
+        write_file(TEST_NPY, buf, size + 2);
+        cten_file* file = cten_load_npy(TEST_NPY);
+        bool ok = file != NULL;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "open/" PLATFORM_NAME);
+        if(ok) {
+            Tensor t = cten_file_tensor(file, 0);
+            Tensor expected = create_test_tensor((TensorShape){4, 3}, values, false);
+            compare_tensors(&t, &expected, op_name, tc_name, 2, FLT_TRUE_MIN);
+            cten_file_close(file);
+        }
+    }
+
+    // Test Case 4: what cannot be viewed as a float tensor is rejected
+    {
+        const char* tc_name = "Invalid";
+        const char* dicts[] = {
+            "{'descr': '<f8', 'fortran_order': False, 'shape': (3,), }",
+            "{'descr': '>f4', 'fortran_order': False, 'shape': (3,), }",
+            "{'descr': '<f4', 'fortran_order': True, 'shape': (3, 2), }",
+            "{'descr': '<f4', 'fortran_order': False, 'shape': (2, 0), }",
+            "{'descr': '<f4', 'fortran_order': False, 'shape': (1, 1, 1, 1, 1), }",
+            "{'descr': '<f4', 'fortran_order': False, 'shape': (4, 4), }",  // truncated data
+        };
+        bool ok = true;
+        char buf[256];
+        for(int i = 0; i < (int)(sizeof(dicts) / sizeof(dicts[0])); i++) {
+            write_file(TEST_NPY, buf, make_npy(buf, dicts[i], values, sizeof(values)));
+            cten_file* file = cten_load_npy(TEST_NPY);
+            ok = ok && file == NULL;
+        }
+        // a deflated member
+        size_t size = make_npy(buf, "{'descr': '<f4', 'fortran_order': False, 'shape': (3,), }", values, 12);
+        const char* names[] = {"x.npy"};
+        char* images[] = {buf};
+        make_npz(TEST_NPZ, 1, names, images, &size, 8);
+        ok = ok && cten_load_npz(TEST_NPZ) == NULL && cten_load_npz(TEST_NPY) == NULL;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "accepted/" PLATFORM_NAME);
+    }
+
+    remove(TEST_NPY);
+    remove(TEST_NPZ);
+    cten_free(pool_id);
+}
@@ -0,0 +1,99 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Tensors written by cten_save come back from cten_load with their names, shapes and exact values, as
+// aligned views into the mapped file.
+
+#define TEST_FILE "cten_test_save_load.cten"
+
+void test_save_load() {
+    const char* op_name = "save_load";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    float w_data[6] = {0.5f, -1.0f, 2.0f, 0.25f, -0.75f, 1.5f};
+    float b_data[3] = {0.1f, -0.2f, FLT_TRUE_MIN};
+    float k_data[2 * 1 * 3 * 2];
+    for(int i = 0; i < 12; i++) k_data[i] = (float)i / 7.0f;
+    Tensor tensors[3] = {
+        create_test_tensor((TensorShape){2, 3}, w_data, true),
+        create_test_tensor((TensorShape){3}, b_data, false),
+        create_test_tensor((TensorShape){2, 1, 3, 2}, k_data, false),
+    };
+    const char* names[3] = {"layer.weight", "layer.bias", "conv.kernel"};
+
+    // Test Case 1: round trip
+    {
+        const char* tc_name = "Round_trip";
+        bool saved = cten_save(TEST_FILE, 3, names, tensors);
+        cten_file* file = cten_load(TEST_FILE);
+        if(!saved || file == NULL || cten_file_num_tensors(file) != 3) {
+            csv_reporter_record_result(op_name, tc_name, 1, "save_or_load_failed/" PLATFORM_NAME);
+        } else {
+            for(int i = 0; i < 3; i++) {
+                Tensor loaded = cten_file_get(file, names[i]);
+                bool ok = loaded.data != NULL && strcmp(cten_file_name(file, i), names[i]) == 0 &&
+                          memcmp(loaded.shape, tensors[i].shape, sizeof(TensorShape)) == 0 &&
+                          (uintptr_t)loaded.data->flex % 64 == 0 && loaded.node == NULL;
+                csv_reporter_record_result(op_name, tc_name, i * 2 + 1, ok ? "/" : "entry/" PLATFORM_NAME);
+                compare_tensors(&loaded, &tensors[i], op_name, tc_name, i * 2 + 2, FLT_TRUE_MIN);
+            }
+            bool missing = cten_file_get(file, "layer.missing").data == NULL;
+            csv_reporter_record_result(op_name, tc_name, 7, missing ? "/" : "missing_name/" PLATFORM_NAME);
+            cten_file_close(file);
+        }
+    }
+
+    // Test Case 2: files that are not complete cten files are rejected
+    {
+        const char* tc_name = "Invalid";
+        bool ok = cten_load("cten_test_does_not_exist.cten") == NULL;
+
+        // drop the last payload's final bytes
+        cten_save(TEST_FILE, 3, names, tensors);
+        FILE* fp = fopen(TEST_FILE, "rb");
+        char buf[4096];
+        size_t n = fread(buf, 1, sizeof(buf), fp);
+        fclose(fp);
+        fp = fopen(TEST_FILE, "wb");
+        fwrite(buf, 1, n - 4, fp);
+        fclose(fp);
+        ok = ok && cten_load(TEST_FILE) == NULL;
+
+        // a file from an older version of the format
+        cten_save(TEST_FILE, 3, names, tensors);
+        fp = fopen(TEST_FILE, "r+b");
+        uint32_t version = 1;
+        fseek(fp, 8, SEEK_SET);
+        fwrite(&version, sizeof(version), 1, fp);
+        fclose(fp);
+        ok = ok && cten_load(TEST_FILE) == NULL;
+
+        fp = fopen(TEST_FILE, "wb");
+        fputs("not a tensor file, just some text", fp);
+        fclose(fp);
+        ok = ok && cten_load(TEST_FILE) == NULL;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "accepted_invalid/" PLATFORM_NAME);
+    }
+
+    // Test Case 3: saving needs no active pool
+    {
+        const char* tc_name = "No_pool";
+        cten_end_malloc();
+        bool saved = cten_save(TEST_FILE, 3, names, tensors);
+        cten_begin_malloc(pool_id);
+        cten_file* file = cten_load(TEST_FILE);
+        bool ok = saved && file != NULL && cten_file_num_tensors(file) == 3;
+        csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : "save_failed/" PLATFORM_NAME);
+        if(file != NULL) cten_file_close(file);
+    }
+
+    remove(TEST_FILE);
+    cten_free(pool_id);
+}
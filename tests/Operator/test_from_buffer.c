@@ -0,0 +1,142 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+// Every operator must give the same result on a view of caller memory as on a pool tensor holding the same
+// values, and must leave the caller's buffer untouched.
+
+typedef Tensor (*UnaryOp)(Tensor);
+typedef Tensor (*BinaryOp)(Tensor, Tensor);
+
+static Tensor softmax_dim1(Tensor x) { return nn_softmax(x, 1); }
+static Tensor elu_1(Tensor x) { return nn_elu(x, 1.0f); }
+static Tensor sum_dim1(Tensor x) { return Tensor_sum_dim(x, 1); }
+static Tensor mean_dim0(Tensor x) { return Tensor_mean_dim(x, 0); }
+static Tensor max_dim1(Tensor x) { return Tensor_max_dim(x, 1).values; }
+static Tensor min_dim0(Tensor x) { return Tensor_min_dim(x, 0).values; }
+static Tensor mulf_3(Tensor x) { return Tensor_mulf(x, 3.0f); }
+static Tensor unsqueeze_0(Tensor x) { return Tensor_unsqueeze(x, 0); }
+static Tensor matmul_t(Tensor a, Tensor b) { return Tensor_matmul(a, Tensor_transpose(b)); }
+static Tensor huber_1(Tensor a, Tensor b) { return nn_huber_loss(a, b, 1.0f); }
+static Tensor crossentropy(Tensor a, Tensor b) { return nn_crossentropy(softmax_dim1(a), softmax_dim1(b)); }
+
+static int n_released;
+static float* last_released;
+
+static void count_release(float* data) {
+    n_released++;
+    last_released = data;
+}
+
+void test_from_buffer_operator() {
+    const char* op_name = "from_buffer";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    // positive, so log, pow and reciprocal are defined
+    float a[6] = {0.5f, 1.25f, 2.0f, 3.0f, 0.75f, 1.5f};
+    float b[6] = {1.5f, 0.25f, 2.5f, 1.0f, 2.0f, 0.5f};
+    float a_copy[6], b_copy[6];
+    memcpy(a_copy, a, sizeof(a));
+    memcpy(b_copy, b, sizeof(b));
+    TensorShape shape = {2, 3};
+    Tensor va = Tensor_from_buffer(shape, a, NULL);
+    Tensor vb = Tensor_from_buffer(shape, b, NULL);
+    Tensor pa = create_test_tensor(shape, a, false);
+    Tensor pb = create_test_tensor(shape, b, false);
+
+    // Test Case 1: unary operators and reductions
+    {
+        const char* tc_name = "Unary";
+        UnaryOp ops[] = {Tensor_abs,     Tensor_square,  Tensor_reciprocal, Tensor_transpose, nn_log,       nn_exp,
+                         nn_sin,         nn_cos,         nn_tan,            nn_relu,          nn_sigmoid,   nn_tanh,
+                         nn_selu,        elu_1,          softmax_dim1,      Tensor_sum_all,   Tensor_mean_all,
+                         Tensor_max_all, Tensor_min_all, sum_dim1,          mean_dim0,        max_dim1,     min_dim0,
+                         mulf_3,         unsqueeze_0};
+        for(int i = 0; i < (int)(sizeof(ops) / sizeof(ops[0])); i++) {
+            Tensor observed = ops[i](va);
+            Tensor expected = ops[i](pa);
+            compare_tensors(&observed, &expected, op_name, tc_name, i + 1, FLT_TRUE_MIN);
+        }
+        int observed[2], expected[2];
+        Tensor_argmax(va, observed);
+        Tensor_argmax(pa, expected);
+        bool ok = memcmp(observed, expected, sizeof(observed)) == 0;
+        csv_reporter_record_result(op_name, tc_name, (int)(sizeof(ops) / sizeof(ops[0])) + 1, ok ? "/" : "argmax/" PLATFORM_NAME);
+    }
+
+    // Test Case 2: binary operators and losses, with views on either side and broadcast against a row
+    {
+        const char* tc_name = "Binary";
+        BinaryOp ops[] = {Tensor_add, Tensor_sub,  Tensor_mul,  Tensor_div,  Tensor_pow,
+                          matmul_t,   nn_mse_loss, nn_mae_loss, huber_1,     crossentropy};
+        int n_ops = (int)(sizeof(ops) / sizeof(ops[0]));
+        for(int i = 0; i < n_ops; i++) {
+            Tensor observed = ops[i](va, vb);
+            Tensor expected = ops[i](pa, pb);
+            compare_tensors(&observed, &expected, op_name, tc_name, 2 * i + 1, FLT_TRUE_MIN);
+            observed = ops[i](pa, vb);
+            compare_tensors(&observed, &expected, op_name, tc_name, 2 * i + 2, FLT_TRUE_MIN);
+        }
+        Tensor row = Tensor_from_buffer((TensorShape){1, 3}, b, NULL);
+        Tensor observed = Tensor_add(va, row);
+        Tensor expected = Tensor_add(pa, create_test_tensor((TensorShape){1, 3}, b, false));
+        compare_tensors(&observed, &expected, op_name, tc_name, 2 * n_ops + 1, FLT_TRUE_MIN);
+        Tensor_release(row);
+    }
+
+    // Test Case 3: a view as the input of a trained layer, forward and backward
+    {
+        const char* tc_name = "Backward";
+        float w[6] = {0.1f, -0.2f, 0.3f, 0.4f, -0.5f, 0.6f};
+        Tensor grads[2];
+        for(int run = 0; run < 2; run++) {
+            Tensor weight = create_test_tensor((TensorShape){3, 2}, w, true);
+            Tensor bias = Tensor_zeros((TensorShape){1, 2}, true);
+            Tensor logit = nn_linear(run == 0 ? va : pa, weight, bias);
+            Tensor y_true = Tensor_from_buffer((TensorShape){2, 2}, (float[]){1, 0, 0, 1}, NULL);
+            Tensor loss = nn_softmax_crossentropy(y_true, logit);
+            Tensor_backward(loss, Tensor_ones((TensorShape){1}, false));
+            grads[run] = weight.node->grad;
+            Tensor_release(y_true);
+        }
+        compare_tensors(&grads[0], &grads[1], op_name, tc_name, 1, FLT_TRUE_MIN);
+    }
+
+    bool untouched = memcmp(a, a_copy, sizeof(a)) == 0 && memcmp(b, b_copy, sizeof(b)) == 0;
+    csv_reporter_record_result(op_name, "Untouched", 1, untouched ? "/" : "written/" PLATFORM_NAME);
+
+    // Test Case 4: a captured graph reads whatever buffer its input view is bound to
+    {
+        const char* tc_name = "Rebind";
+        static float requests[3][6];
+        for(int r = 0; r < 3; r++) {
+            for(int i = 0; i < 6; i++) requests[r][i] = a[i] * (r + 1) - b[i];
+        }
+        Tensor input = Tensor_from_buffer(shape, requests[0], count_release);
+        PoolId graph_pool_id = 1;
+        cten_graph_capture_begin(graph_pool_id);
+        Tensor out = nn_softmax(Tensor_matmul(input, Tensor_transpose(pb)), 1);
+        cten_graph* graph = cten_graph_capture_end(out);
+        for(int r = 0; r < 3; r++) {
+            Tensor_rebind(input, requests[r]);
+            cten_graph_replay(graph);
+            Tensor expected = nn_softmax(Tensor_matmul(create_test_tensor(shape, requests[r], false), Tensor_transpose(pb)), 1);
+            compare_tensors(&out, &expected, op_name, tc_name, r + 1, FLT_TRUE_MIN);
+        }
+        cten_free(graph_pool_id);
+        // rebinding releases the buffer it replaces, and release the last one
+        bool ok = n_released == 2 && last_released == requests[1];
+        Tensor_release(input);
+        ok = ok && n_released == 3 && last_released == requests[2];
+        csv_reporter_record_result(op_name, tc_name, 4, ok ? "/" : "release/" PLATFORM_NAME);
+    }
+
+    Tensor_release(va);
+    Tensor_release(vb);
+    cten_free(pool_id);
+}
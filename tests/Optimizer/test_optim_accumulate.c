@@ -0,0 +1,87 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Accumulating over micro-batches must give the gradients, and so the step, of one full batch.
+
+#define N_SAMPLES 10
+#define N_IN 3
+#define N_OUT 2
+#define SCRATCH_POOL 5
+
+static float X_data[N_SAMPLES * N_IN];
+static float Y_data[N_SAMPLES * N_OUT];
+static float w_init[N_IN * N_OUT] = {0.3f, -0.2f, 0.5f, 0.1f, -0.4f, 0.25f};
+static float b_init[N_OUT] = {0.05f, -0.1f};
+
+typedef struct {
+    Tensor w, b;
+    Tensor params[2];
+} AccumModel;
+
+static void AccumModel_init(AccumModel* self) {
+    self->w = create_test_tensor((TensorShape){N_IN, N_OUT}, w_init, true);
+    self->b = create_test_tensor((TensorShape){1, N_OUT}, b_init, true);
+    self->params[0] = self->w;
+    self->params[1] = self->b;
+}
+
+static Tensor AccumModel_loss(void* ctx, int begin, int end) {
+    AccumModel* self = ctx;
+    Tensor x = create_test_tensor((TensorShape){end - begin, N_IN}, X_data + begin * N_IN, false);
+    Tensor y = create_test_tensor((TensorShape){end - begin, N_OUT}, Y_data + begin * N_OUT, false);
+    return nn_mse_loss(y, nn_linear(x, self->w, self->b));
+}
+
+void test_optim_accumulate() {
+    const char* op_name = "optim_accumulate";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+    for(int i = 0; i < N_SAMPLES * N_IN; i++) X_data[i] = sinf(0.9f * i + 0.1f);
+    for(int i = 0; i < N_SAMPLES * N_OUT; i++) Y_data[i] = cosf(0.4f * i);
+
+    // Test Case 1: plain parameters, the last micro-batch is smaller than the others
+    {
+        const char* tc_name = "Gradients";
+        AccumModel micro, full;
+        AccumModel_init(&micro);
+        AccumModel_init(&full);
+        float loss = cten_accumulate_grad(micro.params, 2, SCRATCH_POOL, N_SAMPLES, 4, AccumModel_loss, &micro);
+        Tensor full_loss = AccumModel_loss(&full, 0, N_SAMPLES);
+        Tensor_backward(full_loss, (Tensor){0});
+
+        compare_tensors(&micro.w.node->grad, &full.w.node->grad, op_name, tc_name, 1, TEST_FLOAT_TOLERANCE);
+        compare_tensors(&micro.b.node->grad, &full.b.node->grad, op_name, tc_name, 2, TEST_FLOAT_TOLERANCE);
+        Tensor obs_loss = create_test_tensor((TensorShape){1}, &loss, false);
+        compare_tensors(&obs_loss, &full_loss, op_name, tc_name, 3, TEST_FLOAT_TOLERANCE);
+    }
+
+    // Test Case 2: SGD with momentum, two accumulated steps against two full-batch steps
+    {
+        const char* tc_name = "SGD_step";
+        AccumModel micro, full;
+        AccumModel_init(&micro);
+        AccumModel_init(&full);
+        optim_sgd* opt_micro = optim_sgd_new(2, micro.params, 0.01f);
+        optim_sgd* opt_full = optim_sgd_new(2, full.params, 0.01f);
+        optim_sgd_config(opt_micro, 0.1f, 0.9f);
+        optim_sgd_config(opt_full, 0.1f, 0.9f);
+        for(int k = 0; k < 2; k++) {
+            optim_sgd_zerograd(opt_micro);
+            cten_accumulate_grad(micro.params, 2, SCRATCH_POOL, N_SAMPLES, 3, AccumModel_loss, &micro);
+            optim_sgd_step(opt_micro);
+
+            optim_sgd_zerograd(opt_full);
+            Tensor_backward(AccumModel_loss(&full, 0, N_SAMPLES), (Tensor){0});
+            optim_sgd_step(opt_full);
+        }
+        compare_tensors(&micro.w, &full.w, op_name, tc_name, 1, TEST_FLOAT_TOLERANCE);
+        compare_tensors(&micro.b, &full.b, op_name, tc_name, 2, TEST_FLOAT_TOLERANCE);
+    }
+
+    cten_free(pool_id);
+}
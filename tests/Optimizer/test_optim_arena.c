@@ -0,0 +1,235 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define N_W 6
+#define N_B 3
+
+static float w_init[N_W] = {0.5f, -1.0f, 2.0f, 0.25f, -0.75f, 1.5f};
+static float b_init[N_B] = {0.1f, -0.2f, 0.3f};
+static float grads[2][N_W + N_B] = {
+    {0.2f, -0.4f, 0.6f, 0.1f, -0.3f, 0.8f, 0.05f, -0.15f, 0.25f},
+    {-0.1f, 0.3f, 0.2f, -0.5f, 0.4f, 0.1f, 0.2f, 0.1f, -0.3f},
+};
+
+// writes step `k`'s gradients through the per-parameter views the optimizer installed
+static void set_grads(Tensor w, Tensor b, int k) {
+    memcpy(w.node->grad.data->flex, grads[k], sizeof(float) * N_W);
+    memcpy(b.node->grad.data->flex, grads[k] + N_W, sizeof(float) * N_B);
+}
+
+static void compare_params(Tensor w, Tensor b, const float* expected, const char* op_name, const char* tc_name, int idx) {
+    Tensor exp_w = create_test_tensor((TensorShape){2, 3}, (float*)expected, false);
+    Tensor exp_b = create_test_tensor((TensorShape){N_B}, (float*)expected + N_W, false);
+    compare_tensors(&w, &exp_w, op_name, tc_name, idx, TEST_FLOAT_TOLERANCE);
+    compare_tensors(&b, &exp_b, op_name, tc_name, idx + 1, TEST_FLOAT_TOLERANCE);
+}
+
+void test_optim_arena() {
+    const char* op_name = "optim_arena";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    // Test Case 1: backward accumulates into the arena views, zerograd clears them
+    {
+        const char* tc_name = "Grad_views";
+        Tensor w = create_test_tensor((TensorShape){2, 3}, w_init, true);
+        Tensor b = create_test_tensor((TensorShape){N_B}, b_init, true);
+        Tensor params[] = {w, b};
+        optim_sgd* opt = optim_sgd_new(2, params, 0.0f);
+        FloatBuffer* w_grad = w.node->grad.data;
+
+        Tensor_backward(Tensor_sum(Tensor_square(w)), (Tensor){0});
+        Tensor_backward(Tensor_sum(Tensor_square(w)), (Tensor){0});
+        float expected[N_W];
+        for(int i = 0; i < N_W; i++) expected[i] = 4.0f * w_init[i];
+        Tensor exp_grad = create_test_tensor((TensorShape){2, 3}, expected, false);
+        compare_tensors(&w.node->grad, &exp_grad, op_name, tc_name, 1, TEST_FLOAT_TOLERANCE);
+        csv_reporter_record_result(op_name, tc_name, 2, w.node->grad.data == w_grad ? "/" : "grad_buffer_replaced/arena_view/" PLATFORM_NAME);
+
+        optim_sgd_zerograd(opt);
+        Tensor zeros = Tensor_zeros((TensorShape){2, 3}, false);
+        compare_tensors(&w.node->grad, &zeros, op_name, tc_name, 3, TEST_FLOAT_TOLERANCE);
+        csv_reporter_record_result(op_name, tc_name, 4, w.node->grad.data == w_grad ? "/" : "zerograd_reallocated/arena_view/" PLATFORM_NAME);
+    }
+
+    // Test Case 2: gradients live in the parameters' pool, not in the optimizer's or the step's
+    {
+        const char* tc_name = "Grad_pool";
+        Tensor w = create_test_tensor((TensorShape){2, 3}, w_init, true);
+        Tensor b = create_test_tensor((TensorShape){N_B}, b_init, true);
+        Tensor params[] = {w, b};
+        cten_begin_malloc(pool_id + 1);
+        optim_sgd_new(2, params, 0.0f);
+        cten_end_malloc();
+
+        cten_begin_malloc(pool_id + 2);
+        Tensor_backward(Tensor_sum(Tensor_square(w)), (Tensor){0});
+        cten_end_malloc();
+        cten_free(pool_id + 2);
+        cten_free(pool_id + 1);
+
+        float expected[N_W];
+        for(int i = 0; i < N_W; i++) expected[i] = 2.0f * w_init[i];
+        Tensor exp_grad = create_test_tensor((TensorShape){2, 3}, expected, false);
+        compare_tensors(&w.node->grad, &exp_grad, op_name, tc_name, 1, TEST_FLOAT_TOLERANCE);
+    }
+
+    // Test Case 3: SGD with momentum and weight decay
+    {
+        const char* tc_name = "SGD_momentum";
+        Tensor w = create_test_tensor((TensorShape){2, 3}, w_init, true);
+        Tensor b = create_test_tensor((TensorShape){N_B}, b_init, true);
+        Tensor params[] = {w, b};
+        optim_sgd* opt = optim_sgd_new(2, params, 0.01f);
+        optim_sgd_config(opt, 0.1f, 0.9f);
+
+        float p[N_W + N_B], vel[N_W + N_B] = {0};
+        memcpy(p, w_init, sizeof(w_init));
+        memcpy(p + N_W, b_init, sizeof(b_init));
+        for(int k = 0; k < 2; k++) {
+            optim_sgd_zerograd(opt);
+            set_grads(w, b, k);
+            optim_sgd_step(opt);
+            for(int j = 0; j < N_W + N_B; j++) {
+                float g = grads[k][j] + 0.01f * p[j];
+                vel[j] = 0.9f * vel[j] + g;
+                p[j] -= 0.1f * vel[j];
+            }
+            compare_params(w, b, p, op_name, tc_name, k * 2 + 1);
+        }
+    }
+
+    // Test Case 4: Adam
+    {
+        const char* tc_name = "Adam";
+        Tensor w = create_test_tensor((TensorShape){2, 3}, w_init, true);
+        Tensor b = create_test_tensor((TensorShape){N_B}, b_init, true);
+        Tensor params[] = {w, b};
+        optim_adam* opt = optim_adam_new(2, params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.0f);
+
+        float p[N_W + N_B], m[N_W + N_B] = {0}, v[N_W + N_B] = {0};
+        memcpy(p, w_init, sizeof(w_init));
+        memcpy(p + N_W, b_init, sizeof(b_init));
+        for(int k = 0; k < 2; k++) {
+            optim_adam_zerograd(opt);
+            set_grads(w, b, k);
+            optim_adam_step(opt);
+            for(int j = 0; j < N_W + N_B; j++) {
+                float g = grads[k][j];
+                m[j] = 0.9f * m[j] + 0.1f * g;
+                v[j] = 0.999f * v[j] + 0.001f * g * g;
+                float m_hat = m[j] / (1 - powf(0.9f, k + 1));
+                float v_hat = v[j] / (1 - powf(0.999f, k + 1));
+                p[j] -= 0.01f * m_hat / (sqrtf(v_hat) + 1e-8f);
+            }
+            compare_params(w, b, p, op_name, tc_name, k * 2 + 1);
+        }
+    }
+
+    // Test Case 5: AdamW decays the parameters, not the gradient
+    {
+        const char* tc_name = "AdamW";
+        Tensor w = create_test_tensor((TensorShape){2, 3}, w_init, true);
+        Tensor b = create_test_tensor((TensorShape){N_B}, b_init, true);
+        Tensor params[] = {w, b};
+        optim_adam* opt = optim_adamw_new(2, params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.1f);
+
+        float p[N_W + N_B], m[N_W + N_B] = {0}, v[N_W + N_B] = {0};
+        memcpy(p, w_init, sizeof(w_init));
+        memcpy(p + N_W, b_init, sizeof(b_init));
+        for(int k = 0; k < 2; k++) {
+            optim_adam_zerograd(opt);
+            set_grads(w, b, k);
+            optim_adam_step(opt);
+            for(int j = 0; j < N_W + N_B; j++) {
+                float g = grads[k][j];
+                m[j] = 0.9f * m[j] + 0.1f * g;
+                v[j] = 0.999f * v[j] + 0.001f * g * g;
+                float m_hat = m[j] / (1 - powf(0.9f, k + 1));
+                float v_hat = v[j] / (1 - powf(0.999f, k + 1));
+                p[j] = p[j] * (1 - 0.01f * 0.1f) - 0.01f * m_hat / (sqrtf(v_hat) + 1e-8f);
+            }
+            compare_params(w, b, p, op_name, tc_name, k * 2 + 1);
+        }
+    }
+
+    // Test Case 6: a step split across worker threads matches the serial one exactly
+    {
+        const char* tc_name = "Adam_threads";
+        enum { N = 1000 };
+        float init[N], g[N];
+        for(int j = 0; j < N; j++) {
+            init[j] = sinf((float)j);
+            g[j] = cosf((float)j * 0.37f);
+        }
+        Tensor serial = create_test_tensor((TensorShape){N}, init, true);
+        Tensor threaded = create_test_tensor((TensorShape){N}, init, true);
+        optim_adam* opt_serial = optim_adam_new(1, &serial, 0.01f, 0.9f, 0.999f, 1e-8f, 0.01f);
+        optim_adam* opt_threaded = optim_adam_new(1, &threaded, 0.01f, 0.9f, 0.999f, 1e-8f, 0.01f);
+        for(int k = 0; k < 3; k++) {
+            memcpy(serial.node->grad.data->flex, g, sizeof(g));
+            memcpy(threaded.node->grad.data->flex, g, sizeof(g));
+            optim_adam_step(opt_serial);
+            cten_set_num_threads(4);
+            optim_adam_step(opt_threaded);
+            cten_set_num_threads(1);
+        }
+        compare_tensors(&threaded, &serial, op_name, tc_name, 1, FLT_TRUE_MIN);
+    }
+
+    // Test Case 7: RMSProp
+    {
+        const char* tc_name = "RMSProp";
+        Tensor w = create_test_tensor((TensorShape){2, 3}, w_init, true);
+        Tensor b = create_test_tensor((TensorShape){N_B}, b_init, true);
+        Tensor params[] = {w, b};
+        optim_rmsprop* opt = optim_rmsprop_new(2, params, 0.01f, 0.9f, 1e-8f, 0.0f);
+
+        float p[N_W + N_B], sq[N_W + N_B] = {0};
+        memcpy(p, w_init, sizeof(w_init));
+        memcpy(p + N_W, b_init, sizeof(b_init));
+        for(int k = 0; k < 2; k++) {
+            optim_rmsprop_zerograd(opt);
+            set_grads(w, b, k);
+            optim_rmsprop_step(opt);
+            for(int j = 0; j < N_W + N_B; j++) {
+                float g = grads[k][j];
+                sq[j] = 0.9f * sq[j] + 0.1f * g * g;
+                p[j] -= 0.01f * g / (sqrtf(sq[j]) + 1e-8f);
+            }
+            compare_params(w, b, p, op_name, tc_name, k * 2 + 1);
+        }
+    }
+
+    // Test Case 8: AdaGrad
+    {
+        const char* tc_name = "AdaGrad";
+        Tensor w = create_test_tensor((TensorShape){2, 3}, w_init, true);
+        Tensor b = create_test_tensor((TensorShape){N_B}, b_init, true);
+        Tensor params[] = {w, b};
+        optim_adagrad* opt = optim_adagrad_new(2, params, 0.1f, 1e-8f, 0.0f);
+
+        float p[N_W + N_B], sum_sq[N_W + N_B] = {0};
+        memcpy(p, w_init, sizeof(w_init));
+        memcpy(p + N_W, b_init, sizeof(b_init));
+        for(int k = 0; k < 2; k++) {
+            optim_adagrad_zerograd(opt);
+            set_grads(w, b, k);
+            optim_adagrad_step(opt);
+            for(int j = 0; j < N_W + N_B; j++) {
+                float g = grads[k][j];
+                sum_sq[j] += g * g;
+                p[j] -= 0.1f * g / (sqrtf(sum_sq[j]) + 1e-8f);
+            }
+            compare_params(w, b, p, op_name, tc_name, k * 2 + 1);
+        }
+    }
+
+    cten_free(pool_id);
+}
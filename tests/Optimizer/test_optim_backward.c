@@ -0,0 +1,175 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+// Stepping inside backward runs the same element-wise updates as optim_*_step after backward, only earlier,
+// so the parameters must match bit for bit.
+#define EXACT_TOLERANCE FLT_TRUE_MIN
+
+typedef struct {
+    Tensor w1, b1, w2, b2;
+    Tensor unused;  // never reached by backward, still stepped
+    Tensor params[5];
+} BackwardMLP;
+
+static float w1_data[] = {0.2f, -0.4f, 0.7f, 0.1f, -0.3f, 0.9f, 0.5f, -0.6f, 0.05f, 0.3f, -0.8f, 0.25f};
+static float b1_data[] = {0.05f, -0.1f, 0.2f, 0.0f};
+static float w2_data[] = {0.3f, -0.2f, -0.5f, 0.4f, 0.6f, 0.1f, -0.7f, 0.8f};
+static float b2_data[] = {0.1f, -0.05f};
+static float unused_data[] = {1.0f, -1.0f};
+
+static float x_batches[3][6] = {
+    {1.0f, -2.0f, 0.5f, 0.0f, 3.0f, -1.0f},
+    {-1.5f, 2.0f, 1.0f, 4.0f, -0.5f, 2.5f},
+    {0.3f, 0.7f, -0.9f, -2.0f, 1.2f, 0.4f},
+};
+static float y_batches[3][4] = {
+    {1.0f, 0.0f, 0.0f, 1.0f},
+    {0.0f, 1.0f, 1.0f, 0.0f},
+    {1.0f, 0.0f, 1.0f, 0.0f},
+};
+
+static void BackwardMLP_init(BackwardMLP* m) {
+    m->w1 = create_test_tensor((TensorShape){3, 4}, w1_data, true);
+    m->b1 = create_test_tensor((TensorShape){1, 4}, b1_data, true);
+    m->w2 = create_test_tensor((TensorShape){4, 2}, w2_data, true);
+    m->b2 = create_test_tensor((TensorShape){1, 2}, b2_data, true);
+    m->unused = create_test_tensor((TensorShape){2}, unused_data, true);
+    Tensor params[] = {m->w1, m->b1, m->w2, m->b2, m->unused};
+    memcpy(m->params, params, sizeof(params));
+}
+
+// h is used twice, so its gradient has two contributions before it propagates
+static Tensor BackwardMLP_loss(BackwardMLP* m, int k) {
+    Tensor x = create_test_tensor((TensorShape){2, 3}, x_batches[k], false);
+    Tensor y = create_test_tensor((TensorShape){2, 2}, y_batches[k], false);
+    Tensor h = nn_tanh(nn_linear(x, m->w1, m->b1));
+    Tensor logits = nn_linear(Tensor_add(h, Tensor_mulf(h, 0.5f)), m->w2, m->b2);
+    return nn_softmax_crossentropy(y, logits);
+}
+
+static void compare_models(BackwardMLP* a, BackwardMLP* b, const char* op_name, const char* tc_name, int base) {
+    for(int i = 0; i < 5; i++) {
+        compare_tensors(&a->params[i], &b->params[i], op_name, tc_name, base + i, EXACT_TOLERANCE);
+    }
+}
+
+void test_optim_backward() {
+    const char* op_name = "optim_backward";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    // Test Case 1: SGD with momentum and weight decay
+    {
+        const char* tc_name = "SGD_momentum";
+        BackwardMLP fused, ref;
+        BackwardMLP_init(&fused);
+        BackwardMLP_init(&ref);
+        optim_sgd* opt_fused = optim_sgd_new(5, fused.params, 0.01f);
+        optim_sgd* opt_ref = optim_sgd_new(5, ref.params, 0.01f);
+        optim_sgd_config(opt_fused, 0.1f, 0.9f);
+        optim_sgd_config(opt_ref, 0.1f, 0.9f);
+
+        optim_sgd_step_in_backward(opt_fused, true);
+        for(int k = 0; k < 3; k++) {
+            Tensor_backward(BackwardMLP_loss(&fused, k), (Tensor){0});
+        }
+        // every gradient was freed once its parameter was stepped
+        bool released = true;
+        for(int i = 0; i < 5; i++) released = released && fused.params[i].node->grad.data == NULL;
+        csv_reporter_record_result(op_name, tc_name, 6, released ? "/" : "gradient kept/" PLATFORM_NAME);
+        optim_sgd_step_in_backward(opt_fused, false);
+
+        for(int k = 0; k < 3; k++) {
+            optim_sgd_zerograd(opt_ref);
+            Tensor_backward(BackwardMLP_loss(&ref, k), (Tensor){0});
+            optim_sgd_step(opt_ref);
+        }
+        compare_models(&fused, &ref, op_name, tc_name, 1);
+    }
+
+    // Test Case 2: Adam with value clipping; the step counter advances once per backward
+    {
+        const char* tc_name = "Adam_clip_value";
+        BackwardMLP fused, ref;
+        BackwardMLP_init(&fused);
+        BackwardMLP_init(&ref);
+        optim_adam* opt_fused = optim_adam_new(5, fused.params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.01f);
+        optim_adam* opt_ref = optim_adam_new(5, ref.params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.01f);
+        optim_adam_clip_grad_value_range(opt_fused, -0.2f, 0.2f);
+        optim_adam_clip_grad_value_range(opt_ref, -0.2f, 0.2f);
+
+        optim_adam_step_in_backward(opt_fused, true);
+        for(int k = 0; k < 3; k++) {
+            Tensor_backward(BackwardMLP_loss(&fused, k), (Tensor){0});
+        }
+        optim_adam_step_in_backward(opt_fused, false);
+
+        for(int k = 0; k < 3; k++) {
+            optim_adam_zerograd(opt_ref);
+            Tensor_backward(BackwardMLP_loss(&ref, k), (Tensor){0});
+            optim_adam_step(opt_ref);
+        }
+        compare_models(&fused, &ref, op_name, tc_name, 1);
+
+        // once disabled, backward only accumulates again
+        Tensor before = Tensor_detach(fused.w1);
+        float w1_before[12];
+        memcpy(w1_before, before.data->flex, sizeof(w1_before));
+        Tensor_backward(BackwardMLP_loss(&fused, 0), (Tensor){0});
+        Tensor expected = create_test_tensor((TensorShape){3, 4}, w1_before, false);
+        compare_tensors(&fused.w1, &expected, op_name, tc_name, 6, EXACT_TOLERANCE);
+    }
+
+    // Test Case 3: 8-bit Adam; all five parameters are smaller than one quantization block
+    {
+        const char* tc_name = "Adam_8bit";
+        BackwardMLP fused, ref;
+        BackwardMLP_init(&fused);
+        BackwardMLP_init(&ref);
+        optim_adam* opt_fused = optim_adam_new_with_state(5, fused.params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.0f, OptimState_8bit);
+        optim_adam* opt_ref = optim_adam_new_with_state(5, ref.params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.0f, OptimState_8bit);
+
+        optim_adam_step_in_backward(opt_fused, true);
+        for(int k = 0; k < 3; k++) {
+            Tensor_backward(BackwardMLP_loss(&fused, k), (Tensor){0});
+        }
+        optim_adam_step_in_backward(opt_fused, false);
+
+        for(int k = 0; k < 3; k++) {
+            optim_adam_zerograd(opt_ref);
+            Tensor_backward(BackwardMLP_loss(&ref, k), (Tensor){0});
+            optim_adam_step(opt_ref);
+        }
+        compare_models(&fused, &ref, op_name, tc_name, 1);
+    }
+
+    // Test Case 4: 8-bit RMSProp
+    {
+        const char* tc_name = "RMSProp_8bit";
+        BackwardMLP fused, ref;
+        BackwardMLP_init(&fused);
+        BackwardMLP_init(&ref);
+        optim_rmsprop* opt_fused = optim_rmsprop_new_with_state(5, fused.params, 0.01f, 0.9f, 1e-8f, 0.0f, OptimState_8bit);
+        optim_rmsprop* opt_ref = optim_rmsprop_new_with_state(5, ref.params, 0.01f, 0.9f, 1e-8f, 0.0f, OptimState_8bit);
+
+        optim_rmsprop_step_in_backward(opt_fused, true);
+        for(int k = 0; k < 3; k++) {
+            Tensor_backward(BackwardMLP_loss(&fused, k), (Tensor){0});
+        }
+        optim_rmsprop_step_in_backward(opt_fused, false);
+
+        for(int k = 0; k < 3; k++) {
+            optim_rmsprop_zerograd(opt_ref);
+            Tensor_backward(BackwardMLP_loss(&ref, k), (Tensor){0});
+            optim_rmsprop_step(opt_ref);
+        }
+        compare_models(&fused, &ref, op_name, tc_name, 1);
+    }
+
+    cten_free(pool_id);
+}
@@ -0,0 +1,136 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Clipping configured on the optimizer must give the same parameters as clipping the gradients with
+// cten_clip_grad_* and then stepping.
+
+#define N_W 6
+#define N_B 3
+#define EXACT_TOLERANCE FLT_TRUE_MIN
+
+static float w_init[N_W] = {0.5f, -1.0f, 2.0f, 0.25f, -0.75f, 1.5f};
+static float b_init[N_B] = {0.1f, -0.2f, 0.3f};
+static float grads[2][N_W + N_B] = {
+    {2.0f, -4.0f, 0.6f, 0.1f, -3.0f, 0.8f, 0.05f, -1.5f, 2.5f},
+    {-1.0f, 3.0f, 0.2f, -5.0f, 0.4f, 0.1f, 2.0f, 0.1f, -0.3f},
+};
+
+typedef struct ClipModel {
+    Tensor w, b;
+    Tensor params[2];
+} ClipModel;
+
+static void ClipModel_init(ClipModel* self) {
+    self->w = create_test_tensor((TensorShape){2, 3}, w_init, true);
+    self->b = create_test_tensor((TensorShape){N_B}, b_init, true);
+    self->params[0] = self->w;
+    self->params[1] = self->b;
+}
+
+static void ClipModel_set_grads(ClipModel* self, const float* g) {
+    memcpy(self->w.node->grad.data->flex, g, sizeof(float) * N_W);
+    memcpy(self->b.node->grad.data->flex, g + N_W, sizeof(float) * N_B);
+}
+
+static void compare_models(ClipModel* obs, ClipModel* exp, const char* op_name, const char* tc_name, int idx) {
+    compare_tensors(&obs->w, &exp->w, op_name, tc_name, idx, EXACT_TOLERANCE);
+    compare_tensors(&obs->b, &exp->b, op_name, tc_name, idx + 1, EXACT_TOLERANCE);
+}
+
+void test_optim_clip() {
+    const char* op_name = "optim_clip";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    // Test Case 1: SGD with momentum, global norm clipping
+    {
+        const char* tc_name = "SGD_norm";
+        ClipModel fused, ref;
+        ClipModel_init(&fused);
+        ClipModel_init(&ref);
+        optim_sgd* opt_fused = optim_sgd_new(2, fused.params, 0.01f);
+        optim_sgd* opt_ref = optim_sgd_new(2, ref.params, 0.01f);
+        optim_sgd_config(opt_fused, 0.1f, 0.9f);
+        optim_sgd_config(opt_ref, 0.1f, 0.9f);
+        optim_sgd_clip_grad_norm(opt_fused, 1.0f);
+        for(int k = 0; k < 2; k++) {
+            ClipModel_set_grads(&fused, grads[k]);
+            ClipModel_set_grads(&ref, grads[k]);
+            optim_sgd_step(opt_fused);
+            cten_clip_grad_norm(ref.params, 2, 1.0f);
+            optim_sgd_step(opt_ref);
+            compare_models(&fused, &ref, op_name, tc_name, k * 2 + 1);
+        }
+    }
+
+    // Test Case 2: Adam, value clipping
+    {
+        const char* tc_name = "Adam_value";
+        ClipModel fused, ref;
+        ClipModel_init(&fused);
+        ClipModel_init(&ref);
+        optim_adam* opt_fused = optim_adam_new(2, fused.params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.0f);
+        optim_adam* opt_ref = optim_adam_new(2, ref.params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.0f);
+        optim_adam_clip_grad_value_range(opt_fused, -0.5f, 0.5f);
+        for(int k = 0; k < 2; k++) {
+            ClipModel_set_grads(&fused, grads[k]);
+            ClipModel_set_grads(&ref, grads[k]);
+            optim_adam_step(opt_fused);
+            cten_clip_grad_value(ref.params, 2, 0.5f);
+            optim_adam_step(opt_ref);
+            compare_models(&fused, &ref, op_name, tc_name, k * 2 + 1);
+        }
+    }
+
+    // Test Case 3: RMSProp, one-sided value clipping followed by norm clipping
+    {
+        const char* tc_name = "RMSProp_value_norm";
+        ClipModel fused, ref;
+        ClipModel_init(&fused);
+        ClipModel_init(&ref);
+        optim_rmsprop* opt_fused = optim_rmsprop_new(2, fused.params, 0.01f, 0.9f, 1e-8f, 0.0f);
+        optim_rmsprop* opt_ref = optim_rmsprop_new(2, ref.params, 0.01f, 0.9f, 1e-8f, 0.0f);
+        optim_rmsprop_clip_grad_value_range(opt_fused, -INFINITY, 1.0f);
+        optim_rmsprop_clip_grad_norm(opt_fused, 2.0f);
+        for(int k = 0; k < 2; k++) {
+            ClipModel_set_grads(&fused, grads[k]);
+            ClipModel_set_grads(&ref, grads[k]);
+            optim_rmsprop_step(opt_fused);
+            cten_clip_grad_positive(ref.params, 2, 1.0f);
+            cten_clip_grad_norm(ref.params, 2, 2.0f);
+            optim_rmsprop_step(opt_ref);
+            compare_models(&fused, &ref, op_name, tc_name, k * 2 + 1);
+        }
+    }
+
+    // Test Case 4: AdaGrad, norm clipping over several pre-pass blocks
+    {
+        const char* tc_name = "AdaGrad_norm_blocks";
+        enum { N = 40000 };
+        static float init[N], g[N];
+        for(int j = 0; j < N; j++) {
+            init[j] = sinf((float)j);
+            g[j] = cosf((float)j * 0.37f);
+        }
+        Tensor fused = create_test_tensor((TensorShape){N}, init, true);
+        Tensor ref = create_test_tensor((TensorShape){N}, init, true);
+        optim_adagrad* opt_fused = optim_adagrad_new(1, &fused, 0.1f, 1e-8f, 0.0f);
+        optim_adagrad* opt_ref = optim_adagrad_new(1, &ref, 0.1f, 1e-8f, 0.0f);
+        optim_adagrad_clip_grad_norm(opt_fused, 10.0f);
+        memcpy(fused.node->grad.data->flex, g, sizeof(g));
+        memcpy(ref.node->grad.data->flex, g, sizeof(g));
+        optim_adagrad_step(opt_fused);
+        cten_clip_grad_norm(&ref, 1, 10.0f);
+        optim_adagrad_step(opt_ref);
+        // the blocked sum rounds differently from a single running sum
+        compare_tensors(&fused, &ref, op_name, tc_name, 1, TEST_FLOAT_TOLERANCE);
+    }
+
+    cten_free(pool_id);
+}
@@ -0,0 +1,106 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// LARS and LAMB scale each tensor's step by its own trust ratio; the references below compute the norms
+// and updates tensor by tensor in plain loops.
+
+#define N_W 6
+#define N_B 3
+
+static float w_init[N_W] = {0.5f, -1.0f, 2.0f, 0.25f, -0.75f, 1.5f};
+static float b_init[N_B] = {0.1f, -0.2f, 0.3f};
+static float grads[2][N_W + N_B] = {
+    {2.0f, -4.0f, 0.6f, 0.1f, -3.0f, 0.8f, 0.05f, -1.5f, 2.5f},
+    {-1.0f, 3.0f, 0.2f, -5.0f, 0.4f, 0.1f, 2.0f, 0.1f, -0.3f},
+};
+
+static float norm(const float* x, int n) {
+    float sum = 0.0f;
+    for(int j = 0; j < n; j++) sum += x[j] * x[j];
+    return sqrtf(sum);
+}
+
+static void lars_reference(float* p, const float* g, float* v, int n, float lr, float momentum, float wd, float eta) {
+    float p_norm = norm(p, n), g_norm = norm(g, n);
+    float trust = p_norm > 0.0f && g_norm + wd * p_norm > 0.0f ? eta * p_norm / (g_norm + wd * p_norm) : 1.0f;
+    for(int j = 0; j < n; j++) {
+        v[j] = momentum * v[j] + trust * (g[j] + wd * p[j]);
+        p[j] -= lr * v[j];
+    }
+}
+
+static void lamb_reference(float* p, const float* g, float* m, float* v, int n, int t, float lr, float β1, float β2,
+                           float ε, float wd) {
+    float r[N_W];
+    for(int j = 0; j < n; j++) {
+        m[j] = β1 * m[j] + (1 - β1) * g[j];
+        v[j] = β2 * v[j] + (1 - β2) * g[j] * g[j];
+        r[j] = (m[j] / (1 - powf(β1, t))) / (sqrtf(v[j] / (1 - powf(β2, t))) + ε) + wd * p[j];
+    }
+    float p_norm = norm(p, n), r_norm = norm(r, n);
+    float trust = p_norm > 0.0f && r_norm > 0.0f ? p_norm / r_norm : 1.0f;
+    for(int j = 0; j < n; j++) p[j] -= lr * trust * r[j];
+}
+
+static void set_grads(Tensor* params, const float* g) {
+    memcpy(params[0].node->grad.data->flex, g, sizeof(float) * N_W);
+    memcpy(params[1].node->grad.data->flex, g + N_W, sizeof(float) * N_B);
+}
+
+void test_optim_layerwise() {
+    const char* op_name = "optim_layerwise";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    // Test Case 1: LARS with momentum and weight decay
+    {
+        const char* tc_name = "LARS";
+        Tensor params[2] = {create_test_tensor((TensorShape){2, 3}, w_init, true),
+                            create_test_tensor((TensorShape){N_B}, b_init, true)};
+        optim_sgd* opt = optim_lars_new(2, params, 0.01f, 0.02f);
+        optim_sgd_config(opt, 0.5f, 0.9f);
+
+        float w[N_W], b[N_B], vw[N_W] = {0}, vb[N_B] = {0};
+        memcpy(w, w_init, sizeof(w));
+        memcpy(b, b_init, sizeof(b));
+        for(int k = 0; k < 2; k++) {
+            set_grads(params, grads[k]);
+            optim_sgd_step(opt);
+            lars_reference(w, grads[k], vw, N_W, 0.5f, 0.9f, 0.01f, 0.02f);
+            lars_reference(b, grads[k] + N_W, vb, N_B, 0.5f, 0.9f, 0.01f, 0.02f);
+            Tensor exp_w = create_test_tensor((TensorShape){2, 3}, w, false);
+            Tensor exp_b = create_test_tensor((TensorShape){N_B}, b, false);
+            compare_tensors(&params[0], &exp_w, op_name, tc_name, k * 2 + 1, TEST_FLOAT_TOLERANCE);
+            compare_tensors(&params[1], &exp_b, op_name, tc_name, k * 2 + 2, TEST_FLOAT_TOLERANCE);
+        }
+    }
+
+    // Test Case 2: LAMB with weight decay
+    {
+        const char* tc_name = "LAMB";
+        Tensor params[2] = {create_test_tensor((TensorShape){2, 3}, w_init, true),
+                            create_test_tensor((TensorShape){N_B}, b_init, true)};
+        optim_adam* opt = optim_lamb_new(2, params, 0.05f, 0.9f, 0.999f, 1e-6f, 0.01f);
+
+        float w[N_W], b[N_B], mw[N_W] = {0}, vw[N_W] = {0}, mb[N_B] = {0}, vb[N_B] = {0};
+        memcpy(w, w_init, sizeof(w));
+        memcpy(b, b_init, sizeof(b));
+        for(int k = 0; k < 2; k++) {
+            set_grads(params, grads[k]);
+            optim_adam_step(opt);
+            lamb_reference(w, grads[k], mw, vw, N_W, k + 1, 0.05f, 0.9f, 0.999f, 1e-6f, 0.01f);
+            lamb_reference(b, grads[k] + N_W, mb, vb, N_B, k + 1, 0.05f, 0.9f, 0.999f, 1e-6f, 0.01f);
+            Tensor exp_w = create_test_tensor((TensorShape){2, 3}, w, false);
+            Tensor exp_b = create_test_tensor((TensorShape){N_B}, b, false);
+            compare_tensors(&params[0], &exp_w, op_name, tc_name, k * 2 + 1, TEST_FLOAT_TOLERANCE);
+            compare_tensors(&params[1], &exp_b, op_name, tc_name, k * 2 + 2, TEST_FLOAT_TOLERANCE);
+        }
+    }
+
+    cten_free(pool_id);
+}
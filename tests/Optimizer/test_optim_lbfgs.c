@@ -0,0 +1,103 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// L-BFGS must fit a realizable least-squares problem and a small classifier within its evaluation budget.
+
+#define N_SAMPLES 24
+#define N_IN 4
+#define N_OUT 3
+#define SCRATCH_POOL 5
+
+static float X_data[N_SAMPLES * N_IN];
+static float Y_data[N_SAMPLES * N_OUT];
+static float w_true[N_IN * N_OUT];
+static float b_true[N_OUT] = {0.5f, -0.25f, 1.0f};
+
+typedef struct {
+    Tensor w, b;
+    Tensor params[2];
+    bool classify;
+} LBFGSModel;
+
+static void LBFGSModel_init(LBFGSModel* self, bool classify) {
+    float w[N_IN * N_OUT] = {0}, b[N_OUT] = {0};
+    self->w = create_test_tensor((TensorShape){N_IN, N_OUT}, w, true);
+    self->b = create_test_tensor((TensorShape){1, N_OUT}, b, true);
+    self->params[0] = self->w;
+    self->params[1] = self->b;
+    self->classify = classify;
+}
+
+static Tensor LBFGSModel_loss(void* ctx) {
+    LBFGSModel* self = ctx;
+    Tensor x = create_test_tensor((TensorShape){N_SAMPLES, N_IN}, X_data, false);
+    Tensor y = create_test_tensor((TensorShape){N_SAMPLES, N_OUT}, Y_data, false);
+    Tensor out = nn_linear(x, self->w, self->b);
+    return self->classify ? nn_softmax_crossentropy(y, out) : nn_mse_loss(y, out);
+}
+
+void test_optim_lbfgs() {
+    const char* op_name = "optim_lbfgs";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+    // pseudo-random features in [-1, 1]: full column rank, unlike a single sinusoid
+    for(int i = 0; i < N_SAMPLES * N_IN; i++) X_data[i] = (float)((i * 7919 + 13) % 101) / 50.0f - 1.0f;
+    for(int i = 0; i < N_IN * N_OUT; i++) w_true[i] = cosf(0.9f * i);
+
+    // Test Case 1: least squares with an exact solution, recovered by a single step
+    {
+        const char* tc_name = "Least_squares";
+        for(int n = 0; n < N_SAMPLES; n++) {
+            for(int o = 0; o < N_OUT; o++) {
+                float y = b_true[o];
+                for(int k = 0; k < N_IN; k++) y += X_data[n * N_IN + k] * w_true[k * N_OUT + o];
+                Y_data[n * N_OUT + o] = y;
+            }
+        }
+        LBFGSModel model;
+        LBFGSModel_init(&model, false);
+        optim_lbfgs* opt = optim_lbfgs_new(2, model.params, 1.0f, 40, 10);
+        optim_lbfgs_step(opt, LBFGSModel_loss, &model, SCRATCH_POOL);
+
+        Tensor exp_w = create_test_tensor((TensorShape){N_IN, N_OUT}, w_true, false);
+        Tensor exp_b = create_test_tensor((TensorShape){1, N_OUT}, b_true, false);
+        compare_tensors(&model.w, &exp_w, op_name, tc_name, 1, 1e-3f);
+        compare_tensors(&model.b, &exp_b, op_name, tc_name, 2, 1e-3f);
+        // max_eval is 1.25 * max_iter
+        int evals = optim_lbfgs_func_evals(opt);
+        csv_reporter_record_result(op_name, tc_name, 3, evals <= 50 ? "/" : "func_evals/" PLATFORM_NAME);
+    }
+
+    // Test Case 2: softmax classifier, the loss never increases from one step to the next
+    {
+        const char* tc_name = "Classifier";
+        memset(Y_data, 0, sizeof(Y_data));
+        for(int n = 0; n < N_SAMPLES; n++) {
+            int best = 0;
+            for(int o = 1; o < N_OUT; o++) {
+                if(X_data[n * N_IN + o] > X_data[n * N_IN + best]) best = o;
+            }
+            Y_data[n * N_OUT + best] = 1.0f;
+        }
+        LBFGSModel model;
+        LBFGSModel_init(&model, true);
+        optim_lbfgs* opt = optim_lbfgs_new(2, model.params, 1.0f, 5, 4);
+        float initial = logf((float)N_OUT), prev = initial;
+        bool monotone = true;
+        for(int k = 0; k < 4; k++) {
+            float loss = optim_lbfgs_step(opt, LBFGSModel_loss, &model, SCRATCH_POOL);
+            monotone = monotone && loss <= prev;
+            prev = loss;
+        }
+        char detail[96];
+        snprintf(detail, sizeof(detail), "initial=%g final=%g/" PLATFORM_NAME, initial, prev);
+        csv_reporter_record_result(op_name, tc_name, 1, monotone && prev < 0.25f * initial ? "/" : detail);
+    }
+
+    cten_free(pool_id);
+}
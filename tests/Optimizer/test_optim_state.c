@@ -0,0 +1,147 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Compact optimizer states must use less memory and still converge like the fp32 state.
+
+#define N_IN 16
+#define N_OUT 8
+#define N_SAMPLES 32
+
+static float X_data[N_SAMPLES * N_IN];
+static float Y_data[N_SAMPLES * N_OUT];
+
+// a linear teacher the student layer has to fit
+static void make_regression() {
+    for(int i = 0; i < N_SAMPLES * N_IN; i++) X_data[i] = sinf(0.7f * i + 0.3f);
+    for(int n = 0; n < N_SAMPLES; n++) {
+        for(int o = 0; o < N_OUT; o++) {
+            float y = 0.1f * o;
+            for(int k = 0; k < N_IN; k++) y += X_data[n * N_IN + k] * cosf(0.37f * (k * N_OUT + o));
+            Y_data[n * N_OUT + o] = y;
+        }
+    }
+}
+
+typedef struct {
+    Tensor w, b;
+    Tensor params[2];
+} Layer;
+
+static void Layer_init(Layer* self) {
+    float w[N_IN * N_OUT], b[N_OUT] = {0};
+    for(int i = 0; i < N_IN * N_OUT; i++) w[i] = 0.05f * sinf(1.3f * i);
+    self->w = create_test_tensor((TensorShape){N_IN, N_OUT}, w, true);
+    self->b = create_test_tensor((TensorShape){1, N_OUT}, b, true);
+    self->params[0] = self->w;
+    self->params[1] = self->b;
+}
+
+static float Layer_loss(Layer* self, bool backward) {
+    Tensor x = create_test_tensor((TensorShape){N_SAMPLES, N_IN}, X_data, false);
+    Tensor y = create_test_tensor((TensorShape){N_SAMPLES, N_OUT}, Y_data, false);
+    Tensor loss = nn_mse_loss(y, nn_linear(x, self->w, self->b));
+    if(backward) Tensor_backward(loss, (Tensor){0});
+    return loss.data->flex[0];
+}
+
+static float train_adam(OptimState state, int n_steps, size_t* state_bytes) {
+    Layer layer;
+    Layer_init(&layer);
+    optim_adam* opt = optim_adam_new_with_state(2, layer.params, 0.02f, 0.9f, 0.999f, 1e-8f, 0.0f, state);
+    for(int k = 0; k < n_steps; k++) {
+        optim_adam_zerograd(opt);
+        Layer_loss(&layer, true);
+        optim_adam_step(opt);
+    }
+    *state_bytes = optim_adam_state_bytes(opt);
+    return Layer_loss(&layer, false);
+}
+
+static float train_rmsprop(OptimState state, int n_steps, size_t* state_bytes) {
+    Layer layer;
+    Layer_init(&layer);
+    optim_rmsprop* opt = optim_rmsprop_new_with_state(2, layer.params, 0.005f, 0.99f, 1e-8f, 0.0f, state);
+    for(int k = 0; k < n_steps; k++) {
+        optim_rmsprop_zerograd(opt);
+        Layer_loss(&layer, true);
+        optim_rmsprop_step(opt);
+    }
+    *state_bytes = optim_rmsprop_state_bytes(opt);
+    return Layer_loss(&layer, false);
+}
+
+static void check_convergence(const char* op_name, const char* tc_name, float initial, float fp32, float lean) {
+    char detail[128];
+    // both must learn the teacher, and the compact state may cost at most a small fraction of the initial loss
+    bool ok = fp32 < 0.005f * initial && lean < 0.005f * initial && fabsf(lean - fp32) < 0.002f * initial;
+    snprintf(detail, sizeof(detail), "initial=%g fp32=%g lean=%g/" PLATFORM_NAME, initial, fp32, lean);
+    csv_reporter_record_result(op_name, tc_name, 1, ok ? "/" : detail);
+}
+
+void test_optim_state() {
+    const char* op_name = "optim_state";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+    make_regression();
+
+    Layer probe;
+    Layer_init(&probe);
+    float initial = Layer_loss(&probe, false);
+
+    // w {16, 8} and b {1, 8}, each padded to 16 floats in the arena: 128 + 16 = 144 state floats
+    const int numel = 144;
+
+    // Test Case 1: Adam, factored second moment of the weight matrix
+    {
+        const char* tc_name = "Adam_factored";
+        size_t fp32_bytes, lean_bytes;
+        float fp32 = train_adam(OptimState_fp32, 200, &fp32_bytes);
+        float lean = train_adam(OptimState_factored, 200, &lean_bytes);
+        check_convergence(op_name, tc_name, initial, fp32, lean);
+        // m in full, v as 16 + 8 row/column averages for w and the full 8 for b
+        bool bytes_ok = fp32_bytes == 2 * 4 * numel && lean_bytes == 4 * (numel + 16 + 8 + 8);
+        csv_reporter_record_result(op_name, tc_name, 2, bytes_ok ? "/" : "state_bytes/" PLATFORM_NAME);
+    }
+
+    // Test Case 2: Adam, 8-bit blocks
+    {
+        const char* tc_name = "Adam_8bit";
+        size_t fp32_bytes, lean_bytes;
+        float fp32 = train_adam(OptimState_fp32, 200, &fp32_bytes);
+        float lean = train_adam(OptimState_8bit, 200, &lean_bytes);
+        check_convergence(op_name, tc_name, initial, fp32, lean);
+        // one byte per element and one fp32 scale per 256-element block, for m and for v; each parameter's
+        // state is padded to a whole block, so w and b take one block each
+        bool bytes_ok = lean_bytes == 2 * 2 * (256 + 4) && lean_bytes < fp32_bytes;
+        csv_reporter_record_result(op_name, tc_name, 2, bytes_ok ? "/" : "state_bytes/" PLATFORM_NAME);
+    }
+
+    // Test Case 3: RMSProp, factored
+    {
+        const char* tc_name = "RMSProp_factored";
+        size_t fp32_bytes, lean_bytes;
+        float fp32 = train_rmsprop(OptimState_fp32, 300, &fp32_bytes);
+        float lean = train_rmsprop(OptimState_factored, 300, &lean_bytes);
+        check_convergence(op_name, tc_name, initial, fp32, lean);
+        bool bytes_ok = fp32_bytes == 4 * numel && lean_bytes == 4 * (16 + 8 + 8);
+        csv_reporter_record_result(op_name, tc_name, 2, bytes_ok ? "/" : "state_bytes/" PLATFORM_NAME);
+    }
+
+    // Test Case 4: RMSProp, 8-bit
+    {
+        const char* tc_name = "RMSProp_8bit";
+        size_t fp32_bytes, lean_bytes;
+        float fp32 = train_rmsprop(OptimState_fp32, 300, &fp32_bytes);
+        float lean = train_rmsprop(OptimState_8bit, 300, &lean_bytes);
+        check_convergence(op_name, tc_name, initial, fp32, lean);
+        bool bytes_ok = lean_bytes == 2 * (256 + 4) && lean_bytes < fp32_bytes;
+        csv_reporter_record_result(op_name, tc_name, 2, bytes_ok ? "/" : "state_bytes/" PLATFORM_NAME);
+    }
+
+    cten_free(pool_id);
+}
@@ -0,0 +1,101 @@
+#include "../../include/cten.h"
+#include "../test_utils.h"
+#include "../csv_reporter.h"
+#include "../test_config.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Every optimizer splits its step into per-thread shards of the flat arena; the result must match the
+// single-threaded step bit for bit. The threaded optimizers are also created under the thread pool, so
+// their buffers go through the sharded first-touch initialization.
+
+#define N_THREADS 4
+#define EXACT_TOLERANCE FLT_TRUE_MIN
+
+// sizes that do not line up with the shard boundaries
+static const int sizes[3] = {3001, 37, 2050};
+
+typedef struct {
+    Tensor params[3];
+} ShardModel;
+
+static void ShardModel_init(ShardModel* self) {
+    static float data[3001];
+    for(int i = 0; i < 3; i++) {
+        for(int j = 0; j < sizes[i]; j++) data[j] = sinf(0.31f * j + i);
+        self->params[i] = create_test_tensor((TensorShape){sizes[i]}, data, true);
+    }
+}
+
+static void ShardModel_set_grads(ShardModel* self, int k) {
+    for(int i = 0; i < 3; i++) {
+        float* g = self->params[i].node->grad.data->flex;
+        for(int j = 0; j < sizes[i]; j++) g[j] = cosf(0.17f * j * (k + 1) + i);
+    }
+}
+
+static void compare_models(ShardModel* threaded, ShardModel* serial, const char* op_name, const char* tc_name) {
+    for(int i = 0; i < 3; i++) {
+        compare_tensors(&threaded->params[i], &serial->params[i], op_name, tc_name, i + 1, EXACT_TOLERANCE);
+    }
+}
+
+typedef enum { Optim_SGD, Optim_AdaGrad, Optim_RMSProp, Optim_Adam, Optim_Adam8bit } OptimKind;
+
+static void* make_optimizer(OptimKind kind, ShardModel* m) {
+    switch(kind) {
+        case Optim_SGD: {
+            optim_sgd* opt = optim_sgd_new(3, m->params, 0.01f);
+            optim_sgd_config(opt, 0.05f, 0.9f);
+            optim_sgd_clip_grad_norm(opt, 5.0f);
+            return opt;
+        }
+        case Optim_AdaGrad: return optim_adagrad_new(3, m->params, 0.1f, 1e-8f, 0.01f);
+        case Optim_RMSProp: return optim_rmsprop_new(3, m->params, 0.01f, 0.9f, 1e-8f, 0.01f);
+        case Optim_Adam: return optim_adamw_new(3, m->params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.01f);
+        case Optim_Adam8bit:
+            return optim_adam_new_with_state(3, m->params, 0.01f, 0.9f, 0.999f, 1e-8f, 0.0f, OptimState_8bit);
+    }
+    return NULL;
+}
+
+static void step_optimizer(OptimKind kind, void* opt) {
+    switch(kind) {
+        case Optim_SGD: optim_sgd_step(opt); break;
+        case Optim_AdaGrad: optim_adagrad_step(opt); break;
+        case Optim_RMSProp: optim_rmsprop_step(opt); break;
+        case Optim_Adam:
+        case Optim_Adam8bit: optim_adam_step(opt); break;
+    }
+}
+
+void test_optim_threads() {
+    const char* op_name = "optim_threads";
+    PoolId pool_id = 0;
+    cten_begin_malloc(pool_id);
+
+    const char* tc_names[] = {"SGD_momentum_clip", "AdaGrad", "RMSProp", "AdamW", "Adam_8bit"};
+    for(int kind = Optim_SGD; kind <= Optim_Adam8bit; kind++) {
+        ShardModel serial, threaded;
+        ShardModel_init(&serial);
+        ShardModel_init(&threaded);
+        void* opt_serial = make_optimizer(kind, &serial);
+        cten_set_num_threads(N_THREADS);
+        void* opt_threaded = make_optimizer(kind, &threaded);
+        cten_set_num_threads(1);
+
+        for(int k = 0; k < 3; k++) {
+            ShardModel_set_grads(&serial, k);
+            ShardModel_set_grads(&threaded, k);
+            step_optimizer(kind, opt_serial);
+            cten_set_num_threads(N_THREADS);
+            step_optimizer(kind, opt_threaded);
+            cten_set_num_threads(1);
+        }
+        compare_models(&threaded, &serial, op_name, tc_names[kind]);
+    }
+
+    cten_free(pool_id);
+}
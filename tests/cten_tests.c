@@ -29,6 +29,7 @@ void test_max_operator();
 void test_min_operator();
 void test_abs_operator();
 void test_softmax_operator();
+void test_from_buffer_operator();
 
 // Backward tests
 void test_add_backward();
@@ -45,6 +46,31 @@ void test_div_backward();
 void test_pow_backward();
 void test_abs_backward();
 void test_softmax_backward();
+void test_elu_backward();
+
+// Graph tests
+void test_graph_capture();
+void test_graph_training();
+void test_graph_memory();
+
+// Optimizer tests
+void test_optim_arena();
+void test_optim_clip();
+void test_optim_backward();
+void test_optim_state();
+void test_optim_layerwise();
+void test_optim_accumulate();
+void test_optim_threads();
+void test_optim_lbfgs();
+
+// File format tests
+void test_save_load();
+void test_checkpoint();
+void test_csv();
+void test_dataset();
+void test_dataloader();
+void test_feature_stats();
+void test_npy();
 
 int main() {
     printf("Starting cTensor Test Suite on %s...\n", PLATFORM_NAME);
@@ -120,6 +146,9 @@ int main() {
     test_softmax_operator();
     printf("Softmax operator tests finished.\n");
 
+    test_from_buffer_operator();
+    printf("Buffer view tests finished.\n");
+
     // Backward tests
     test_add_backward();
     printf("Add backward tests finished.\n");
@@ -162,7 +191,66 @@ int main() {
     
     test_softmax_backward();
     printf("Softmax backward tests finished.\n");
+
+    test_elu_backward();
+    printf("ELU backward tests finished.\n");
     
+    // Graph tests
+    test_graph_capture();
+    printf("Graph capture tests finished.\n");
+
+    test_graph_training();
+    printf("Graph training tests finished.\n");
+
+    test_graph_memory();
+    printf("Graph memory tests finished.\n");
+
+    // Optimizer tests
+    test_optim_arena();
+    printf("Optimizer arena tests finished.\n");
+
+    test_optim_clip();
+    printf("Optimizer clip tests finished.\n");
+
+    test_optim_backward();
+    printf("Optimizer step-in-backward tests finished.\n");
+
+    test_optim_state();
+    printf("Optimizer state tests finished.\n");
+
+    test_optim_layerwise();
+    printf("Optimizer layer-wise (LARS/LAMB) tests finished.\n");
+
+    test_optim_accumulate();
+    printf("Gradient accumulation tests finished.\n");
+
+    test_optim_threads();
+    printf("Optimizer thread-sharding tests finished.\n");
+
+    test_optim_lbfgs();
+    printf("L-BFGS tests finished.\n");
+
+    test_save_load();
+    printf("Save/load tests finished.\n");
+
+    test_checkpoint();
+    printf("Checkpoint tests finished.\n");
+
+    test_csv();
+    printf("CSV dataset tests finished.\n");
+
+    test_dataset();
+    printf("Binary dataset tests finished.\n");
+
+    test_dataloader();
+    printf("Data loader tests finished.\n");
+
+    test_feature_stats();
+    printf("Feature statistics tests finished.\n");
+
+    test_npy();
+    printf("NumPy interop tests finished.\n");
+
     // other tests
     
     csv_reporter_close();